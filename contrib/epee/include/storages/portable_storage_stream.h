@@ -0,0 +1,703 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "misc_log_ex.h"
+#include "portable_storage_base.h"
+#include "portable_storage_to_bin.h"
+#include "portable_storage_from_bin.h"
+#include "portable_storage_val_converters.h"
+
+namespace epee
+{
+  namespace serialization
+  {
+    template<class t_type> struct portable_storage_type_code;
+    template<> struct portable_storage_type_code<int64_t>     { static const uint8_t value = SERIALIZE_TYPE_INT64; };
+    template<> struct portable_storage_type_code<int32_t>     { static const uint8_t value = SERIALIZE_TYPE_INT32; };
+    template<> struct portable_storage_type_code<int16_t>     { static const uint8_t value = SERIALIZE_TYPE_INT16; };
+    template<> struct portable_storage_type_code<int8_t>      { static const uint8_t value = SERIALIZE_TYPE_INT8; };
+    template<> struct portable_storage_type_code<uint64_t>    { static const uint8_t value = SERIALIZE_TYPE_UINT64; };
+    template<> struct portable_storage_type_code<uint32_t>    { static const uint8_t value = SERIALIZE_TYPE_UINT32; };
+    template<> struct portable_storage_type_code<uint16_t>    { static const uint8_t value = SERIALIZE_TYPE_UINT16; };
+    template<> struct portable_storage_type_code<uint8_t>     { static const uint8_t value = SERIALIZE_TYPE_UINT8; };
+    template<> struct portable_storage_type_code<double>      { static const uint8_t value = SERIALIZE_TYPE_DUOBLE; };
+    template<> struct portable_storage_type_code<bool>        { static const uint8_t value = SERIALIZE_TYPE_BOOL; };
+    template<> struct portable_storage_type_code<std::string> { static const uint8_t value = SERIALIZE_TYPE_STRING; };
+
+    /************************************************************************/
+    /* portable_storage_writer                                              */
+    /*                                                                      */
+    /* Writes the portable storage binary format directly from the          */
+    /* KV_SERIALIZE maps, without building a section tree first. It has the */
+    /* storing half of portable_storage's interface, so any struct with a   */
+    /* KV_SERIALIZE map can be stored to it.                                */
+    /*                                                                      */
+    /* Entries are written in the order they are stored rather than sorted  */
+    /* by name; readers look entries up by name, so the output is read the  */
+    /* same way by both portable_storage and portable_storage_reader.       */
+    /* Element and entry counts are not known up front: a one byte          */
+    /* placeholder is written and patched (and widened if needed) once the  */
+    /* section or array is complete, which is when an entry is stored       */
+    /* through a handle further up the tree, or on store_to_binary.         */
+    /************************************************************************/
+    class portable_storage_writer
+    {
+    public:
+      struct frame
+      {
+        size_t count_offset; //offset of the count placeholder in the buffer
+        size_t count;
+        size_t depth;
+        uint8_t type;        //SERIALIZE_TYPE_OBJECT for sections, element type|SERIALIZE_FLAG_ARRAY for arrays
+      };
+      typedef frame* hsection;
+      typedef frame* harray;
+      typedef storage_entry meta_entry;
+
+      portable_storage_writer();
+
+      hsection  open_section(const char* section_name, hsection hparent_section, bool create_if_notexist = true);
+      template<class t_value>
+      bool      set_value(const char* value_name, const t_value& v, hsection hparent_section);
+      bool      set_value(const char* value_name, const storage_entry& v, hsection hparent_section);
+
+      //serial access for arrays of values --------------------------------------
+      template<class t_value>
+      harray    insert_first_value(const char* value_name, const t_value& v, hsection hparent_section);
+      template<class t_value>
+      bool      insert_next_value(harray hval_array, const t_value& v);
+      harray    insert_first_section(const char* section_name, hsection& hinserted_childsection, hsection hparent_section);
+      bool      insert_next_section(harray hsec_array, hsection& hinserted_childsection);
+
+      //-------------------------------------------------------------------------------
+      //moves the stored data to target, and leaves the writer empty
+      bool      store_to_binary(binarybuffer& target);
+
+    private:
+      struct string_stream
+      {
+        std::string& m_buffer;
+        void write(const char* data, size_t size) { m_buffer.append(data, size); }
+      };
+
+      void      reset();
+      frame*    push_frame(uint8_t type);
+      void      pop_frame();
+      frame*    get_section(hsection hsec);
+      frame*    get_array(harray harr, uint8_t type);
+      void      put_name(const char* name, hsection hparent_section);
+      template<class t_pod_type>
+      void      put_value(const t_pod_type& v) { m_buffer.append((const char*)&v, sizeof(v)); }
+      void      put_value(const std::string& v);
+
+      std::string m_buffer;
+      frame m_frames[EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL];
+      size_t m_depth;
+      bool m_error;
+    };
+
+#define PORTABLE_STORAGE_WRITER_CHECK(expr, message) do { if(!(expr)) { m_error = true; ASSERT_MES_AND_THROW(message); } } while(0)
+
+    inline
+    portable_storage_writer::portable_storage_writer()
+    {
+      reset();
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_writer::reset()
+    {
+      const uint32_t signature_a = PORTABLE_STORAGE_SIGNATUREA;
+      const uint32_t signature_b = PORTABLE_STORAGE_SIGNATUREB;
+      const uint8_t ver = PORTABLE_STORAGE_FORMAT_VER;
+      m_buffer.clear();
+      m_buffer.append((const char*)&signature_a, sizeof(signature_a));
+      m_buffer.append((const char*)&signature_b, sizeof(signature_b));
+      m_buffer.append((const char*)&ver, sizeof(ver));
+      m_depth = 0;
+      m_error = false;
+      push_frame(SERIALIZE_TYPE_OBJECT);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_writer::frame* portable_storage_writer::push_frame(uint8_t type)
+    {
+      PORTABLE_STORAGE_WRITER_CHECK(m_depth < EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL, "portable_storage_writer: recursion limitation (" << EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL << ") exceeded");
+      frame& f = m_frames[m_depth];
+      f.count_offset = m_buffer.size();
+      f.count = 0;
+      f.depth = m_depth;
+      f.type = type;
+      ++m_depth;
+      m_buffer.push_back(0);
+      return &f;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_writer::pop_frame()
+    {
+      const frame& f = m_frames[--m_depth];
+      if(f.count <= 63)
+      {
+        m_buffer[f.count_offset] = static_cast<char>(f.count << 2);
+        return;
+      }
+      std::string count;
+      string_stream strm{count};
+      pack_varint(strm, f.count);
+      m_buffer.replace(f.count_offset, 1, count);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_writer::frame* portable_storage_writer::get_section(hsection hsec)
+    {
+      frame* f = hsec ? hsec : &m_frames[0];
+      PORTABLE_STORAGE_WRITER_CHECK(f->depth < m_depth && f == &m_frames[f->depth] && f->type == SERIALIZE_TYPE_OBJECT, "portable_storage_writer: invalid section handle");
+      //everything nested deeper than this section is complete now
+      while(m_depth > f->depth + 1)
+        pop_frame();
+      return f;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_writer::frame* portable_storage_writer::get_array(harray harr, uint8_t type)
+    {
+      PORTABLE_STORAGE_WRITER_CHECK(harr && harr->depth < m_depth && harr == &m_frames[harr->depth], "portable_storage_writer: invalid array handle");
+      PORTABLE_STORAGE_WRITER_CHECK(harr->type == (type | SERIALIZE_FLAG_ARRAY), "portable_storage_writer: unexpected type " << (unsigned)type << " in array of type " << (unsigned)harr->type);
+      while(m_depth > harr->depth + 1)
+        pop_frame();
+      return harr;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_writer::put_name(const char* name, hsection hparent_section)
+    {
+      frame* parent = get_section(hparent_section);
+      const size_t len = strlen(name);
+      PORTABLE_STORAGE_WRITER_CHECK(len < std::numeric_limits<uint8_t>::max(), "storage_entry_name is too long: " << len << ", val: " << name);
+      ++parent->count;
+      m_buffer.push_back(static_cast<char>(len));
+      m_buffer.append(name, len);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_writer::put_value(const std::string& v)
+    {
+      string_stream strm{m_buffer};
+      put_string(strm, v);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_writer::hsection portable_storage_writer::open_section(const char* section_name, hsection hparent_section, bool create_if_notexist)
+    {
+      TRY_ENTRY();
+      CHECK_AND_ASSERT_MES(create_if_notexist, nullptr, "portable_storage_writer can only create sections");
+      put_name(section_name, hparent_section);
+      m_buffer.push_back(SERIALIZE_TYPE_OBJECT);
+      return push_frame(SERIALIZE_TYPE_OBJECT);
+      CATCH_ENTRY("portable_storage_writer::open_section", nullptr);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    bool portable_storage_writer::set_value(const char* value_name, const t_value& v, hsection hparent_section)
+    {
+      TRY_ENTRY();
+      put_name(value_name, hparent_section);
+      m_buffer.push_back(portable_storage_type_code<t_value>::value);
+      put_value(v);
+      return true;
+      CATCH_ENTRY("portable_storage_writer::set_value", false);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_writer::set_value(const char* value_name, const storage_entry& v, hsection hparent_section)
+    {
+      TRY_ENTRY();
+      put_name(value_name, hparent_section);
+      string_stream strm{m_buffer};
+      return pack_entry_to_buff(strm, v);
+      CATCH_ENTRY("portable_storage_writer::set_value", false);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    portable_storage_writer::harray portable_storage_writer::insert_first_value(const char* value_name, const t_value& v, hsection hparent_section)
+    {
+      TRY_ENTRY();
+      const uint8_t type = portable_storage_type_code<t_value>::value | SERIALIZE_FLAG_ARRAY;
+      put_name(value_name, hparent_section);
+      m_buffer.push_back(type);
+      frame* harr = push_frame(type);
+      put_value(v);
+      harr->count = 1;
+      return harr;
+      CATCH_ENTRY("portable_storage_writer::insert_first_value", nullptr);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    bool portable_storage_writer::insert_next_value(harray hval_array, const t_value& v)
+    {
+      TRY_ENTRY();
+      frame* harr = get_array(hval_array, portable_storage_type_code<t_value>::value);
+      put_value(v);
+      ++harr->count;
+      return true;
+      CATCH_ENTRY("portable_storage_writer::insert_next_value", false);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_writer::harray portable_storage_writer::insert_first_section(const char* section_name, hsection& hinserted_childsection, hsection hparent_section)
+    {
+      TRY_ENTRY();
+      put_name(section_name, hparent_section);
+      m_buffer.push_back(SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY);
+      frame* harr = push_frame(SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY);
+      hinserted_childsection = push_frame(SERIALIZE_TYPE_OBJECT);
+      harr->count = 1;
+      return harr;
+      CATCH_ENTRY("portable_storage_writer::insert_first_section", nullptr);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_writer::insert_next_section(harray hsec_array, hsection& hinserted_childsection)
+    {
+      TRY_ENTRY();
+      frame* harr = get_array(hsec_array, SERIALIZE_TYPE_OBJECT);
+      hinserted_childsection = push_frame(SERIALIZE_TYPE_OBJECT);
+      ++harr->count;
+      return true;
+      CATCH_ENTRY("portable_storage_writer::insert_next_section", false);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_writer::store_to_binary(binarybuffer& target)
+    {
+      TRY_ENTRY();
+      if(m_error)
+      {
+        LOG_ERROR("portable_storage_writer: failed to store some of the entries");
+        reset();
+        return false;
+      }
+      while(m_depth)
+        pop_frame();
+      target = std::move(m_buffer);
+      reset();
+      return true;
+      CATCH_ENTRY("portable_storage_writer::store_to_binary", false);
+    }
+
+#undef PORTABLE_STORAGE_WRITER_CHECK
+
+    /************************************************************************/
+    /* portable_storage_reader                                              */
+    /*                                                                      */
+    /* Reads the portable storage binary format straight into the           */
+    /* KV_SERIALIZE maps. Instead of a tree of maps, lists and variants,    */
+    /* load_from_binary indexes the buffer in a single pass into a flat     */
+    /* vector of entries pointing into the source buffer, and values are    */
+    /* only decoded when the struct being loaded asks for them. The source  */
+    /* buffer must outlive the reader.                                      */
+    /*                                                                      */
+    /* Arrays of arrays are not supported, as with portable_storage.        */
+    /************************************************************************/
+    class portable_storage_reader
+    {
+    public:
+      struct entry
+      {
+        const char* name;
+        const uint8_t* raw;  //type byte of a named entry, for meta_entry reads
+        const uint8_t* data; //value, string data, or first element of a pod array
+        size_t count;        //string length, or number of section entries or array elements
+        size_t end;          //index one past the last entry nested in this one
+        size_t next;         //array iteration cursor
+        uint8_t name_size;
+        uint8_t type;
+      };
+      typedef entry* hsection;
+      typedef entry* harray;
+      typedef storage_entry meta_entry;
+
+      hsection  open_section(const char* section_name, hsection hparent_section, bool create_if_notexist = false);
+      template<class t_value>
+      bool      get_value(const char* value_name, t_value& val, hsection hparent_section);
+      bool      get_value(const char* value_name, storage_entry& val, hsection hparent_section);
+
+      //serial access for arrays of values --------------------------------------
+      template<class t_value>
+      harray    get_first_value(const char* value_name, t_value& target, hsection hparent_section);
+      template<class t_value>
+      bool      get_next_value(harray hval_array, t_value& target);
+      harray    get_first_section(const char* section_name, hsection& h_child_section, hsection hparent_section);
+      bool      get_next_section(harray hsec_array, hsection& h_child_section);
+
+      //-------------------------------------------------------------------------------
+      bool      load_from_binary(const binarybuffer& source);
+
+    private:
+      entry*    find_entry(const char* name, hsection hparent_section);
+      size_t    add_entry(const char* name, uint8_t name_size, const uint8_t* raw, uint8_t type);
+      const uint8_t* take(size_t count);
+      uint8_t   read_byte() { return *take(1); }
+      size_t    read_varint();
+      void      parse_section(size_t index, size_t depth);
+      void      parse_value(size_t index, uint8_t type, size_t depth);
+      void      parse_array(size_t index, uint8_t type, size_t depth);
+      void      parse_string(size_t index);
+
+      template<class t_pod_type>
+      static t_pod_type load_pod(const uint8_t* data) { t_pod_type v; memcpy(&v, data, sizeof(v)); return v; }
+      static size_t pod_size(uint8_t type);
+      template<class t_value>
+      static void read_scalar(uint8_t type, const uint8_t* data, size_t count, t_value& val);
+      static void read_scalar(uint8_t type, const uint8_t* data, size_t count, std::string& val);
+
+      std::vector<entry> m_entries;
+      const uint8_t* m_ptr;
+      const uint8_t* m_end;
+    };
+
+    inline
+    size_t portable_storage_reader::pod_size(uint8_t type)
+    {
+      switch(type)
+      {
+      case SERIALIZE_TYPE_INT64:  return sizeof(int64_t);
+      case SERIALIZE_TYPE_INT32:  return sizeof(int32_t);
+      case SERIALIZE_TYPE_INT16:  return sizeof(int16_t);
+      case SERIALIZE_TYPE_INT8:   return sizeof(int8_t);
+      case SERIALIZE_TYPE_UINT64: return sizeof(uint64_t);
+      case SERIALIZE_TYPE_UINT32: return sizeof(uint32_t);
+      case SERIALIZE_TYPE_UINT16: return sizeof(uint16_t);
+      case SERIALIZE_TYPE_UINT8:  return sizeof(uint8_t);
+      case SERIALIZE_TYPE_DUOBLE: return sizeof(double);
+      case SERIALIZE_TYPE_BOOL:   return sizeof(bool);
+      default:
+        ASSERT_MES_AND_THROW("unknown entry_type code = " << (unsigned)type);
+      }
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    void portable_storage_reader::read_scalar(uint8_t type, const uint8_t* data, size_t count, t_value& val)
+    {
+      switch(type)
+      {
+      case SERIALIZE_TYPE_INT64:  convert_t(load_pod<int64_t>(data), val); break;
+      case SERIALIZE_TYPE_INT32:  convert_t(load_pod<int32_t>(data), val); break;
+      case SERIALIZE_TYPE_INT16:  convert_t(load_pod<int16_t>(data), val); break;
+      case SERIALIZE_TYPE_INT8:   convert_t(load_pod<int8_t>(data), val); break;
+      case SERIALIZE_TYPE_UINT64: convert_t(load_pod<uint64_t>(data), val); break;
+      case SERIALIZE_TYPE_UINT32: convert_t(load_pod<uint32_t>(data), val); break;
+      case SERIALIZE_TYPE_UINT16: convert_t(load_pod<uint16_t>(data), val); break;
+      case SERIALIZE_TYPE_UINT8:  convert_t(load_pod<uint8_t>(data), val); break;
+      case SERIALIZE_TYPE_DUOBLE: convert_t(load_pod<double>(data), val); break;
+      case SERIALIZE_TYPE_BOOL:   convert_t(load_pod<bool>(data), val); break;
+      case SERIALIZE_TYPE_STRING: convert_t(std::string((const char*)data, count), val); break;
+      default:
+        ASSERT_MES_AND_THROW("WRONG DATA CONVERSION: from type code=" << (unsigned)type << " to type " << typeid(t_value).name());
+      }
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_reader::read_scalar(uint8_t type, const uint8_t* data, size_t count, std::string& val)
+    {
+      if(type == SERIALIZE_TYPE_STRING)
+        val.assign((const char*)data, count);
+      else
+        read_scalar<std::string>(type, data, count, val);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    const uint8_t* portable_storage_reader::take(size_t count)
+    {
+      CHECK_AND_ASSERT_THROW_MES(size_t(m_end - m_ptr) >= count, " attempt to read " << count << " bytes from buffer with " << size_t(m_end - m_ptr) << " bytes remained");
+      const uint8_t* p = m_ptr;
+      m_ptr += count;
+      return p;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    size_t portable_storage_reader::read_varint()
+    {
+      CHECK_AND_ASSERT_THROW_MES(m_ptr != m_end, "empty buff, expected place for varint");
+      size_t v = 0;
+      switch(*m_ptr & PORTABLE_RAW_SIZE_MARK_MASK)
+      {
+      case PORTABLE_RAW_SIZE_MARK_BYTE:  v = load_pod<uint8_t>(take(sizeof(uint8_t))); break;
+      case PORTABLE_RAW_SIZE_MARK_WORD:  v = load_pod<uint16_t>(take(sizeof(uint16_t))); break;
+      case PORTABLE_RAW_SIZE_MARK_DWORD: v = load_pod<uint32_t>(take(sizeof(uint32_t))); break;
+      case PORTABLE_RAW_SIZE_MARK_INT64: v = load_pod<uint64_t>(take(sizeof(uint64_t))); break;
+      }
+      return v >> 2;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    size_t portable_storage_reader::add_entry(const char* name, uint8_t name_size, const uint8_t* raw, uint8_t type)
+    {
+      entry e = AUTO_VAL_INIT(e);
+      e.name = name;
+      e.name_size = name_size;
+      e.raw = raw;
+      e.type = type;
+      m_entries.push_back(e);
+      return m_entries.size() - 1;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_reader::parse_section(size_t index, size_t depth)
+    {
+      CHECK_AND_ASSERT_THROW_MES(depth < EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL, "Wrong blob data in portable storage: recursion limitation (" << EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL << ") exceeded");
+      size_t count = read_varint();
+      m_entries[index].count = count;
+      while(count--)
+      {
+        const uint8_t name_size = read_byte();
+        const char* name = (const char*)take(name_size);
+        const uint8_t* raw = m_ptr;
+        const uint8_t type = read_byte();
+        parse_value(add_entry(name, name_size, raw, type), type, depth);
+      }
+      m_entries[index].end = m_entries.size();
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_reader::parse_value(size_t index, uint8_t type, size_t depth)
+    {
+      if(type & SERIALIZE_FLAG_ARRAY)
+        return parse_array(index, type, depth);
+
+      switch(type)
+      {
+      case SERIALIZE_TYPE_OBJECT:
+        return parse_section(index, depth + 1);
+      case SERIALIZE_TYPE_ARRAY:
+      {
+        const uint8_t array_type = read_byte();
+        CHECK_AND_ASSERT_THROW_MES(array_type & SERIALIZE_FLAG_ARRAY, "wrong type sequenses");
+        m_entries[index].type = array_type;
+        return parse_array(index, array_type, depth);
+      }
+      case SERIALIZE_TYPE_STRING:
+        parse_string(index);
+        break;
+      default:
+        m_entries[index].data = take(pod_size(type));
+        break;
+      }
+      m_entries[index].end = index + 1;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_reader::parse_array(size_t index, uint8_t type, size_t depth)
+    {
+      const uint8_t element_type = type & ~SERIALIZE_FLAG_ARRAY;
+      const size_t count = read_varint();
+      m_entries[index].count = count;
+      switch(element_type)
+      {
+      case SERIALIZE_TYPE_STRING:
+        for(size_t i = 0; i < count; ++i)
+        {
+          const size_t child = add_entry(nullptr, 0, nullptr, SERIALIZE_TYPE_STRING);
+          parse_string(child);
+          m_entries[child].end = child + 1;
+        }
+        break;
+      case SERIALIZE_TYPE_OBJECT:
+        for(size_t i = 0; i < count; ++i)
+          parse_section(add_entry(nullptr, 0, nullptr, SERIALIZE_TYPE_OBJECT), depth + 1);
+        break;
+      default:
+      {
+        const size_t size = pod_size(element_type);
+        CHECK_AND_ASSERT_THROW_MES(count <= size_t(m_end - m_ptr) / size, "array of " << count << " elements goes out of remain storage len " << size_t(m_end - m_ptr));
+        m_entries[index].data = take(count * size);
+        break;
+      }
+      }
+      m_entries[index].end = m_entries.size();
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_reader::parse_string(size_t index)
+    {
+      const size_t len = read_varint();
+      CHECK_AND_ASSERT_THROW_MES(len < MAX_STRING_LEN_POSSIBLE, "to big string len value in storage: " << len);
+      m_entries[index].data = take(len);
+      m_entries[index].count = len;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_reader::load_from_binary(const binarybuffer& source)
+    {
+      const size_t header_size = 2 * sizeof(uint32_t) + sizeof(uint8_t);
+      m_entries.clear();
+      if(source.size() < header_size)
+      {
+        LOG_ERROR("portable_storage_reader: wrong binary format, packet size = " << source.size() << " less than expected header size " << header_size);
+        return false;
+      }
+      const uint8_t* p = (const uint8_t*)source.data();
+      if(load_pod<uint32_t>(p) != PORTABLE_STORAGE_SIGNATUREA ||
+        load_pod<uint32_t>(p + sizeof(uint32_t)) != PORTABLE_STORAGE_SIGNATUREB
+        )
+      {
+        LOG_ERROR("portable_storage_reader: wrong binary format - signature mismatch");
+        return false;
+      }
+      if(p[2 * sizeof(uint32_t)] != PORTABLE_STORAGE_FORMAT_VER)
+      {
+        LOG_ERROR("portable_storage_reader: wrong binary format - unknown format ver = " << (unsigned)p[2 * sizeof(uint32_t)]);
+        return false;
+      }
+      TRY_ENTRY();
+      m_ptr = p + header_size;
+      m_end = p + source.size();
+      //every entry takes at least a couple of bytes, this avoids most reallocations on large messages
+      m_entries.reserve(source.size() / 16 + 1);
+      parse_section(add_entry(nullptr, 0, nullptr, SERIALIZE_TYPE_OBJECT), 0);
+      return true;
+      CATCH_ENTRY("portable_storage_reader::load_from_binary", false);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_reader::entry* portable_storage_reader::find_entry(const char* name, hsection hparent_section)
+    {
+      if(m_entries.empty())
+        return nullptr;
+      const entry* section = hparent_section ? hparent_section : &m_entries[0];
+      const size_t name_size = strlen(name);
+      for(size_t i = section - m_entries.data() + 1; i < section->end; i = m_entries[i].end)
+      {
+        entry& e = m_entries[i];
+        if(e.name_size == name_size && !memcmp(e.name, name, name_size))
+          return &e;
+      }
+      return nullptr;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_reader::hsection portable_storage_reader::open_section(const char* section_name, hsection hparent_section, bool create_if_notexist)
+    {
+      entry* e = find_entry(section_name, hparent_section);
+      if(!e || e->type != SERIALIZE_TYPE_OBJECT)
+        return nullptr;
+      return e;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    bool portable_storage_reader::get_value(const char* value_name, t_value& val, hsection hparent_section)
+    {
+      const entry* e = find_entry(value_name, hparent_section);
+      if(!e)
+        return false;
+      read_scalar(e->type, e->data, e->count, val);
+      return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_reader::get_value(const char* value_name, storage_entry& val, hsection hparent_section)
+    {
+      const entry* e = find_entry(value_name, hparent_section);
+      if(!e)
+        return false;
+      throwable_buffer_reader buf_reader(e->raw, m_end - e->raw);
+      val = buf_reader.load_storage_entry();
+      return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    portable_storage_reader::harray portable_storage_reader::get_first_value(const char* value_name, t_value& target, hsection hparent_section)
+    {
+      entry* e = find_entry(value_name, hparent_section);
+      if(!e || !(e->type & SERIALIZE_FLAG_ARRAY) || !e->count)
+        return nullptr;
+      e->next = 0;
+      if(!get_next_value(e, target))
+        return nullptr;
+      return e;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    bool portable_storage_reader::get_next_value(harray hval_array, t_value& target)
+    {
+      CHECK_AND_ASSERT(hval_array, false);
+      if(hval_array->next >= hval_array->count)
+        return false;
+      const uint8_t type = hval_array->type & ~SERIALIZE_FLAG_ARRAY;
+      if(type == SERIALIZE_TYPE_STRING)
+      {
+        //string elements are single entries following the array's own
+        const entry& e = m_entries[hval_array - m_entries.data() + 1 + hval_array->next];
+        read_scalar(type, e.data, e.count, target);
+      }
+      else if(type == SERIALIZE_TYPE_OBJECT)
+      {
+        ASSERT_MES_AND_THROW("WRONG DATA CONVERSION: from section to type " << typeid(t_value).name());
+      }
+      else
+      {
+        read_scalar(type, hval_array->data + hval_array->next * pod_size(type), 0, target);
+      }
+      ++hval_array->next;
+      return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_reader::harray portable_storage_reader::get_first_section(const char* section_name, hsection& h_child_section, hsection hparent_section)
+    {
+      entry* e = find_entry(section_name, hparent_section);
+      if(!e || e->type != (SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY))
+        return nullptr;
+      //for arrays of sections, next is the index of the next element's entry
+      e->next = e - m_entries.data() + 1;
+      if(!get_next_section(e, h_child_section))
+        return nullptr;
+      return e;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_reader::get_next_section(harray hsec_array, hsection& h_child_section)
+    {
+      CHECK_AND_ASSERT(hsec_array, false);
+      if(hsec_array->type != (SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY))
+        return false;
+      if(hsec_array->next >= hsec_array->end)
+        return false;
+      h_child_section = &m_entries[hsec_array->next];
+      hsec_array->next = h_child_section->end;
+      return true;
+    }
+  }
+}
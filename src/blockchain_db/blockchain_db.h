@@ -130,6 +130,16 @@ struct tx_data_t
 };
 #pragma pack(pop)
 
+/**
+ * @brief the serialized data of a block, as sent to syncing wallets
+ */
+struct block_blobs_entry
+{
+  cryptonote::blobdata block;                         //!< the block blob, including its miner tx
+  std::vector<cryptonote::blobdata> txs;              //!< the blobs of the block's txs, in block order
+  std::vector<std::vector<uint64_t>> output_indices;  //!< the amount output indices of each tx, miner tx first
+};
+
 /**
  * @brief a struct containing txpool per transaction metadata
  */
@@ -1114,6 +1124,56 @@ public:
    */
   virtual bool get_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const = 0;
 
+  /**
+   * @brief fetches the pruned transaction blob with the given hash
+   *
+   * The subclass should return the pruned part of the transaction stored
+   * which has the given hash: the prefix and, for rct transactions, the
+   * rct signatures base. This is what is sent to wallets which do not
+   * need to verify signatures.
+   *
+   * If the transaction does not exist, the subclass should return false.
+   *
+   * @param h the hash to look for
+   *
+   * @return true iff the transaction was found
+   */
+  virtual bool get_pruned_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const = 0;
+
+  /**
+   * @brief fetches the prunable transaction blob with the given hash
+   *
+   * The subclass should return the prunable part of the transaction stored
+   * which has the given hash: what follows the pruned part in the full blob.
+   *
+   * If the transaction does not exist, the subclass should return false.
+   *
+   * @param h the hash to look for
+   *
+   * @return true iff the transaction was found
+   */
+  virtual bool get_prunable_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const = 0;
+
+  /**
+   * @brief fetches a range of blocks with their txs and output indices
+   *
+   * The subclass should read the blocks starting at the given height,
+   * along with the blobs and amount output indices of their transactions,
+   * stopping at the top of the chain, after max_count blocks, or once
+   * max_size bytes of blobs were read and at least min_count blocks were
+   * returned.  All data should come from a consistent view of the database.
+   *
+   * @param start_height the height of the first block to fetch
+   * @param min_count the number of blocks to return regardless of max_size
+   * @param max_count the maximum number of blocks to return
+   * @param max_size the size of blobs after which to stop
+   * @param pruned whether to return pruned tx blobs
+   * @param blocks return-by-reference the blocks
+   *
+   * @return true on success, false if start_height is above the chain
+   */
+  virtual bool get_blocks_from(uint64_t start_height, size_t min_count, size_t max_count, size_t max_size, bool pruned, std::vector<block_blobs_entry>& blocks) const = 0;
+
   /**
    * @brief fetches the total number of transactions ever
    *
@@ -1487,6 +1547,32 @@ public:
    */
   virtual std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> get_output_histogram(const std::vector<uint64_t> &amounts, bool unlocked, uint64_t recent_cutoff) const = 0;
 
+  /**
+   * @brief get the number of outputs of an amount up to a given height
+   *
+   * This is a single lookup in the per amount output distribution, which
+   * is kept up to date as blocks are added and popped.
+   *
+   * @param amount the output amount
+   * @param height the block height, inclusive
+   *
+   * @return the number of outputs of that amount in blocks 0 to height
+   */
+  virtual uint64_t get_cumulative_num_outputs(const uint64_t& amount, uint64_t height) const = 0;
+
+  /**
+   * @brief get the cumulative output distribution of an amount
+   *
+   * @param amount the output amount
+   * @param from_height the first block height
+   * @param to_height the last block height, inclusive
+   * @param distribution return-by-reference, for each height in the range, the number of outputs of that amount in blocks up to it
+   * @param base return-by-reference the number of outputs of that amount before from_height
+   *
+   * @return false if the range is empty or goes past the top of the chain, true otherwise
+   */
+  virtual bool get_output_distribution(uint64_t amount, uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const = 0;
+
   /**
    * @brief is BlockchainDB in read-only mode?
    *
@@ -0,0 +1,84 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <string.h>
+#include "common/int-util.h"
+#include "key_image_filter.h"
+
+// 12 bits per key image and 6 bits set by each: about 0.5% false positives at capacity
+#define KEY_IMAGE_FILTER_BITS_PER_KEY 12
+#define KEY_IMAGE_FILTER_BITS_SET 6
+#define KEY_IMAGE_FILTER_BLOCK_WORDS 8
+
+namespace cryptonote
+{
+  //---------------------------------------------------------------
+  key_image_filter::key_image_filter(uint64_t capacity):
+    m_num_blocks(std::max<uint64_t>(1, (capacity * KEY_IMAGE_FILTER_BITS_PER_KEY + 511) / 512)),
+    m_capacity(capacity),
+    m_size(0)
+  {
+    m_words.reset(new std::atomic<uint64_t>[m_num_blocks * KEY_IMAGE_FILTER_BLOCK_WORDS]);
+    for (uint64_t i = 0; i < m_num_blocks * KEY_IMAGE_FILTER_BLOCK_WORDS; ++i)
+      m_words[i].store(0, std::memory_order_relaxed);
+  }
+  //---------------------------------------------------------------
+  uint64_t key_image_filter::block_index(const crypto::key_image &ki) const
+  {
+    uint64_t h, block;
+    memcpy(&h, &ki, sizeof(h));
+    mul128(SWAP64LE(h), m_num_blocks, &block);
+    return block;
+  }
+  //---------------------------------------------------------------
+  void key_image_filter::add(const crypto::key_image &ki)
+  {
+    std::atomic<uint64_t> *words = &m_words[block_index(ki) * KEY_IMAGE_FILTER_BLOCK_WORDS];
+    uint64_t bits;
+    memcpy(&bits, (const char*)&ki + 8, sizeof(bits));
+    bits = SWAP64LE(bits);
+    for (int i = 0; i < KEY_IMAGE_FILTER_BITS_SET; ++i, bits >>= 9)
+      words[(bits >> 6) & 7].fetch_or((uint64_t)1 << (bits & 63), std::memory_order_release);
+    ++m_size;
+  }
+  //---------------------------------------------------------------
+  bool key_image_filter::may_contain(const crypto::key_image &ki) const
+  {
+    const std::atomic<uint64_t> *words = &m_words[block_index(ki) * KEY_IMAGE_FILTER_BLOCK_WORDS];
+    uint64_t bits;
+    memcpy(&bits, (const char*)&ki + 8, sizeof(bits));
+    bits = SWAP64LE(bits);
+    for (int i = 0; i < KEY_IMAGE_FILTER_BITS_SET; ++i, bits >>= 9)
+    {
+      if (!(words[(bits >> 6) & 7].load(std::memory_order_acquire) & ((uint64_t)1 << (bits & 63))))
+        return false;
+    }
+    return true;
+  }
+}
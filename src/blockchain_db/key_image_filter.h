@@ -0,0 +1,96 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include "crypto/crypto.h"
+
+namespace cryptonote
+{
+  /**
+   * @brief A bloom filter over spent key images
+   *
+   * Tells whether a key image may have been spent, without false negatives,
+   * so that looking up a key image which was not spent, by far the most
+   * common case, does not need to touch the database.
+   *
+   * The filter is split in 512 bit blocks, and all the bits of a key image
+   * are set in the same block, so a lookup reads a single cache line. Key
+   * images are hashes, so their bytes are used as is to select the block and
+   * the bits.
+   *
+   * Key images may be added while other threads look them up. They cannot be
+   * removed: bits of removed key images are left set, which only costs a
+   * database lookup when they are checked again.
+   */
+  class key_image_filter
+  {
+  public:
+    /**
+     * @brief creates an empty filter
+     *
+     * @param capacity the number of key images the filter is sized for
+     */
+    explicit key_image_filter(uint64_t capacity);
+
+    /**
+     * @brief adds a key image to the filter
+     */
+    void add(const crypto::key_image &ki);
+
+    /**
+     * @brief checks whether a key image may have been added
+     *
+     * @return false if the key image was not added, true if it may have been
+     */
+    bool may_contain(const crypto::key_image &ki) const;
+
+    /**
+     * @brief gets the number of key images the filter was sized for
+     *
+     * More can be added, at the cost of more false positives.
+     */
+    uint64_t capacity() const { return m_capacity; }
+
+    /**
+     * @brief gets the number of key images added
+     */
+    uint64_t size() const { return m_size; }
+
+  private:
+    uint64_t block_index(const crypto::key_image &ki) const;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> m_words;
+    uint64_t m_num_blocks;
+    uint64_t m_capacity;
+    std::atomic<uint64_t> m_size;
+  };
+}
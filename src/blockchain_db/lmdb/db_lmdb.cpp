@@ -54,7 +54,11 @@ using namespace crypto;
 
 // Increase when the DB changes in a non backward compatible way, and there
 // is no automatic conversion, so that a full resync is needed.
-#define VERSION 1
+#define VERSION 3
+
+// the spent key image filter has room for at least this many key images,
+// and twice as many as when it was last built
+#define KEY_IMAGE_FILTER_MIN_CAPACITY (1 << 20)
 
 namespace
 {
@@ -128,6 +132,18 @@ private:
   std::unique_ptr<char[]> data;
 };
 
+// the pruned part of a tx blob is what serialize_base writes, and it comes
+// first, so the prunable part is whatever follows it
+bool get_pruned_tx_size(const cryptonote::transaction &tx, size_t &size)
+{
+  std::stringstream ss;
+  binary_archive<true> ba(ss);
+  if (!const_cast<cryptonote::transaction&>(tx).serialize_base(ba))
+    return false;
+  size = ss.str().size();
+  return true;
+}
+
 int compare_uint64(const MDB_val *a, const MDB_val *b)
 {
   const uint64_t va = *(const uint64_t *)a->mv_data;
@@ -164,12 +180,14 @@ int compare_string(const MDB_val *a, const MDB_val *b)
  * block_heights    block hash   block height
  * block_info       block ID     {block metadata}
  *
- * txs              txn ID       txn blob
+ * txs_pruned       txn ID       pruned txn blob
+ * txs_prunable     txn ID       prunable txn blob
  * tx_indices       txn hash     {txn ID, metadata}
  * tx_outputs       txn ID       [txn amount output indices]
  *
  * output_txs       output ID    {txn hash, local index}
  * output_amounts   amount       [{amount output index, metadata}...]
+ * output_distribution amount    [{block height, cumulative output count}...]
  *
  * spent_keys       input hash   -
  *
@@ -183,17 +201,27 @@ int compare_string(const MDB_val *a, const MDB_val *b)
  * (DUPFIXED saves 8 bytes per record.)
  *
  * The output_amounts table doesn't use a dummy key, but uses DUPSORT.
+ * Neither does output_distribution, which only has an entry for the heights
+ * where the amount has outputs; the count there includes all outputs of the
+ * amount up to and including that block.
+ *
+ * A txn blob is its pruned blob followed by its prunable blob. The pruned
+ * part is the prefix and, for rct txes, the rct signatures base; keeping
+ * it apart lets pruned txes be served without parsing the full blob.
  */
 const char* const LMDB_BLOCKS = "blocks";
 const char* const LMDB_BLOCK_HEIGHTS = "block_heights";
 const char* const LMDB_BLOCK_INFO = "block_info";
 
 const char* const LMDB_TXS = "txs";
+const char* const LMDB_TXS_PRUNED = "txs_pruned";
+const char* const LMDB_TXS_PRUNABLE = "txs_prunable";
 const char* const LMDB_TX_INDICES = "tx_indices";
 const char* const LMDB_TX_OUTPUTS = "tx_outputs";
 
 const char* const LMDB_OUTPUT_TXS = "output_txs";
 const char* const LMDB_OUTPUT_AMOUNTS = "output_amounts";
+const char* const LMDB_OUTPUT_DISTRIBUTION = "output_distribution";
 const char* const LMDB_SPENT_KEYS = "spent_keys";
 
 const char* const LMDB_TXPOOL_META = "txpool_meta";
@@ -278,6 +306,41 @@ typedef struct outkey {
     output_data_t data;
 } outkey;
 
+typedef struct outdist {
+    uint64_t height;
+    uint64_t count;
+} outdist;
+
+// number of outputs of an amount in blocks up to and including the given
+// height, from the last output_distribution entry at or below it
+static uint64_t get_cumulative_count(MDB_cursor *cur, uint64_t amount, uint64_t height)
+{
+  MDB_val_set(k, amount);
+  outdist od = {height, 0};
+  MDB_val_set(v, od);
+  int result = mdb_cursor_get(cur, &k, &v, MDB_GET_BOTH_RANGE);
+  if (result == MDB_NOTFOUND)
+  {
+    // every entry is below height, if there are any
+    k.mv_data = &amount;
+    k.mv_size = sizeof(amount);
+    result = mdb_cursor_get(cur, &k, &v, MDB_SET);
+    if (result == MDB_NOTFOUND)
+      return 0;
+    if (!result)
+      result = mdb_cursor_get(cur, &k, &v, MDB_LAST_DUP);
+  }
+  else if (!result && ((const outdist*)v.mv_data)->height != height)
+  {
+    result = mdb_cursor_get(cur, &k, &v, MDB_PREV_DUP);
+    if (result == MDB_NOTFOUND)
+      return 0;
+  }
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to get output distribution: ", result).c_str()));
+  return ((const outdist*)v.mv_data)->count;
+}
+
 typedef struct outtx {
     uint64_t output_id;
     crypto::hash tx_hash;
@@ -767,7 +830,8 @@ uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash& blk_hash, cons
   int result;
   uint64_t tx_id = get_tx_count();
 
-  CURSOR(txs)
+  CURSOR(txs_pruned)
+  CURSOR(txs_prunable)
   CURSOR(tx_indices)
 
   MDB_val_set(val_tx_id, tx_id);
@@ -793,10 +857,20 @@ uint64_t BlockchainLMDB::add_transaction_data(const crypto::hash& blk_hash, cons
   if (result)
     throw0(DB_ERROR(lmdb_error("Failed to add tx data to db transaction: ", result).c_str()));
 
-  MDB_val_copy<blobdata> blob(tx_to_blob(tx));
-  result = mdb_cursor_put(m_cur_txs, &val_tx_id, &blob, MDB_APPEND);
+  const blobdata blob = tx_to_blob(tx);
+  size_t pruned_size;
+  if (!get_pruned_tx_size(tx, pruned_size) || pruned_size > blob.size())
+    throw0(DB_ERROR("Failed to serialize pruned tx"));
+
+  MDB_val pruned_blob = {pruned_size, (void*)blob.data()};
+  result = mdb_cursor_put(m_cur_txs_pruned, &val_tx_id, &pruned_blob, MDB_APPEND);
   if (result)
-    throw0(DB_ERROR(lmdb_error("Failed to add tx blob to db transaction: ", result).c_str()));
+    throw0(DB_ERROR(lmdb_error("Failed to add pruned tx blob to db transaction: ", result).c_str()));
+
+  MDB_val prunable_blob = {blob.size() - pruned_size, (void*)(blob.data() + pruned_size)};
+  result = mdb_cursor_put(m_cur_txs_prunable, &val_tx_id, &prunable_blob, MDB_APPEND);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to add prunable tx blob to db transaction: ", result).c_str()));
 
   return tx_id;
 }
@@ -812,7 +886,8 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash& tx_hash, const
 
   mdb_txn_cursors *m_cursors = &m_wcursors;
   CURSOR(tx_indices)
-  CURSOR(txs)
+  CURSOR(txs_pruned)
+  CURSOR(txs_prunable)
   CURSOR(tx_outputs)
 
   MDB_val_set(val_h, tx_hash);
@@ -822,11 +897,17 @@ void BlockchainLMDB::remove_transaction_data(const crypto::hash& tx_hash, const
   txindex *tip = (txindex *)val_h.mv_data;
   MDB_val_set(val_tx_id, tip->data.tx_id);
 
-  if ((result = mdb_cursor_get(m_cur_txs, &val_tx_id, NULL, MDB_SET)))
-      throw1(DB_ERROR(lmdb_error("Failed to locate tx for removal: ", result).c_str()));
-  result = mdb_cursor_del(m_cur_txs, 0);
+  if ((result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, NULL, MDB_SET)))
+      throw1(DB_ERROR(lmdb_error("Failed to locate pruned tx for removal: ", result).c_str()));
+  result = mdb_cursor_del(m_cur_txs_pruned, 0);
+  if (result)
+      throw1(DB_ERROR(lmdb_error("Failed to add removal of pruned tx to db transaction: ", result).c_str()));
+
+  if ((result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, NULL, MDB_SET)))
+      throw1(DB_ERROR(lmdb_error("Failed to locate prunable tx for removal: ", result).c_str()));
+  result = mdb_cursor_del(m_cur_txs_prunable, 0);
   if (result)
-      throw1(DB_ERROR(lmdb_error("Failed to add removal of tx to db transaction: ", result).c_str()));
+      throw1(DB_ERROR(lmdb_error("Failed to add removal of prunable tx to db transaction: ", result).c_str()));
 
   remove_tx_outputs(tip->data.tx_id, tx);
 
@@ -863,6 +944,7 @@ uint64_t BlockchainLMDB::add_output(const crypto::hash& tx_hash,
 
   CURSOR(output_txs)
   CURSOR(output_amounts)
+  CURSOR(output_distribution)
 
   if (tx_output.target.type() != typeid(txout_to_key))
     throw0(DB_ERROR("Wrong output type: expected txout_to_key"));
@@ -910,6 +992,23 @@ uint64_t BlockchainLMDB::add_output(const crypto::hash& tx_hash,
   if ((result = mdb_cursor_put(m_cur_output_amounts, &val_amount, &data, MDB_APPENDDUP)))
       throw0(DB_ERROR(lmdb_error("Failed to add output pubkey to db transaction: ", result).c_str()));
 
+  // bump the cumulative count for this amount at this height, adding an
+  // entry for the height if this is the first output of the amount in it
+  // (MDB_LAST_DUP points the key it is given into the page, which the put
+  // may then move, so it gets a copy)
+  outdist od = {m_height, ok.amount_index + 1};
+  MDB_val_set(vod, od);
+  MDB_val kd = val_amount, v;
+  result = mdb_cursor_get(m_cur_output_distribution, &kd, &v, MDB_SET);
+  if (!result)
+    result = mdb_cursor_get(m_cur_output_distribution, &kd, &v, MDB_LAST_DUP);
+  if (!result && ((const outdist*)v.mv_data)->height == m_height)
+    result = mdb_cursor_put(m_cur_output_distribution, &val_amount, &vod, MDB_CURRENT);
+  else if (!result || result == MDB_NOTFOUND)
+    result = mdb_cursor_put(m_cur_output_distribution, &val_amount, &vod, MDB_APPENDDUP);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to add output distribution to db transaction: ", result).c_str()));
+
   return ok.amount_index;
 }
 
@@ -965,6 +1064,7 @@ void BlockchainLMDB::remove_output(const uint64_t amount, const uint64_t& out_in
   mdb_txn_cursors *m_cursors = &m_wcursors;
   CURSOR(output_amounts);
   CURSOR(output_txs);
+  CURSOR(output_distribution);
 
   MDB_val_set(k, amount);
   MDB_val_set(v, out_index);
@@ -976,6 +1076,7 @@ void BlockchainLMDB::remove_output(const uint64_t amount, const uint64_t& out_in
     throw0(DB_ERROR(lmdb_error("DB error attempting to get an output", result).c_str()));
 
   const pre_rct_outkey *ok = (const pre_rct_outkey *)v.mv_data;
+  const uint64_t out_height = ok->data.height;
   MDB_val_set(otxk, ok->output_id);
   result = mdb_cursor_get(m_cur_output_txs, (MDB_val *)&zerokval, &otxk, MDB_GET_BOTH);
   if (result == MDB_NOTFOUND)
@@ -994,6 +1095,39 @@ void BlockchainLMDB::remove_output(const uint64_t amount, const uint64_t& out_in
   result = mdb_cursor_del(m_cur_output_amounts, 0);
   if (result)
     throw0(DB_ERROR(lmdb_error(std::string("Error deleting amount for output index ").append(boost::lexical_cast<std::string>(out_index).append(": ")).c_str(), result).c_str()));
+
+  // outputs are removed last first, so this one is the last counted at its
+  // height: decrement that count, or drop the entry if it was its only output
+  outdist od = {out_height, 0};
+  MDB_val_set(vod, od);
+  result = mdb_cursor_get(m_cur_output_distribution, &k, &vod, MDB_GET_BOTH);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Unexpected: output distribution not found: ", result).c_str()));
+  if (((const outdist*)vod.mv_data)->count != out_index + 1)
+    throw0(DB_ERROR("Unexpected: output distribution out of sync with output amounts"));
+  uint64_t prev_count = 0;
+  MDB_val kprev = k, vprev;
+  result = mdb_cursor_get(m_cur_output_distribution, &kprev, &vprev, MDB_PREV_DUP);
+  if (!result)
+    prev_count = ((const outdist*)vprev.mv_data)->count;
+  else if (result != MDB_NOTFOUND)
+    throw0(DB_ERROR(lmdb_error("Failed to get output distribution: ", result).c_str()));
+  od.count = out_index;
+  vod.mv_data = &od;
+  vod.mv_size = sizeof(od);
+  result = mdb_cursor_get(m_cur_output_distribution, &k, &vod, MDB_GET_BOTH);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to get output distribution: ", result).c_str()));
+  if (out_index == prev_count)
+    result = mdb_cursor_del(m_cur_output_distribution, 0);
+  else
+  {
+    vod.mv_data = &od;
+    vod.mv_size = sizeof(od);
+    result = mdb_cursor_put(m_cur_output_distribution, &k, &vod, MDB_CURRENT);
+  }
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to update output distribution: ", result).c_str()));
 }
 
 void BlockchainLMDB::add_spent_key(const crypto::key_image& k_image)
@@ -1011,6 +1145,14 @@ void BlockchainLMDB::add_spent_key(const crypto::key_image& k_image)
     else
       throw1(DB_ERROR(lmdb_error("Error adding spent key image to db transaction: ", result).c_str()));
   }
+
+  std::shared_ptr<key_image_filter> filter = std::atomic_load(&m_key_image_filter);
+  if (filter)
+  {
+    filter->add(k_image);
+    if (filter->size() > filter->capacity())
+      build_key_image_filter();
+  }
 }
 
 void BlockchainLMDB::remove_spent_key(const crypto::key_image& k_image)
@@ -1031,6 +1173,7 @@ void BlockchainLMDB::remove_spent_key(const crypto::key_image& k_image)
     if (result)
         throw1(DB_ERROR(lmdb_error("Error adding removal of key image to db transaction", result).c_str()));
   }
+  // the key image stays in m_key_image_filter, which only costs a lookup here if it is checked again
 }
 
 blobdata BlockchainLMDB::output_to_blob(const tx_out& output) const
@@ -1045,9 +1188,7 @@ blobdata BlockchainLMDB::output_to_blob(const tx_out& output) const
 tx_out BlockchainLMDB::output_from_blob(const blobdata& blob) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
-  std::stringstream ss;
-  ss << blob;
-  binary_archive<false> ba(ss);
+  binary_archive<false> ba{epee::strspan<std::uint8_t>(blob)};
   tx_out o;
 
   if (!(::serialization::serialize(ba, o)))
@@ -1193,11 +1334,14 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
   lmdb_db_open(txn, LMDB_BLOCK_HEIGHTS, MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_block_heights, "Failed to open db handle for m_block_heights");
 
   lmdb_db_open(txn, LMDB_TXS, MDB_INTEGERKEY | MDB_CREATE, m_txs, "Failed to open db handle for m_txs");
+  lmdb_db_open(txn, LMDB_TXS_PRUNED, MDB_INTEGERKEY | MDB_CREATE, m_txs_pruned, "Failed to open db handle for m_txs_pruned");
+  lmdb_db_open(txn, LMDB_TXS_PRUNABLE, MDB_INTEGERKEY | MDB_CREATE, m_txs_prunable, "Failed to open db handle for m_txs_prunable");
   lmdb_db_open(txn, LMDB_TX_INDICES, MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_tx_indices, "Failed to open db handle for m_tx_indices");
   lmdb_db_open(txn, LMDB_TX_OUTPUTS, MDB_INTEGERKEY | MDB_CREATE, m_tx_outputs, "Failed to open db handle for m_tx_outputs");
 
   lmdb_db_open(txn, LMDB_OUTPUT_TXS, MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_output_txs, "Failed to open db handle for m_output_txs");
   lmdb_db_open(txn, LMDB_OUTPUT_AMOUNTS, MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_CREATE, m_output_amounts, "Failed to open db handle for m_output_amounts");
+  lmdb_db_open(txn, LMDB_OUTPUT_DISTRIBUTION, MDB_INTEGERKEY | MDB_DUPSORT | MDB_DUPFIXED | MDB_CREATE, m_output_distribution, "Failed to open db handle for m_output_distribution");
 
   lmdb_db_open(txn, LMDB_SPENT_KEYS, MDB_INTEGERKEY | MDB_CREATE | MDB_DUPSORT | MDB_DUPFIXED, m_spent_keys, "Failed to open db handle for m_spent_keys");
 
@@ -1218,6 +1362,7 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
   mdb_set_dupsort(txn, m_block_heights, compare_hash32);
   mdb_set_dupsort(txn, m_tx_indices, compare_hash32);
   mdb_set_dupsort(txn, m_output_amounts, compare_uint64);
+  mdb_set_dupsort(txn, m_output_distribution, compare_uint64);
   mdb_set_dupsort(txn, m_output_txs, compare_uint64);
   mdb_set_dupsort(txn, m_block_info, compare_uint64);
 
@@ -1260,6 +1405,7 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
       txn.commit();
       m_open = true;
       migrate(*(const uint32_t *)v.mv_data);
+      build_key_image_filter();
       return;
     }
 #endif
@@ -1306,6 +1452,8 @@ void BlockchainLMDB::open(const std::string& filename, const int db_flags)
   txn.commit();
 
   m_open = true;
+
+  build_key_image_filter();
   // from here, init should be finished
 }
 
@@ -1319,6 +1467,7 @@ void BlockchainLMDB::close()
   }
   this->sync();
   m_tinfo.reset();
+  std::atomic_store(&m_key_image_filter, std::shared_ptr<key_image_filter>());
 
   // FIXME: not yet thread safe!!!  Use with care.
   mdb_env_close(m_env);
@@ -1360,6 +1509,10 @@ void BlockchainLMDB::reset()
     throw0(DB_ERROR(lmdb_error("Failed to drop m_block_heights: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_txs, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_txs: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_txs_pruned, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_txs_pruned: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_txs_prunable, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_txs_prunable: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_tx_indices, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_tx_indices: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_tx_outputs, 0))
@@ -1368,6 +1521,8 @@ void BlockchainLMDB::reset()
     throw0(DB_ERROR(lmdb_error("Failed to drop m_output_txs: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_output_amounts, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_output_amounts: ", result).c_str()));
+  if (auto result = mdb_drop(txn, m_output_distribution, 0))
+    throw0(DB_ERROR(lmdb_error("Failed to drop m_output_distribution: ", result).c_str()));
   if (auto result = mdb_drop(txn, m_spent_keys, 0))
     throw0(DB_ERROR(lmdb_error("Failed to drop m_spent_keys: ", result).c_str()));
   (void)mdb_drop(txn, m_hf_starting_heights, 0); // this one is dropped in new code
@@ -1385,6 +1540,8 @@ void BlockchainLMDB::reset()
   txn.commit();
   m_cum_size = 0;
   m_cum_count = 0;
+
+  build_key_image_filter();
 }
 
 std::vector<std::string> BlockchainLMDB::get_filenames() const
@@ -2054,7 +2211,6 @@ bool BlockchainLMDB::tx_exists(const crypto::hash& h) const
 
   TXN_PREFIX_RDONLY();
   RCURSOR(tx_indices);
-  RCURSOR(txs);
 
   MDB_val_set(key, h);
   bool tx_found = false;
@@ -2067,7 +2223,7 @@ bool BlockchainLMDB::tx_exists(const crypto::hash& h) const
     throw0(DB_ERROR(lmdb_error(std::string("DB error attempting to fetch transaction index from hash ") + epee::string_tools::pod_to_hex(h) + ": ", get_result).c_str()));
 
   // This isn't needed as part of the check. we're not checking consistency of db.
-  // get_result = mdb_cursor_get(m_cur_txs, &val_tx_index, &result, MDB_SET);
+  // get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_index, &result, MDB_SET);
   TIME_MEASURE_FINISH(time1);
   time_tx_exists += time1;
 
@@ -2149,7 +2305,72 @@ bool BlockchainLMDB::get_tx_blob(const crypto::hash& h, cryptonote::blobdata &bd
 
   TXN_PREFIX_RDONLY();
   RCURSOR(tx_indices);
-  RCURSOR(txs);
+  RCURSOR(txs_pruned);
+  RCURSOR(txs_prunable);
+
+  MDB_val_set(v, h);
+  MDB_val result0, result1;
+  auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val *)&zerokval, &v, MDB_GET_BOTH);
+  if (get_result == 0)
+  {
+    txindex *tip = (txindex *)v.mv_data;
+    MDB_val_set(val_tx_id, tip->data.tx_id);
+    get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result0, MDB_SET);
+    if (get_result == 0)
+      get_result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &result1, MDB_SET);
+  }
+  if (get_result == MDB_NOTFOUND)
+    return false;
+  else if (get_result)
+    throw0(DB_ERROR(lmdb_error("DB error attempting to fetch tx from hash", get_result).c_str()));
+
+  bd.reserve(result0.mv_size + result1.mv_size);
+  bd.assign(reinterpret_cast<char*>(result0.mv_data), result0.mv_size);
+  bd.append(reinterpret_cast<char*>(result1.mv_data), result1.mv_size);
+
+  TXN_POSTFIX_RDONLY();
+
+  return true;
+}
+
+bool BlockchainLMDB::get_pruned_tx_blob(const crypto::hash& h, cryptonote::blobdata &bd) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(tx_indices);
+  RCURSOR(txs_pruned);
+
+  MDB_val_set(v, h);
+  MDB_val result;
+  auto get_result = mdb_cursor_get(m_cur_tx_indices, (MDB_val *)&zerokval, &v, MDB_GET_BOTH);
+  if (get_result == 0)
+  {
+    txindex *tip = (txindex *)v.mv_data;
+    MDB_val_set(val_tx_id, tip->data.tx_id);
+    get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result, MDB_SET);
+  }
+  if (get_result == MDB_NOTFOUND)
+    return false;
+  else if (get_result)
+    throw0(DB_ERROR(lmdb_error("DB error attempting to fetch tx from hash", get_result).c_str()));
+
+  bd.assign(reinterpret_cast<char*>(result.mv_data), result.mv_size);
+
+  TXN_POSTFIX_RDONLY();
+
+  return true;
+}
+
+bool BlockchainLMDB::get_prunable_tx_blob(const crypto::hash& h, cryptonote::blobdata &bd) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(tx_indices);
+  RCURSOR(txs_prunable);
 
   MDB_val_set(v, h);
   MDB_val result;
@@ -2158,7 +2379,7 @@ bool BlockchainLMDB::get_tx_blob(const crypto::hash& h, cryptonote::blobdata &bd
   {
     txindex *tip = (txindex *)v.mv_data;
     MDB_val_set(val_tx_id, tip->data.tx_id);
-    get_result = mdb_cursor_get(m_cur_txs, &val_tx_id, &result, MDB_SET);
+    get_result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &result, MDB_SET);
   }
   if (get_result == MDB_NOTFOUND)
     return false;
@@ -2172,6 +2393,98 @@ bool BlockchainLMDB::get_tx_blob(const crypto::hash& h, cryptonote::blobdata &bd
   return true;
 }
 
+bool BlockchainLMDB::get_blocks_from(uint64_t start_height, size_t min_count, size_t max_count, size_t max_size, bool pruned, std::vector<block_blobs_entry>& blocks) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(blocks);
+  RCURSOR(tx_indices);
+  RCURSOR(txs_pruned);
+  RCURSOR(tx_outputs);
+  if (!pruned)
+  {
+    RCURSOR(txs_prunable);
+  }
+
+  blocks.clear();
+
+  MDB_val_copy<uint64_t> key(start_height);
+  MDB_val k, v;
+  int result = mdb_cursor_get(m_cur_blocks, &key, &v, MDB_SET);
+  if (result == MDB_NOTFOUND)
+    return false;
+  else if (result)
+    throw0(DB_ERROR(lmdb_error("Error attempting to retrieve a block blob from the db: ", result).c_str()));
+
+  // tx ids are allocated in chain order, so once the first miner tx is
+  // found, the txs of all following blocks are at consecutive ids
+  uint64_t tx_id = 0;
+  size_t size = 0;
+  while (blocks.size() < max_count && (blocks.size() < min_count || size < max_size))
+  {
+    blocks.resize(blocks.size() + 1);
+    block_blobs_entry &entry = blocks.back();
+    entry.block.assign(reinterpret_cast<char*>(v.mv_data), v.mv_size);
+    size += entry.block.size();
+
+    // the block does not record its tx count, so it has to be parsed
+    block b;
+    if (!parse_and_validate_block_from_blob(entry.block, b))
+      throw0(DB_ERROR("Failed to parse block from blob retrieved from the db"));
+
+    if (blocks.size() == 1)
+    {
+      crypto::hash miner_tx_hash = get_transaction_hash(b.miner_tx);
+      MDB_val_set(val_h, miner_tx_hash);
+      result = mdb_cursor_get(m_cur_tx_indices, (MDB_val *)&zerokval, &val_h, MDB_GET_BOTH);
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to find miner tx of block in the db: ", result).c_str()));
+      tx_id = ((const txindex *)val_h.mv_data)->data.tx_id;
+    }
+
+    entry.txs.reserve(b.tx_hashes.size());
+    entry.output_indices.resize(b.tx_hashes.size() + 1);
+    for (size_t n = 0; n <= b.tx_hashes.size(); ++n, ++tx_id)
+    {
+      MDB_val_set(val_tx_id, tx_id);
+      result = mdb_cursor_get(m_cur_tx_outputs, &val_tx_id, &v, MDB_SET);
+      if (result)
+        throw0(DB_ERROR(lmdb_error("DB error attempting to get data for tx_outputs[tx_index]", result).c_str()));
+      const uint64_t *indices = (const uint64_t*)v.mv_data;
+      entry.output_indices[n].assign(indices, indices + v.mv_size / sizeof(uint64_t));
+
+      // the miner tx is part of the block blob
+      if (n == 0)
+        continue;
+
+      result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &v, MDB_SET);
+      if (result)
+        throw0(DB_ERROR(lmdb_error("DB error attempting to fetch tx from tx id", result).c_str()));
+      entry.txs.push_back(cryptonote::blobdata(reinterpret_cast<char*>(v.mv_data), v.mv_size));
+      if (!pruned)
+      {
+        result = mdb_cursor_get(m_cur_txs_prunable, &val_tx_id, &v, MDB_SET);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("DB error attempting to fetch tx from tx id", result).c_str()));
+        entry.txs.back().append(reinterpret_cast<char*>(v.mv_data), v.mv_size);
+      }
+      size += entry.txs.back().size();
+    }
+
+    result = mdb_cursor_get(m_cur_blocks, &k, &v, MDB_NEXT);
+    if (result == MDB_NOTFOUND)
+      break;
+    else if (result)
+      throw0(DB_ERROR(lmdb_error("Error attempting to retrieve a block blob from the db: ", result).c_str()));
+  }
+
+  TXN_POSTFIX_RDONLY();
+
+  return true;
+}
+
 uint64_t BlockchainLMDB::get_tx_count() const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -2181,8 +2494,8 @@ uint64_t BlockchainLMDB::get_tx_count() const
   int result;
 
   MDB_stat db_stats;
-  if ((result = mdb_stat(m_txn, m_txs, &db_stats)))
-    throw0(DB_ERROR(lmdb_error("Failed to query m_txs: ", result).c_str()));
+  if ((result = mdb_stat(m_txn, m_txs_pruned, &db_stats)))
+    throw0(DB_ERROR(lmdb_error("Failed to query m_txs_pruned: ", result).c_str()));
 
   TXN_POSTFIX_RDONLY();
 
@@ -2258,7 +2571,7 @@ output_data_t BlockchainLMDB::get_output_key(const uint64_t &global_index) const
   TXN_PREFIX_RDONLY();
   RCURSOR(output_txs);
   RCURSOR(tx_indices);
-  RCURSOR(txs);
+  RCURSOR(txs_pruned);
 
   output_data_t od;
   MDB_val_set(v, global_index);
@@ -2278,7 +2591,7 @@ output_data_t BlockchainLMDB::get_output_key(const uint64_t &global_index) const
   txindex *tip = (txindex *)val_h.mv_data;
   MDB_val_set(val_tx_id, tip->data.tx_id);
   MDB_val result;
-  get_result = mdb_cursor_get(m_cur_txs, &val_tx_id, &result, MDB_SET);
+  get_result = mdb_cursor_get(m_cur_txs_pruned, &val_tx_id, &result, MDB_SET);
   if (get_result == MDB_NOTFOUND)
     throw1(TX_DNE(std::string("tx with hash ").append(epee::string_tools::pod_to_hex(ot->tx_hash)).append(" not found in db").c_str()));
   else if (get_result)
@@ -2288,7 +2601,7 @@ output_data_t BlockchainLMDB::get_output_key(const uint64_t &global_index) const
   bd.assign(reinterpret_cast<char*>(result.mv_data), result.mv_size);
 
   transaction tx;
-  if (!parse_and_validate_tx_from_blob(bd, tx))
+  if (!parse_and_validate_tx_base_from_blob(bd, tx))
     throw0(DB_ERROR("Failed to parse tx from blob retrieved from the db"));
 
   const tx_out tx_output = tx.vout[ot->local_index];
@@ -2411,6 +2724,10 @@ bool BlockchainLMDB::has_key_image(const crypto::key_image& img) const
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
   check_open();
 
+  std::shared_ptr<key_image_filter> filter = std::atomic_load(&m_key_image_filter);
+  if (filter && !filter->may_contain(img))
+    return false;
+
   bool ret;
 
   TXN_PREFIX_RDONLY();
@@ -2456,6 +2773,26 @@ bool BlockchainLMDB::for_all_key_images(std::function<bool(const crypto::key_ima
   return ret;
 }
 
+void BlockchainLMDB::build_key_image_filter()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  MDB_stat db_stats;
+  {
+    TXN_PREFIX_RDONLY();
+    if (auto result = mdb_stat(m_txn, m_spent_keys, &db_stats))
+      throw0(DB_ERROR(lmdb_error("Failed to query m_spent_keys: ", result).c_str()));
+    TXN_POSTFIX_RDONLY();
+  }
+
+  const uint64_t capacity = std::max<uint64_t>(KEY_IMAGE_FILTER_MIN_CAPACITY, db_stats.ms_entries * 2);
+  std::shared_ptr<key_image_filter> filter = std::make_shared<key_image_filter>(capacity);
+  for_all_key_images([&filter](const crypto::key_image &ki) { filter->add(ki); return true; });
+  std::atomic_store(&m_key_image_filter, filter);
+  MDEBUG("Built spent key image filter: " << filter->size() << " key images, capacity " << capacity);
+}
+
 bool BlockchainLMDB::for_blocks_range(const uint64_t& h1, const uint64_t& h2, std::function<bool(uint64_t, const crypto::hash&, const cryptonote::block&)> f) const
 {
   LOG_PRINT_L3("BlockchainLMDB::" << __func__);
@@ -2513,7 +2850,8 @@ bool BlockchainLMDB::for_all_transactions(std::function<bool(const crypto::hash&
   check_open();
 
   TXN_PREFIX_RDONLY();
-  RCURSOR(txs);
+  RCURSOR(txs_pruned);
+  RCURSOR(txs_prunable);
   RCURSOR(tx_indices);
 
   MDB_val k;
@@ -2534,13 +2872,17 @@ bool BlockchainLMDB::for_all_transactions(std::function<bool(const crypto::hash&
     const crypto::hash hash = ti->key;
     k.mv_data = (void *)&ti->data.tx_id;
     k.mv_size = sizeof(ti->data.tx_id);
-    ret = mdb_cursor_get(m_cur_txs, &k, &v, MDB_SET);
+    ret = mdb_cursor_get(m_cur_txs_pruned, &k, &v, MDB_SET);
     if (ret == MDB_NOTFOUND)
       break;
     if (ret)
       throw0(DB_ERROR(lmdb_error("Failed to enumerate transactions: ", ret).c_str()));
     blobdata bd;
     bd.assign(reinterpret_cast<char*>(v.mv_data), v.mv_size);
+    ret = mdb_cursor_get(m_cur_txs_prunable, &k, &v, MDB_SET);
+    if (ret)
+      throw0(DB_ERROR(lmdb_error("Failed to get prunable tx data: ", ret).c_str()));
+    bd.append(reinterpret_cast<char*>(v.mv_data), v.mv_size);
     transaction tx;
     if (!parse_and_validate_tx_from_blob(bd, tx))
       throw0(DB_ERROR("Failed to parse tx from blob retrieved from the db"));
@@ -3090,34 +3432,31 @@ std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> BlockchainLMDB::get
   }
 
   if (unlocked || recent_cutoff > 0) {
+    RCURSOR(output_distribution);
     const uint64_t blockchain_height = height();
+    const bool any_unlocked = blockchain_height >= CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE;
+    // outputs in blocks up to this height are unlocked
+    const uint64_t unlocked_height = any_unlocked ? blockchain_height - CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE : 0;
+
+    // the recent zone starts at the same height for all amounts, so find it once
+    uint64_t recent_height = unlocked_height + 1;
+    if (any_unlocked && recent_cutoff > 0)
+    {
+      while (recent_height > 0 && get_block_timestamp(recent_height - 1) >= recent_cutoff)
+        --recent_height;
+    }
+
     for (std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>>::iterator i = histogram.begin(); i != histogram.end(); ++i) {
-      uint64_t amount = i->first;
-      uint64_t num_elems = std::get<0>(i->second);
-      while (num_elems > 0) {
-        const tx_out_index toi = get_output_tx_and_index(amount, num_elems - 1);
-        const uint64_t height = get_tx_block_height(toi.first);
-        if (height + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE <= blockchain_height)
-          break;
-        --num_elems;
-      }
+      const uint64_t amount = i->first;
+      const uint64_t num_elems = any_unlocked ? get_cumulative_count(m_cur_output_distribution, amount, unlocked_height) : 0;
       // modifying second does not invalidate the iterator
       std::get<1>(i->second) = num_elems;
 
-      if (recent_cutoff > 0)
+      if (recent_cutoff > 0 && num_elems > 0)
       {
-        uint64_t recent = 0;
-        while (num_elems > 0) {
-          const tx_out_index toi = get_output_tx_and_index(amount, num_elems - 1);
-          const uint64_t height = get_tx_block_height(toi.first);
-          const uint64_t ts = get_block_timestamp(height);
-          if (ts < recent_cutoff)
-            break;
-          --num_elems;
-          ++recent;
-        }
+        const uint64_t older = recent_height > 0 ? get_cumulative_count(m_cur_output_distribution, amount, recent_height - 1) : 0;
         // modifying second does not invalidate the iterator
-        std::get<2>(i->second) = recent;
+        std::get<2>(i->second) = num_elems - older;
       }
     }
   }
@@ -3127,6 +3466,64 @@ std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> BlockchainLMDB::get
   return histogram;
 }
 
+uint64_t BlockchainLMDB::get_cumulative_num_outputs(const uint64_t& amount, uint64_t height) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(output_distribution);
+
+  uint64_t count = get_cumulative_count(m_cur_output_distribution, amount, height);
+
+  TXN_POSTFIX_RDONLY();
+
+  return count;
+}
+
+bool BlockchainLMDB::get_output_distribution(uint64_t amount, uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  check_open();
+
+  distribution.clear();
+  if (from_height > to_height || to_height >= height())
+    return false;
+
+  TXN_PREFIX_RDONLY();
+  RCURSOR(output_distribution);
+
+  base = from_height > 0 ? get_cumulative_count(m_cur_output_distribution, amount, from_height - 1) : 0;
+  distribution.reserve(to_height - from_height + 1);
+
+  // the count only changes at the heights which have an entry, in between it
+  // carries over from the previous block
+  MDB_val_set(k, amount);
+  outdist od = {from_height, 0};
+  MDB_val_set(v, od);
+  int result = mdb_cursor_get(m_cur_output_distribution, &k, &v, MDB_GET_BOTH_RANGE);
+  if (result && result != MDB_NOTFOUND)
+    throw0(DB_ERROR(lmdb_error("Failed to get output distribution: ", result).c_str()));
+  const outdist *next = result ? NULL : (const outdist*)v.mv_data;
+  uint64_t count = base;
+  for (uint64_t h = from_height; h <= to_height; ++h)
+  {
+    if (next && next->height == h)
+    {
+      count = next->count;
+      result = mdb_cursor_get(m_cur_output_distribution, &k, &v, MDB_NEXT_DUP);
+      if (result && result != MDB_NOTFOUND)
+        throw0(DB_ERROR(lmdb_error("Failed to get output distribution: ", result).c_str()));
+      next = result ? NULL : (const outdist*)v.mv_data;
+    }
+    distribution.push_back(count);
+  }
+
+  TXN_POSTFIX_RDONLY();
+
+  return true;
+}
+
 void BlockchainLMDB::check_hard_fork_info()
 {
 }
@@ -3669,7 +4066,7 @@ void BlockchainLMDB::migrate_0_1()
           throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs: ", result).c_str()));
         if (!i) {
           MDB_stat ms;
-          mdb_stat(txn, m_txs, &ms);
+          mdb_stat(txn, m_txs_pruned, &ms);
           i = ms.ms_entries;
           if (i) {
             MDB_val_set(pk, "txblk");
@@ -3750,11 +4147,234 @@ void BlockchainLMDB::migrate_0_1()
   txn.commit();
 }
 
+void BlockchainLMDB::migrate_1_2()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  uint64_t i, z;
+  int result;
+  mdb_txn_safe txn(false);
+  MDB_val v;
+
+  MLOG_YELLOW(el::Level::Info, "Migrating blockchain from DB version 1 to 2 - this may take a while:");
+  MINFO("splitting txs into txs_pruned and txs_prunable...");
+
+  do {
+    result = mdb_txn_begin(m_env, NULL, 0, txn);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+
+    MDB_stat db_stats_txs, db_stats_txs_pruned, db_stats_txs_prunable;
+    if ((result = mdb_stat(txn, m_txs, &db_stats_txs)))
+      throw0(DB_ERROR(lmdb_error("Failed to query m_txs: ", result).c_str()));
+    if ((result = mdb_stat(txn, m_txs_pruned, &db_stats_txs_pruned)))
+      throw0(DB_ERROR(lmdb_error("Failed to query m_txs_pruned: ", result).c_str()));
+    if ((result = mdb_stat(txn, m_txs_prunable, &db_stats_txs_prunable)))
+      throw0(DB_ERROR(lmdb_error("Failed to query m_txs_prunable: ", result).c_str()));
+    if (db_stats_txs_pruned.ms_entries != db_stats_txs_prunable.ms_entries)
+      throw0(DB_ERROR("Mismatched sizes for txs_pruned and txs_prunable"));
+    /* migrated txs are deleted from txs as we go, so an empty txs means we're done */
+    if (db_stats_txs.ms_entries == 0)
+    {
+      txn.commit();
+      LOG_PRINT_L1("  txs already migrated");
+      break;
+    }
+    z = db_stats_txs.ms_entries + db_stats_txs_pruned.ms_entries;
+    txn.commit();
+
+    MDB_cursor *c_old, *c_pruned, *c_prunable;
+    i = 0;
+
+    while(1) {
+      if (!(i % 1000)) {
+        if (i) {
+          LOGIF(el::Level::Info) {
+            std::cout << i << " / " << z << "  \r" << std::flush;
+          }
+          txn.commit();
+        }
+        result = mdb_txn_begin(m_env, NULL, 0, txn);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+        result = mdb_cursor_open(txn, m_txs, &c_old);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs: ", result).c_str()));
+        result = mdb_cursor_open(txn, m_txs_pruned, &c_pruned);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_pruned: ", result).c_str()));
+        result = mdb_cursor_open(txn, m_txs_prunable, &c_prunable);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to open a cursor for txs_prunable: ", result).c_str()));
+        if (!i) {
+          /* resume where an interrupted migration left off */
+          MDB_stat ms;
+          mdb_stat(txn, m_txs_pruned, &ms);
+          i = ms.ms_entries;
+        }
+      }
+
+      MDB_val_set(k, i);
+      result = mdb_cursor_get(c_old, &k, &v, MDB_SET);
+      if (result == MDB_NOTFOUND)
+      {
+        txn.commit();
+        break;
+      }
+      else if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to get a record from txs: ", result).c_str()));
+
+      cryptonote::blobdata bd;
+      bd.assign(reinterpret_cast<char*>(v.mv_data), v.mv_size);
+      transaction tx;
+      if (!parse_and_validate_tx_from_blob(bd, tx))
+        throw0(DB_ERROR("Failed to parse tx from blob retrieved from the db"));
+      size_t pruned_size;
+      if (!get_pruned_tx_size(tx, pruned_size) || pruned_size > bd.size())
+        throw0(DB_ERROR("Failed to serialize pruned tx"));
+
+      MDB_val pruned_blob = {pruned_size, (void*)bd.data()};
+      result = mdb_cursor_put(c_pruned, &k, &pruned_blob, MDB_APPEND);
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to put a record into txs_pruned: ", result).c_str()));
+
+      MDB_val prunable_blob = {bd.size() - pruned_size, (void*)(bd.data() + pruned_size)};
+      result = mdb_cursor_put(c_prunable, &k, &prunable_blob, MDB_APPEND);
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to put a record into txs_prunable: ", result).c_str()));
+
+      result = mdb_cursor_del(c_old, 0);
+      if (result)
+        throw0(DB_ERROR(lmdb_error("Failed to delete a record from txs: ", result).c_str()));
+
+      ++i;
+    }
+  } while(0);
+
+  uint32_t version = 2;
+  v.mv_data = (void *)&version;
+  v.mv_size = sizeof(version);
+  MDB_val_copy<const char *> vk("version");
+  result = mdb_txn_begin(m_env, NULL, 0, txn);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+  result = mdb_put(txn, m_properties, &vk, &v, 0);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to update version for the db: ", result).c_str()));
+  txn.commit();
+}
+
+void BlockchainLMDB::migrate_2_3()
+{
+  LOG_PRINT_L3("BlockchainLMDB::" << __func__);
+  uint64_t i, z;
+  int result;
+  mdb_txn_safe txn(false);
+  MDB_val k, v;
+
+  MLOG_YELLOW(el::Level::Info, "Migrating blockchain from DB version 2 to 3 - this may take a while:");
+  MINFO("building the per amount output distribution...");
+
+  do {
+    result = mdb_txn_begin(m_env, NULL, 0, txn);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+
+    /* the table is only used once complete, so an interrupted migration just starts over */
+    result = mdb_drop(txn, m_output_distribution, 0);
+    if (result)
+      throw0(DB_ERROR(lmdb_error("Failed to drop m_output_distribution: ", result).c_str()));
+
+    MDB_stat db_stats;
+    if ((result = mdb_stat(txn, m_output_amounts, &db_stats)))
+      throw0(DB_ERROR(lmdb_error("Failed to query m_output_amounts: ", result).c_str()));
+    z = db_stats.ms_entries;
+    txn.commit();
+
+    MDB_cursor *c_amounts, *c_dist;
+    uint64_t amount = 0, amount_index = 0;
+    outdist od = {0, 0};
+    bool have_od = false;
+    i = 0;
+
+    while(1) {
+      if (!(i % 10000)) {
+        if (i) {
+          LOGIF(el::Level::Info) {
+            std::cout << i << " / " << z << "  \r" << std::flush;
+          }
+          txn.commit();
+        }
+        result = mdb_txn_begin(m_env, NULL, 0, txn);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+        result = mdb_cursor_open(txn, m_output_amounts, &c_amounts);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to open a cursor for output_amounts: ", result).c_str()));
+        result = mdb_cursor_open(txn, m_output_distribution, &c_dist);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to open a cursor for output_distribution: ", result).c_str()));
+        if (i) {
+          /* pick up after the last output we looked at */
+          MDB_val_set(ka, amount);
+          MDB_val_set(va, amount_index);
+          result = mdb_cursor_get(c_amounts, &ka, &va, MDB_GET_BOTH);
+          if (result)
+            throw0(DB_ERROR(lmdb_error("Failed to find the last migrated output: ", result).c_str()));
+        }
+      }
+
+      result = mdb_cursor_get(c_amounts, &k, &v, i ? MDB_NEXT : MDB_FIRST);
+      if (result && result != MDB_NOTFOUND)
+        throw0(DB_ERROR(lmdb_error("Failed to get a record from output_amounts: ", result).c_str()));
+
+      const bool done = result == MDB_NOTFOUND;
+      const uint64_t next_amount = done ? 0 : *(const uint64_t*)k.mv_data;
+      const pre_rct_outkey *ok = done ? NULL : (const pre_rct_outkey*)v.mv_data;
+      if (have_od && (done || next_amount != amount || ok->data.height != od.height))
+      {
+        MDB_val_set(kd, amount);
+        MDB_val_set(vd, od);
+        result = mdb_cursor_put(c_dist, &kd, &vd, MDB_APPENDDUP);
+        if (result)
+          throw0(DB_ERROR(lmdb_error("Failed to put a record into output_distribution: ", result).c_str()));
+      }
+      if (done)
+      {
+        txn.commit();
+        break;
+      }
+
+      amount = next_amount;
+      amount_index = ok->amount_index;
+      od.height = ok->data.height;
+      od.count = amount_index + 1;
+      have_od = true;
+      ++i;
+    }
+  } while(0);
+
+  uint32_t version = 3;
+  v.mv_data = (void *)&version;
+  v.mv_size = sizeof(version);
+  MDB_val_copy<const char *> vk("version");
+  result = mdb_txn_begin(m_env, NULL, 0, txn);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to create a transaction for the db: ", result).c_str()));
+  result = mdb_put(txn, m_properties, &vk, &v, 0);
+  if (result)
+    throw0(DB_ERROR(lmdb_error("Failed to update version for the db: ", result).c_str()));
+  txn.commit();
+}
+
 void BlockchainLMDB::migrate(const uint32_t oldversion)
 {
   switch(oldversion) {
   case 0:
     migrate_0_1(); /* FALLTHRU */
+  case 1:
+    migrate_1_2(); /* FALLTHRU */
+  case 2:
+    migrate_2_3(); /* FALLTHRU */
   default:
     ;
   }
@@ -29,6 +29,7 @@
 #include <atomic>
 
 #include "blockchain_db/blockchain_db.h"
+#include "blockchain_db/key_image_filter.h"
 #include "cryptonote_basic/blobdatatype.h" // for type blobdata
 #include "ringct/rctTypes.h"
 #include <boost/thread/tss.hpp>
@@ -48,8 +49,10 @@ typedef struct mdb_txn_cursors
 
   MDB_cursor *m_txc_output_txs;
   MDB_cursor *m_txc_output_amounts;
+  MDB_cursor *m_txc_output_distribution;
 
-  MDB_cursor *m_txc_txs;
+  MDB_cursor *m_txc_txs_pruned;
+  MDB_cursor *m_txc_txs_prunable;
   MDB_cursor *m_txc_tx_indices;
   MDB_cursor *m_txc_tx_outputs;
 
@@ -66,7 +69,9 @@ typedef struct mdb_txn_cursors
 #define m_cur_block_info	m_cursors->m_txc_block_info
 #define m_cur_output_txs	m_cursors->m_txc_output_txs
 #define m_cur_output_amounts	m_cursors->m_txc_output_amounts
-#define m_cur_txs	m_cursors->m_txc_txs
+#define m_cur_output_distribution	m_cursors->m_txc_output_distribution
+#define m_cur_txs_pruned	m_cursors->m_txc_txs_pruned
+#define m_cur_txs_prunable	m_cursors->m_txc_txs_prunable
 #define m_cur_tx_indices	m_cursors->m_txc_tx_indices
 #define m_cur_tx_outputs	m_cursors->m_txc_tx_outputs
 #define m_cur_spent_keys	m_cursors->m_txc_spent_keys
@@ -82,7 +87,9 @@ typedef struct mdb_rflags
   bool m_rf_block_info;
   bool m_rf_output_txs;
   bool m_rf_output_amounts;
-  bool m_rf_txs;
+  bool m_rf_output_distribution;
+  bool m_rf_txs_pruned;
+  bool m_rf_txs_prunable;
   bool m_rf_tx_indices;
   bool m_rf_tx_outputs;
   bool m_rf_spent_keys;
@@ -217,6 +224,10 @@ public:
   virtual uint64_t get_tx_unlock_time(const crypto::hash& h) const;
 
   virtual bool get_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const;
+  virtual bool get_pruned_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const;
+  virtual bool get_prunable_tx_blob(const crypto::hash& h, cryptonote::blobdata &tx) const;
+
+  virtual bool get_blocks_from(uint64_t start_height, size_t min_count, size_t max_count, size_t max_size, bool pruned, std::vector<block_blobs_entry>& blocks) const;
 
   virtual uint64_t get_tx_count() const;
 
@@ -290,6 +301,10 @@ public:
    */
   std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> get_output_histogram(const std::vector<uint64_t> &amounts, bool unlocked, uint64_t recent_cutoff) const;
 
+  virtual uint64_t get_cumulative_num_outputs(const uint64_t& amount, uint64_t height) const;
+
+  virtual bool get_output_distribution(uint64_t amount, uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const;
+
 private:
   void do_resize(uint64_t size_increase=0);
 
@@ -368,8 +383,17 @@ private:
   // migrate from DB version 0 to 1
   void migrate_0_1();
 
+  // migrate from DB version 1 to 2
+  void migrate_1_2();
+
+  // migrate from DB version 2 to 3
+  void migrate_2_3();
+
   void cleanup_batch();
 
+  // (re)build the spent key image filter from the database
+  void build_key_image_filter();
+
 private:
   MDB_env* m_env;
 
@@ -377,12 +401,15 @@ private:
   MDB_dbi m_block_heights;
   MDB_dbi m_block_info;
 
-  MDB_dbi m_txs;
+  MDB_dbi m_txs;  // only used by migrations
+  MDB_dbi m_txs_pruned;
+  MDB_dbi m_txs_prunable;
   MDB_dbi m_tx_indices;
   MDB_dbi m_tx_outputs;
 
   MDB_dbi m_output_txs;
   MDB_dbi m_output_amounts;
+  MDB_dbi m_output_distribution;
 
   MDB_dbi m_spent_keys;
 
@@ -407,6 +434,9 @@ private:
   mdb_txn_cursors m_wcursors;
   mutable boost::thread_specific_ptr<mdb_threadinfo> m_tinfo;
 
+  // filter over m_spent_keys, replaced with std::atomic_store when rebuilt
+  std::shared_ptr<key_image_filter> m_key_image_filter;
+
 #if defined(__arm__)
   // force a value so it can compile with 32-bit ARM
   constexpr static uint64_t DEFAULT_MAPSIZE = 1LL << 31;
@@ -30,16 +30,20 @@
 #include <cstdio>
 #include <algorithm>
 #include <fstream>
+#include <memory>
 
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/thread/thread.hpp>
 #include "misc_log_ex.h"
+#include "misc_language.h"
 #include "bootstrap_file.h"
 #include "bootstrap_serialization.h"
 #include "cryptonote_basic/cryptonote_format_utils.h"
 #include "serialization/binary_utils.h" // dump_binary(), parse_binary()
 #include "serialization/json_utils.h" // dump_json()
 #include "include_base_utils.h"
+#include "common/threadpool.h"
 #include "blockchain_db/db_types.h"
 #include "cryptonote_core/cryptonote_core.h"
 
@@ -68,6 +72,35 @@ uint64_t db_batch_size = 100;
 uint64_t db_batch_size_verify = 5000;
 
 std::string refresh_string = "\r                                    \r";
+
+// a block read from the bootstrap file
+struct import_entry
+{
+  bootstrap::block_package bp;
+  cryptonote::block_complete_entry blobs; // serialized again, when verifying
+  crypto::hash hash;                      // when verifying
+};
+
+// consecutive blocks read from the bootstrap file
+struct import_batch
+{
+  import_batch(): bytes(0), quit(0) {}
+
+  std::vector<import_entry> entries;
+  uint64_t bytes;
+  int quit; // 1: nothing to read after these, 2: error
+};
+
+void show_progress(uint64_t height, uint64_t block_stop)
+{
+  int progress_interval = 10;
+  if (height % progress_interval == 0)
+  {
+    std::cout << refresh_string << "block " << height
+      << " / " << block_stop
+      << std::flush;
+  }
+}
 }
 
 
@@ -163,46 +196,160 @@ int pop_blocks(cryptonote::core& core, int num_blocks)
   return num_blocks;
 }
 
-int check_flush(cryptonote::core &core, std::list<block_complete_entry> &blocks, bool force)
+// reads up to count chunks, then checks and parses them in parallel, so the
+// next batch can be made ready while the current one is verified and written
+void read_batch(std::ifstream& import_file, const BootstrapFile& bootstrap, uint64_t height, uint64_t count, uint64_t block_stop, import_batch& batch)
 {
-  if (blocks.empty())
-    return 0;
-  if (!force && blocks.size() < db_batch_size)
-    return 0;
+  std::vector<std::string> chunks;
+  chunks.reserve(count);
+  char buffer1[1024];
+  std::string str1;
 
-  // wait till we can verify a full HOH without extra, for speed
-  uint64_t new_height = core.get_blockchain_storage().get_db().height() + blocks.size();
-  if (!force && new_height % HASH_OF_HASHES_STEP)
-    return 0;
+  while (chunks.size() < count)
+  {
+    if (height + chunks.size() > block_stop)
+    {
+      batch.quit = 1;
+      break;
+    }
 
-  std::list<crypto::hash> hashes;
-  for (const auto &b: blocks)
+    uint32_t chunk_size;
+    import_file.read(buffer1, sizeof(chunk_size));
+    if (! import_file) {
+      std::cout << refresh_string;
+      MINFO("End of file reached");
+      batch.quit = 1;
+      break;
+    }
+    batch.bytes += sizeof(chunk_size);
+
+    str1.assign(buffer1, sizeof(chunk_size));
+    if (! ::serialization::parse_binary(str1, chunk_size))
+    {
+      MFATAL("Error in deserialization of chunk size");
+      batch.quit = 2;
+      break;
+    }
+    MDEBUG("chunk_size: " << chunk_size);
+
+    if (chunk_size > BUFFER_SIZE)
+    {
+      MWARNING("WARNING: chunk_size " << chunk_size << " > BUFFER_SIZE " << BUFFER_SIZE);
+      MFATAL("Aborting: chunk size exceeds buffer size");
+      batch.quit = 2;
+      break;
+    }
+    if (chunk_size > CHUNK_SIZE_WARNING_THRESHOLD)
+    {
+      MINFO("NOTE: chunk_size " << chunk_size << " > " << CHUNK_SIZE_WARNING_THRESHOLD);
+    }
+    else if (chunk_size == 0) {
+      MFATAL("ERROR: chunk_size == 0");
+      batch.quit = 2;
+      break;
+    }
+    chunks.push_back(std::string(chunk_size, '\0'));
+    import_file.read(&chunks.back()[0], chunk_size);
+    if (! import_file) {
+      chunks.pop_back();
+      if (import_file.eof())
+      {
+        std::cout << refresh_string;
+        MINFO("End of file reached - file was truncated");
+        batch.quit = 1;
+      }
+      else
+      {
+        MFATAL("ERROR: unexpected end of file: bytes read before error: "
+            << import_file.gcount() << " of chunk_size " << chunk_size);
+        batch.quit = 2;
+      }
+      break;
+    }
+    batch.bytes += chunk_size;
+  }
+  MDEBUG("Read " << chunks.size() << " chunks, " << batch.bytes << " bytes");
+
+  // NOTE: one block per chunk, see NUM_BLOCKS_PER_CHUNK
+  batch.entries.resize(chunks.size());
+  std::unique_ptr<std::atomic<bool>[]> parsed(new std::atomic<bool>[chunks.size()]);
+  tools::threadpool& tpool = tools::threadpool::getInstance();
+  tools::threadpool::waiter waiter;
+  for (size_t i = 0; i < chunks.size(); ++i)
+  {
+    parsed[i] = false;
+    tpool.submit(&waiter, [&, i]() {
+      try
+      {
+        if (!bootstrap.check_chunk(height + i, chunks[i]))
+        {
+          MERROR("Chunk checksum mismatch");
+          return;
+        }
+        import_entry &e = batch.entries[i];
+        if (! ::serialization::parse_binary(chunks[i], e.bp))
+          return;
+        if (opt_verify)
+        {
+          cryptonote::block_to_blob(e.bp.block, e.blobs.block);
+          for (const auto &tx: e.bp.txs)
+          {
+            e.blobs.txs.push_back(cryptonote::blobdata());
+            cryptonote::tx_to_blob(tx, e.blobs.txs.back());
+          }
+          e.hash = cryptonote::get_block_hash(e.bp.block);
+        }
+        parsed[i] = true;
+      }
+      catch (const std::exception &e)
+      {
+        MERROR("Exception while parsing chunk: " << e.what());
+      }
+    });
+  }
+  waiter.wait();
+
+  for (size_t i = 0; i < chunks.size(); ++i)
   {
-    cryptonote::block block;
-    if (!parse_and_validate_block_from_blob(b.block, block))
+    if (!parsed[i])
     {
-      MERROR("Failed to parse block: "
-          << epee::string_tools::pod_to_hex(get_blob_hash(b.block)));
-      core.cleanup_handle_incoming_blocks();
-      return 1;
+      std::cout << refresh_string;
+      MFATAL("Error in deserialization of chunk, height=" << height + i);
+      batch.entries.resize(i);
+      batch.quit = 2;
+      break;
     }
-    hashes.push_back(cryptonote::get_block_hash(block));
   }
-  core.prevalidate_block_hashes(core.get_blockchain_storage().get_db().height(), hashes);
+}
+
+int verify_batch(cryptonote::core &core, import_batch &batch, uint64_t block_stop)
+{
+  std::list<block_complete_entry> blocks;
+  std::list<crypto::hash> hashes;
+  for (auto &e: batch.entries)
+  {
+    blocks.push_back(std::move(e.blobs));
+    hashes.push_back(e.hash);
+  }
+  uint64_t height = core.get_blockchain_storage().get_db().height();
+  core.prevalidate_block_hashes(height, hashes);
 
   core.prepare_handle_incoming_blocks(blocks);
 
   for(const block_complete_entry& block_entry: blocks)
   {
+    show_progress(height++, block_stop);
+
     // process transactions
-    for(auto& tx_blob: block_entry.txs)
+    std::vector<tx_verification_context> tvc;
+    core.handle_incoming_txs(block_entry.txs, tvc, true, true, false);
+    auto tx_blob = block_entry.txs.begin();
+    for (size_t i = 0; i < tvc.size(); ++i, ++tx_blob)
     {
-      tx_verification_context tvc = AUTO_VAL_INIT(tvc);
-      core.handle_incoming_tx(tx_blob, tvc, true, true, false);
-      if(tvc.m_verifivation_failed)
+      if(tvc[i].m_verifivation_failed)
       {
         MERROR("transaction verification failed, tx_id = "
-            << epee::string_tools::pod_to_hex(get_blob_hash(tx_blob)));
+            << epee::string_tools::pod_to_hex(get_blob_hash(*tx_blob)));
         core.cleanup_handle_incoming_blocks();
         return 1;
       }
@@ -232,7 +379,28 @@ int check_flush(cryptonote::core &core, std::list<block_complete_entry> &blocks,
   if (!core.cleanup_handle_incoming_blocks())
     return 1;
 
-  blocks.clear();
+  return 0;
+}
+
+int add_batch(cryptonote::core &core, const import_batch &batch, uint64_t height, uint64_t block_stop)
+{
+  for (const import_entry &entry: batch.entries)
+  {
+    show_progress(height++, block_stop);
+
+    // add_block() adds the miner tx first, so it is not in txs
+    try
+    {
+      const bootstrap::block_package &bp = entry.bp;
+      core.get_blockchain_storage().get_db().add_block(bp.block, bp.block_size, bp.cumulative_difficulty, bp.coins_generated, bp.txs);
+    }
+    catch (const std::exception& e)
+    {
+      std::cout << refresh_string;
+      MFATAL("Error adding block to blockchain: " << e.what());
+      return 1;
+    }
+  }
   return 0;
 }
 
@@ -267,6 +435,12 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
     return false;
   }
 
+  if (bootstrap.get_block_first() > start_height)
+  {
+    MFATAL("bootstrap file starts at block " << bootstrap.get_block_first() << ", past the next block to import: " << start_height);
+    return 2;
+  }
+
   std::cout << ENDL;
   std::cout << "Preparing to read blocks..." << ENDL;
   std::cout << ENDL;
@@ -285,18 +459,13 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
   // 4 byte magic + (currently) 1024 byte header structures
   bootstrap.seek_to_first_chunk(import_file);
 
-  std::string str1;
-  char buffer1[1024];
-  char buffer_block[BUFFER_SIZE];
-  block b;
-  transaction tx;
   int quit = 0;
-  uint64_t bytes_read;
 
   // Note that a new blockchain will start with block number 0 (total blocks: 1)
   // due to genesis block being added at initialization.
 
-  if (! block_stop)
+  // with an index, whatever follows the last block is not a chunk
+  if (! block_stop || block_stop > total_source_blocks - 1)
   {
     block_stop = total_source_blocks - 1;
   }
@@ -311,240 +480,112 @@ int import_from_file(cryptonote::core& core, const std::string& import_file_path
   MINFO("Reading blockchain from bootstrap file...");
   std::cout << ENDL;
 
-  std::list<block_complete_entry> blocks;
-
-  // Skip to start_height before we start adding.
+  // Skip to start_height before we start adding. With an index, pos is
+  // already there.
+  if (start_height > seek_height)
   {
     bool q2 = false;
     import_file.seekg(pos);
-    bytes_read = bootstrap.count_bytes(import_file, start_height-seek_height, h, q2);
+    bootstrap.count_bytes(import_file, start_height-seek_height, h, q2);
     if (q2)
     {
       quit = 2;
       goto quitting;
     }
-    h = start_height;
   }
-
-  if (use_batch)
+  else
   {
-    uint64_t bytes, h2;
-    bool q2;
-    pos = import_file.tellg();
-    bytes = bootstrap.count_bytes(import_file, db_batch_size, h2, q2);
-    if (import_file.eof())
-      import_file.clear();
     import_file.seekg(pos);
-    core.get_blockchain_storage().get_db().batch_start(db_batch_size, bytes);
   }
-  while (! quit)
-  {
-    uint32_t chunk_size;
-    import_file.read(buffer1, sizeof(chunk_size));
-    // TODO: bootstrap.read_chunk();
-    if (! import_file) {
-      std::cout << refresh_string;
-      MINFO("End of file reached");
-      quit = 1;
-      break;
-    }
-    bytes_read += sizeof(chunk_size);
-
-    str1.assign(buffer1, sizeof(chunk_size));
-    if (! ::serialization::parse_binary(str1, chunk_size))
-    {
-      throw std::runtime_error("Error in deserialization of chunk size");
-    }
-    MDEBUG("chunk_size: " << chunk_size);
-
-    if (chunk_size > BUFFER_SIZE)
-    {
-      MWARNING("WARNING: chunk_size " << chunk_size << " > BUFFER_SIZE " << BUFFER_SIZE);
-      throw std::runtime_error("Aborting: chunk size exceeds buffer size");
-    }
-    if (chunk_size > CHUNK_SIZE_WARNING_THRESHOLD)
+  h = start_height;
+
+  {
+    // when verifying, end batches on a hash of hashes boundary where
+    // possible, so they can be checked against it without extra blocks
+    auto batch_size = [](uint64_t height) {
+      uint64_t n = db_batch_size;
+      if (opt_verify && (height + n) / HASH_OF_HASHES_STEP * HASH_OF_HASHES_STEP > height)
+        n = (height + n) / HASH_OF_HASHES_STEP * HASH_OF_HASHES_STEP - height;
+      return n;
+    };
+
+    // read and parse the next batch on another thread, while this one
+    // verifies and writes the current batch
+    std::unique_ptr<import_batch> batch(new import_batch());
+    read_batch(import_file, bootstrap, h, batch_size(h), block_stop, *batch);
+    while (true)
     {
-      MINFO("NOTE: chunk_size " << chunk_size << " > " << CHUNK_SIZE_WARNING_THRESHOLD);
-    }
-    else if (chunk_size == 0) {
-      MFATAL("ERROR: chunk_size == 0");
-      return 2;
-    }
-    import_file.read(buffer_block, chunk_size);
-    if (! import_file) {
-      if (import_file.eof())
+      if (batch->quit > 1)
       {
-        std::cout << refresh_string;
-        MINFO("End of file reached - file was truncated");
-        quit = 1;
+        // don't add blocks from a batch which could not be read completely
+        quit = 2;
         break;
       }
-      else
+      if (batch->entries.empty())
+        break;
+
+      const uint64_t next_height = h + batch->entries.size();
+      std::unique_ptr<import_batch> next(new import_batch());
+      boost::thread reader;
+      if (!batch->quit)
+        reader = boost::thread([&]() { read_batch(import_file, bootstrap, next_height, batch_size(next_height), block_stop, *next); });
+      // the reader uses next and import_file, so it must not outlive them if
+      // verifying or adding the batch throws
+      auto join_reader = epee::misc_utils::create_scope_leave_handler([&reader]() {
+        if (reader.joinable())
+          reader.join();
+      });
+
+      int ret;
+      if (opt_verify)
       {
-        MFATAL("ERROR: unexpected end of file: bytes read before error: "
-            << import_file.gcount() << " of chunk_size " << chunk_size);
-        return 2;
+        ret = verify_batch(core, *batch, block_stop);
       }
-    }
-    bytes_read += chunk_size;
-    MDEBUG("Total bytes read: " << bytes_read);
-
-    if (h > block_stop)
-    {
-      std::cout << refresh_string << "block " << h-1
-        << " / " << block_stop
-        << std::flush;
-      std::cout << ENDL << ENDL;
-      MINFO("Specified block number reached - stopping.  block: " << h-1 << "  total blocks: " << h);
-      quit = 1;
-      break;
-    }
-
-    try
-    {
-      str1.assign(buffer_block, chunk_size);
-      bootstrap::block_package bp;
-      if (! ::serialization::parse_binary(str1, bp))
-        throw std::runtime_error("Error in deserialization of chunk");
-
-      int display_interval = 1000;
-      int progress_interval = 10;
-      // NOTE: use of NUM_BLOCKS_PER_CHUNK is a placeholder in case multi-block chunks are later supported.
-      for (int chunk_ind = 0; chunk_ind < NUM_BLOCKS_PER_CHUNK; ++chunk_ind)
+      else
       {
-        ++h;
-        if ((h-1) % display_interval == 0)
+        if (use_batch)
+          core.get_blockchain_storage().get_db().batch_start(batch->entries.size(), batch->bytes);
+        ret = add_batch(core, *batch, h, block_stop);
+        if (use_batch && !ret)
         {
           std::cout << refresh_string;
-          MDEBUG("loading block number " << h-1);
-        }
-        else
-        {
-          MDEBUG("loading block number " << h-1);
+          // zero-based height
+          std::cout << ENDL << "[- batch commit at height " << next_height-1 << " -]" << ENDL;
+          core.get_blockchain_storage().get_db().batch_stop();
+          std::cout << ENDL;
+          core.get_blockchain_storage().get_db().show_stats();
         }
-        b = bp.block;
-        MDEBUG("block prev_id: " << b.prev_id << ENDL);
-
-        if ((h-1) % progress_interval == 0)
-        {
-          std::cout << refresh_string << "block " << h-1
-            << " / " << block_stop
-            << std::flush;
-        }
-
-        if (opt_verify)
-        {
-          cryptonote::blobdata block;
-          cryptonote::block_to_blob(bp.block, block);
-          std::list<cryptonote::blobdata> txs;
-          for (const auto &tx: bp.txs)
-          {
-            txs.push_back(cryptonote::blobdata());
-            cryptonote::tx_to_blob(tx, txs.back());
-          }
-          blocks.push_back({block, txs});
-          int ret = check_flush(core, blocks, false);
-          if (ret)
-          {
-            quit = 2; // make sure we don't commit partial block data
-            break;
-          }
-        }
-        else
-        {
-          std::vector<transaction> txs;
-          std::vector<transaction> archived_txs;
-
-          archived_txs = bp.txs;
-
-          // tx number 1: coinbase tx
-          // tx number 2 onwards: archived_txs
-          for (const transaction &tx : archived_txs)
-          {
-            // add blocks with verification.
-            // for Blockchain and blockchain_storage add_new_block().
-            // for add_block() method, without (much) processing.
-            // don't add coinbase transaction to txs.
-            //
-            // because add_block() calls
-            // add_transaction(blk_hash, blk.miner_tx) first, and
-            // then a for loop for the transactions in txs.
-            txs.push_back(tx);
-          }
-
-          size_t block_size;
-          difficulty_type cumulative_difficulty;
-          uint64_t coins_generated;
+      }
 
-          block_size = bp.block_size;
-          cumulative_difficulty = bp.cumulative_difficulty;
-          coins_generated = bp.coins_generated;
+      if (reader.joinable())
+        reader.join();
 
-          try
-          {
-            core.get_blockchain_storage().get_db().add_block(b, block_size, cumulative_difficulty, coins_generated, txs);
-          }
-          catch (const std::exception& e)
-          {
-            std::cout << refresh_string;
-            MFATAL("Error adding block to blockchain: " << e.what());
-            quit = 2; // make sure we don't commit partial block data
-            break;
-          }
-
-          if (use_batch)
-          {
-            if ((h-1) % db_batch_size == 0)
-            {
-              uint64_t bytes, h2;
-              bool q2;
-              std::cout << refresh_string;
-              // zero-based height
-              std::cout << ENDL << "[- batch commit at height " << h-1 << " -]" << ENDL;
-              core.get_blockchain_storage().get_db().batch_stop();
-              pos = import_file.tellg();
-              bytes = bootstrap.count_bytes(import_file, db_batch_size, h2, q2);
-              import_file.seekg(pos);
-              core.get_blockchain_storage().get_db().batch_start(db_batch_size, bytes);
-              std::cout << ENDL;
-              core.get_blockchain_storage().get_db().show_stats();
-            }
-          }
-        }
-        ++num_imported;
+      if (ret)
+      {
+        // There was an error, so don't commit pending data.
+        // Destructor will abort write txn.
+        quit = 2;
+        break;
       }
-    }
-    catch (const std::exception& e)
-    {
-      std::cout << refresh_string;
-      MFATAL("exception while reading from file, height=" << h << ": " << e.what());
-      return 2;
-    }
-  } // while
 
-quitting:
-  import_file.close();
+      h = next_height;
+      num_imported += batch->entries.size();
 
-  if (opt_verify)
-  {
-    int ret = check_flush(core, blocks, true);
-    if (ret)
-      return ret;
+      if (batch->quit)
+        break;
+      batch = std::move(next);
+    }
   }
 
-  if (use_batch)
+  if (!quit && h > block_stop)
   {
-    if (quit > 1)
-    {
-      // There was an error, so don't commit pending data.
-      // Destructor will abort write txn.
-    }
-    else
-    {
-      core.get_blockchain_storage().get_db().batch_stop();
-    }
+    std::cout << ENDL << ENDL;
+    MINFO("Specified block number reached - stopping.  block: " << h-1 << "  total blocks: " << h);
   }
 
+quitting:
+  import_file.close();
+
   core.get_blockchain_storage().get_db().show_stats();
   MINFO("Number of blocks imported: " << num_imported);
   if (h > 0)
@@ -552,7 +593,7 @@ quitting:
     MINFO("Finished at block: " << h-1 << "  total blocks: " << h);
 
   std::cout << ENDL;
-  return 0;
+  return quit > 1 ? 2 : 0;
 }
 
 int main(int argc, char* argv[])
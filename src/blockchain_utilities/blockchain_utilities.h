@@ -36,5 +36,7 @@
 #define BUFFER_SIZE 1000000
 #define CHUNK_SIZE_WARNING_THRESHOLD 500000
 #define NUM_BLOCKS_PER_CHUNK 1
+// blocks serialized by one thread at a time when exporting
+#define NUM_BLOCKS_PER_EXPORT_RANGE 100
 #define BLOCKCHAIN_RAW "blockchain.raw"
 
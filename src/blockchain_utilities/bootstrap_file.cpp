@@ -29,6 +29,8 @@
 #include "bootstrap_serialization.h"
 #include "serialization/binary_utils.h" // dump_binary(), parse_binary()
 #include "serialization/json_utils.h" // dump_json()
+#include "common/threadpool.h"
+#include "common/util.h"
 
 #include "bootstrap_file.h"
 
@@ -48,11 +50,38 @@ namespace
   const uint32_t header_size = 1024;
 
   std::string refresh_string = "\r                                    \r";
+
+  // header structures are each preceded by their size
+  template<typename T>
+  void append_header_struct(std::string& header, const T& t, const char* name)
+  {
+    blobdata bd = t_serializable_object_to_blob(t);
+    MDEBUG(name << " size: " << bd.size());
+    uint32_t bd_size = bd.size();
+
+    std::string blob;
+    if (! ::serialization::dump_binary(bd_size, blob))
+    {
+      throw std::runtime_error(std::string("Error in serialization of ") + name + " size");
+    }
+    header += blob;
+    header += bd;
+  }
 }
 
 
 
-bool BootstrapFile::open_writer(const boost::filesystem::path& file_path)
+BootstrapFile::BootstrapFile():
+  m_blockchain_storage(NULL), m_tx_pool(NULL), m_raw_data_file(NULL),
+  m_height(0), m_cur_height(0), m_max_chunk(0), m_has_index(false)
+{
+  m_index_info.index_pos = 0;
+  m_index_info.index_size = 0;
+  m_index_info.index_hash = crypto::null_hash;
+  m_index.block_first = 0;
+}
+
+bool BootstrapFile::open_writer(const boost::filesystem::path& file_path, uint64_t block_start)
 {
   const boost::filesystem::path dir_path = file_path.parent_path();
   if (!dir_path.empty())
@@ -78,41 +107,83 @@ bool BootstrapFile::open_writer(const boost::filesystem::path& file_path)
   m_raw_data_file = new std::ofstream();
 
   bool do_initialize_file = false;
-  uint64_t num_blocks = 0;
+  uint64_t end_pos = 0;
 
   if (! boost::filesystem::exists(file_path))
   {
     MDEBUG("creating file");
     do_initialize_file = true;
-    num_blocks = 0;
+    m_index.block_first = block_start;
+    m_index.chunks.clear();
   }
   else
   {
-    num_blocks = count_blocks(file_path.string());
+    // keep the chunks already there, new ones are written over the index
+    std::ifstream import_file;
+    import_file.open(file_path.string(), std::ios_base::binary | std::ifstream::in);
+    if (import_file.fail())
+    {
+      MFATAL("import_file.open() fail");
+      return false;
+    }
+    seek_to_first_chunk(import_file);
+    if (load_index(import_file))
+      end_pos = m_index_info.index_pos;
+    else if (!rebuild_index(import_file, end_pos))
+      return false;
+    import_file.close();
+
+    const uint64_t num_blocks = m_index.block_first + m_index.chunks.size();
+    if (block_start && block_start != num_blocks)
+      MWARNING("appending to existing file, ignoring requested start height " << block_start);
     MDEBUG("appending to existing file with height: " << num_blocks-1 << "  total blocks: " << num_blocks);
   }
-  m_height = num_blocks;
+  m_height = m_index.block_first + m_index.chunks.size();
 
   if (do_initialize_file)
     m_raw_data_file->open(file_path.string(), std::ios_base::binary | std::ios_base::out | std::ios::trunc);
   else
-    m_raw_data_file->open(file_path.string(), std::ios_base::binary | std::ios_base::out | std::ios::app | std::ios::ate);
+    m_raw_data_file->open(file_path.string(), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
 
   if (m_raw_data_file->fail())
     return false;
 
-  m_output_stream = new boost::iostreams::stream<boost::iostreams::back_insert_device<buffer_type>>(m_buffer);
-  if (m_output_stream == nullptr)
+  // until the export completes, the header does not point at an index
+  initialize_file();
+  m_raw_data_file->flush();
+  if (m_raw_data_file->fail())
     return false;
 
-  if (do_initialize_file)
-    initialize_file();
+  if (!do_initialize_file)
+  {
+    // the old index is only cut off once the header no longer points at it
+    m_raw_data_file->close();
+    const std::error_code e = tools::sync_file(file_path.string());
+    if (e)
+    {
+      MFATAL("Failed to sync " << file_path << ": " << e.message());
+      return false;
+    }
+    boost::filesystem::resize_file(file_path, end_pos);
+    m_raw_data_file->open(file_path.string(), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+  }
+  m_raw_data_file->seekp(0, std::ios_base::end);
 
-  return true;
+  return !m_raw_data_file->fail();
 }
 
 
 bool BootstrapFile::initialize_file()
+{
+  bootstrap::index_info bii;
+  bii.index_pos = 0;
+  bii.index_size = 0;
+  bii.index_hash = crypto::null_hash;
+  write_header(bii);
+  return true;
+}
+
+void BootstrapFile::write_header(const bootstrap::index_info& bii)
 {
   const uint32_t file_magic = blockchain_raw_magic;
 
@@ -121,58 +192,78 @@ bool BootstrapFile::initialize_file()
   {
     throw std::runtime_error("Error in serialization of file magic");
   }
+  m_raw_data_file->seekp(0);
   *m_raw_data_file << blob;
 
   bootstrap::file_info bfi;
-  bfi.major_version = 0;
-  bfi.minor_version = 1;
+  bfi.major_version = 1;
+  bfi.minor_version = 0;
   bfi.header_size = header_size;
 
   bootstrap::blocks_info bbi;
-  bbi.block_first = 0;
-  bbi.block_last = 0;
-  bbi.block_last_pos = 0;
-
-  buffer_type buffer2;
-  boost::iostreams::stream<boost::iostreams::back_insert_device<buffer_type>> output_stream_header(buffer2);
+  bbi.block_first = m_index.block_first;
+  bbi.block_last = m_index.chunks.empty() ? m_index.block_first : m_index.block_first + m_index.chunks.size() - 1;
+  bbi.block_last_pos = m_index.chunks.empty() ? 0 : m_index.chunks.back().pos;
 
-  uint32_t bd_size = 0;
+  std::string header;
+  append_header_struct(header, bfi, "bootstrap::file_info");
+  append_header_struct(header, bbi, "bootstrap::blocks_info");
+  append_header_struct(header, bii, "bootstrap::index_info");
 
-  blobdata bd = t_serializable_object_to_blob(bfi);
-  MDEBUG("bootstrap::file_info size: " << bd.size());
-  bd_size = bd.size();
-
-  if (! ::serialization::dump_binary(bd_size, blob))
+  if (header.size() > header_size)
   {
-    throw std::runtime_error("Error in serialization of bootstrap::file_info size");
+    throw std::runtime_error("Error: bootstrap header structures exceed header size");
   }
-  output_stream_header << blob;
-  output_stream_header << bd;
+  header.resize(header_size, 0); // fill in rest with null bytes
+  m_raw_data_file->write(header.data(), header.size());
+}
 
-  bd = t_serializable_object_to_blob(bbi);
-  MDEBUG("bootstrap::blocks_info size: " << bd.size());
-  bd_size = bd.size();
+// Indexes the chunks of a file which has none, up to the last complete one.
+// A chunk cut short by an interrupted export is left out, so it gets
+// written over, as is an old index left behind by an append that was
+// interrupted before truncating the file.
+bool BootstrapFile::rebuild_index(std::ifstream& import_file, uint64_t& end_pos)
+{
+  MINFO("Indexing bootstrap file...");
+  m_index.chunks.clear();
+  end_pos = import_file.tellg();
 
-  if (! ::serialization::dump_binary(bd_size, blob))
+  uint32_t chunk_size;
+  char buf1[sizeof(chunk_size)];
+  std::string str1, chunk_data;
+  while (1)
   {
-    throw std::runtime_error("Error in serialization of bootstrap::blocks_info size");
+    bootstrap::chunk_info ci;
+    ci.pos = import_file.tellg();
+    import_file.read(buf1, sizeof(chunk_size));
+    if (! import_file)
+      break;
+    str1.assign(buf1, sizeof(chunk_size));
+    if (! ::serialization::parse_binary(str1, chunk_size))
+      throw std::runtime_error("Error in deserialization of chunk_size");
+    if (chunk_size == 0 || chunk_size > BUFFER_SIZE)
+    {
+      MWARNING("Invalid chunk_size " << chunk_size << " at file position " << ci.pos << ", the rest of the file will be overwritten");
+      break;
+    }
+    chunk_data.resize(chunk_size);
+    import_file.read(&chunk_data[0], chunk_size);
+    if (! import_file)
+    {
+      MWARNING("Incomplete chunk at file position " << ci.pos << " will be overwritten");
+      break;
+    }
+    ci.hash = crypto::cn_fast_hash(chunk_data.data(), chunk_data.size());
+    m_index.chunks.push_back(ci);
+    end_pos = ci.pos + sizeof(chunk_size) + chunk_size;
   }
-  output_stream_header << blob;
-  output_stream_header << bd;
-
-  output_stream_header.flush();
-  output_stream_header << std::string(header_size-buffer2.size(), 0); // fill in rest with null bytes
-  output_stream_header.flush();
-  std::copy(buffer2.begin(), buffer2.end(), std::ostreambuf_iterator<char>(*m_raw_data_file));
-
+  MINFO("Indexed " << m_index.chunks.size() << " chunks");
   return true;
 }
 
-void BootstrapFile::flush_chunk()
+void BootstrapFile::write_chunk(const chunk& c)
 {
-  m_output_stream->flush();
-
-  uint32_t chunk_size = m_buffer.size();
+  uint32_t chunk_size = c.data.size();
   // MTRACE("chunk_size " << chunk_size);
   if (chunk_size > BUFFER_SIZE)
   {
@@ -184,6 +275,11 @@ void BootstrapFile::flush_chunk()
   {
     throw std::runtime_error("Error in serialization of chunk size");
   }
+
+  bootstrap::chunk_info ci;
+  ci.pos = m_raw_data_file->tellp();
+  ci.hash = c.hash;
+
   *m_raw_data_file << blob;
 
   if (m_max_chunk < chunk_size)
@@ -191,8 +287,7 @@ void BootstrapFile::flush_chunk()
     m_max_chunk = chunk_size;
   }
   long pos_before = m_raw_data_file->tellp();
-  std::copy(m_buffer.begin(), m_buffer.end(), std::ostreambuf_iterator<char>(*m_raw_data_file));
-  m_raw_data_file->flush();
+  m_raw_data_file->write(c.data.data(), c.data.size());
   long pos_after = m_raw_data_file->tellp();
   long num_chars_written = pos_after - pos_before;
   if (static_cast<unsigned long>(num_chars_written) != chunk_size)
@@ -201,52 +296,50 @@ void BootstrapFile::flush_chunk()
     throw std::runtime_error("Error writing chunk");
   }
 
-  m_buffer.clear();
-  delete m_output_stream;
-  m_output_stream = new boost::iostreams::stream<boost::iostreams::back_insert_device<buffer_type>>(m_buffer);
-  MDEBUG("flushed chunk:  chunk_size: " << chunk_size);
+  m_index.chunks.push_back(ci);
+  MDEBUG("wrote chunk:  chunk_size: " << chunk_size);
 }
 
-void BootstrapFile::write_block(block& block)
+// Serializes the blocks of a height range, one per chunk. Ranges are read on
+// the thread pool, each in a read only txn of its own thread.
+void BootstrapFile::export_range(uint64_t block_start, uint64_t block_stop, std::vector<chunk>& chunks) const
 {
-  bootstrap::block_package bp;
-  bp.block = block;
-
-  std::vector<transaction> txs;
-
-  uint64_t block_height = boost::get<txin_gen>(block.miner_tx.vin.front()).height;
-
-
-  // now add all regular transactions
-  for (const auto& tx_id : block.tx_hashes)
+  BlockchainDB& db = m_blockchain_storage->get_db();
+  db.block_txn_start(true);
+  try
   {
-    if (tx_id == crypto::null_hash)
+    for (uint64_t height = block_start; height <= block_stop; ++height)
     {
-      throw std::runtime_error("Aborting: tx == null_hash");
-    }
-    transaction tx = m_blockchain_storage->get_db().get_tx(tx_id);
+      bootstrap::block_package bp;
+      bp.block = db.get_block_from_height(height);
 
-    txs.push_back(tx);
-  }
+      // now add all regular transactions
+      // these non-coinbase txs will be serialized using this structure
+      for (const auto& tx_id : bp.block.tx_hashes)
+      {
+        if (tx_id == crypto::null_hash)
+        {
+          throw std::runtime_error("Aborting: tx == null_hash");
+        }
+        bp.txs.push_back(db.get_tx(tx_id));
+      }
 
-  // these non-coinbase txs will be serialized using this structure
-  bp.txs = txs;
+      // These three attributes are currently necessary for a fast import that adds blocks without verification.
+      bp.block_size = db.get_block_size(height);
+      bp.cumulative_difficulty = db.get_block_cumulative_difficulty(height);
+      bp.coins_generated = db.get_block_already_generated_coins(height);
 
-  // These three attributes are currently necessary for a fast import that adds blocks without verification.
-  bool include_extra_block_data = true;
-  if (include_extra_block_data)
+      chunks.push_back(chunk());
+      chunks.back().data = t_serializable_object_to_blob(bp);
+      chunks.back().hash = crypto::cn_fast_hash(chunks.back().data.data(), chunks.back().data.size());
+    }
+  }
+  catch (...)
   {
-    size_t block_size = m_blockchain_storage->get_db().get_block_size(block_height);
-    difficulty_type cumulative_difficulty = m_blockchain_storage->get_db().get_block_cumulative_difficulty(block_height);
-    uint64_t coins_generated = m_blockchain_storage->get_db().get_block_already_generated_coins(block_height);
-
-    bp.block_size = block_size;
-    bp.cumulative_difficulty = cumulative_difficulty;
-    bp.coins_generated = coins_generated;
+    db.block_txn_stop();
+    throw;
   }
-
-  blobdata bd = t_serializable_object_to_blob(bp);
-  m_output_stream->write((const char*)bd.data(), bd.size());
+  db.block_txn_stop();
 }
 
 bool BootstrapFile::close()
@@ -254,27 +347,39 @@ bool BootstrapFile::close()
   if (m_raw_data_file->fail())
     return false;
 
+  // the index goes after the last chunk, and is written out before the
+  // header points at it
+  blobdata bd = t_serializable_object_to_blob(m_index);
+  bootstrap::index_info bii;
+  bii.index_pos = m_raw_data_file->tellp();
+  bii.index_size = bd.size();
+  bii.index_hash = crypto::cn_fast_hash(bd.data(), bd.size());
+  m_raw_data_file->write(bd.data(), bd.size());
+  m_raw_data_file->flush();
+  MDEBUG("bootstrap::chunk_index size: " << bd.size());
+
+  write_header(bii);
   m_raw_data_file->flush();
-  delete m_output_stream;
+
+  bool r = !m_raw_data_file->fail();
   delete m_raw_data_file;
-  return true;
+  m_raw_data_file = NULL;
+  return r;
 }
 
 
-bool BootstrapFile::store_blockchain_raw(Blockchain* _blockchain_storage, tx_memory_pool* _tx_pool, boost::filesystem::path& output_file, uint64_t requested_block_stop)
+bool BootstrapFile::store_blockchain_raw(Blockchain* _blockchain_storage, tx_memory_pool* _tx_pool, boost::filesystem::path& output_file, uint64_t requested_block_stop, uint64_t requested_block_start)
 {
   uint64_t num_blocks_written = 0;
   m_max_chunk = 0;
   m_blockchain_storage = _blockchain_storage;
   m_tx_pool = _tx_pool;
-  uint64_t progress_interval = 100;
   MINFO("Storing blocks raw data...");
-  if (!BootstrapFile::open_writer(output_file))
+  if (!BootstrapFile::open_writer(output_file, requested_block_start))
   {
     MFATAL("failed to open raw file for write");
     return false;
   }
-  block b;
 
   // block_start, block_stop use 0-based height. m_height uses 1-based height. So to resume export
   // from last exported block, block_start doesn't need to add 1 here, as it's already at the next
@@ -292,29 +397,57 @@ bool BootstrapFile::store_blockchain_raw(Blockchain* _blockchain_storage, tx_mem
     block_stop = m_blockchain_storage->get_current_blockchain_height() - 1;
     MINFO("Using block height of source blockchain: " << block_stop);
   }
-  for (m_cur_height = block_start; m_cur_height <= block_stop; ++m_cur_height)
+  MINFO("Exporting from block " << block_start);
+
+  // A round of consecutive ranges is serialized in parallel, then appended
+  // in height order, as a chunk's position is only known once the chunks
+  // before it are serialized.
+  tools::threadpool& tpool = tools::threadpool::getInstance();
+  const uint64_t num_ranges = std::max(tpool.get_max_concurrency(), 1);
+  for (m_cur_height = block_start; m_cur_height <= block_stop; )
   {
-    // this method's height refers to 0-based height (genesis block = height 0)
-    crypto::hash hash = m_blockchain_storage->get_block_id_by_height(m_cur_height);
-    m_blockchain_storage->get_block_by_hash(hash, b);
-    write_block(b);
-    if (m_cur_height % NUM_BLOCKS_PER_CHUNK == 0) {
-      flush_chunk();
-      num_blocks_written += NUM_BLOCKS_PER_CHUNK;
+    std::vector<std::vector<chunk>> ranges(num_ranges);
+    std::atomic<bool> failed(false);
+    tools::threadpool::waiter waiter;
+    for (uint64_t r = 0; r < num_ranges; ++r)
+    {
+      const uint64_t start = m_cur_height + r * NUM_BLOCKS_PER_EXPORT_RANGE;
+      if (start > block_stop)
+        break;
+      const uint64_t stop = std::min<uint64_t>(start + NUM_BLOCKS_PER_EXPORT_RANGE - 1, block_stop);
+      tpool.submit(&waiter, [&, r, start, stop]() {
+        try
+        {
+          export_range(start, stop, ranges[r]);
+        }
+        catch (const std::exception &e)
+        {
+          MERROR("Exception while exporting blocks " << start << " to " << stop << ": " << e.what());
+          failed = true;
+        }
+      });
     }
-    if (m_cur_height % progress_interval == 0) {
-      std::cout << refresh_string;
-      std::cout << "block " << m_cur_height << "/" << block_stop << std::flush;
+    waiter.wait();
+    if (failed)
+    {
+      // what was written so far is kept, a later export appends to it
+      m_raw_data_file->flush();
+      throw std::runtime_error("Aborting: failed to read blocks");
     }
+
+    for (const auto& range: ranges)
+    {
+      for (const auto& c: range)
+      {
+        write_chunk(c);
+        ++m_cur_height;
+        ++num_blocks_written;
+      }
+    }
+    std::cout << refresh_string;
+    std::cout << "block " << m_cur_height-1 << "/" << block_stop << std::flush;
   }
-  // NOTE: use of NUM_BLOCKS_PER_CHUNK is a placeholder in case multi-block chunks are later supported.
-  if (m_cur_height % NUM_BLOCKS_PER_CHUNK != 0)
-  {
-    flush_chunk();
-  }
-  // print message for last block, which may not have been printed yet due to progress_interval
-  std::cout << refresh_string;
-  std::cout << "block " << m_cur_height-1 << "/" << block_stop << ENDL;
+  std::cout << ENDL;
 
   MINFO("Number of blocks exported: " << num_blocks_written);
   if (num_blocks_written > 0)
@@ -368,12 +501,108 @@ uint64_t BootstrapFile::seek_to_first_chunk(std::ifstream& import_file)
   MINFO("bootstrap magic size: " << sizeof(file_magic));
   MINFO("bootstrap header size: " << bfi.header_size);
 
+  uint32_t buflen_blocks_info;
+
+  import_file.read(buf1, sizeof(buflen_blocks_info));
+  str1.assign(buf1, sizeof(buflen_blocks_info));
+  if (! import_file)
+    throw std::runtime_error("Error reading expected number of bytes");
+  if (! ::serialization::parse_binary(str1, buflen_blocks_info))
+    throw std::runtime_error("Error in deserialization of buflen_blocks_info");
+
+  if (buflen_blocks_info > sizeof(buf1))
+    throw std::runtime_error("Error: bootstrap::blocks_info size exceeds buffer size");
+  import_file.read(buf1, buflen_blocks_info);
+  if (! import_file)
+    throw std::runtime_error("Error reading expected number of bytes");
+  str1.assign(buf1, buflen_blocks_info);
+  bootstrap::blocks_info bbi;
+  if (! ::serialization::parse_binary(str1, bbi))
+    throw std::runtime_error("Error in deserialization of bootstrap::blocks_info");
+  m_index.block_first = bbi.block_first;
+  MINFO("bootstrap first block: " << bbi.block_first);
+
+  m_index_info.index_pos = 0;
+  m_index_info.index_size = 0;
+  m_index_info.index_hash = crypto::null_hash;
+  if (bfi.major_version >= 1)
+  {
+    uint32_t buflen_index_info;
+
+    import_file.read(buf1, sizeof(buflen_index_info));
+    str1.assign(buf1, sizeof(buflen_index_info));
+    if (! import_file)
+      throw std::runtime_error("Error reading expected number of bytes");
+    if (! ::serialization::parse_binary(str1, buflen_index_info))
+      throw std::runtime_error("Error in deserialization of buflen_index_info");
+
+    if (buflen_index_info > sizeof(buf1))
+      throw std::runtime_error("Error: bootstrap::index_info size exceeds buffer size");
+    import_file.read(buf1, buflen_index_info);
+    if (! import_file)
+      throw std::runtime_error("Error reading expected number of bytes");
+    str1.assign(buf1, buflen_index_info);
+    if (! ::serialization::parse_binary(str1, m_index_info))
+      throw std::runtime_error("Error in deserialization of bootstrap::index_info");
+  }
+
   uint64_t full_header_size = sizeof(file_magic) + bfi.header_size;
   import_file.seekg(full_header_size);
 
   return full_header_size;
 }
 
+bool BootstrapFile::load_index(std::ifstream& import_file)
+{
+  m_has_index = false;
+  if (m_index_info.index_pos == 0)
+  {
+    MINFO("bootstrap file has no index");
+    return false;
+  }
+
+  const std::streampos pos = import_file.tellg();
+  import_file.seekg(0, std::ios_base::end);
+  const uint64_t file_size = import_file.tellg();
+  if (m_index_info.index_pos > file_size || m_index_info.index_size > file_size - m_index_info.index_pos)
+  {
+    // the file was cut short after the index was written, scan it instead
+    MWARNING("bootstrap file index exceeds file size, ignoring it");
+    import_file.clear();
+    import_file.seekg(pos);
+    return false;
+  }
+
+  std::string blob(m_index_info.index_size, '\0');
+  import_file.seekg(m_index_info.index_pos);
+  import_file.read(&blob[0], blob.size());
+  if (! import_file)
+    throw std::runtime_error("Error reading expected number of bytes");
+  if (crypto::cn_fast_hash(blob.data(), blob.size()) != m_index_info.index_hash)
+    throw std::runtime_error("Error: bootstrap file index checksum mismatch");
+
+  bootstrap::chunk_index index;
+  if (! ::serialization::parse_binary(blob, index))
+    throw std::runtime_error("Error in deserialization of bootstrap::chunk_index");
+  if (index.block_first != m_index.block_first)
+    throw std::runtime_error("Error: bootstrap file index does not match header");
+  m_index = std::move(index);
+  m_has_index = true;
+  import_file.seekg(pos);
+
+  MINFO("bootstrap file index: " << m_index.chunks.size() << " chunks");
+  return true;
+}
+
+bool BootstrapFile::check_chunk(uint64_t height, const std::string& data) const
+{
+  if (!m_has_index)
+    return true;
+  if (height < m_index.block_first || height - m_index.block_first >= m_index.chunks.size())
+    return false;
+  return crypto::cn_fast_hash(data.data(), data.size()) == m_index.chunks[height - m_index.block_first].hash;
+}
+
 uint64_t BootstrapFile::count_bytes(std::ifstream& import_file, uint64_t blocks, uint64_t& h, bool& quit)
 {
   uint64_t bytes_read = 0;
@@ -463,6 +692,25 @@ uint64_t BootstrapFile::count_blocks(const std::string& import_file_path, std::s
   uint64_t full_header_size; // 4 byte magic + length of header structures
   full_header_size = seek_to_first_chunk(import_file);
 
+  if (load_index(import_file))
+  {
+    h = m_index.block_first + m_index.chunks.size();
+    if (start_height >= m_index.block_first && start_height < h)
+    {
+      start_pos = m_index.chunks[start_height - m_index.block_first].pos;
+      seek_height = start_height;
+    }
+    import_file.close();
+
+    std::cout << ENDL;
+    std::cout << "Read bootstrap file index" << ENDL;
+    std::cout << "First block:      " << m_index.block_first << ENDL;
+    std::cout << "Number of blocks: " << h << ENDL;
+    std::cout << ENDL;
+    return h;
+  }
+  h = m_index.block_first;
+
   MINFO("Scanning blockchain from bootstrap file...");
   bool quit = false;
   uint64_t bytes_read = 0, blocks;
@@ -48,6 +48,7 @@
 #include "version.h"
 
 #include "blockchain_utilities.h"
+#include "bootstrap_serialization.h"
 
 
 using namespace cryptonote;
@@ -57,34 +58,57 @@ class BootstrapFile
 {
 public:
 
+  BootstrapFile();
+
   uint64_t count_bytes(std::ifstream& import_file, uint64_t blocks, uint64_t& h, bool& quit);
   uint64_t count_blocks(const std::string& dir_path, std::streampos& start_pos, uint64_t& seek_height);
   uint64_t count_blocks(const std::string& dir_path);
   uint64_t seek_to_first_chunk(std::ifstream& import_file);
 
+  // Reads the chunk index of a file whose header was read by
+  // seek_to_first_chunk(). Returns false if the file has none: it predates
+  // indexes, or its export did not complete.
+  bool load_index(std::ifstream& import_file);
+  bool has_index() const { return m_has_index; }
+  const bootstrap::chunk_index& get_index() const { return m_index; }
+  // zero-based height of the file's first block
+  uint64_t get_block_first() const { return m_index.block_first; }
+  // Checks a chunk read from the file against the index. Always true for a
+  // file without an index.
+  bool check_chunk(uint64_t height, const std::string& data) const;
+
   bool store_blockchain_raw(cryptonote::Blockchain* cs, cryptonote::tx_memory_pool* txp,
-      boost::filesystem::path& output_file, uint64_t use_block_height=0);
+      boost::filesystem::path& output_file, uint64_t use_block_height=0, uint64_t block_start=0);
 
 protected:
 
+  // a serialized block_package, and the checksum it is indexed with
+  struct chunk
+  {
+    cryptonote::blobdata data;
+    crypto::hash hash;
+  };
+
   Blockchain* m_blockchain_storage;
 
   tx_memory_pool* m_tx_pool;
-  typedef std::vector<char> buffer_type;
   std::ofstream * m_raw_data_file;
-  buffer_type m_buffer;
-  boost::iostreams::stream<boost::iostreams::back_insert_device<buffer_type>>* m_output_stream;
 
   // open export file for write
-  bool open_writer(const boost::filesystem::path& file_path);
+  bool open_writer(const boost::filesystem::path& file_path, uint64_t block_start);
   bool initialize_file();
+  void write_header(const bootstrap::index_info& bii);
+  bool rebuild_index(std::ifstream& import_file, uint64_t& end_pos);
   bool close();
-  void write_block(block& block);
-  void flush_chunk();
+  void export_range(uint64_t block_start, uint64_t block_stop, std::vector<chunk>& chunks) const;
+  void write_chunk(const chunk& c);
 
 private:
 
   uint64_t m_height;
   uint64_t m_cur_height; // tracks current height during export
   uint32_t m_max_chunk;
+  bootstrap::index_info m_index_info;
+  bootstrap::chunk_index m_index;
+  bool m_has_index;
 };
@@ -66,6 +66,49 @@ namespace cryptonote
       END_SERIALIZE()
     };
 
+    // present in the header from major version 1 on
+    struct index_info
+    {
+      // file position and size of the chunk index, zero if the file has none
+      // (yet), eg if its export was interrupted
+      uint64_t index_pos;
+      uint64_t index_size;
+      crypto::hash index_hash;
+
+      BEGIN_SERIALIZE_OBJECT()
+        VARINT_FIELD(index_pos);
+        VARINT_FIELD(index_size);
+        FIELD(index_hash);
+      END_SERIALIZE()
+    };
+
+    struct chunk_info
+    {
+      // file position of the chunk's size prefix
+      uint64_t pos;
+      // cn_fast_hash of the chunk's data
+      crypto::hash hash;
+
+      BEGIN_SERIALIZE_OBJECT()
+        VARINT_FIELD(pos);
+        FIELD(hash);
+      END_SERIALIZE()
+    };
+
+    // written after the last chunk, one entry per chunk, so a reader can
+    // start at any height and check what it reads
+    struct chunk_index
+    {
+      // zero-based height of the first chunk's block
+      uint64_t block_first;
+      std::vector<chunk_info> chunks;
+
+      BEGIN_SERIALIZE_OBJECT()
+        VARINT_FIELD(block_first);
+        FIELD(chunks);
+      END_SERIALIZE()
+    };
+
     struct block_package
     {
       cryptonote::block block;
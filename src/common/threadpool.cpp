@@ -31,20 +31,26 @@
 #include <limits>
 #include <stdexcept>
 
+#include "misc_language.h"
+#include "misc_log_ex.h"
 #include "cryptonote_config.h"
 #include "common/util.h"
 
-static __thread int depth = 0;
+// index of the pool worker running on this thread, -1 for other threads
+static __thread int worker_index = -1;
 
 namespace tools
 {
-threadpool::threadpool() : running(true), active(0) {
+threadpool::threadpool() : running(true), next_queue(0), pending(0), submitted(0), executed(0), stolen(0), helped(0) {
   boost::thread::attributes attrs;
   attrs.set_stack_size(THREAD_STACK_SIZE);
   max = tools::get_max_concurrency();
-  size_t i = max;
-  while(i--) {
-    threads.push_back(boost::thread(attrs, boost::bind(&threadpool::run, this)));
+  if (max < 1)
+    max = 1;
+  for (int i = 0; i < max; ++i)
+    queues.emplace_back(new worker_queue());
+  for (int i = 0; i < max; ++i) {
+    threads.push_back(boost::thread(attrs, boost::bind(&threadpool::run, this, i)));
   }
 }
 
@@ -60,28 +66,105 @@ threadpool::~threadpool() {
 }
 
 void threadpool::submit(waiter *obj, std::function<void()> f) {
-  entry e = {obj, f};
-  boost::unique_lock<boost::mutex> lock(mutex);
-  if ((active == max && !queue.empty()) || depth > 0) {
-    // if all available threads are already running
-    // and there's work waiting, just run in current thread
-    lock.unlock();
-    ++depth;
-    f();
-    --depth;
-  } else {
-    if (obj)
-      obj->inc();
-    queue.push_back(e);
-    has_work.notify_one();
+  if (obj)
+    obj->inc();
+  ++submitted;
+  ++pending;
+  // workers keep their own tasks, others are spread round robin
+  const size_t index = worker_index >= 0 ? worker_index : next_queue++ % queues.size();
+  {
+    worker_queue &q = *queues[index];
+    const boost::unique_lock<boost::mutex> lock(q.mutex);
+    q.queue.push_back({obj, std::move(f)});
   }
+  const boost::unique_lock<boost::mutex> lock(mutex);
+  has_work.notify_one();
 }
 
 int threadpool::get_max_concurrency() {
   return max;
 }
 
+threadpool::stats threadpool::get_stats() const {
+  stats s;
+  s.submitted = submitted;
+  s.executed = executed;
+  s.stolen = stolen;
+  s.helped = helped;
+  s.queued = pending;
+  return s;
+}
+
+bool threadpool::pop(size_t index, entry &e) {
+  worker_queue &q = *queues[index];
+  const boost::unique_lock<boost::mutex> lock(q.mutex);
+  if (q.queue.empty())
+    return false;
+  e = std::move(q.queue.back());
+  q.queue.pop_back();
+  return true;
+}
+
+bool threadpool::steal(int index, entry &e) {
+  // start after our own queue, so thieves don't all go for the same one
+  const size_t n = queues.size();
+  const size_t start = index >= 0 ? index + 1 : next_queue % n;
+  for (size_t i = 0; i < n; ++i) {
+    const size_t victim = (start + i) % n;
+    if ((int)victim == index)
+      continue;
+    worker_queue &q = *queues[victim];
+    const boost::unique_lock<boost::mutex> lock(q.mutex);
+    if (q.queue.empty())
+      continue;
+    e = std::move(q.queue.front());
+    q.queue.pop_front();
+    return true;
+  }
+  return false;
+}
+
+bool threadpool::run_one(bool helping) {
+  entry e;
+  const int index = worker_index;
+  if (index < 0 || !pop(index, e)) {
+    if (!steal(index, e))
+      return false;
+    if (index >= 0)
+      ++stolen;
+  }
+  --pending;
+  if (helping)
+    ++helped;
+  // the waiter must hear about the task even if it throws, or it hangs
+  auto done = epee::misc_utils::create_scope_leave_handler([&e, this]() {
+    ++executed;
+    if (e.wo)
+      e.wo->dec();
+  });
+  try {
+    e.f();
+  } catch (const std::exception &ex) {
+    MERROR("Exception in threadpool task: " << ex.what());
+  } catch (...) {
+    MERROR("Unknown exception in threadpool task");
+  }
+  return true;
+}
+
 void threadpool::waiter::wait() {
+  threadpool &pool = threadpool::getInstance();
+  while (true) {
+    {
+      const boost::unique_lock<boost::mutex> lock(mt);
+      if (!num)
+        return;
+    }
+    // our tasks may be queued behind others, or not started yet:
+    // run whatever is pending rather than sit idle
+    if (!pool.run_one(true))
+      break;
+  }
   boost::unique_lock<boost::mutex> lock(mt);
   while(num) cv.wait(lock);
 }
@@ -98,26 +181,18 @@ void threadpool::waiter::dec() {
     cv.notify_one();
 }
 
-void threadpool::run() {
-  boost::unique_lock<boost::mutex> lock(mutex);
-  while (running) {
-    entry e;
-    while(queue.empty() && running)
+void threadpool::run(int index) {
+  worker_index = index;
+  while (true) {
+    if (run_one(false))
+      continue;
+    boost::unique_lock<boost::mutex> lock(mutex);
+    // submit bumps pending before notifying under this lock, so
+    // checking it here cannot miss a wakeup
+    while (running && pending == 0)
       has_work.wait(lock);
-    if (!running) break;
-
-    active++;
-    e = queue.front();
-    queue.pop_front();
-    lock.unlock();
-    ++depth;
-    e.f();
-    --depth;
-
-    if (e.wo)
-      e.wo->dec();
-    lock.lock();
-    active--;
+    if (!running)
+      break;
   }
 }
 }
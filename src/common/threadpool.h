@@ -30,14 +30,24 @@
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/thread.hpp>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <memory>
 #include <utility>
 #include <vector>
 
 namespace tools
 {
 //! A global thread pool
+//
+// Each worker thread has its own queue. Tasks submitted from a worker go
+// to the back of that worker's queue, and are taken from there again
+// (last in, first out) so nested work stays on the same thread. Tasks
+// submitted from other threads are spread over the queues. A worker
+// which runs out of work steals from the front of the other queues.
 class threadpool
 {
 public:
@@ -55,7 +65,10 @@ public:
     public:
     void inc();
     void dec();
-    void wait();  //! Wait for a set of tasks to finish.
+    // Wait for a set of tasks to finish. Queued tasks are run
+    // in the calling thread meanwhile, so waiting from within
+    // a task does not tie up a worker.
+    void wait();
     waiter() : num(0){}
     ~waiter() { wait(); }
   };
@@ -67,6 +80,16 @@ public:
 
   int get_max_concurrency();
 
+  // Counters, for diagnostics
+  struct stats {
+    uint64_t submitted;  // tasks submitted so far
+    uint64_t executed;   // tasks run so far
+    uint64_t stolen;     // tasks a worker took from another worker's queue
+    uint64_t helped;     // tasks run by a thread waiting on a waiter
+    uint64_t queued;     // tasks waiting to run now
+  };
+  stats get_stats() const;
+
   private:
     threadpool();
     ~threadpool();
@@ -74,14 +97,26 @@ public:
       waiter *wo;
       std::function<void()> f;
     } entry;
-    std::deque<entry> queue;
+    struct worker_queue {
+      boost::mutex mutex;
+      std::deque<entry> queue;
+    };
+    std::vector<std::unique_ptr<worker_queue>> queues;
     boost::condition_variable has_work;
     boost::mutex mutex;
     std::vector<boost::thread> threads;
-    int active;
     int max;
     bool running;
-    void run();
+    std::atomic<unsigned> next_queue;
+    std::atomic<uint64_t> pending;
+    std::atomic<uint64_t> submitted;
+    std::atomic<uint64_t> executed;
+    std::atomic<uint64_t> stolen;
+    std::atomic<uint64_t> helped;
+    bool pop(size_t index, entry &e);
+    bool steal(int index, entry &e);
+    bool run_one(bool helping);
+    void run(int index);
 };
 
 }
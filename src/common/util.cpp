@@ -52,6 +52,11 @@ using namespace epee;
   #include <sys/file.h>
   #include <sys/utsname.h>
   #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+#ifdef __linux__
+  #include <sched.h>
 #endif
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
@@ -521,6 +526,28 @@ std::string get_nix_version_display_string()
     return std::error_code(code, std::system_category());
   }
 
+  std::error_code sync_file(const std::string& filename)
+  {
+    int code = 0;
+#if defined(WIN32)
+    HANDLE handle = ::CreateFile(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (INVALID_HANDLE_VALUE == handle)
+      return std::error_code(static_cast<int>(::GetLastError()), std::system_category());
+    if (!::FlushFileBuffers(handle))
+      code = static_cast<int>(::GetLastError());
+    ::CloseHandle(handle);
+#else
+    // fsync flushes the file's data whichever descriptor it was written through
+    const int fd = ::open(filename.c_str(), O_WRONLY);
+    if (fd < 0)
+      return std::error_code(errno, std::system_category());
+    if (::fsync(fd) != 0)
+      code = errno;
+    ::close(fd);
+#endif
+    return std::error_code(code, std::system_category());
+  }
+
   bool sanitize_locale()
   {
     // boost::filesystem throws for "invalid" locales, such as en_US.UTF-8, or kjsdkfs,
@@ -577,15 +604,31 @@ std::string get_nix_version_display_string()
 
   namespace
   {
+    // the number of CPUs we may run on, which can be less than the number
+    // of CPUs in the machine if we were started with a restricted affinity
+    unsigned get_available_concurrency()
+    {
+#ifdef __linux__
+      cpu_set_t cpus;
+      if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0)
+      {
+        const int n = CPU_COUNT(&cpus);
+        if (n > 0)
+          return n;
+      }
+#endif
+      return boost::thread::hardware_concurrency();
+    }
+
     boost::mutex max_concurrency_lock;
-    unsigned max_concurrency = boost::thread::hardware_concurrency();
+    unsigned max_concurrency = get_available_concurrency();
   }
 
   void set_max_concurrency(unsigned n)
   {
     if (n < 1)
-      n = boost::thread::hardware_concurrency();
-    unsigned hwc = boost::thread::hardware_concurrency();
+      n = get_available_concurrency();
+    unsigned hwc = get_available_concurrency();
     if (n > hwc)
       n = hwc;
     boost::lock_guard<boost::mutex> lock(max_concurrency_lock);
@@ -131,6 +131,9 @@ namespace tools
   /*! \brief std::rename wrapper for nix and something strange for windows.
    */
   std::error_code replace_file(const std::string& replacement_name, const std::string& replaced_name);
+  /*! \brief flushes a file's data to disk, fsync for nix and FlushFileBuffers for windows.
+   */
+  std::error_code sync_file(const std::string& filename);
 
   bool sanitize_locale();
 
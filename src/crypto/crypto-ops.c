@@ -29,6 +29,7 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "warnings.h"
@@ -1558,20 +1559,20 @@ static void ge_precomp_cmov(ge_precomp *t, const ge_precomp *u, unsigned char b)
   fe_cmov(t->xy2d, u->xy2d, b);
 }
 
-static void select(ge_precomp *t, int pos, signed char b) {
+static void select(ge_precomp *t, const ge_precomp *row, signed char b) {
   ge_precomp minust;
   unsigned char bnegative = negative(b);
   unsigned char babs = b - (((-bnegative) & b) << 1);
 
   ge_precomp_0(t);
-  ge_precomp_cmov(t, &ge_base[pos][0], equal(babs, 1));
-  ge_precomp_cmov(t, &ge_base[pos][1], equal(babs, 2));
-  ge_precomp_cmov(t, &ge_base[pos][2], equal(babs, 3));
-  ge_precomp_cmov(t, &ge_base[pos][3], equal(babs, 4));
-  ge_precomp_cmov(t, &ge_base[pos][4], equal(babs, 5));
-  ge_precomp_cmov(t, &ge_base[pos][5], equal(babs, 6));
-  ge_precomp_cmov(t, &ge_base[pos][6], equal(babs, 7));
-  ge_precomp_cmov(t, &ge_base[pos][7], equal(babs, 8));
+  ge_precomp_cmov(t, &row[0], equal(babs, 1));
+  ge_precomp_cmov(t, &row[1], equal(babs, 2));
+  ge_precomp_cmov(t, &row[2], equal(babs, 3));
+  ge_precomp_cmov(t, &row[3], equal(babs, 4));
+  ge_precomp_cmov(t, &row[4], equal(babs, 5));
+  ge_precomp_cmov(t, &row[5], equal(babs, 6));
+  ge_precomp_cmov(t, &row[6], equal(babs, 7));
+  ge_precomp_cmov(t, &row[7], equal(babs, 8));
   fe_copy(minust.yplusx, t->yminusx);
   fe_copy(minust.yminusx, t->yplusx);
   fe_neg(minust.xy2d, t->xy2d);
@@ -1588,6 +1589,15 @@ Preconditions:
 */
 
 void ge_scalarmult_base(ge_p3 *h, const unsigned char *a) {
+  ge_scalarmult_fixed(h, a, ge_base);
+}
+
+/*
+h = a * P, where table holds the multiples of P made by ge_precomp_fixed.
+Same preconditions as ge_scalarmult_base, which is this with the table of B.
+*/
+
+void ge_scalarmult_fixed(ge_p3 *h, const unsigned char *a, const ge_precomp table[32][8]) {
   signed char e[64];
   signed char carry;
   ge_p1p1 r;
@@ -1614,7 +1624,7 @@ void ge_scalarmult_base(ge_p3 *h, const unsigned char *a) {
 
   ge_p3_0(h);
   for (i = 1; i < 64; i += 2) {
-    select(&t, i / 2, e[i]);
+    select(&t, table[i / 2], e[i]);
     ge_madd(&r, h, &t); ge_p1p1_to_p3(h, &r);
   }
 
@@ -1624,7 +1634,7 @@ void ge_scalarmult_base(ge_p3 *h, const unsigned char *a) {
   ge_p2_dbl(&r, &s); ge_p1p1_to_p3(h, &r);
 
   for (i = 0; i < 64; i += 2) {
-    select(&t, i / 2, e[i]);
+    select(&t, table[i / 2], e[i]);
     ge_madd(&r, h, &t); ge_p1p1_to_p3(h, &r);
   }
 }
@@ -1986,12 +1996,8 @@ static void ge_cached_cmov(ge_cached *t, const ge_cached *u, unsigned char b) {
 }
 
 /* Assumes that a[31] <= 127 */
-void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
-  signed char e[64];
+void ge_scalarmult_recode(signed char *e, const unsigned char *a) {
   int carry, carry2, i;
-  ge_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
-  ge_p1p1 t;
-  ge_p3 u;
 
   carry = 0; /* 0..1 */
   for (i = 0; i < 31; i++) {
@@ -2005,6 +2011,15 @@ void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
   carry2 = (carry + 8) >> 4; /* 0..8 */
   e[62] = carry - (carry2 << 4); /* -8..7 */
   e[63] = carry2; /* 0..8 */
+}
+
+/* e is a scalar recoded by ge_scalarmult_recode, which can be done once
+ * for a scalar used with many points */
+void ge_scalarmult_recoded(ge_p2 *r, const signed char *e, const ge_p3 *A) {
+  int i;
+  ge_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
+  ge_p1p1 t;
+  ge_p3 u;
 
   ge_p3_to_cached(&Ai[0], A);
   for (i = 0; i < 7; i++) {
@@ -2092,6 +2107,108 @@ void ge_double_scalarmult_precomp_vartime(ge_p2 *r, const unsigned char *a, cons
   ge_double_scalarmult_precomp_vartime2(r, a, Ai, b, Bi);
 }
 
+void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
+  signed char e[64];
+  ge_scalarmult_recode(e, a);
+  ge_scalarmult_recoded(r, e, A);
+}
+
+/* Same as ge_tobytes on each of n points, writing 32 * n bytes to s.
+ * The inversions of the Z coordinates are batched (Montgomery's trick),
+ * so a group of points costs one inversion and three multiplications
+ * per point. */
+#define GE_BATCH_TOBYTES_SIZE 64
+void ge_p2_batch_tobytes(unsigned char *s, const ge_p2 *h, size_t n) {
+  fe acc[GE_BATCH_TOBYTES_SIZE];
+  fe inv;
+  fe recip;
+  fe x;
+  fe y;
+  size_t i, j, count;
+
+  for (i = 0; i < n; i += count) {
+    count = n - i < GE_BATCH_TOBYTES_SIZE ? n - i : GE_BATCH_TOBYTES_SIZE;
+
+    /* acc[j] = Z[0] * ... * Z[j] */
+    fe_copy(acc[0], h[i].Z);
+    for (j = 1; j < count; j++) {
+      fe_mul(acc[j], acc[j - 1], h[i + j].Z);
+    }
+    fe_invert(inv, acc[count - 1]);
+
+    for (j = count; j-- > 0; ) {
+      if (j > 0) {
+        /* inv is 1 / (Z[0] * ... * Z[j]) */
+        fe_mul(recip, inv, acc[j - 1]);
+        fe_mul(inv, inv, h[i + j].Z);
+      } else {
+        fe_copy(recip, inv);
+      }
+      fe_mul(x, h[i + j].X, recip);
+      fe_mul(y, h[i + j].Y, recip);
+      fe_tobytes(s + 32 * (i + j), y);
+      s[32 * (i + j) + 31] ^= fe_isnegative(x) << 7;
+    }
+  }
+}
+
+/* Fills table so that table[i][j] = (j + 1) * 256^i * P, the layout of
+ * ge_base, for use with ge_scalarmult_fixed. The 256 points are made
+ * affine with a single batched inversion. */
+void ge_precomp_fixed(ge_precomp table[32][8], const ge_p3 *p) {
+  ge_p3 points[32][8];
+  fe acc[32 * 8];
+  ge_cached base;
+  ge_p1p1 t;
+  ge_p2 s;
+  fe inv;
+  fe recip;
+  fe x;
+  fe y;
+  int i, j, k;
+
+  points[0][0] = *p;
+  for (i = 0; i < 32; i++) {
+    if (i > 0) {
+      /* 256 * the previous row's first point */
+      ge_p3_dbl(&t, &points[i - 1][0]); ge_p1p1_to_p2(&s, &t);
+      for (k = 0; k < 6; k++) {
+        ge_p2_dbl(&t, &s); ge_p1p1_to_p2(&s, &t);
+      }
+      ge_p2_dbl(&t, &s); ge_p1p1_to_p3(&points[i][0], &t);
+    }
+    ge_p3_to_cached(&base, &points[i][0]);
+    for (j = 1; j < 8; j++) {
+      ge_add(&t, &points[i][j - 1], &base);
+      ge_p1p1_to_p3(&points[i][j], &t);
+    }
+  }
+
+  /* acc[k] = Z[0] * ... * Z[k] */
+  fe_copy(acc[0], points[0][0].Z);
+  for (k = 1; k < 32 * 8; k++) {
+    fe_mul(acc[k], acc[k - 1], points[k / 8][k % 8].Z);
+  }
+  fe_invert(inv, acc[32 * 8 - 1]);
+
+  for (k = 32 * 8; k-- > 0; ) {
+    const ge_p3 *q = &points[k / 8][k % 8];
+    ge_precomp *r = &table[k / 8][k % 8];
+    if (k > 0) {
+      fe_mul(recip, inv, acc[k - 1]);
+      fe_mul(inv, inv, q->Z);
+    } else {
+      fe_copy(recip, inv);
+    }
+    fe_mul(x, q->X, recip);
+    fe_mul(y, q->Y, recip);
+    fe_add(r->yplusx, y, x);
+    fe_sub(r->yminusx, y, x);
+    fe_mul(r->xy2d, x, y);
+    fe_mul(r->xy2d, r->xy2d, fe_d2);
+  }
+}
+
 void ge_mul8(ge_p1p1 *r, const ge_p2 *t) {
   ge_p2 u;
   ge_p2_dbl(r, t);
@@ -30,6 +30,8 @@
 
 #pragma once
 
+#include <stddef.h>
+
 /* From fe.h */
 
 typedef int32_t fe[10];
@@ -115,6 +117,7 @@ void ge_p3_tobytes(unsigned char *, const ge_p3 *);
 
 extern const ge_precomp ge_base[32][8];
 void ge_scalarmult_base(ge_p3 *, const unsigned char *);
+void ge_scalarmult_fixed(ge_p3 *, const unsigned char *, const ge_precomp [32][8]);
 
 /* From ge_tobytes.c */
 
@@ -127,6 +130,10 @@ void sc_reduce(unsigned char *);
 /* New code */
 
 void ge_scalarmult(ge_p2 *, const unsigned char *, const ge_p3 *);
+void ge_scalarmult_recode(signed char *, const unsigned char *);
+void ge_scalarmult_recoded(ge_p2 *, const signed char *, const ge_p3 *);
+void ge_p2_batch_tobytes(unsigned char *, const ge_p2 *, size_t);
+void ge_precomp_fixed(ge_precomp [32][8], const ge_p3 *);
 void ge_double_scalarmult_precomp_vartime(ge_p2 *, const unsigned char *, const ge_p3 *, const unsigned char *, const ge_dsmp);
 void ge_double_scalarmult_precomp_vartime2(ge_p2 *, const unsigned char *, const ge_dsmp, const unsigned char *, const ge_dsmp);
 void ge_mul8(ge_p1p1 *, const ge_p2 *);
@@ -208,6 +208,68 @@ namespace crypto {
     return true;
   }
 
+  void crypto_ops::generate_key_derivations(const public_key *keys, std::size_t count, const secret_key &key, key_derivation *derivations, bool *valid) {
+    signed char e[64];
+    std::vector<ge_p2> points;
+    std::vector<std::size_t> indices;
+    assert(sc_check(&key) == 0);
+    ge_scalarmult_recode(e, reinterpret_cast<const unsigned char*>(&key));
+    points.reserve(count);
+    indices.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      ge_p3 point;
+      ge_p2 point2;
+      ge_p1p1 point3;
+      valid[i] = ge_frombytes_vartime(&point, &keys[i]) == 0;
+      if (!valid[i]) {
+        continue;
+      }
+      ge_scalarmult_recoded(&point2, e, &point);
+      ge_mul8(&point3, &point2);
+      points.push_back(ge_p2());
+      ge_p1p1_to_p2(&points.back(), &point3);
+      indices.push_back(i);
+    }
+    memwipe(e, sizeof(e));
+
+    std::vector<ec_point> results(points.size());
+    ge_p2_batch_tobytes(reinterpret_cast<unsigned char*>(results.data()), points.data(), points.size());
+    for (std::size_t n = 0; n < indices.size(); ++n) {
+      memcpy(&derivations[indices[n]], &results[n], sizeof(ec_point));
+    }
+  }
+
+  void crypto_ops::derive_subaddress_public_keys(const public_key *out_keys, const key_derivation *derivations, const std::size_t *output_indices, std::size_t count, public_key *results, bool *valid) {
+    std::vector<ge_p2> points;
+    std::vector<std::size_t> indices;
+    points.reserve(count);
+    indices.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      ec_scalar scalar;
+      ge_p3 point1;
+      ge_p3 point2;
+      ge_cached point3;
+      ge_p1p1 point4;
+      valid[i] = ge_frombytes_vartime(&point1, &out_keys[i]) == 0;
+      if (!valid[i]) {
+        continue;
+      }
+      derivation_to_scalar(derivations[i], output_indices[i], scalar);
+      ge_scalarmult_base(&point2, &scalar);
+      ge_p3_to_cached(&point3, &point2);
+      ge_sub(&point4, &point1, &point3);
+      points.push_back(ge_p2());
+      ge_p1p1_to_p2(&points.back(), &point4);
+      indices.push_back(i);
+    }
+
+    std::vector<ec_point> keys(points.size());
+    ge_p2_batch_tobytes(reinterpret_cast<unsigned char*>(keys.data()), points.data(), points.size());
+    for (std::size_t n = 0; n < indices.size(); ++n) {
+      memcpy(&results[indices[n]], &keys[n], sizeof(ec_point));
+    }
+  }
+
   struct s_comm {
     hash h;
     ec_point key;
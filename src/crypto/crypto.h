@@ -129,6 +129,10 @@ namespace crypto {
     friend void derive_secret_key(const key_derivation &, std::size_t, const secret_key &, secret_key &);
     static bool derive_subaddress_public_key(const public_key &, const key_derivation &, std::size_t, public_key &);
     friend bool derive_subaddress_public_key(const public_key &, const key_derivation &, std::size_t, public_key &);
+    static void generate_key_derivations(const public_key *, std::size_t, const secret_key &, key_derivation *, bool *);
+    friend void generate_key_derivations(const public_key *, std::size_t, const secret_key &, key_derivation *, bool *);
+    static void derive_subaddress_public_keys(const public_key *, const key_derivation *, const std::size_t *, std::size_t, public_key *, bool *);
+    friend void derive_subaddress_public_keys(const public_key *, const key_derivation *, const std::size_t *, std::size_t, public_key *, bool *);
     static void generate_signature(const hash &, const public_key &, const secret_key &, signature &);
     friend void generate_signature(const hash &, const public_key &, const secret_key &, signature &);
     static bool check_signature(const hash &, const public_key &, const signature &);
@@ -208,6 +212,18 @@ namespace crypto {
     return crypto_ops::derive_subaddress_public_key(out_key, derivation, output_index, result);
   }
 
+  /* Batched variants, for scanning many keys with the same secret key. The scalar
+   * is recoded once for all the keys, and the conversions of the results to affine
+   * coordinates share a field inversion. valid[i] is set to whether keys[i] (or
+   * out_keys[i]) is a valid point, the matching result is left untouched if not.
+   */
+  inline void generate_key_derivations(const public_key *keys, std::size_t count, const secret_key &key, key_derivation *derivations, bool *valid) {
+    crypto_ops::generate_key_derivations(keys, count, key, derivations, valid);
+  }
+  inline void derive_subaddress_public_keys(const public_key *out_keys, const key_derivation *derivations, const std::size_t *output_indices, std::size_t count, public_key *results, bool *valid) {
+    crypto_ops::derive_subaddress_public_keys(out_keys, derivations, output_indices, count, results, valid);
+  }
+
   /* Generation and checking of a standard signature.
    */
   inline void generate_signature(const hash &prefix_hash, const public_key &pub, const secret_key &sec, signature &sig) {
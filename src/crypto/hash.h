@@ -75,6 +75,13 @@ namespace crypto {
     cn_slow_hash(data, length, reinterpret_cast<char *>(&hash));
   }
 
+  /*
+    Computes count slow hashes, several at a time per core when the CPU allows
+  */
+  inline void cn_slow_hash_multi(const void *const *data, const std::size_t *length, std::size_t count, hash *hashes) {
+    cn_slow_hash_multi(data, length, count, reinterpret_cast<char *>(hashes));
+  }
+
   inline void tree_hash(const hash *hashes, std::size_t count, hash &root_hash) {
     tree_hash(reinterpret_cast<const char (*)[HASH_SIZE]>(hashes), count, reinterpret_cast<char *>(&root_hash));
   }
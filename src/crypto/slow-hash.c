@@ -135,6 +135,34 @@ extern int aesb_pseudo_round(const uint8_t *in, uint8_t *out, const uint8_t *exp
   a[0] ^= b[0]; a[1] ^= b[1]; \
   _b = _c; \
 
+/*
+ * The same as pre_aes and post_aes, for one of the hashes cn_slow_hash_multi
+ * computes together, with its variables suffixed by n, and its scratchpad.
+ */
+#if defined(_MSC_VER)
+#define __mul_n(n) lo##n = _umul128(c##n[0], b##n[0], &hi##n);
+#else
+#define __mul_n(n) ASM("mulq %3\n\t" : "=d"(hi##n), "=a"(lo##n) : "%a" (c##n[0]), "rm" (b##n[0]) : "cc");
+#endif
+
+#define pre_aes_n(n, pad) \
+  j##n = state_index(a##n); \
+  _c##n = _mm_load_si128(R128(&pad[j##n])); \
+  _a##n = _mm_load_si128(R128(a##n)); \
+
+#define post_aes_n(n, pad) \
+  _mm_store_si128(R128(c##n), _c##n); \
+  _b##n = _mm_xor_si128(_b##n, _c##n); \
+  _mm_store_si128(R128(&pad[j##n]), _b##n); \
+  j##n = state_index(c##n); \
+  p##n = U64(&pad[j##n]); \
+  b##n[0] = p##n[0]; b##n[1] = p##n[1]; \
+  __mul_n(n); \
+  a##n[0] += hi##n; a##n[1] += lo##n; \
+  p##n[0] = a##n[0];  p##n[1] = a##n[1]; \
+  a##n[0] ^= b##n[0]; a##n[1] ^= b##n[1]; \
+  _b##n = _c##n; \
+
 #if defined(_MSC_VER)
 #define THREADV __declspec(thread)
 #else
@@ -156,6 +184,12 @@ union cn_slow_hash_state
 THREADV uint8_t *hp_state = NULL;
 THREADV int hp_allocated = 0;
 
+/* cn_slow_hash_multi interleaves this many hashes, each with its own 2MB of hp_state_multi */
+#define MULTI_WAYS 2
+
+THREADV uint8_t *hp_state_multi = NULL;
+THREADV int hp_multi_allocated = 0;
+
 #if defined(_MSC_VER)
 #define cpuid(info,x)    __cpuidex(info,x,0)
 #else
@@ -421,68 +455,94 @@ BOOL SetLockPagesPrivilege(HANDLE hProcess, BOOL bEnable)
 #endif
 
 /**
- * @brief allocate the 2MB scratch buffer using OS support for huge pages, if available
+ * @brief allocate a scratch buffer using OS support for huge pages, if available
  *
- * This function tries to allocate the 2MB scratch buffer using a single
- * 2MB "huge page" (instead of the usual 4KB page sizes) to reduce TLB misses
- * during the random accesses to the scratch buffer.  This is one of the
- * important speed optimizations needed to make CryptoNight faster.
+ * This function tries to allocate the scratch buffer using 2MB "huge pages"
+ * (instead of the usual 4KB page sizes) to reduce TLB misses during the
+ * random accesses to the scratch buffer.  This is one of the important speed
+ * optimizations needed to make CryptoNight faster.
  *
- * No parameters.  Updates a thread-local pointer, hp_state, to point to
- * the allocated buffer.
+ * @param size the size of the buffer, a multiple of 2MB
+ * @param hugepages set to whether the buffer was allocated with huge pages
+ * @return the buffer
  */
 
-void slow_hash_allocate_state(void)
+STATIC uint8_t *allocate_scratchpad(size_t size, int *hugepages)
 {
-    if(hp_state != NULL)
-        return;
+    uint8_t *pad;
 
 #if defined(_MSC_VER) || defined(__MINGW32__)
     SetLockPagesPrivilege(GetCurrentProcess(), TRUE);
-    hp_state = (uint8_t *) VirtualAlloc(hp_state, MEMORY, MEM_LARGE_PAGES |
-                                        MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    pad = (uint8_t *) VirtualAlloc(NULL, size, MEM_LARGE_PAGES |
+                                   MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
 #else
 #if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) || \
   defined(__DragonFly__)
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANON, 0, 0);
+    pad = mmap(0, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANON, 0, 0);
 #else
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
+    pad = mmap(0, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
 #endif
-    if(hp_state == MAP_FAILED)
-        hp_state = NULL;
+    if(pad == MAP_FAILED)
+        pad = NULL;
 #endif
-    hp_allocated = 1;
-    if(hp_state == NULL)
+    *hugepages = 1;
+    if(pad == NULL)
     {
-        hp_allocated = 0;
-        hp_state = (uint8_t *) malloc(MEMORY);
+        *hugepages = 0;
+        pad = (uint8_t *) malloc(size);
     }
+    return pad;
 }
 
-/**
- *@brief frees the state allocated by slow_hash_allocate_state
- */
-
-void slow_hash_free_state(void)
+STATIC void free_scratchpad(uint8_t *pad, size_t size, int hugepages)
 {
-    if(hp_state == NULL)
-        return;
-
-    if(!hp_allocated)
-        free(hp_state);
+    if(!hugepages)
+        free(pad);
     else
     {
 #if defined(_MSC_VER) || defined(__MINGW32__)
-        VirtualFree(hp_state, MEMORY, MEM_RELEASE);
+        VirtualFree(pad, 0, MEM_RELEASE);
 #else
-        munmap(hp_state, MEMORY);
+        munmap(pad, size);
 #endif
     }
+}
 
-    hp_state = NULL;
-    hp_allocated = 0;
+/**
+ * @brief allocate the 2MB scratch buffer used by cn_slow_hash
+ *
+ * No parameters.  Updates a thread-local pointer, hp_state, to point to
+ * the allocated buffer.
+ */
+
+void slow_hash_allocate_state(void)
+{
+    if(hp_state != NULL)
+        return;
+
+    hp_state = allocate_scratchpad(MEMORY, &hp_allocated);
+}
+
+/**
+ *@brief frees the state allocated by slow_hash_allocate_state, and the one used by cn_slow_hash_multi
+ */
+
+void slow_hash_free_state(void)
+{
+    if(hp_state != NULL)
+    {
+        free_scratchpad(hp_state, MEMORY, hp_allocated);
+        hp_state = NULL;
+        hp_allocated = 0;
+    }
+    if(hp_state_multi != NULL)
+    {
+        free_scratchpad(hp_state_multi, MULTI_WAYS * MEMORY, hp_multi_allocated);
+        hp_state_multi = NULL;
+        hp_multi_allocated = 0;
+    }
 }
 
 /**
@@ -645,6 +705,119 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
     extra_hashes[state.hs.b[0] & 3](&state, 200, hash);
 }
 
+/**
+ * @brief CryptoNight steps 1 and 2 with hardware AES: fills a scratchpad from the data
+ */
+
+STATIC INLINE void cn_explode_scratchpad(const void *data, size_t length, union cn_slow_hash_state *state, uint8_t *pad)
+{
+    RDATA_ALIGN16 uint8_t expandedKey[240];
+    uint8_t text[INIT_SIZE_BYTE];
+    size_t i;
+
+    hash_process(&state->hs, data, length);
+    memcpy(text, state->init, INIT_SIZE_BYTE);
+    aes_expand_key(state->hs.b, expandedKey);
+    for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
+    {
+        aes_pseudo_round(text, text, expandedKey, INIT_SIZE_BLK);
+        memcpy(&pad[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
+    }
+}
+
+/**
+ * @brief CryptoNight steps 4 and 5 with hardware AES: mixes a scratchpad back into the state and hashes it
+ */
+
+STATIC INLINE void cn_implode_scratchpad(union cn_slow_hash_state *state, const uint8_t *pad, char *hash)
+{
+    static void (*const extra_hashes[4])(const void *, size_t, char *) =
+    {
+        hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
+    };
+    RDATA_ALIGN16 uint8_t expandedKey[240];
+    uint8_t text[INIT_SIZE_BYTE];
+    size_t i;
+
+    memcpy(text, state->init, INIT_SIZE_BYTE);
+    aes_expand_key(&state->hs.b[32], expandedKey);
+    for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
+        aes_pseudo_round_xor(text, text, expandedKey, &pad[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
+
+    memcpy(state->init, text, INIT_SIZE_BYTE);
+    hash_permutation(&state->hs);
+    extra_hashes[state->hs.b[0] & 3](state, 200, hash);
+}
+
+/**
+ * @brief computes two CryptoNight hashes at once with hardware AES
+ *
+ * The main loops of both hashes are interleaved, so that the random reads
+ * from one scratchpad are in flight while the other hash is being computed,
+ * instead of stalling the core.
+ */
+
+STATIC void cn_slow_hash_2(const void *data0, size_t length0, char *hash0,
+                           const void *data1, size_t length1, char *hash1)
+{
+    RDATA_ALIGN16 uint64_t a0[2];
+    RDATA_ALIGN16 uint64_t b0[2];
+    RDATA_ALIGN16 uint64_t c0[2];
+    RDATA_ALIGN16 uint64_t a1[2];
+    RDATA_ALIGN16 uint64_t b1[2];
+    RDATA_ALIGN16 uint64_t c1[2];
+    union cn_slow_hash_state state0, state1;
+    __m128i _a0, _b0, _c0, _a1, _b1, _c1;
+    uint64_t hi0, lo0, hi1, lo1;
+    uint8_t *pad0 = hp_state_multi;
+    uint8_t *pad1 = hp_state_multi + MEMORY;
+    size_t i, j0, j1;
+    uint64_t *p0, *p1;
+
+    cn_explode_scratchpad(data0, length0, &state0, pad0);
+    cn_explode_scratchpad(data1, length1, &state1, pad1);
+
+    U64(a0)[0] = U64(&state0.k[0])[0] ^ U64(&state0.k[32])[0];
+    U64(a0)[1] = U64(&state0.k[0])[1] ^ U64(&state0.k[32])[1];
+    U64(b0)[0] = U64(&state0.k[16])[0] ^ U64(&state0.k[48])[0];
+    U64(b0)[1] = U64(&state0.k[16])[1] ^ U64(&state0.k[48])[1];
+    U64(a1)[0] = U64(&state1.k[0])[0] ^ U64(&state1.k[32])[0];
+    U64(a1)[1] = U64(&state1.k[0])[1] ^ U64(&state1.k[32])[1];
+    U64(b1)[0] = U64(&state1.k[16])[0] ^ U64(&state1.k[48])[0];
+    U64(b1)[1] = U64(&state1.k[16])[1] ^ U64(&state1.k[48])[1];
+
+    _b0 = _mm_load_si128(R128(b0));
+    _b1 = _mm_load_si128(R128(b1));
+    for(i = 0; i < ITER / 2; i++)
+    {
+        pre_aes_n(0, pad0);
+        pre_aes_n(1, pad1);
+        _c0 = _mm_aesenc_si128(_c0, _a0);
+        _c1 = _mm_aesenc_si128(_c1, _a1);
+        post_aes_n(0, pad0);
+        post_aes_n(1, pad1);
+    }
+
+    cn_implode_scratchpad(&state0, pad0, hash0);
+    cn_implode_scratchpad(&state1, pad1, hash1);
+}
+
+void cn_slow_hash_multi(const void *const *data, const size_t *length, size_t count, char *hashes)
+{
+    size_t i = 0;
+
+    if(count >= MULTI_WAYS && !force_software_aes() && check_aes_hw())
+    {
+        if(hp_state_multi == NULL)
+            hp_state_multi = allocate_scratchpad(MULTI_WAYS * MEMORY, &hp_multi_allocated);
+        for(; i + MULTI_WAYS <= count; i += MULTI_WAYS)
+            cn_slow_hash_2(data[i], length[i], hashes + i * HASH_SIZE,
+                           data[i + 1], length[i + 1], hashes + (i + 1) * HASH_SIZE);
+    }
+    for(; i < count; i++)
+        cn_slow_hash(data[i], length[i], hashes + i * HASH_SIZE);
+}
+
 #elif !defined NO_AES && (defined(__arm__) || defined(__aarch64__))
 void slow_hash_allocate_state(void)
 {
@@ -1282,3 +1455,13 @@ void cn_slow_hash(const void *data, size_t length, char *hash) {
 }
 
 #endif
+
+#if !(!defined NO_AES && (defined(__x86_64__) || (defined(_MSC_VER) && defined(_WIN64))))
+void cn_slow_hash_multi(const void *const *data, const size_t *length, size_t count, char *hashes)
+{
+    size_t i;
+
+    for(i = 0; i < count; i++)
+        cn_slow_hash(data[i], length[i], hashes + i * HASH_SIZE);
+}
+#endif
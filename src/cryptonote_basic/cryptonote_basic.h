@@ -194,9 +194,13 @@ namespace cryptonote
     mutable crypto::hash hash;
     mutable size_t blob_size;
 
+    // where the prefix and the rct base end in the blob this was parsed from
+    size_t prefix_size;
+    size_t unprunable_size;
+
     transaction();
-    transaction(const transaction &t): transaction_prefix(t), hash_valid(false), blob_size_valid(false), signatures(t.signatures), rct_signatures(t.rct_signatures) { if (t.is_hash_valid()) { hash = t.hash; set_hash_valid(true); } if (t.is_blob_size_valid()) { blob_size = t.blob_size; set_blob_size_valid(true); } }
-    transaction &operator=(const transaction &t) { transaction_prefix::operator=(t); set_hash_valid(false); set_blob_size_valid(false); signatures = t.signatures; rct_signatures = t.rct_signatures; if (t.is_hash_valid()) { hash = t.hash; set_hash_valid(true); } if (t.is_blob_size_valid()) { blob_size = t.blob_size; set_blob_size_valid(true); } return *this; }
+    transaction(const transaction &t): transaction_prefix(t), hash_valid(false), blob_size_valid(false), signatures(t.signatures), rct_signatures(t.rct_signatures), prefix_size(t.prefix_size), unprunable_size(t.unprunable_size) { if (t.is_hash_valid()) { hash = t.hash; set_hash_valid(true); } if (t.is_blob_size_valid()) { blob_size = t.blob_size; set_blob_size_valid(true); } }
+    transaction &operator=(const transaction &t) { transaction_prefix::operator=(t); set_hash_valid(false); set_blob_size_valid(false); signatures = t.signatures; rct_signatures = t.rct_signatures; prefix_size = t.prefix_size; unprunable_size = t.unprunable_size; if (t.is_hash_valid()) { hash = t.hash; set_hash_valid(true); } if (t.is_blob_size_valid()) { blob_size = t.blob_size; set_blob_size_valid(true); } return *this; }
     virtual ~transaction();
     void set_null();
     void invalidate_hashes();
@@ -206,14 +210,19 @@ namespace cryptonote
     void set_blob_size_valid(bool v) const { blob_size_valid.store(v,std::memory_order_release); }
 
     BEGIN_SERIALIZE_OBJECT()
+      size_t start_pos = 0;
       if (!typename Archive<W>::is_saving())
       {
         set_hash_valid(false);
         set_blob_size_valid(false);
+        start_pos = ar.getpos();
       }
 
       FIELDS(*static_cast<transaction_prefix *>(this))
 
+      if (!typename Archive<W>::is_saving())
+        prefix_size = unprunable_size = ar.getpos() - start_pos;
+
       if (version == 1)
       {
         ar.tag("signatures");
@@ -254,6 +263,8 @@ namespace cryptonote
           bool r = rct_signatures.serialize_rctsig_base(ar, vin.size(), vout.size());
           if (!r || !ar.stream().good()) return false;
           ar.end_object();
+          if (!typename Archive<W>::is_saving())
+            unprunable_size = ar.getpos() - start_pos;
           if (rct_signatures.type != rct::RCTTypeNull)
           {
             ar.tag("rctsig_prunable");
@@ -318,6 +329,8 @@ namespace cryptonote
     rct_signatures.type = rct::RCTTypeNull;
     set_hash_valid(false);
     set_blob_size_valid(false);
+    prefix_size = 0;
+    unprunable_size = 0;
   }
 
   inline
@@ -370,9 +383,9 @@ namespace cryptonote
     mutable std::atomic<bool> hash_valid;
 
   public:
-    block(): block_header(), hash_valid(false) {}
-    block(const block &b): block_header(b), hash_valid(false), miner_tx(b.miner_tx), tx_hashes(b.tx_hashes) { if (b.is_hash_valid()) { hash = b.hash; set_hash_valid(true); } }
-    block &operator=(const block &b) { block_header::operator=(b); hash_valid = false; miner_tx = b.miner_tx; tx_hashes = b.tx_hashes; if (b.is_hash_valid()) { hash = b.hash; set_hash_valid(true); } return *this; }
+    block(): block_header(), hash_valid(false), header_size(0), miner_tx_end(0) {}
+    block(const block &b): block_header(b), hash_valid(false), miner_tx(b.miner_tx), tx_hashes(b.tx_hashes), header_size(b.header_size), miner_tx_end(b.miner_tx_end) { if (b.is_hash_valid()) { hash = b.hash; set_hash_valid(true); } }
+    block &operator=(const block &b) { block_header::operator=(b); hash_valid = false; miner_tx = b.miner_tx; tx_hashes = b.tx_hashes; header_size = b.header_size; miner_tx_end = b.miner_tx_end; if (b.is_hash_valid()) { hash = b.hash; set_hash_valid(true); } return *this; }
     void invalidate_hashes() { set_hash_valid(false); }
     bool is_hash_valid() const { return hash_valid.load(std::memory_order_acquire); }
     void set_hash_valid(bool v) const { hash_valid.store(v,std::memory_order_release); }
@@ -383,12 +396,24 @@ namespace cryptonote
     // hash cash
     mutable crypto::hash hash;
 
+    // where the header and the miner tx end in the blob this was parsed from
+    size_t header_size;
+    size_t miner_tx_end;
+
     BEGIN_SERIALIZE_OBJECT()
+      size_t start_pos = 0;
       if (!typename Archive<W>::is_saving())
+      {
         set_hash_valid(false);
+        start_pos = ar.getpos();
+      }
 
       FIELDS(*static_cast<block_header *>(this))
+      if (!typename Archive<W>::is_saving())
+        header_size = ar.getpos() - start_pos;
       FIELD(miner_tx)
+      if (!typename Archive<W>::is_saving())
+        miner_tx_end = ar.getpos() - start_pos;
       FIELD(tx_hashes)
     END_SERIALIZE()
   };
@@ -123,39 +123,96 @@ namespace cryptonote
     return h;
   }
   //---------------------------------------------------------------
-  bool parse_and_validate_tx_from_blob(const blobdata& tx_blob, transaction& tx)
+  static bool parse_tx_from_blob(const blobdata& tx_blob, transaction& tx, bool& canonical)
   {
-    std::stringstream ss;
-    ss << tx_blob;
-    binary_archive<false> ba(ss);
+    binary_archive<false> ba{epee::strspan<std::uint8_t>(tx_blob)};
     bool r = ::serialization::serialize(ba, tx);
     CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction from blob");
     tx.invalidate_hashes();
+    canonical = ba.is_canonical();
+    if (canonical)
+    {
+      tx.blob_size = ba.getpos();
+      tx.set_blob_size_valid(true);
+    }
     return true;
   }
   //---------------------------------------------------------------
+  // hashes the parts of the blob a tx was parsed from, rather than serializing them again
+  static bool set_transaction_hash_from_blob(const transaction& tx, const std::uint8_t *blob, size_t blob_size)
+  {
+    // a v2 tx without inputs has no rct base in the blob, but its hash does
+    if (tx.version > 1 && tx.vin.empty())
+      return false;
+
+    crypto::hash res;
+    if (tx.version == 1)
+    {
+      cn_fast_hash(blob, blob_size, res);
+    }
+    else
+    {
+      crypto::hash hashes[3];
+      cn_fast_hash(blob, tx.prefix_size, hashes[0]);
+      cn_fast_hash(blob + tx.prefix_size, tx.unprunable_size - tx.prefix_size, hashes[1]);
+      if (tx.rct_signatures.type == rct::RCTTypeNull)
+        hashes[2] = crypto::null_hash;
+      else
+        cn_fast_hash(blob + tx.unprunable_size, blob_size - tx.unprunable_size, hashes[2]);
+      res = cn_fast_hash(hashes, sizeof(hashes));
+    }
+
+    tx.hash = res;
+    tx.set_hash_valid(true);
+    tx.blob_size = blob_size;
+    tx.set_blob_size_valid(true);
+    return true;
+  }
+  //---------------------------------------------------------------
+  bool parse_and_validate_tx_from_blob(const blobdata& tx_blob, transaction& tx)
+  {
+    bool canonical;
+    return parse_tx_from_blob(tx_blob, tx, canonical);
+  }
+  //---------------------------------------------------------------
   bool parse_and_validate_tx_base_from_blob(const blobdata& tx_blob, transaction& tx)
   {
-    std::stringstream ss;
-    ss << tx_blob;
-    binary_archive<false> ba(ss);
+    binary_archive<false> ba{epee::strspan<std::uint8_t>(tx_blob)};
     bool r = tx.serialize_base(ba);
     CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction from blob");
     return true;
   }
   //---------------------------------------------------------------
+  bool parse_and_validate_tx_from_blob(const blobdata& tx_blob, transaction& tx, crypto::hash& tx_hash)
+  {
+    bool canonical;
+    if (!parse_tx_from_blob(tx_blob, tx, canonical))
+      return false;
+    //TODO: validate tx
+
+    if (canonical)
+      set_transaction_hash_from_blob(tx, reinterpret_cast<const std::uint8_t*>(tx_blob.data()), tx.blob_size);
+    get_transaction_hash(tx, tx_hash);
+    return true;
+  }
+  //---------------------------------------------------------------
   bool parse_and_validate_tx_from_blob(const blobdata& tx_blob, transaction& tx, crypto::hash& tx_hash, crypto::hash& tx_prefix_hash)
   {
-    std::stringstream ss;
-    ss << tx_blob;
-    binary_archive<false> ba(ss);
-    bool r = ::serialization::serialize(ba, tx);
-    CHECK_AND_ASSERT_MES(r, false, "Failed to parse transaction from blob");
-    tx.invalidate_hashes();
+    bool canonical;
+    if (!parse_tx_from_blob(tx_blob, tx, canonical))
+      return false;
     //TODO: validate tx
 
+    if (canonical)
+    {
+      set_transaction_hash_from_blob(tx, reinterpret_cast<const std::uint8_t*>(tx_blob.data()), tx.blob_size);
+      cn_fast_hash(tx_blob.data(), tx.prefix_size, tx_prefix_hash);
+    }
+    else
+    {
+      get_transaction_prefix_hash(tx, tx_prefix_hash);
+    }
     get_transaction_hash(tx, tx_hash);
-    get_transaction_prefix_hash(tx, tx_prefix_hash);
     return true;
   }
   //---------------------------------------------------------------
@@ -171,7 +228,7 @@ namespace cryptonote
     return m;
   }
   //---------------------------------------------------------------
-  bool generate_key_image_helper(const account_keys& ack, const std::unordered_map<crypto::public_key, subaddress_index>& subaddresses, const crypto::public_key& out_key, const crypto::public_key& tx_public_key, const std::vector<crypto::public_key>& additional_tx_public_keys, size_t real_output_index, keypair& in_ephemeral, crypto::key_image& ki)
+  bool generate_key_image_helper(const account_keys& ack, const subaddress_map& subaddresses, const crypto::public_key& out_key, const crypto::public_key& tx_public_key, const std::vector<crypto::public_key>& additional_tx_public_keys, size_t real_output_index, keypair& in_ephemeral, crypto::key_image& ki)
   {
     crypto::key_derivation recv_derivation = AUTO_VAL_INIT(recv_derivation);
     bool r = crypto::generate_key_derivation(tx_public_key, ack.m_view_secret_key, recv_derivation);
@@ -329,9 +386,7 @@ namespace cryptonote
     if(tx_extra.empty())
       return true;
 
-    std::string extra_str(reinterpret_cast<const char*>(tx_extra.data()), tx_extra.size());
-    std::istringstream iss(extra_str);
-    binary_archive<false> ar(iss);
+    binary_archive<false> ar{epee::to_span(tx_extra)};
 
     bool eof = false;
     while (!eof)
@@ -341,9 +396,9 @@ namespace cryptonote
       CHECK_AND_NO_ASSERT_MES_L1(r, false, "failed to deserialize extra field. extra = " << string_tools::buff_to_hex_nodelimer(std::string(reinterpret_cast<const char*>(tx_extra.data()), tx_extra.size())));
       tx_extra_fields.push_back(field);
 
-      std::ios_base::iostate state = iss.rdstate();
-      eof = (EOF == iss.peek());
-      iss.clear(state);
+      std::ios_base::iostate state = ar.stream().rdstate();
+      eof = (EOF == ar.stream().peek());
+      ar.stream().clear(state);
     }
     CHECK_AND_NO_ASSERT_MES_L1(::serialization::check_stream_state(ar), false, "failed to deserialize extra field. extra = " << string_tools::buff_to_hex_nodelimer(std::string(reinterpret_cast<const char*>(tx_extra.data()), tx_extra.size())));
 
@@ -444,9 +499,7 @@ namespace cryptonote
   {
     if (tx_extra.empty())
       return true;
-    std::string extra_str(reinterpret_cast<const char*>(tx_extra.data()), tx_extra.size());
-    std::istringstream iss(extra_str);
-    binary_archive<false> ar(iss);
+    binary_archive<false> ar{epee::to_span(tx_extra)};
     std::ostringstream oss;
     binary_archive<true> newar(oss);
 
@@ -459,9 +512,9 @@ namespace cryptonote
       if (field.type() != type)
         ::do_serialize(newar, field);
 
-      std::ios_base::iostate state = iss.rdstate();
-      eof = (EOF == iss.peek());
-      iss.clear(state);
+      std::ios_base::iostate state = ar.stream().rdstate();
+      eof = (EOF == ar.stream().peek());
+      ar.stream().clear(state);
     }
     CHECK_AND_NO_ASSERT_MES_L1(::serialization::check_stream_state(ar), false, "failed to deserialize extra field. extra = " << string_tools::buff_to_hex_nodelimer(std::string(reinterpret_cast<const char*>(tx_extra.data()), tx_extra.size())));
     tx_extra.clear();
@@ -650,7 +703,7 @@ namespace cryptonote
     return false;
   }
   //---------------------------------------------------------------
-  boost::optional<subaddress_receive_info> is_out_to_acc_precomp(const std::unordered_map<crypto::public_key, subaddress_index>& subaddresses, const crypto::public_key& out_key, const crypto::key_derivation& derivation, const std::vector<crypto::key_derivation>& additional_derivations, size_t output_index)
+  boost::optional<subaddress_receive_info> is_out_to_acc_precomp(const subaddress_map& subaddresses, const crypto::public_key& out_key, const crypto::key_derivation& derivation, const std::vector<crypto::key_derivation>& additional_derivations, size_t output_index)
   {
     // try the shared tx pubkey
     crypto::public_key subaddress_spendkey;
@@ -871,28 +924,31 @@ namespace cryptonote
     return get_transaction_hash(t, res, &blob_size);
   }
   //---------------------------------------------------------------
-  blobdata get_block_hashing_blob(const block& b)
+  static blobdata get_block_hashing_blob(const block& b, blobdata blob)
   {
-    blobdata blob = t_serializable_object_to_blob(static_cast<block_header>(b));
     crypto::hash tree_root_hash = get_tx_tree_hash(b);
     blob.append(reinterpret_cast<const char*>(&tree_root_hash), sizeof(tree_root_hash));
     blob.append(tools::get_varint_data(b.tx_hashes.size()+1));
     return blob;
   }
   //---------------------------------------------------------------
-  bool calculate_block_hash(const block& b, crypto::hash& res)
+  blobdata get_block_hashing_blob(const block& b)
+  {
+    return get_block_hashing_blob(b, t_serializable_object_to_blob(static_cast<block_header>(b)));
+  }
+  //---------------------------------------------------------------
+  static bool calculate_block_hash(const crypto::hash& block_blob_hash, const blobdata& hashing_blob, crypto::hash& res)
   {
     // EXCEPTION FOR BLOCK 202612
     const std::string correct_blob_hash_202612 = "3a8a2b3a29b50fc86ff73dd087ea43c6f0d6b8f936c849194d5c84c737903966";
     const std::string existing_block_id_202612 = "bbd604d2ba11ba27935e006ed39c9bfdd99b76bf4a50654bc1e1e61217962698";
-    crypto::hash block_blob_hash = get_blob_hash(block_to_blob(b));
 
     if (string_tools::pod_to_hex(block_blob_hash) == correct_blob_hash_202612)
     {
       string_tools::hex_to_pod(existing_block_id_202612, res);
       return true;
     }
-    bool hash_result = get_object_hash(get_block_hashing_blob(b), res);
+    bool hash_result = get_object_hash(hashing_blob, res);
 
     if (hash_result)
     {
@@ -907,6 +963,11 @@ namespace cryptonote
     return hash_result;
   }
   //---------------------------------------------------------------
+  bool calculate_block_hash(const block& b, crypto::hash& res)
+  {
+    return calculate_block_hash(get_blob_hash(block_to_blob(b)), get_block_hashing_blob(b), res);
+  }
+  //---------------------------------------------------------------
   bool get_block_hash(const block& b, crypto::hash& res)
   {
     if (b.is_hash_valid())
@@ -934,10 +995,11 @@ namespace cryptonote
     return p;
   }
   //---------------------------------------------------------------
+  // block 202612 bug workaround
+  static const char *const longhash_202612 = "84f64766475d51837ac9efbef1926486e58563c95a19fef4aec3254f03000000";
+  //---------------------------------------------------------------
   bool get_block_longhash(const block& b, crypto::hash& res, uint64_t height)
   {
-    // block 202612 bug workaround
-    const std::string longhash_202612 = "84f64766475d51837ac9efbef1926486e58563c95a19fef4aec3254f03000000";
     if (height == 202612)
     {
       string_tools::hex_to_pod(longhash_202612, res);
@@ -948,6 +1010,22 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------
+  void get_block_longhashes(const block *blocks, size_t count, uint64_t height, crypto::hash *res)
+  {
+    std::vector<blobdata> blobs(count);
+    std::vector<const void*> data(count);
+    std::vector<size_t> sizes(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      blobs[i] = get_block_hashing_blob(blocks[i]);
+      data[i] = blobs[i].data();
+      sizes[i] = blobs[i].size();
+    }
+    crypto::cn_slow_hash_multi(data.data(), sizes.data(), count, res);
+    if (height <= 202612 && 202612 < height + count)
+      string_tools::hex_to_pod(longhash_202612, res[202612 - height]);
+  }
+  //---------------------------------------------------------------
   std::vector<uint64_t> relative_output_offsets_to_absolute(const std::vector<uint64_t>& off)
   {
     std::vector<uint64_t> res = off;
@@ -975,18 +1053,41 @@ namespace cryptonote
     return p;
   }
   //---------------------------------------------------------------
-  bool parse_and_validate_block_from_blob(const blobdata& b_blob, block& b)
+  bool parse_and_validate_block_from_blob(const blobdata& b_blob, block& b, crypto::hash *block_hash)
   {
-    std::stringstream ss;
-    ss << b_blob;
-    binary_archive<false> ba(ss);
+    binary_archive<false> ba{epee::strspan<std::uint8_t>(b_blob)};
     bool r = ::serialization::serialize(ba, b);
     CHECK_AND_ASSERT_MES(r, false, "Failed to parse block from blob");
     b.invalidate_hashes();
     b.miner_tx.invalidate_hashes();
+
+    if (!ba.is_canonical())
+      return !block_hash || get_block_hash(b, *block_hash);
+
+    const std::uint8_t *data = reinterpret_cast<const std::uint8_t*>(b_blob.data());
+    set_transaction_hash_from_blob(b.miner_tx, data + b.header_size, b.miner_tx_end - b.header_size);
+    if (block_hash)
+    {
+      crypto::hash block_blob_hash;
+      cn_fast_hash(data, ba.getpos(), block_blob_hash);
+      if (!calculate_block_hash(block_blob_hash, get_block_hashing_blob(b, blobdata(b_blob.data(), b.header_size)), *block_hash))
+        return false;
+      b.hash = *block_hash;
+      b.set_hash_valid(true);
+    }
     return true;
   }
   //---------------------------------------------------------------
+  bool parse_and_validate_block_from_blob(const blobdata& b_blob, block& b)
+  {
+    return parse_and_validate_block_from_blob(b_blob, b, NULL);
+  }
+  //---------------------------------------------------------------
+  bool parse_and_validate_block_from_blob(const blobdata& b_blob, block& b, crypto::hash& block_hash)
+  {
+    return parse_and_validate_block_from_blob(b_blob, b, &block_hash);
+  }
+  //---------------------------------------------------------------
   blobdata block_to_blob(const block& b)
   {
     return t_serializable_object_to_blob(b);
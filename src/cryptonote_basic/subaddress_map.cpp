@@ -0,0 +1,254 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <string.h>
+#include "common/int-util.h"
+#include "subaddress_map.h"
+
+// Entries are moved to a table twice the size once it is 7/8 full. Unlike
+// keys, tags are read at every probe, and 32 of them fit in a cache line.
+#define SUBADDRESS_MAP_MIN_CAPACITY 16
+#define SUBADDRESS_MAP_MAX_LOAD_NUM 7
+#define SUBADDRESS_MAP_MAX_LOAD_DEN 8
+
+static const char SUBADDRESS_MAP_MAGIC[8] = {'s', 'u', 'b', 'a', 'd', 'd', 'r', '\001'};
+
+namespace
+{
+  // keys are curve points of random scalars, so their bytes can be used as hashes as is
+  inline size_t slot_hash(const crypto::public_key &key)
+  {
+    uint64_t h;
+    memcpy(&h, &key, sizeof(h));
+    return SWAP64LE(h);
+  }
+
+  inline uint16_t key_tag(const crypto::public_key &key)
+  {
+    const uint16_t tag = (uint8_t)key.data[8] | ((uint8_t)key.data[9] << 8);
+    return tag ? tag : 1;
+  }
+
+  inline uint16_t swap16le(uint16_t x)
+  {
+#if BYTE_ORDER == BIG_ENDIAN
+    return (x << 8) | (x >> 8);
+#else
+    return x;
+#endif
+  }
+
+  inline size_t capacity_for(size_t n)
+  {
+    size_t capacity = SUBADDRESS_MAP_MIN_CAPACITY;
+    while (capacity * SUBADDRESS_MAP_MAX_LOAD_NUM < n * SUBADDRESS_MAP_MAX_LOAD_DEN)
+      capacity *= 2;
+    return capacity;
+  }
+
+  inline size_t tags_size(size_t capacity)
+  {
+    return (capacity * sizeof(uint16_t) + 7) & ~(size_t)7;
+  }
+}
+
+namespace cryptonote
+{
+  struct subaddress_map::header_t
+  {
+    char magic[8];
+    uint64_t capacity;
+    uint64_t size;
+  };
+  static_assert(sizeof(subaddress_map::value_type) == sizeof(crypto::public_key) + sizeof(subaddress_index), "Unexpected subaddress_map entry layout");
+
+  //---------------------------------------------------------------
+  subaddress_map::subaddress_map():
+    m_capacity(0),
+    m_size(0)
+  {
+  }
+  //---------------------------------------------------------------
+  size_t subaddress_map::locate(const crypto::public_key &key, uint16_t tag) const
+  {
+    // the load factor guarantees there is an empty slot to stop at
+    const size_t mask = m_capacity - 1;
+    size_t slot = slot_hash(key) & mask;
+    while (m_tags[slot] != 0 && (m_tags[slot] != tag || m_slots[slot].first != key))
+      slot = (slot + 1) & mask;
+    return slot;
+  }
+  //---------------------------------------------------------------
+  size_t subaddress_map::next_used(size_t slot) const
+  {
+    while (slot < m_capacity && m_tags[slot] == 0)
+      ++slot;
+    return slot;
+  }
+  //---------------------------------------------------------------
+  subaddress_map::const_iterator subaddress_map::find(const crypto::public_key &key) const
+  {
+    if (m_size == 0)
+      return end();
+    const size_t slot = locate(key, key_tag(key));
+    return m_tags[slot] ? const_iterator(this, slot) : end();
+  }
+  //---------------------------------------------------------------
+  subaddress_index &subaddress_map::operator[](const crypto::public_key &key)
+  {
+    if ((m_size + 1) * SUBADDRESS_MAP_MAX_LOAD_DEN > m_capacity * SUBADDRESS_MAP_MAX_LOAD_NUM)
+      rehash(capacity_for(m_size + 1));
+    const uint16_t tag = key_tag(key);
+    const size_t slot = locate(key, tag);
+    if (m_tags[slot] == 0)
+    {
+      m_tags[slot] = tag;
+      m_slots[slot] = value_type(key, subaddress_index{0, 0});
+      ++m_size;
+    }
+    return m_slots[slot].second;
+  }
+  //---------------------------------------------------------------
+  void subaddress_map::reserve(size_t n)
+  {
+    const size_t capacity = capacity_for(n);
+    if (capacity > m_capacity)
+      rehash(capacity);
+  }
+  //---------------------------------------------------------------
+  void subaddress_map::clear()
+  {
+    m_tags.clear();
+    m_tags.shrink_to_fit();
+    m_slots.clear();
+    m_slots.shrink_to_fit();
+    m_capacity = 0;
+    m_size = 0;
+  }
+  //---------------------------------------------------------------
+  void subaddress_map::rehash(size_t capacity)
+  {
+    std::vector<uint16_t> tags(capacity, 0);
+    std::vector<value_type> slots(capacity);
+    const size_t mask = capacity - 1;
+    for (size_t i = 0; i < m_capacity; ++i)
+    {
+      if (m_tags[i] == 0)
+        continue;
+      size_t slot = slot_hash(m_slots[i].first) & mask;
+      while (tags[slot] != 0)
+        slot = (slot + 1) & mask;
+      tags[slot] = m_tags[i];
+      slots[slot] = m_slots[i];
+    }
+    m_tags.swap(tags);
+    m_slots.swap(slots);
+    m_capacity = capacity;
+  }
+  //---------------------------------------------------------------
+  std::string subaddress_map::to_blob() const
+  {
+    const size_t slots_offset = sizeof(header_t) + tags_size(m_capacity);
+    std::string blob(slots_offset + m_capacity * sizeof(value_type), '\0');
+
+    header_t header;
+    memcpy(header.magic, SUBADDRESS_MAP_MAGIC, sizeof(header.magic));
+    header.capacity = SWAP64LE((uint64_t)m_capacity);
+    header.size = SWAP64LE((uint64_t)m_size);
+    memcpy(&blob[0], &header, sizeof(header));
+
+    for (size_t i = 0; i < m_capacity; ++i)
+    {
+      const uint16_t tag = swap16le(m_tags[i]);
+      memcpy(&blob[sizeof(header_t) + i * sizeof(uint16_t)], &tag, sizeof(tag));
+      if (tag == 0)
+        continue;
+      const subaddress_index index{SWAP32LE(m_slots[i].second.major), SWAP32LE(m_slots[i].second.minor)};
+      memcpy(&blob[slots_offset + i * sizeof(value_type)], &m_slots[i].first, sizeof(crypto::public_key));
+      memcpy(&blob[slots_offset + i * sizeof(value_type) + sizeof(crypto::public_key)], &index, sizeof(index));
+    }
+    return blob;
+  }
+  //---------------------------------------------------------------
+  bool subaddress_map::check_layout(const void *data, size_t size, size_t &capacity, size_t &entries)
+  {
+    if (size < sizeof(header_t))
+      return false;
+    header_t header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, SUBADDRESS_MAP_MAGIC, sizeof(header.magic)))
+      return false;
+    const uint64_t cap = SWAP64LE(header.capacity);
+    const uint64_t n = SWAP64LE(header.size);
+    if (cap != 0 && (cap < SUBADDRESS_MAP_MIN_CAPACITY || (cap & (cap - 1)) || cap > (uint64_t)(size / sizeof(value_type))))
+      return false;
+    if (n > cap || n * SUBADDRESS_MAP_MAX_LOAD_DEN > cap * SUBADDRESS_MAP_MAX_LOAD_NUM)
+      return false;
+    if (size != sizeof(header_t) + tags_size(cap) + cap * sizeof(value_type))
+      return false;
+
+    // lookups rely on the number of used slots to find an empty one
+    const unsigned char *tag_data = (const unsigned char*)data + sizeof(header_t);
+    uint64_t used = 0;
+    for (uint64_t i = 0; i < cap; ++i)
+      used += tag_data[2 * i] != 0 || tag_data[2 * i + 1] != 0;
+    if (used != n)
+      return false;
+
+    capacity = cap;
+    entries = n;
+    return true;
+  }
+  //---------------------------------------------------------------
+  bool subaddress_map::from_blob(const std::string &blob)
+  {
+    size_t capacity, entries;
+    if (!check_layout(blob.data(), blob.size(), capacity, entries))
+      return false;
+
+    clear();
+    const size_t slots_offset = sizeof(header_t) + tags_size(capacity);
+    m_tags.resize(capacity);
+    m_slots.resize(capacity);
+    for (size_t i = 0; i < capacity; ++i)
+    {
+      uint16_t tag;
+      memcpy(&tag, &blob[sizeof(header_t) + i * sizeof(uint16_t)], sizeof(tag));
+      m_tags[i] = swap16le(tag);
+      if (m_tags[i] == 0)
+        continue;
+      memcpy(&m_slots[i].first, &blob[slots_offset + i * sizeof(value_type)], sizeof(crypto::public_key));
+      memcpy(&m_slots[i].second, &blob[slots_offset + i * sizeof(value_type) + sizeof(crypto::public_key)], sizeof(subaddress_index));
+      m_slots[i].second.major = SWAP32LE(m_slots[i].second.major);
+      m_slots[i].second.minor = SWAP32LE(m_slots[i].second.minor);
+    }
+    m_capacity = capacity;
+    m_size = entries;
+    return true;
+  }
+}
@@ -0,0 +1,168 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/serialization/serialization.hpp>
+#include <boost/serialization/split_free.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/archive/archive_exception.hpp>
+
+#include "crypto/crypto.h"
+#include "subaddress_index.h"
+
+namespace cryptonote
+{
+  /**
+   * @brief A lookup table from subaddress spend public keys to subaddress indices
+   *
+   * An open addressing table with linear probing, meant to stay small and
+   * fast with millions of subaddresses: entries live in a single flat array,
+   * with a parallel array of 16 bit tags taken from their keys. Looking up a
+   * key which is not in the table, which is the case for almost all scanned
+   * outputs, only reads a few contiguous tags.
+   *
+   * The serialized form of the table is its memory layout, so loading it
+   * does not rehash any key.
+   *
+   * Entries cannot be removed.
+   */
+  class subaddress_map
+  {
+  public:
+    typedef crypto::public_key key_type;
+    typedef subaddress_index mapped_type;
+    typedef std::pair<crypto::public_key, subaddress_index> value_type;
+
+    class const_iterator
+    {
+    public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef subaddress_map::value_type value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const value_type *pointer;
+      typedef const value_type &reference;
+
+      const_iterator(): m_map(NULL), m_slot(0) {}
+      reference operator*() const { return m_map->m_slots[m_slot]; }
+      pointer operator->() const { return &m_map->m_slots[m_slot]; }
+      const_iterator &operator++() { m_slot = m_map->next_used(m_slot + 1); return *this; }
+      const_iterator operator++(int) { const_iterator i = *this; ++*this; return i; }
+      bool operator==(const const_iterator &other) const { return m_slot == other.m_slot; }
+      bool operator!=(const const_iterator &other) const { return m_slot != other.m_slot; }
+
+    private:
+      friend class subaddress_map;
+      const_iterator(const subaddress_map *map, size_t slot): m_map(map), m_slot(slot) {}
+
+      const subaddress_map *m_map;
+      size_t m_slot;
+    };
+    typedef const_iterator iterator;
+
+    subaddress_map();
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    const_iterator begin() const { return const_iterator(this, next_used(0)); }
+    const_iterator end() const { return const_iterator(this, m_capacity); }
+
+    const_iterator find(const crypto::public_key &key) const;
+    size_t count(const crypto::public_key &key) const { return find(key) != end(); }
+
+    /**
+     * @brief gets the index of a key, inserting a zero index if not found
+     */
+    subaddress_index &operator[](const crypto::public_key &key);
+
+    /**
+     * @brief makes room for a number of entries without further allocation
+     */
+    void reserve(size_t n);
+
+    void clear();
+
+    /**
+     * @brief serializes the table
+     *
+     * @return a blob with the table's memory layout
+     */
+    std::string to_blob() const;
+
+    /**
+     * @brief loads a table from a copy of a blob made by to_blob
+     *
+     * @return false if the blob is not a valid table
+     */
+    bool from_blob(const std::string &blob);
+
+  private:
+    struct header_t;
+
+    size_t locate(const crypto::public_key &key, uint16_t tag) const;
+    size_t next_used(size_t slot) const;
+    void rehash(size_t capacity);
+    static bool check_layout(const void *data, size_t size, size_t &capacity, size_t &entries);
+
+    std::vector<uint16_t> m_tags;      //!< 0 for empty slots
+    std::vector<value_type> m_slots;
+    size_t m_capacity;                 //!< a power of 2, or 0
+    size_t m_size;
+  };
+}
+
+namespace boost
+{
+  namespace serialization
+  {
+    template <class Archive>
+    inline void save(Archive &a, const cryptonote::subaddress_map &x, const boost::serialization::version_type ver)
+    {
+      const std::string blob = x.to_blob();
+      a & blob;
+    }
+
+    template <class Archive>
+    inline void load(Archive &a, cryptonote::subaddress_map &x, const boost::serialization::version_type ver)
+    {
+      std::string blob;
+      a & blob;
+      if (!x.from_blob(blob))
+        throw boost::archive::archive_exception(boost::archive::archive_exception::other_exception, "Invalid subaddress map");
+    }
+  }
+}
+
+BOOST_SERIALIZATION_SPLIT_FREE(cryptonote::subaddress_map)
@@ -60,6 +60,7 @@
 #define MONERO_DEFAULT_LOG_CATEGORY "blockchain"
 
 #define FIND_BLOCKCHAIN_SUPPLEMENT_MAX_SIZE (100*1024*1024) // 100 MB
+#define BLOCKS_RANGE_CACHE_MAX_SIZE (64*1024*1024) // 64 MB
 
 using namespace crypto;
 
@@ -133,7 +134,7 @@ static const uint64_t testnet_hard_fork_version_1_till = 624633;
 
 //------------------------------------------------------------------
 Blockchain::Blockchain(tx_memory_pool& tx_pool) :
-  m_db(), m_tx_pool(tx_pool), m_hardfork(NULL), m_timestamps_and_difficulties_height(0), m_current_block_cumul_sz_limit(0),
+  m_db(), m_tx_pool(tx_pool), m_hardfork(NULL), m_timestamps_and_difficulties_height(0), m_blocks_range_cache_size(0), m_current_block_cumul_sz_limit(0),
   m_enforce_dns_checkpoints(false), m_max_prepare_blocks_threads(4), m_db_blocks_per_sync(1), m_db_sync_mode(db_async), m_db_default_sync(false), m_fast_sync(true), m_show_time_stats(false), m_sync_counter(0), m_cancel(false)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -526,6 +527,13 @@ block Blockchain::pop_block_from_blockchain()
     throw;
   }
 
+  if (!m_detach_notifiers.empty())
+  {
+    const crypto::hash popped_id = get_block_hash(popped_block);
+    for (const auto& notify: m_detach_notifiers)
+      notify(m_db->height(), popped_id);
+  }
+
   // return transactions from popped block to the tx_pool
   for (transaction& tx : popped_txs)
   {
@@ -1606,19 +1614,11 @@ void Blockchain::add_out_to_get_random_outs(COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_A
 
 uint64_t Blockchain::get_num_mature_outputs(uint64_t amount) const
 {
-  uint64_t num_outs = m_db->get_num_outputs(amount);
   // ensure we don't include outputs that aren't yet eligible to be used
-  // outpouts are sorted by height
-  while (num_outs > 0)
-  {
-    const tx_out_index toi = m_db->get_output_tx_and_index(amount, num_outs - 1);
-    const uint64_t height = m_db->get_tx_block_height(toi.first);
-    if (height + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE <= m_db->height())
-      break;
-    --num_outs;
-  }
-
-  return num_outs;
+  const uint64_t blockchain_height = m_db->height();
+  if (blockchain_height < CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE)
+    return 0;
+  return m_db->get_cumulative_num_outputs(amount, blockchain_height - CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE);
 }
 
 std::vector<uint64_t> Blockchain::get_random_outputs(uint64_t amount, uint64_t count) const
@@ -1635,11 +1635,8 @@ std::vector<uint64_t> Blockchain::get_random_outputs(uint64_t amount, uint64_t c
   {
     for (uint64_t i = 0; i < num_outs; i++)
     {
-      // get tx_hash, tx_out_index from DB
-      tx_out_index toi = m_db->get_output_tx_and_index(amount, i);
-
       // if tx is unlocked, add output to indices
-      if (is_tx_spendtime_unlocked(m_db->get_tx_unlock_time(toi.first)))
+      if (is_tx_spendtime_unlocked(m_db->get_output_key(amount, i).unlock_time))
       {
         indices.push_back(i);
       }
@@ -1674,12 +1671,9 @@ std::vector<uint64_t> Blockchain::get_random_outputs(uint64_t amount, uint64_t c
       }
       seen_indices.emplace(i);
 
-      // get tx_hash, tx_out_index from DB
-      tx_out_index toi = m_db->get_output_tx_and_index(amount, i);
-
       // if the output's transaction is unlocked, add the output's index to
       // our list.
-      if (is_tx_spendtime_unlocked(m_db->get_tx_unlock_time(toi.first)))
+      if (is_tx_spendtime_unlocked(m_db->get_output_key(amount, i).unlock_time))
       {
         indices.push_back(i);
       }
@@ -1752,17 +1746,7 @@ bool Blockchain::get_random_rct_outs(const COMMAND_RPC_GET_RANDOM_RCT_OUTPUTS::r
 
   // for each amount that we need to get mixins for, get <n> random outputs
   // from BlockchainDB where <n> is req.outs_count (number of mixins).
-  auto num_outs = m_db->get_num_outputs(0);
-  // ensure we don't include outputs that aren't yet eligible to be used
-  // outpouts are sorted by height
-  while (num_outs > 0)
-  {
-    const tx_out_index toi = m_db->get_output_tx_and_index(0, num_outs - 1);
-    const uint64_t height = m_db->get_tx_block_height(toi.first);
-    if (height + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE <= m_db->height())
-      break;
-    --num_outs;
-  }
+  auto num_outs = get_num_mature_outputs(0);
 
   std::unordered_set<uint64_t> seen_indices;
 
@@ -1772,11 +1756,8 @@ bool Blockchain::get_random_rct_outs(const COMMAND_RPC_GET_RANDOM_RCT_OUTPUTS::r
   {
     for (uint64_t i = 0; i < num_outs; i++)
     {
-      // get tx_hash, tx_out_index from DB
-      tx_out_index toi = m_db->get_output_tx_and_index(0, i);
-
       // if tx is unlocked, add output to result_outs
-      if (is_tx_spendtime_unlocked(m_db->get_tx_unlock_time(toi.first)))
+      if (is_tx_spendtime_unlocked(m_db->get_output_key(0, i).unlock_time))
       {
         add_out_to_get_rct_random_outs(res.outs, 0, i);
       }
@@ -1811,12 +1792,9 @@ bool Blockchain::get_random_rct_outs(const COMMAND_RPC_GET_RANDOM_RCT_OUTPUTS::r
       }
       seen_indices.emplace(i);
 
-      // get tx_hash, tx_out_index from DB
-      tx_out_index toi = m_db->get_output_tx_and_index(0, i);
-
       // if the output's transaction is unlocked, add the output's index to
       // our list.
-      if (is_tx_spendtime_unlocked(m_db->get_tx_unlock_time(toi.first)))
+      if (is_tx_spendtime_unlocked(m_db->get_output_key(0, i).unlock_time))
       {
         add_out_to_get_rct_random_outs(res.outs, 0, i);
       }
@@ -1871,7 +1849,7 @@ bool Blockchain::get_outs(const COMMAND_RPC_GET_OUTPUTS_BIN::request& req, COMMA
     // get tx_hash, tx_out_index from DB
     const output_data_t od = m_db->get_output_key(i.amount, i.index);
     tx_out_index toi = m_db->get_output_tx_and_index(i.amount, i.index);
-    bool unlocked = is_tx_spendtime_unlocked(m_db->get_tx_unlock_time(toi.first));
+    bool unlocked = is_tx_spendtime_unlocked(od.unlock_time);
 
     res.outs.push_back({od.pubkey, od.commitment, unlocked, od.height, toi.first});
   }
@@ -1883,8 +1861,7 @@ void Blockchain::get_output_key_mask_unlocked(const uint64_t& amount, const uint
   const auto o_data = m_db->get_output_key(amount, index);
   key = o_data.pubkey;
   mask = o_data.commitment;
-  tx_out_index toi = m_db->get_output_tx_and_index(amount, index);
-  unlocked = is_tx_spendtime_unlocked(m_db->get_tx_unlock_time(toi.first));
+  unlocked = is_tx_spendtime_unlocked(o_data.unlock_time);
 }
 //------------------------------------------------------------------
 // This function takes a list of block hashes from another node
@@ -1999,7 +1976,7 @@ bool Blockchain::get_blocks(const t_ids_container& block_ids, t_blocks_container
 //TODO: return type should be void, throw on exception
 //       alternatively, return true only if no transactions missed
 template<class t_ids_container, class t_tx_container, class t_missed_container>
-bool Blockchain::get_transactions_blobs(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) const
+bool Blockchain::get_transactions_blobs(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs, bool pruned) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
@@ -2009,7 +1986,7 @@ bool Blockchain::get_transactions_blobs(const t_ids_container& txs_ids, t_tx_con
     try
     {
       cryptonote::blobdata tx;
-      if (m_db->get_tx_blob(tx_hash, tx))
+      if (pruned ? m_db->get_pruned_tx_blob(tx_hash, tx) : m_db->get_tx_blob(tx_hash, tx))
         txs.push_back(std::move(tx));
       else
         missed_txs.push_back(tx_hash);
@@ -2094,7 +2071,7 @@ bool Blockchain::find_blockchain_supplement(const std::list<crypto::hash>& qbloc
 // find split point between ours and foreign blockchain (or start at
 // blockchain height <req_start_block>), and return up to max_count FULL
 // blocks by reference.
-bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<cryptonote::blobdata, std::list<cryptonote::blobdata> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count) const
+bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<cryptonote::blobdata, std::list<cryptonote::blobdata> > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, size_t max_count) const
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
@@ -2127,7 +2104,7 @@ bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, cons
     block b;
     CHECK_AND_ASSERT_MES(parse_and_validate_block_from_blob(blocks.back().first, b), false, "internal error, invalid block");
     std::list<crypto::hash> mis;
-    get_transactions_blobs(b.tx_hashes, blocks.back().second, mis);
+    get_transactions_blobs(b.tx_hashes, blocks.back().second, mis, pruned);
     CHECK_AND_ASSERT_MES(!mis.size(), false, "internal error, transaction from block not found");
     size += blocks.back().first.size();
     for (const auto &t: blocks.back().second)
@@ -2137,6 +2114,79 @@ bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, cons
   return true;
 }
 //------------------------------------------------------------------
+bool Blockchain::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::shared_ptr<const std::vector<block_blobs_entry>>& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, size_t max_count) const
+{
+  LOG_PRINT_L3("Blockchain::" << __func__);
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+
+  // if a specific start height has been requested
+  if(req_start_block > 0)
+  {
+    // if requested height is higher than our chain, return false -- we can't help
+    if (req_start_block >= m_db->height())
+    {
+      return false;
+    }
+    start_height = req_start_block;
+  }
+  else
+  {
+    if(!find_blockchain_supplement(qblock_ids, start_height))
+    {
+      return false;
+    }
+  }
+
+  m_db->block_txn_start(true);
+  auto txn_stop = epee::misc_utils::create_scope_leave_handler([this](){ m_db->block_txn_stop(); });
+  total_height = get_current_blockchain_height();
+
+  // a cached range is still good if its last block is still on the main
+  // chain (so none of the ones before changed either), and it either was
+  // cut short by the limits or still ends at the top of the chain
+  for (auto i = m_blocks_range_cache.begin(); i != m_blocks_range_cache.end(); ++i)
+  {
+    if (i->start_height != start_height || i->max_count != max_count || i->pruned != pruned)
+      continue;
+    const uint64_t end_height = start_height + i->blocks->size();
+    if ((end_height < i->chain_height || end_height == total_height) && end_height <= total_height &&
+        m_db->get_block_hash_from_height(end_height - 1) == i->last_hash)
+    {
+      m_blocks_range_cache.splice(m_blocks_range_cache.begin(), m_blocks_range_cache, i);
+      blocks = m_blocks_range_cache.front().blocks;
+      return true;
+    }
+    m_blocks_range_cache_size -= i->size;
+    m_blocks_range_cache.erase(i);
+    break;
+  }
+
+  std::shared_ptr<std::vector<block_blobs_entry>> entries = std::make_shared<std::vector<block_blobs_entry>>();
+  const bool r = m_db->get_blocks_from(start_height, 3, max_count, FIND_BLOCKCHAIN_SUPPLEMENT_MAX_SIZE, pruned, *entries) && !entries->empty();
+  const crypto::hash last_hash = r ? m_db->get_block_hash_from_height(start_height + entries->size() - 1) : crypto::null_hash;
+  CHECK_AND_ASSERT_MES(r, false, "internal error, failed to get blocks from height " << start_height);
+  blocks = entries;
+
+  size_t size = 0;
+  for (const block_blobs_entry &e: *entries)
+  {
+    size += e.block.size();
+    for (const auto &t: e.txs)
+      size += t.size();
+  }
+  if (size <= BLOCKS_RANGE_CACHE_MAX_SIZE)
+  {
+    m_blocks_range_cache.push_front({start_height, max_count, pruned, total_height, last_hash, size, blocks});
+    m_blocks_range_cache_size += size;
+    while (m_blocks_range_cache_size > BLOCKS_RANGE_CACHE_MAX_SIZE)
+    {
+      m_blocks_range_cache_size -= m_blocks_range_cache.back().size;
+      m_blocks_range_cache.pop_back();
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------
 bool Blockchain::add_block_as_invalid(const block& bl, const crypto::hash& h)
 {
   LOG_PRINT_L3("Blockchain::" << __func__);
@@ -3506,9 +3556,24 @@ leave:
   // appears to be a NOP *and* is called elsewhere.  wat?
   m_tx_pool.on_blockchain_inc(new_height, id);
 
+  for (const auto& notify: m_block_notifiers)
+    notify(new_height - 1, id, bl, txs);
+
   return true;
 }
 //------------------------------------------------------------------
+void Blockchain::add_block_notify(block_notify_t&& notify)
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  m_block_notifiers.push_back(std::move(notify));
+}
+//------------------------------------------------------------------
+void Blockchain::add_detach_notify(detach_notify_t&& notify)
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  m_detach_notifiers.push_back(std::move(notify));
+}
+//------------------------------------------------------------------
 bool Blockchain::update_next_cumulative_size_limit()
 {
   uint64_t full_reward_zone = get_min_block_size(get_current_hard_fork_version());
@@ -3641,13 +3706,17 @@ void Blockchain::block_longhash_worker(uint64_t height, const std::vector<block>
   TIME_MEASURE_START(t);
   slow_hash_allocate_state();
 
-  for (const auto & block : blocks)
+  // a few blocks at a time, so their hashes can be interleaved
+  static const size_t blocks_per_call = 8;
+  crypto::hash pow[blocks_per_call];
+  for (size_t i = 0; i < blocks.size(); i += blocks_per_call)
   {
     if (m_cancel)
        break;
-    crypto::hash id = get_block_hash(block);
-    crypto::hash pow = get_block_longhash(block, height++);
-    map.emplace(id, pow);
+    const size_t count = std::min(blocks_per_call, blocks.size() - i);
+    get_block_longhashes(&blocks[i], count, height + i, pow);
+    for (size_t n = 0; n < count; ++n)
+      map.emplace(get_block_hash(blocks[i + n]), pow[n]);
   }
 
   slow_hash_free_state();
@@ -3905,8 +3974,9 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
       for (int j = 0; j < batches; j++)
       {
         block block;
+        crypto::hash block_hash;
 
-        if (!parse_and_validate_block_from_blob(it->block, block))
+        if (!parse_and_validate_block_from_blob(it->block, block, block_hash))
         {
           std::advance(it, 1);
           continue;
@@ -3922,7 +3992,7 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
             return true;
           }
         }
-        if (have_block(get_block_hash(block)))
+        if (have_block(block_hash))
         {
           blocks_exist = true;
           break;
@@ -3936,14 +4006,15 @@ bool Blockchain::prepare_handle_incoming_blocks(const std::list<block_complete_e
     for (int i = 0; i < extra && !blocks_exist; i++)
     {
       block block;
+      crypto::hash block_hash;
 
-      if (!parse_and_validate_block_from_blob(it->block, block))
+      if (!parse_and_validate_block_from_blob(it->block, block, block_hash))
       {
         std::advance(it, 1);
         continue;
       }
 
-      if (have_block(get_block_hash(block)))
+      if (have_block(block_hash))
       {
         blocks_exist = true;
         break;
@@ -4263,6 +4334,19 @@ std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> Blockchain:: get_ou
   return m_db->get_output_histogram(amounts, unlocked, recent_cutoff);
 }
 
+bool Blockchain::get_output_distribution(uint64_t amount, uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  const uint64_t db_height = m_db->height();
+  if (to_height == 0)
+  {
+    if (db_height == 0)
+      return false;
+    to_height = db_height - 1;
+  }
+  return m_db->get_output_distribution(amount, from_height, to_height, distribution, base);
+}
+
 std::list<std::pair<Blockchain::block_extended_info,uint64_t>> Blockchain::get_alternative_chains() const
 {
   std::list<std::pair<Blockchain::block_extended_info,uint64_t>> chains;
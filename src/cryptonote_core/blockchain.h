@@ -38,6 +38,9 @@
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
 #include <atomic>
+#include <functional>
+#include <list>
+#include <memory>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -424,11 +427,33 @@ namespace cryptonote
      * @param blocks return-by-reference the blocks and their transactions
      * @param total_height return-by-reference our current blockchain height
      * @param start_height return-by-reference the height of the first block returned
+     * @param pruned whether to return pruned transactions
      * @param max_count the max number of blocks to get
      *
      * @return true if a block found in common or req_start_block specified, else false
      */
-    bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<cryptonote::blobdata, std::list<cryptonote::blobdata> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count) const;
+    bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<cryptonote::blobdata, std::list<cryptonote::blobdata> > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, size_t max_count) const;
+
+    /**
+     * @brief get recent blocks for a foreign chain, with their output indices
+     *
+     * Like the above, but the blocks, their transactions and the amount
+     * output indices of those are read from the database in one pass,
+     * without looking up each transaction by hash. Recently served ranges
+     * are kept in a cache, since many wallets syncing to the top of the
+     * chain ask for the same ones.
+     *
+     * @param req_start_block if non-zero, specifies a start point (otherwise find most recent commonality)
+     * @param qblock_ids the foreign chain's "short history" (see get_short_chain_history)
+     * @param blocks return-by-reference the blocks, their transactions and output indices
+     * @param total_height return-by-reference our current blockchain height
+     * @param start_height return-by-reference the height of the first block returned
+     * @param pruned whether to return pruned transactions
+     * @param max_count the max number of blocks to get
+     *
+     * @return true if a block found in common or req_start_block specified, else false
+     */
+    bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::shared_ptr<const std::vector<block_blobs_entry>>& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, size_t max_count) const;
 
     /**
      * @brief retrieves a set of blocks and their transactions, and possibly other transactions
@@ -669,11 +694,12 @@ namespace cryptonote
      * @param txs_ids a container of hashes for which to get the corresponding transactions
      * @param txs return-by-reference a container to store result transactions in
      * @param missed_txs return-by-reference a container to store missed transactions in
+     * @param pruned whether to return the pruned blobs, without signatures
      *
      * @return false if an unexpected exception occurs, else true
      */
     template<class t_ids_container, class t_tx_container, class t_missed_container>
-    bool get_transactions_blobs(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) const;
+    bool get_transactions_blobs(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs, bool pruned = false) const;
     template<class t_ids_container, class t_tx_container, class t_missed_container>
     bool get_transactions(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) const;
 
@@ -735,6 +761,32 @@ namespace cryptonote
      */
     void set_show_time_stats(bool stats) { m_show_time_stats = stats; }
 
+    //! called with the height, hash, block and txs of each block added to the main chain
+    typedef std::function<void(uint64_t, const crypto::hash&, const block&, const std::vector<transaction>&)> block_notify_t;
+
+    //! called with the height and hash of each block popped off the main chain
+    typedef std::function<void(uint64_t, const crypto::hash&)> detach_notify_t;
+
+    /**
+     * @brief registers a function to call when a block is added to the main chain
+     *
+     * The function is called with the blockchain lock held, so it should
+     * not take long.
+     *
+     * @param notify the function to call
+     */
+    void add_block_notify(block_notify_t&& notify);
+
+    /**
+     * @brief registers a function to call when a block is popped off the main chain
+     *
+     * The function is called with the blockchain lock held, before the
+     * popped block's transactions are returned to the pool.
+     *
+     * @param notify the function to call
+     */
+    void add_detach_notify(detach_notify_t&& notify);
+
     /**
      * @brief gets the hardfork voting state object
      *
@@ -823,6 +875,19 @@ namespace cryptonote
      */
     std::map<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t>> get_output_histogram(const std::vector<uint64_t> &amounts, bool unlocked, uint64_t recent_cutoff) const;
 
+    /**
+     * @brief return the cumulative distribution of outputs of an amount
+     *
+     * @param amount the output amount
+     * @param from_height the first block height
+     * @param to_height the last block height, inclusive, or 0 for the top of the chain
+     * @param distribution return-by-reference, for each height in the range, the number of outputs of that amount in blocks up to it
+     * @param base return-by-reference the number of outputs of that amount before from_height
+     *
+     * @return false if the range is invalid, true otherwise
+     */
+    bool get_output_distribution(uint64_t amount, uint64_t from_height, uint64_t to_height, std::vector<uint64_t> &distribution, uint64_t &base) const;
+
     /**
      * @brief perform a check on all key images in the blockchain
      *
@@ -986,6 +1051,23 @@ namespace cryptonote
     std::vector<difficulty_type> m_difficulties;
     uint64_t m_timestamps_and_difficulties_height;
 
+    // recently served block ranges, most recently used first
+    struct blocks_range_cache_entry
+    {
+      uint64_t start_height;
+      size_t max_count;
+      bool pruned;
+      uint64_t chain_height;       // the chain height when the range was read
+      crypto::hash last_hash;      // the hash of the last block in the range
+      size_t size;
+      std::shared_ptr<const std::vector<block_blobs_entry>> blocks;
+    };
+    mutable std::list<blocks_range_cache_entry> m_blocks_range_cache;
+    mutable size_t m_blocks_range_cache_size;
+
+    std::vector<block_notify_t> m_block_notifiers;
+    std::vector<detach_notify_t> m_detach_notifiers;
+
     boost::asio::io_service m_async_service;
     boost::thread_group m_async_pool;
     std::unique_ptr<boost::asio::io_service::work> m_async_work_idle;
@@ -133,11 +133,22 @@ namespace cryptonote
   , "Relay blocks as fluffy blocks where possible (automatic on testnet)"
   , false
   };
+  static const command_line::arg_descriptor<bool> arg_light_wallet_server  = {
+    "light-wallet-server"
+  , "Scan the chain for registered view key accounts and serve the light wallet RPC API"
+  , false
+  };
+  static const command_line::arg_descriptor<uint64_t> arg_light_wallet_max_accounts  = {
+    "light-wallet-max-accounts"
+  , "Maximum number of light wallet accounts, 0 for no limit"
+  , 10000
+  };
 
   //-----------------------------------------------------------------------------------------------
   core::core(i_cryptonote_protocol* pprotocol):
               m_mempool(m_blockchain_storage),
               m_blockchain_storage(m_mempool),
+              m_light_wallet_scanner(m_blockchain_storage, m_mempool),
               m_miner(this),
               m_miner_address(boost::value_initialized<account_public_address>()),
               m_starter_message_showed(false),
@@ -147,7 +158,8 @@ namespace cryptonote
               m_last_json_checkpoints_update(0),
               m_disable_dns_checkpoints(false),
               m_threadpool(tools::threadpool::getInstance()),
-              m_update_download(0)
+              m_update_download(0),
+              m_light_wallet_enabled(false)
   {
     m_checkpoints_updating.clear();
     set_cryptonote_protocol(pprotocol);
@@ -234,6 +246,8 @@ namespace cryptonote
     command_line::add_arg(desc, arg_block_sync_size);
     command_line::add_arg(desc, arg_check_updates);
     command_line::add_arg(desc, arg_fluffy_blocks);
+    command_line::add_arg(desc, arg_light_wallet_server);
+    command_line::add_arg(desc, arg_light_wallet_max_accounts);
     command_line::add_arg(desc, arg_test_dbg_lock_sleep);
     command_line::add_arg(desc, arg_offline);
 
@@ -270,6 +284,8 @@ namespace cryptonote
     test_drop_download_height(command_line::get_arg(vm, arg_test_drop_download_height));
     m_fluffy_blocks_enabled = m_testnet || get_arg(vm, arg_fluffy_blocks);
     m_offline = get_arg(vm, arg_offline);
+    m_light_wallet_enabled = get_arg(vm, arg_light_wallet_server);
+    m_light_wallet_scanner.set_max_accounts(get_arg(vm, arg_light_wallet_max_accounts));
 
     if (command_line::get_arg(vm, arg_test_drop_download) == true)
       test_drop_download();
@@ -507,6 +523,12 @@ namespace cryptonote
     r = m_miner.init(vm, m_testnet);
     CHECK_AND_ASSERT_MES(r, false, "Failed to initialize miner instance");
 
+    if (m_light_wallet_enabled)
+    {
+      r = m_light_wallet_scanner.init(folder.parent_path().string());
+      CHECK_AND_ASSERT_MES(r, false, "Failed to initialize light wallet scanner");
+    }
+
     return load_state_data();
   }
   //-----------------------------------------------------------------------------------------------
@@ -524,6 +546,7 @@ namespace cryptonote
     bool core::deinit()
   {
     m_miner.stop();
+    m_light_wallet_scanner.deinit();
     m_mempool.deinit();
     m_blockchain_storage.deinit();
     return true;
@@ -645,26 +668,85 @@ namespace cryptonote
       }
     }
 
+    return true;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void core::set_semantics_failed(const crypto::hash &tx_hash)
+  {
+    LOG_PRINT_L1("WRONG TRANSACTION BLOB, Failed to check tx " << tx_hash << " semantic, rejected");
+    bad_semantics_txes_lock.lock();
+    bad_semantics_txes[0].insert(tx_hash);
+    if (bad_semantics_txes[0].size() >= BAD_SEMANTICS_TXES_MAX_SIZE)
+    {
+      std::swap(bad_semantics_txes[0], bad_semantics_txes[1]);
+      bad_semantics_txes[0].clear();
+    }
+    bad_semantics_txes_lock.unlock();
+  }
+  //-----------------------------------------------------------------------------------------------
+  static bool is_valid_rct_type(const transaction &tx)
+  {
+    switch (tx.rct_signatures.type) {
+      case rct::RCTTypeNull:
+        // coinbase should not come here, so we reject for all other types
+        MERROR_VER("Unexpected Null rctSig type");
+        return false;
+      case rct::RCTTypeSimple:
+      case rct::RCTTypeSimpleBulletproof:
+      case rct::RCTTypeFull:
+      case rct::RCTTypeFullBulletproof:
+        return true;
+      default:
+        MERROR_VER("Unknown rct type: " << tx.rct_signatures.type);
+        return false;
+    }
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::handle_incoming_tx_accumulated_batch(std::vector<tx_verification_batch_info> &tx_info, bool keeped_by_block)
+  {
     if (keeped_by_block && get_blockchain_storage().is_within_compiled_block_hash_area())
     {
-      MTRACE("Skipping semantics check for tx kept by block in embedded hash area");
+      MTRACE("Skipping semantics check for txs kept by block in embedded hash area");
+      return true;
     }
-    else if(!check_tx_semantic(tx, keeped_by_block))
+
+    bool ret = true;
+    std::vector<const rct::rctSig*> rvv;
+    for (tx_verification_batch_info &info: tx_info)
     {
-      LOG_PRINT_L1("WRONG TRANSACTION BLOB, Failed to check tx " << tx_hash << " semantic, rejected");
-      tvc.m_verifivation_failed = true;
-      bad_semantics_txes_lock.lock();
-      bad_semantics_txes[0].insert(tx_hash);
-      if (bad_semantics_txes[0].size() >= BAD_SEMANTICS_TXES_MAX_SIZE)
+      if (!check_tx_semantic(*info.tx, keeped_by_block) || (info.tx->version >= 2 && !is_valid_rct_type(*info.tx)))
       {
-        std::swap(bad_semantics_txes[0], bad_semantics_txes[1]);
-        bad_semantics_txes[0].clear();
+        set_semantics_failed(info.tx_hash);
+        info.tvc.m_verifivation_failed = true;
+        info.result = false;
+        ret = false;
+        continue;
       }
-      bad_semantics_txes_lock.unlock();
-      return false;
+      if (info.tx->version >= 2)
+        rvv.push_back(&info.tx->rct_signatures);
     }
 
-    return true;
+    // all range proofs are checked in one batch, and only if that fails
+    // do we go through the txes one at a time to find the bad ones
+    if (!rvv.empty() && !rct::verRctSemantics(rvv))
+    {
+      LOG_PRINT_L1("One transaction among this group has bad semantics, verifying one at a time");
+      ret = false;
+      for (tx_verification_batch_info &info: tx_info)
+      {
+        if (!info.result || info.tx->version < 2)
+          continue;
+        if (!rct::verRctSemantics(std::vector<const rct::rctSig*>(1, &info.tx->rct_signatures)))
+        {
+          MERROR_VER("rct signature semantics check failed");
+          set_semantics_failed(info.tx_hash);
+          info.tvc.m_verifivation_failed = true;
+          info.result = false;
+        }
+      }
+    }
+
+    return ret;
   }
   //-----------------------------------------------------------------------------------------------
   bool core::handle_incoming_txs(const std::list<blobdata>& tx_blobs, std::vector<tx_verification_context>& tvc, bool keeped_by_block, bool relayed, bool do_not_relay)
@@ -698,10 +780,12 @@ namespace cryptonote
       if(m_mempool.have_tx(results[i].hash))
       {
         LOG_PRINT_L2("tx " << results[i].hash << "already have transaction in tx_pool");
+        results[i].in_txpool = true;
       }
       else if(m_blockchain_storage.have_tx(results[i].hash))
       {
         LOG_PRINT_L2("tx " << results[i].hash << " already have transaction in blockchain");
+        results[i].in_blockchain = true;
       }
       else
       {
@@ -720,6 +804,16 @@ namespace cryptonote
     }
     waiter.wait();
 
+    std::vector<tx_verification_batch_info> tx_info;
+    tx_info.reserve(tx_blobs.size());
+    for (size_t i = 0; i < tx_blobs.size(); i++) {
+      if (!results[i].res || results[i].in_txpool || results[i].in_blockchain)
+        continue;
+      tx_info.push_back({&results[i].tx, results[i].hash, tvc[i], results[i].res});
+    }
+    if (!tx_info.empty())
+      handle_incoming_tx_accumulated_batch(tx_info, keeped_by_block);
+
     bool ok = true;
     it = tx_blobs.begin();
     for (size_t i = 0; i < tx_blobs.size(); i++, ++it) {
@@ -837,35 +931,7 @@ namespace cryptonote
       return false;
     }
 
-    if (tx.version >= 2)
-    {
-      const rct::rctSig &rv = tx.rct_signatures;
-      switch (rv.type) {
-        case rct::RCTTypeNull:
-          // coinbase should not come here, so we reject for all other types
-          MERROR_VER("Unexpected Null rctSig type");
-          return false;
-        case rct::RCTTypeSimple:
-        case rct::RCTTypeSimpleBulletproof:
-          if (!rct::verRctSimple(rv, true))
-          {
-            MERROR_VER("rct signature semantics check failed");
-            return false;
-          }
-          break;
-        case rct::RCTTypeFull:
-        case rct::RCTTypeFullBulletproof:
-          if (!rct::verRct(rv, true))
-          {
-            MERROR_VER("rct signature semantics check failed");
-            return false;
-          }
-          break;
-        default:
-          MERROR_VER("Unknown rct type: " << rv.type);
-          return false;
-      }
-    }
+    // rct semantics are checked by handle_incoming_tx_accumulated_batch
 
     return true;
   }
@@ -1048,9 +1114,14 @@ namespace cryptonote
     return m_blockchain_storage.find_blockchain_supplement(qblock_ids, resp);
   }
   //-----------------------------------------------------------------------------------------------
-  bool core::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<cryptonote::blobdata, std::list<cryptonote::blobdata> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count) const
+  bool core::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<cryptonote::blobdata, std::list<cryptonote::blobdata> > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, size_t max_count) const
+  {
+    return m_blockchain_storage.find_blockchain_supplement(req_start_block, qblock_ids, blocks, total_height, start_height, pruned, max_count);
+  }
+  //-----------------------------------------------------------------------------------------------
+  bool core::find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::shared_ptr<const std::vector<block_blobs_entry>>& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, size_t max_count) const
   {
-    return m_blockchain_storage.find_blockchain_supplement(req_start_block, qblock_ids, blocks, total_height, start_height, max_count);
+    return m_blockchain_storage.find_blockchain_supplement(req_start_block, qblock_ids, blocks, total_height, start_height, pruned, max_count);
   }
   //-----------------------------------------------------------------------------------------------
   bool core::get_random_outs_for_amounts(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) const
@@ -1198,7 +1269,8 @@ namespace cryptonote
     }
 
     block b = AUTO_VAL_INIT(b);
-    if(!parse_and_validate_block_from_blob(block_blob, b))
+    crypto::hash block_hash; // hashed from the blob here, cached for add_new_block
+    if(!parse_and_validate_block_from_blob(block_blob, b, block_hash))
     {
       LOG_PRINT_L1("Failed to parse and validate new block");
       bvc.m_verifivation_failed = true;
@@ -1266,6 +1338,11 @@ namespace cryptonote
     return true;
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::get_pool_transaction_changes(uint64_t since, std::vector<crypto::hash>& added, std::vector<crypto::hash>& removed, uint64_t& sequence, bool include_sensitive_data) const
+  {
+    return m_mempool.get_transaction_changes(since, added, removed, sequence, include_sensitive_data);
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::get_pool_transaction_stats(struct txpool_stats& stats, bool include_sensitive_data) const
   {
     m_mempool.get_transaction_stats(stats, include_sensitive_data);
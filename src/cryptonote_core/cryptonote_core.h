@@ -43,6 +43,7 @@
 #include "common/command_line.h"
 #include "tx_pool.h"
 #include "blockchain.h"
+#include "light_wallet_scanner.h"
 #include "cryptonote_basic/miner.h"
 #include "cryptonote_basic/connection_context.h"
 #include "cryptonote_basic/cryptonote_stat_info.h"
@@ -447,6 +448,13 @@ namespace cryptonote
       */
      bool get_pool_transaction_hashes(std::vector<crypto::hash>& txs, bool include_unrelayed_txes = true) const;
 
+     /**
+      * @copydoc tx_memory_pool::get_transaction_changes
+      *
+      * @note see tx_memory_pool::get_transaction_changes
+      */
+     bool get_pool_transaction_changes(uint64_t since, std::vector<crypto::hash>& added, std::vector<crypto::hash>& removed, uint64_t& sequence, bool include_unrelayed_txes = true) const;
+
      /**
       * @copydoc tx_memory_pool::get_transactions
       * @param include_unrelayed_txes include unrelayed txes in result
@@ -513,11 +521,18 @@ namespace cryptonote
      bool find_blockchain_supplement(const std::list<crypto::hash>& qblock_ids, NOTIFY_RESPONSE_CHAIN_ENTRY::request& resp) const;
 
      /**
-      * @copydoc Blockchain::find_blockchain_supplement(const uint64_t, const std::list<crypto::hash>&, std::list<std::pair<cryptonote::blobdata, std::list<cryptonote::blobdata> > >&, uint64_t&, uint64_t&, size_t) const
+      * @copydoc Blockchain::find_blockchain_supplement(const uint64_t, const std::list<crypto::hash>&, std::list<std::pair<cryptonote::blobdata, std::list<cryptonote::blobdata> > >&, uint64_t&, uint64_t&, bool, size_t) const
       *
-      * @note see Blockchain::find_blockchain_supplement(const uint64_t, const std::list<crypto::hash>&, std::list<std::pair<cryptonote::blobdata, std::list<transaction> > >&, uint64_t&, uint64_t&, size_t) const
+      * @note see Blockchain::find_blockchain_supplement(const uint64_t, const std::list<crypto::hash>&, std::list<std::pair<cryptonote::blobdata, std::list<transaction> > >&, uint64_t&, uint64_t&, bool, size_t) const
       */
-     bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<cryptonote::blobdata, std::list<cryptonote::blobdata> > >& blocks, uint64_t& total_height, uint64_t& start_height, size_t max_count) const;
+     bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::list<std::pair<cryptonote::blobdata, std::list<cryptonote::blobdata> > >& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, size_t max_count) const;
+
+     /**
+      * @copydoc Blockchain::find_blockchain_supplement(const uint64_t, const std::list<crypto::hash>&, std::shared_ptr<const std::vector<block_blobs_entry>>&, uint64_t&, uint64_t&, bool, size_t) const
+      *
+      * @note see Blockchain::find_blockchain_supplement(const uint64_t, const std::list<crypto::hash>&, std::shared_ptr<const std::vector<block_blobs_entry>>&, uint64_t&, uint64_t&, bool, size_t) const
+      */
+     bool find_blockchain_supplement(const uint64_t req_start_block, const std::list<crypto::hash>& qblock_ids, std::shared_ptr<const std::vector<block_blobs_entry>>& blocks, uint64_t& total_height, uint64_t& start_height, bool pruned, size_t max_count) const;
 
      /**
       * @brief gets some stats about the daemon
@@ -600,6 +615,27 @@ namespace cryptonote
       */
      const Blockchain& get_blockchain_storage()const{return m_blockchain_storage;}
 
+     /**
+      * @brief gets the transaction pool instance
+      *
+      * @return a reference to the transaction pool instance
+      */
+     tx_memory_pool& get_pool(){return m_mempool;}
+
+     /**
+      * @brief gets the light wallet scanner instance
+      *
+      * @return a reference to the light wallet scanner instance
+      */
+     light_wallet_scanner& get_light_wallet_scanner(){return m_light_wallet_scanner;}
+
+     /**
+      * @brief get whether the light wallet scanner is enabled
+      *
+      * @return whether the light wallet scanner is enabled
+      */
+     bool light_wallet_enabled() const { return m_light_wallet_enabled; }
+
      /**
       * @copydoc tx_memory_pool::print_pool
       *
@@ -837,6 +873,9 @@ namespace cryptonote
       *                   tx not too large,
       *                   each input has a different key image.
       *
+      * The rct semantics are checked separately, in batches, by
+      * handle_incoming_tx_accumulated_batch.
+      *
       * @param tx the transaction to check
       * @param keeped_by_block if the transaction has been in a block
       *
@@ -847,6 +886,32 @@ namespace cryptonote
      bool handle_incoming_tx_pre(const blobdata& tx_blob, tx_verification_context& tvc, cryptonote::transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefixt_hash, bool keeped_by_block, bool relayed, bool do_not_relay);
      bool handle_incoming_tx_post(const blobdata& tx_blob, tx_verification_context& tvc, cryptonote::transaction &tx, crypto::hash &tx_hash, crypto::hash &tx_prefixt_hash, bool keeped_by_block, bool relayed, bool do_not_relay);
 
+     //! a tx waiting for its semantics to be checked with others
+     struct tx_verification_batch_info { const cryptonote::transaction *tx; crypto::hash tx_hash; tx_verification_context &tvc; bool &result; };
+
+     /**
+      * @brief checks the semantics of a group of transactions
+      *
+      * Runs check_tx_semantic on each transaction, then verifies the rct
+      * semantics (range proofs) of all of them in a single batch. If the
+      * batch fails, the transactions are checked one at a time to find
+      * which ones are bad. Failures are recorded in each tx's
+      * verification context and result.
+      *
+      * @param tx_info the transactions to check
+      * @param keeped_by_block if the transactions have been in a block
+      *
+      * @return true if all the transactions pass, otherwise false
+      */
+     bool handle_incoming_tx_accumulated_batch(std::vector<tx_verification_batch_info> &tx_info, bool keeped_by_block);
+
+     /**
+      * @brief remembers a transaction as having bad semantics
+      *
+      * @param tx_hash the transaction's hash
+      */
+     void set_semantics_failed(const crypto::hash &tx_hash);
+
      /**
       * @copydoc miner::on_block_chain_update
       *
@@ -932,6 +997,7 @@ namespace cryptonote
 
      tx_memory_pool m_mempool; //!< transaction pool instance
      Blockchain m_blockchain_storage; //!< Blockchain instance
+     light_wallet_scanner m_light_wallet_scanner; //!< light wallet scanner instance
 
      i_cryptonote_protocol* m_pprotocol; //!< cryptonote protocol instance
 
@@ -988,6 +1054,7 @@ namespace cryptonote
 
      bool m_fluffy_blocks_enabled;
      bool m_offline;
+     bool m_light_wallet_enabled;
    };
 }
 
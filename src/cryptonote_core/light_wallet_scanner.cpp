@@ -0,0 +1,845 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include <boost/archive/portable_binary_iarchive.hpp>
+#include <boost/archive/portable_binary_oarchive.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/vector.hpp>
+#include <boost/serialization/version.hpp>
+
+#include "light_wallet_scanner.h"
+#include "blockchain.h"
+#include "tx_pool.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_basic/cryptonote_boost_serialization.h"
+#include "cryptonote_basic/account_boost_serialization.h"
+#include "ringct/rctSigs.h"
+#include "common/threadpool.h"
+#include "common/util.h"
+#include "misc_language.h"
+#include "math_helper.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "lightwallet"
+
+#define LIGHT_WALLET_STATE_FILENAME "lightwallet.bin"
+#define LIGHT_WALLET_STATE_VERSION 1
+
+// how many scanned block hashes to keep around to detect reorgs
+#define LIGHT_WALLET_REORG_WINDOW 720
+
+// how many blocks an account may advance by in a single pass
+#define LIGHT_WALLET_SCAN_BATCH 100
+
+// below this, splitting the accounts over more threads costs more than it saves
+#define LIGHT_WALLET_MIN_ACCOUNTS_PER_TASK 16
+
+namespace boost
+{
+  namespace serialization
+  {
+    template <class Archive>
+    inline void serialize(Archive &a, cryptonote::lw_output &x, const boost::serialization::version_type ver)
+    {
+      a & x.tx_hash;
+      a & x.tx_prefix_hash;
+      a & x.tx_pub_key;
+      a & x.public_key;
+      a & x.commitment;
+      a & x.encrypted_mask;
+      a & x.encrypted_amount;
+      a & x.amount;
+      a & x.index;
+      a & x.global_index;
+      a & x.height;
+      a & x.timestamp;
+      a & x.unlock_time;
+      a & x.rct;
+      a & x.coinbase;
+    }
+
+    template <class Archive>
+    inline void serialize(Archive &a, cryptonote::lw_spend &x, const boost::serialization::version_type ver)
+    {
+      a & x.key_image;
+      a & x.amount;
+      a & x.tx_pub_key;
+      a & x.out_index;
+      a & x.mixin;
+    }
+
+    template <class Archive>
+    inline void serialize(Archive &a, cryptonote::lw_tx &x, const boost::serialization::version_type ver)
+    {
+      a & x.hash;
+      a & x.payment_id;
+      a & x.height;
+      a & x.timestamp;
+      a & x.unlock_time;
+      a & x.total_received;
+      a & x.total_sent;
+      a & x.mixin;
+      a & x.coinbase;
+      a & x.spends;
+    }
+
+    template <class Archive>
+    inline void serialize(Archive &a, cryptonote::lw_account &x, const boost::serialization::version_type ver)
+    {
+      a & x.address;
+      a & x.view_secret_key;
+      a & x.start_height;
+      a & x.scanned_height;
+      a & x.outputs;
+      a & x.txs;
+    }
+  }
+}
+
+namespace cryptonote
+{
+  namespace
+  {
+    bool check_view_key(const account_public_address& address, const crypto::secret_key& view_secret_key)
+    {
+      crypto::public_key view_public_key;
+      if (!crypto::secret_key_to_public_key(view_secret_key, view_public_key))
+        return false;
+      return view_public_key == address.m_view_public_key;
+    }
+
+    uint64_t decode_rct_amount(const rct::rctSig& rv, const crypto::key_derivation& derivation, unsigned int i, rct::key& mask)
+    {
+      crypto::secret_key scalar;
+      crypto::derivation_to_scalar(derivation, i, scalar);
+      switch (rv.type)
+      {
+      case rct::RCTTypeSimple:
+      case rct::RCTTypeSimpleBulletproof:
+        return rct::decodeRctSimple(rv, rct::sk2rct(scalar), i, mask);
+      case rct::RCTTypeFull:
+      case rct::RCTTypeFullBulletproof:
+        return rct::decodeRct(rv, rct::sk2rct(scalar), i, mask);
+      default:
+        throw std::runtime_error("Unsupported rct type");
+      }
+    }
+
+    crypto::hash get_payment_id(const transaction& tx, const crypto::public_key& tx_pub_key, const crypto::secret_key& view_secret_key)
+    {
+      crypto::hash payment_id = crypto::null_hash;
+      std::vector<tx_extra_field> tx_extra_fields;
+      parse_tx_extra(tx.extra, tx_extra_fields);
+      tx_extra_nonce extra_nonce;
+      if (find_tx_extra_field_by_type(tx_extra_fields, extra_nonce))
+      {
+        crypto::hash8 payment_id8;
+        if (get_encrypted_payment_id_from_tx_extra_nonce(extra_nonce.nonce, payment_id8))
+        {
+          if (decrypt_payment_id(payment_id8, tx_pub_key, view_secret_key))
+            memcpy(payment_id.data, payment_id8.data, sizeof(payment_id8));
+        }
+        else if (!get_payment_id_from_tx_extra_nonce(extra_nonce.nonce, payment_id))
+        {
+          payment_id = crypto::null_hash;
+        }
+      }
+      return payment_id;
+    }
+  }
+  //---------------------------------------------------------------------------------
+  void lw_account::rebuild_output_lookup()
+  {
+    output_lookup.clear();
+    for (size_t n = 0; n < outputs.size(); ++n)
+    {
+      const lw_output& o = outputs[n];
+      output_lookup[std::make_pair(o.rct ? 0 : o.amount, o.global_index)] = n;
+    }
+  }
+  //---------------------------------------------------------------------------------
+  light_wallet_scanner::light_wallet_scanner(Blockchain& bchs, tx_memory_pool& pool):
+    m_blockchain(bchs),
+    m_tx_pool(pool),
+    m_max_accounts(0),
+    m_running(false),
+    m_initialized(false)
+  {
+  }
+  //---------------------------------------------------------------------------------
+  light_wallet_scanner::~light_wallet_scanner()
+  {
+    try { deinit(); }
+    catch (...) { }
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::init(const std::string& config_folder)
+  {
+    m_filename = (boost::filesystem::path(config_folder) / LIGHT_WALLET_STATE_FILENAME).string();
+    if (!load())
+    {
+      MERROR("Failed to load light wallet state from " << m_filename << ", starting afresh");
+      m_accounts.clear();
+      m_scanned_hashes.clear();
+    }
+    MGINFO("Light wallet scanner loaded " << m_accounts.size() << " account(s)");
+
+    m_running = true;
+    m_thread = boost::thread(boost::bind(&light_wallet_scanner::run, this));
+    m_initialized = true;
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::deinit()
+  {
+    if (!m_initialized)
+      return true;
+    m_initialized = false;
+
+    {
+      boost::lock_guard<boost::mutex> lock(m_wakeup_lock);
+      m_running = false;
+    }
+    m_wakeup.notify_all();
+    if (m_thread.joinable())
+      m_thread.join();
+
+    if (!store())
+    {
+      MERROR("Failed to store light wallet state to " << m_filename);
+      return false;
+    }
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::load()
+  {
+    boost::system::error_code ec;
+    if (!boost::filesystem::exists(m_filename, ec))
+      return true;
+
+    try
+    {
+      std::ifstream f(m_filename, std::ios_base::binary | std::ios_base::in);
+      if (f.fail())
+        return false;
+      boost::archive::portable_binary_iarchive a(f);
+
+      uint32_t version;
+      a >> version;
+      CHECK_AND_ASSERT_MES(version == LIGHT_WALLET_STATE_VERSION, false, "Unknown light wallet state version " << version);
+
+      uint64_t count;
+      a >> count;
+      for (uint64_t n = 0; n < count; ++n)
+      {
+        account_ptr account = std::make_shared<lw_account>();
+        a >> *account;
+        account->rebuild_output_lookup();
+        m_accounts[account->address.m_spend_public_key] = account;
+      }
+      a >> m_scanned_hashes;
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Error loading light wallet state: " << e.what());
+      return false;
+    }
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::store() const
+  {
+    if (m_filename.empty())
+      return false;
+
+    const std::string tmp_filename = m_filename + ".tmp";
+#ifndef WIN32
+    // the file holds view secret keys, keep it readable by its owner only,
+    // whatever the umask or the mode of a leftover temporary file
+    const int fd = open(tmp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+      MERROR("Failed to create " << tmp_filename << ": " << strerror(errno));
+      return false;
+    }
+    const bool restricted = fchmod(fd, S_IRUSR | S_IWUSR) == 0;
+    close(fd);
+    if (!restricted)
+    {
+      MERROR("Failed to restrict permissions of " << tmp_filename << ": " << strerror(errno));
+      return false;
+    }
+#endif
+    try
+    {
+      std::ofstream f(tmp_filename, std::ios_base::binary | std::ios_base::out | std::ios::trunc);
+      if (f.fail())
+        return false;
+      boost::archive::portable_binary_oarchive a(f);
+
+      const uint32_t version = LIGHT_WALLET_STATE_VERSION;
+      a << version;
+
+      const std::vector<account_ptr> accounts = get_accounts();
+      const uint64_t count = accounts.size();
+      a << count;
+      for (const account_ptr &account: accounts)
+      {
+        boost::lock_guard<boost::mutex> lock(account->lock);
+        a << *account;
+      }
+      a << m_scanned_hashes;
+      f.flush();
+      if (f.fail())
+        return false;
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Error storing light wallet state: " << e.what());
+      return false;
+    }
+
+    // the new state must be on disk before it replaces the old one
+    const std::error_code e = tools::sync_file(tmp_filename);
+    if (e)
+    {
+      MERROR("Failed to sync " << tmp_filename << ": " << e.message());
+      return false;
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(tmp_filename, m_filename, ec);
+    if (ec)
+    {
+      MERROR("Failed to rename " << tmp_filename << " to " << m_filename << ": " << ec.message());
+      return false;
+    }
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  light_wallet_scanner::account_ptr light_wallet_scanner::find_account(const account_public_address& address, const crypto::secret_key& view_secret_key) const
+  {
+    account_ptr account;
+    {
+      boost::lock_guard<boost::mutex> lock(m_accounts_lock);
+      auto i = m_accounts.find(address.m_spend_public_key);
+      if (i == m_accounts.end())
+        return account_ptr();
+      account = i->second;
+    }
+    if (account->address.m_view_public_key != address.m_view_public_key || account->view_secret_key != view_secret_key)
+      return account_ptr();
+    return account;
+  }
+  //---------------------------------------------------------------------------------
+  std::vector<light_wallet_scanner::account_ptr> light_wallet_scanner::get_accounts() const
+  {
+    std::vector<account_ptr> accounts;
+    boost::lock_guard<boost::mutex> lock(m_accounts_lock);
+    accounts.reserve(m_accounts.size());
+    for (const auto &e: m_accounts)
+      accounts.push_back(e.second);
+    return accounts;
+  }
+  //---------------------------------------------------------------------------------
+  size_t light_wallet_scanner::get_account_count() const
+  {
+    boost::lock_guard<boost::mutex> lock(m_accounts_lock);
+    return m_accounts.size();
+  }
+  //---------------------------------------------------------------------------------
+  void light_wallet_scanner::set_max_accounts(size_t max_accounts)
+  {
+    m_max_accounts = max_accounts;
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::is_full() const
+  {
+    const size_t max_accounts = m_max_accounts;
+    return max_accounts && get_account_count() >= max_accounts;
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::login(const account_public_address& address, const crypto::secret_key& view_secret_key, bool create, bool& new_address)
+  {
+    new_address = false;
+    if (!check_view_key(address, view_secret_key))
+      return false;
+
+    {
+      boost::lock_guard<boost::mutex> lock(m_accounts_lock);
+      auto i = m_accounts.find(address.m_spend_public_key);
+      if (i != m_accounts.end())
+        return i->second->address.m_view_public_key == address.m_view_public_key;
+      if (!create)
+        return false;
+      const size_t max_accounts = m_max_accounts;
+      if (max_accounts && m_accounts.size() >= max_accounts)
+      {
+        MWARNING("Light wallet account limit of " << max_accounts << " reached, not registering a new account");
+        return false;
+      }
+
+      // a new account cannot have received anything before now
+      account_ptr account = std::make_shared<lw_account>();
+      account->address = address;
+      account->view_secret_key = view_secret_key;
+      account->start_height = m_blockchain.get_current_blockchain_height();
+      account->scanned_height = account->start_height;
+      m_accounts[address.m_spend_public_key] = account;
+      new_address = true;
+    }
+    MINFO("New light wallet account registered, " << get_account_count() << " accounts");
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::rescan(const account_public_address& address, const crypto::secret_key& view_secret_key)
+  {
+    account_ptr account = find_account(address, view_secret_key);
+    if (!account)
+      return false;
+
+    {
+      boost::lock_guard<boost::mutex> lock(account->lock);
+      account->start_height = 0;
+      rollback(*account, 0);
+    }
+    m_wakeup.notify_all();
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::with_account(const account_public_address& address, const crypto::secret_key& view_secret_key, const std::function<void(const lw_account&)>& f) const
+  {
+    account_ptr account = find_account(address, view_secret_key);
+    if (!account)
+      return false;
+
+    boost::lock_guard<boost::mutex> lock(account->lock);
+    f(*account);
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::get_pool_txs(const account_public_address& address, const crypto::secret_key& view_secret_key, std::vector<lw_tx>& txs) const
+  {
+    account_ptr account = find_account(address, view_secret_key);
+    if (!account)
+      return false;
+
+    std::list<transaction> pool_txs;
+    m_tx_pool.get_transactions(pool_txs, false);
+
+    std::vector<tx_data> pool_tx_data(pool_txs.size());
+    size_t n = 0;
+    for (transaction &tx: pool_txs)
+    {
+      const crypto::hash txid = get_transaction_hash(tx);
+      fill_tx_data(tx, txid, pool_tx_data[n++]);
+    }
+
+    const uint64_t now = time(NULL);
+    boost::lock_guard<boost::mutex> lock(account->lock);
+    for (const tx_data &td: pool_tx_data)
+    {
+      tx_scan_result result;
+      if (scan_tx(*account, td, 0, now, result))
+        txs.push_back(std::move(result.tx));
+    }
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::is_output_unlocked(const lw_output& o, uint64_t chain_height)
+  {
+    if (o.height + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE > chain_height)
+      return false;
+    if (o.unlock_time < CRYPTONOTE_MAX_BLOCK_NUMBER)
+      return chain_height - 1 + CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_BLOCKS >= o.unlock_time;
+    return static_cast<uint64_t>(time(NULL)) + CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_SECONDS_V2 >= o.unlock_time;
+  }
+  //---------------------------------------------------------------------------------
+  void light_wallet_scanner::fill_tx_data(transaction& tx, const crypto::hash& txid, tx_data& td)
+  {
+    td.hash = txid;
+    td.prefix_hash = get_transaction_prefix_hash(tx);
+    td.pub_key = get_tx_pub_key_from_extra(tx);
+    td.coinbase = is_coinbase(tx);
+    td.ring_offsets.clear();
+    td.ring_offsets.resize(tx.vin.size());
+    for (size_t n = 0; n < tx.vin.size(); ++n)
+    {
+      if (tx.vin[n].type() == typeid(txin_to_key))
+        td.ring_offsets[n] = relative_output_offsets_to_absolute(boost::get<txin_to_key>(tx.vin[n]).key_offsets);
+    }
+    td.tx = std::move(tx);
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::get_block_data(uint64_t height, block_data& bd) const
+  {
+    try
+    {
+      const BlockchainDB &db = m_blockchain.get_db();
+      bd.height = height;
+      bd.hash = db.get_block_hash_from_height(height);
+      block blk = db.get_block_from_height(height);
+      // the chain may have changed between the two reads
+      if (get_block_hash(blk) != bd.hash)
+        return false;
+      bd.timestamp = blk.timestamp;
+
+      std::list<transaction> txs;
+      std::list<crypto::hash> missed_txs;
+      if (!m_blockchain.get_transactions(blk.tx_hashes, txs, missed_txs) || !missed_txs.empty())
+        return false;
+
+      bd.txs.clear();
+      bd.txs.resize(txs.size() + 1);
+      fill_tx_data(blk.miner_tx, get_transaction_hash(blk.miner_tx), bd.txs[0]);
+      size_t n = 1;
+      for (transaction &tx: txs)
+      {
+        fill_tx_data(tx, blk.tx_hashes[n - 1], bd.txs[n]);
+        ++n;
+      }
+
+      for (tx_data &td: bd.txs)
+        if (!m_blockchain.get_tx_outputs_gindexs(td.hash, td.gindices))
+          return false;
+    }
+    catch (const std::exception &e)
+    {
+      MERROR("Failed to get block data at height " << height << ": " << e.what());
+      return false;
+    }
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::scan_tx(const lw_account& account, const tx_data& td, uint64_t height, uint64_t timestamp, tx_scan_result& result) const
+  {
+    const transaction &tx = td.tx;
+    const crypto::hash &txid = td.hash;
+    const bool coinbase = td.coinbase;
+    const crypto::public_key &tx_pub_key = td.pub_key;
+
+    result.outputs.clear();
+    lw_tx &ltx = result.tx;
+    ltx.hash = txid;
+    ltx.height = height;
+    ltx.timestamp = timestamp;
+    ltx.unlock_time = tx.unlock_time;
+    ltx.total_received = 0;
+    ltx.total_sent = 0;
+    ltx.mixin = 0;
+    ltx.coinbase = coinbase;
+    ltx.spends.clear();
+
+    // incoming
+    crypto::key_derivation derivation;
+    if (tx_pub_key != crypto::null_pkey && crypto::generate_key_derivation(tx_pub_key, account.view_secret_key, derivation))
+    {
+      for (size_t i = 0; i < tx.vout.size(); ++i)
+      {
+        if (tx.vout[i].target.type() != typeid(txout_to_key))
+          continue;
+        const crypto::public_key &out_key = boost::get<txout_to_key>(tx.vout[i].target).key;
+        crypto::public_key derived_key;
+        if (!crypto::derive_public_key(derivation, i, account.address.m_spend_public_key, derived_key) || derived_key != out_key)
+          continue;
+
+        lw_output o;
+        o.tx_hash = txid;
+        o.tx_prefix_hash = td.prefix_hash;
+        o.tx_pub_key = tx_pub_key;
+        o.public_key = out_key;
+        o.index = i;
+        o.global_index = i < td.gindices.size() ? td.gindices[i] : 0;
+        o.height = height;
+        o.timestamp = timestamp;
+        o.unlock_time = tx.unlock_time;
+        o.coinbase = coinbase;
+        o.rct = tx.version > 1;
+        o.encrypted_mask = rct::zero();
+        o.encrypted_amount = rct::zero();
+        if (tx.version > 1 && tx.rct_signatures.type != rct::RCTTypeNull)
+        {
+          rct::key mask;
+          try
+          {
+            o.amount = decode_rct_amount(tx.rct_signatures, derivation, i, mask);
+          }
+          catch (const std::exception &e)
+          {
+            MWARNING("Failed to decode amount of output " << i << " of tx " << txid << ": " << e.what());
+            continue;
+          }
+          o.commitment = tx.rct_signatures.outPk[i].mask;
+          o.encrypted_mask = tx.rct_signatures.ecdhInfo[i].mask;
+          o.encrypted_amount = tx.rct_signatures.ecdhInfo[i].amount;
+        }
+        else
+        {
+          o.amount = tx.vout[i].amount;
+          o.commitment = o.rct ? rct::zeroCommit(o.amount) : rct::zero();
+        }
+        ltx.total_received += o.amount;
+        result.outputs.push_back(o);
+      }
+      if (!result.outputs.empty())
+        ltx.payment_id = get_payment_id(tx, tx_pub_key, account.view_secret_key);
+    }
+
+    // outgoing, any input that has one of our outputs in its ring
+    for (size_t n = 0; n < tx.vin.size(); ++n)
+    {
+      if (tx.vin[n].type() != typeid(txin_to_key))
+        continue;
+      const txin_to_key &in_to_key = boost::get<txin_to_key>(tx.vin[n]);
+      const uint32_t mixin = in_to_key.key_offsets.empty() ? 0 : in_to_key.key_offsets.size() - 1;
+      ltx.mixin = std::max(ltx.mixin, mixin);
+      if (account.output_lookup.empty())
+        continue;
+      for (uint64_t offset: td.ring_offsets[n])
+      {
+        auto i = account.output_lookup.find(std::make_pair(in_to_key.amount, offset));
+        if (i == account.output_lookup.end())
+          continue;
+        const lw_output &o = account.outputs[i->second];
+        lw_spend spend;
+        spend.key_image = in_to_key.k_image;
+        spend.amount = o.amount;
+        spend.tx_pub_key = o.tx_pub_key;
+        spend.out_index = o.index;
+        spend.mixin = mixin;
+        ltx.total_sent += o.amount;
+        ltx.spends.push_back(spend);
+      }
+    }
+
+    if (ltx.spends.empty() && result.outputs.empty())
+      return false;
+    if (result.outputs.empty())
+      ltx.payment_id = crypto::null_hash;
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  void light_wallet_scanner::rollback(lw_account& account, uint64_t height) const
+  {
+    while (!account.txs.empty() && account.txs.back().height >= height)
+      account.txs.pop_back();
+    while (!account.outputs.empty() && account.outputs.back().height >= height)
+      account.outputs.pop_back();
+    account.rebuild_output_lookup();
+    account.scanned_height = std::min(account.scanned_height, height);
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::check_reorg()
+  {
+    if (m_scanned_hashes.empty())
+      return false;
+
+    uint64_t fork_height = std::numeric_limits<uint64_t>::max();
+    const uint64_t chain_height = m_blockchain.get_current_blockchain_height();
+    for (const auto &e: m_scanned_hashes)
+    {
+      if (e.first >= chain_height || m_blockchain.get_block_id_by_height(e.first) != e.second)
+      {
+        fork_height = e.first;
+        break;
+      }
+    }
+    if (fork_height == std::numeric_limits<uint64_t>::max())
+      return false;
+
+    if (fork_height == m_scanned_hashes.begin()->first && fork_height > 0)
+      MWARNING("Reorg deeper than the light wallet reorg window, rolling back to " << fork_height);
+    MINFO("Reorg detected, rolling light wallet accounts back to height " << fork_height);
+
+    for (const account_ptr &account: get_accounts())
+    {
+      boost::lock_guard<boost::mutex> lock(account->lock);
+      rollback(*account, fork_height);
+    }
+    m_scanned_hashes.erase(m_scanned_hashes.lower_bound(fork_height), m_scanned_hashes.end());
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::apply_block(lw_account& account, const block_data& bd) const
+  {
+    boost::lock_guard<boost::mutex> lock(account.lock);
+    if (account.scanned_height != bd.height)
+      return false; // rescan requested meanwhile
+    for (const tx_data &td: bd.txs)
+    {
+      tx_scan_result result;
+      if (!scan_tx(account, td, bd.height, bd.timestamp, result))
+        continue;
+      for (lw_output &o: result.outputs)
+      {
+        account.output_lookup[std::make_pair(o.rct ? 0 : o.amount, o.global_index)] = account.outputs.size();
+        account.outputs.push_back(std::move(o));
+      }
+      account.txs.push_back(std::move(result.tx));
+    }
+    account.scanned_height = bd.height + 1;
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  void light_wallet_scanner::scan_block(const block_data& bd, const std::vector<pending_account>& accounts, std::vector<uint8_t>& applied) const
+  {
+    applied.assign(accounts.size(), 0);
+
+    // the derivations dominate, so split the accounts over the thread pool
+    tools::threadpool& tpool = tools::threadpool::getInstance();
+    const size_t max_tasks = std::max(1, tpool.get_max_concurrency());
+    const size_t chunk = std::max<size_t>(LIGHT_WALLET_MIN_ACCOUNTS_PER_TASK, (accounts.size() + max_tasks - 1) / max_tasks);
+    if (accounts.size() <= chunk)
+    {
+      for (size_t n = 0; n < accounts.size(); ++n)
+        applied[n] = apply_block(*accounts[n].first, bd);
+      return;
+    }
+
+    tools::threadpool::waiter waiter;
+    for (size_t begin = 0; begin < accounts.size(); begin += chunk)
+    {
+      const size_t end = std::min(begin + chunk, accounts.size());
+      tpool.submit(&waiter, [this, &bd, &accounts, &applied, begin, end]() {
+        for (size_t n = begin; n < end; ++n)
+          applied[n] = apply_block(*accounts[n].first, bd);
+      });
+    }
+    waiter.wait();
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::scan_pass(uint64_t chain_height)
+  {
+    // accounts by the height of the next block they need
+    std::map<uint64_t, std::vector<pending_account>> pending;
+    for (const account_ptr &account: get_accounts())
+    {
+      uint64_t height;
+      {
+        boost::lock_guard<boost::mutex> lock(account->lock);
+        height = account->scanned_height;
+      }
+      if (height < chain_height)
+        pending[height].push_back(std::make_pair(account, std::min(height + LIGHT_WALLET_SCAN_BATCH, chain_height)));
+    }
+
+    block_data bd;
+    std::vector<uint8_t> applied;
+    while (!pending.empty() && m_running)
+    {
+      const uint64_t height = pending.begin()->first;
+      const std::vector<pending_account> accounts = std::move(pending.begin()->second);
+      pending.erase(pending.begin());
+
+      if (!get_block_data(height, bd))
+        return false;
+      scan_block(bd, accounts, applied);
+      m_scanned_hashes[height] = bd.hash;
+
+      // accounts still in their pass join whoever needs the next block
+      for (size_t n = 0; n < accounts.size(); ++n)
+        if (applied[n] && height + 1 < accounts[n].second)
+          pending[height + 1].push_back(accounts[n]);
+    }
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  bool light_wallet_scanner::scan_to_tip()
+  {
+    CHECK_AND_ASSERT_MES(!m_initialized, false, "scan_to_tip called while the scanner thread is running");
+
+    m_running = true;
+    bool ret = false;
+    for (;;)
+    {
+      check_reorg();
+      const uint64_t chain_height = m_blockchain.get_current_blockchain_height();
+      if (!scan_pass(chain_height))
+        break;
+      bool behind = false;
+      for (const account_ptr &account: get_accounts())
+      {
+        boost::lock_guard<boost::mutex> lock(account->lock);
+        behind |= account->scanned_height < chain_height;
+      }
+      if (!behind)
+      {
+        ret = true;
+        break;
+      }
+    }
+    m_running = false;
+    return ret;
+  }
+  //---------------------------------------------------------------------------------
+  void light_wallet_scanner::run()
+  {
+    epee::math_helper::once_a_time_seconds<60*10, false> store_interval;
+    MINFO("Light wallet scanner started");
+    while (m_running)
+    {
+      check_reorg();
+
+      const uint64_t chain_height = m_blockchain.get_current_blockchain_height();
+      bool behind = false;
+      // if a block could not be read, the chain probably changed under us, so give it a moment
+      if (scan_pass(chain_height))
+      {
+        for (const account_ptr &account: get_accounts())
+        {
+          boost::lock_guard<boost::mutex> lock(account->lock);
+          behind |= account->scanned_height < chain_height;
+        }
+      }
+
+      while (!m_scanned_hashes.empty() && m_scanned_hashes.begin()->first + LIGHT_WALLET_REORG_WINDOW < chain_height)
+        m_scanned_hashes.erase(m_scanned_hashes.begin());
+
+      store_interval.do_call([this](){ store(); return true; });
+
+      if (!behind)
+      {
+        boost::unique_lock<boost::mutex> lock(m_wakeup_lock);
+        if (m_running)
+          m_wakeup.timed_wait(lock, boost::posix_time::seconds(1));
+      }
+    }
+    MINFO("Light wallet scanner stopped");
+  }
+}
@@ -0,0 +1,330 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/utility.hpp>
+
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "crypto/crypto.h"
+#include "crypto/hash.h"
+#include "ringct/rctTypes.h"
+
+namespace cryptonote
+{
+  class Blockchain;
+  class tx_memory_pool;
+
+  /**
+   * @brief an output received by a light wallet account
+   */
+  struct lw_output
+  {
+    crypto::hash tx_hash;
+    crypto::hash tx_prefix_hash;
+    crypto::public_key tx_pub_key;
+    crypto::public_key public_key;
+    rct::key commitment;        //!< output commitment, zero for pre-rct outputs
+    rct::key encrypted_mask;    //!< ecdh encoded mask, as found on chain
+    rct::key encrypted_amount;  //!< ecdh encoded amount, as found on chain
+    uint64_t amount;            //!< decoded amount
+    uint64_t index;             //!< index of the output in its transaction
+    uint64_t global_index;      //!< amount specific global output index
+    uint64_t height;
+    uint64_t timestamp;
+    uint64_t unlock_time;
+    bool rct;
+    bool coinbase;
+  };
+
+  /**
+   * @brief an input which may spend an output of a light wallet account
+   *
+   * Without the spend key the scanner cannot compute key images, so every
+   * input with one of the account's outputs in its ring is recorded, and
+   * the client checks which key images are really its own.
+   */
+  struct lw_spend
+  {
+    crypto::key_image key_image;
+    uint64_t amount;                //!< amount of the referenced output
+    crypto::public_key tx_pub_key;  //!< tx public key of the referenced output
+    uint64_t out_index;             //!< index of the referenced output in its transaction
+    uint32_t mixin;
+  };
+
+  /**
+   * @brief a transaction touching a light wallet account
+   */
+  struct lw_tx
+  {
+    crypto::hash hash;
+    crypto::hash payment_id;
+    uint64_t height;
+    uint64_t timestamp;
+    uint64_t unlock_time;
+    uint64_t total_received;
+    uint64_t total_sent;
+    uint32_t mixin;
+    bool coinbase;
+    std::vector<lw_spend> spends;
+  };
+
+  /**
+   * @brief the state the scanner keeps for one light wallet account
+   */
+  struct lw_account
+  {
+    account_public_address address;
+    crypto::secret_key view_secret_key;
+    uint64_t start_height;    //!< height the account was registered at
+    uint64_t scanned_height;  //!< number of blocks scanned so far
+    std::vector<lw_output> outputs;
+    std::vector<lw_tx> txs;
+
+    //! (index amount, global index) -> position in outputs, used to spot spends
+    std::map<std::pair<uint64_t, uint64_t>, size_t> output_lookup;
+
+    //! guards everything above against the scanner thread
+    mutable boost::mutex lock;
+
+    void rebuild_output_lookup();
+  };
+
+  /**
+   * @brief Scans the blockchain on behalf of hosted view key accounts
+   *
+   * This class backs the light wallet RPC API (login, get_address_info,
+   * get_address_txs, get_unspent_outs). Accounts are registered with their
+   * address and secret view key, and a background thread keeps each of
+   * them up to date as blocks are added to the chain, so clients do not need
+   * to download and scan blocks themselves.
+   *
+   * Accounts share a single pass over the chain: each block is read, parsed
+   * and hashed once, then scanned for all accounts waiting on it, with the
+   * per account key derivations spread over the thread pool. Accounts which
+   * are far behind (new imports) advance in bounded steps so they do not
+   * hold up the ones at the tip.
+   *
+   * Account state survives restarts: it is saved to disk on shutdown and
+   * periodically while running. Reorganizations are detected by comparing
+   * the hashes of recently scanned blocks against the chain, and affected
+   * accounts are rolled back and rescanned.
+   */
+  class light_wallet_scanner: boost::noncopyable
+  {
+  public:
+    /**
+     * @brief Constructor
+     *
+     * @param bchs the Blockchain to scan
+     * @param pool the transaction pool, for unconfirmed transactions
+     */
+    light_wallet_scanner(Blockchain& bchs, tx_memory_pool& pool);
+
+    ~light_wallet_scanner();
+
+    /**
+     * @brief loads saved accounts and starts the scanning thread
+     *
+     * @param config_folder folder to keep the account state in
+     *
+     * @return true on success, false otherwise
+     */
+    bool init(const std::string& config_folder);
+
+    /**
+     * @brief stops the scanning thread and saves account state
+     *
+     * @return true on success, false otherwise
+     */
+    bool deinit();
+
+    /**
+     * @brief sets how many accounts may be registered
+     *
+     * Every account adds work to the scan of each block, so new accounts
+     * are refused past this number. Accounts already registered are kept.
+     *
+     * @param max_accounts the maximum number of accounts, 0 for no limit
+     */
+    void set_max_accounts(size_t max_accounts);
+
+    /**
+     * @brief checks whether the maximum number of accounts is registered
+     */
+    bool is_full() const;
+
+    /**
+     * @brief registers a light wallet account, or checks an existing one
+     *
+     * @param address the account's address
+     * @param view_secret_key the account's secret view key
+     * @param create whether to register the account if it is not known yet
+     * @param new_address return-by-reference whether the account was just created
+     *
+     * @return true if the account is (now) registered, false otherwise
+     */
+    bool login(const account_public_address& address, const crypto::secret_key& view_secret_key, bool create, bool& new_address);
+
+    /**
+     * @brief schedules a full rescan of an account from the genesis block
+     *
+     * @param address the account's address
+     * @param view_secret_key the account's secret view key
+     *
+     * @return true if the account is registered, false otherwise
+     */
+    bool rescan(const account_public_address& address, const crypto::secret_key& view_secret_key);
+
+    /**
+     * @brief runs a function on an account's state, under its lock
+     *
+     * @param address the account's address
+     * @param view_secret_key the account's secret view key
+     * @param f the function to run
+     *
+     * @return false if the account is not registered or the key does not match, true otherwise
+     */
+    bool with_account(const account_public_address& address, const crypto::secret_key& view_secret_key, const std::function<void(const lw_account&)>& f) const;
+
+    /**
+     * @brief scans the transaction pool for an account
+     *
+     * @param address the account's address
+     * @param view_secret_key the account's secret view key
+     * @param txs return-by-reference the pool transactions touching the account
+     *
+     * @return false if the account is not registered or the key does not match, true otherwise
+     */
+    bool get_pool_txs(const account_public_address& address, const crypto::secret_key& view_secret_key, std::vector<lw_tx>& txs) const;
+
+    /**
+     * @brief checks whether an output can be spent at a given chain height
+     *
+     * @param o the output to check
+     * @param chain_height the current blockchain height
+     *
+     * @return true if the output is unlocked, false otherwise
+     */
+    static bool is_output_unlocked(const lw_output& o, uint64_t chain_height);
+
+    /**
+     * @brief get the number of registered accounts
+     */
+    size_t get_account_count() const;
+
+    /**
+     * @brief brings all accounts up to the current chain height, synchronously
+     *
+     * Only usable while the scanning thread is not running, ie, before init
+     * or after deinit.
+     *
+     * @return true if all accounts are up to date, false otherwise
+     */
+    bool scan_to_tip();
+
+  private:
+    typedef std::shared_ptr<lw_account> account_ptr;
+
+    //! a transaction, with everything shared by all accounts computed once
+    struct tx_data
+    {
+      transaction tx;
+      crypto::hash hash;
+      crypto::hash prefix_hash;
+      crypto::public_key pub_key;
+      bool coinbase;
+      std::vector<uint64_t> gindices;                 //!< empty for pool txs
+      std::vector<std::vector<uint64_t>> ring_offsets;  //!< absolute ring member offsets, per input
+    };
+
+    //! the data of one block the scanner needs
+    struct block_data
+    {
+      uint64_t height;
+      crypto::hash hash;
+      uint64_t timestamp;
+      std::vector<tx_data> txs;  //!< miner tx first, then the block's txs
+    };
+
+    //! what one transaction contributed to an account
+    struct tx_scan_result
+    {
+      lw_tx tx;
+      std::vector<lw_output> outputs;
+    };
+
+    //! an account waiting for a block, and the height its current pass stops at
+    typedef std::pair<account_ptr, uint64_t> pending_account;
+
+    account_ptr find_account(const account_public_address& address, const crypto::secret_key& view_secret_key) const;
+    std::vector<account_ptr> get_accounts() const;
+
+    static void fill_tx_data(transaction& tx, const crypto::hash& txid, tx_data& td);
+    bool get_block_data(uint64_t height, block_data& bd) const;
+    bool scan_tx(const lw_account& account, const tx_data& td, uint64_t height, uint64_t timestamp, tx_scan_result& result) const;
+    bool apply_block(lw_account& account, const block_data& bd) const;
+    void scan_block(const block_data& bd, const std::vector<pending_account>& accounts, std::vector<uint8_t>& applied) const;
+    bool scan_pass(uint64_t chain_height);
+    bool check_reorg();
+    void rollback(lw_account& account, uint64_t height) const;
+
+    bool load();
+    bool store() const;
+    void run();
+
+    Blockchain& m_blockchain;
+    tx_memory_pool& m_tx_pool;
+
+    std::string m_filename;
+
+    mutable boost::mutex m_accounts_lock;  //!< guards m_accounts
+    std::unordered_map<crypto::public_key, account_ptr> m_accounts;  //!< accounts by spend public key
+    std::atomic<size_t> m_max_accounts;  //!< 0 for no limit
+
+    //! hashes of recently scanned blocks, for reorg detection (scanner thread only)
+    std::map<uint64_t, crypto::hash> m_scanned_hashes;
+
+    boost::thread m_thread;
+    boost::mutex m_wakeup_lock;
+    boost::condition_variable m_wakeup;
+    std::atomic<bool> m_running;
+    bool m_initialized;
+  };
+}
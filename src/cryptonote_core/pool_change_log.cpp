@@ -0,0 +1,69 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <unordered_map>
+
+#include "pool_change_log.h"
+
+namespace cryptonote
+{
+  //---------------------------------------------------------------------------------
+  pool_change_log::pool_change_log(uint64_t sequence, size_t max_size):
+    m_sequence(sequence),
+    m_max_size(max_size)
+  {
+  }
+  //---------------------------------------------------------------------------------
+  void pool_change_log::record(const crypto::hash &id, bool added, bool do_not_relay)
+  {
+    ++m_sequence;
+    m_changes.push_back({id, added, do_not_relay});
+    if (m_changes.size() > m_max_size)
+      m_changes.pop_front();
+  }
+  //---------------------------------------------------------------------------------
+  bool pool_change_log::get_changes(uint64_t since, std::vector<crypto::hash>& added, std::vector<crypto::hash>& removed, bool include_unrelayed_txes) const
+  {
+    // how far behind the caller is, which also works across a wrap
+    const uint64_t behind = m_sequence - since;
+    if (behind > m_changes.size())
+      return false;
+
+    // a tx may come and go several times, only its last state matters
+    std::unordered_map<crypto::hash, bool> last_state;
+    for (auto it = m_changes.end() - behind; it != m_changes.end(); ++it)
+    {
+      if (it->do_not_relay && !include_unrelayed_txes)
+        continue;
+      last_state[it->id] = it->added;
+    }
+    for (const auto &e: last_state)
+      (e.second ? added : removed).push_back(e.first);
+    return true;
+  }
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "crypto/hash.h"
+
+namespace cryptonote
+{
+  /**
+   * @brief the recent history of transactions entering and leaving the pool
+   *
+   * Every change bumps a sequence number, and the most recent changes are
+   * kept so clients can follow the pool without fetching all of it every
+   * time. Sequence numbers are compared modulo 2^64, so the log keeps
+   * working if they wrap around.
+   *
+   * This is not thread safe, the pool guards it with its own lock.
+   */
+  class pool_change_log
+  {
+  public:
+    /**
+     * @brief Constructor
+     *
+     * @param sequence the sequence number to start from
+     * @param max_size how many changes to remember
+     */
+    pool_change_log(uint64_t sequence, size_t max_size);
+
+    /**
+     * @brief record a transaction entering or leaving the pool
+     *
+     * @param id the transaction's hash
+     * @param added whether the transaction was added or removed
+     * @param do_not_relay whether the transaction is not to be relayed
+     */
+    void record(const crypto::hash &id, bool added, bool do_not_relay);
+
+    /**
+     * @brief get the changes since a given sequence number
+     *
+     * A transaction which changed several times is only reported in its
+     * last state.
+     *
+     * @param since the sequence number the caller last synced to
+     * @param added return-by-reference the transactions added since then
+     * @param removed return-by-reference the transactions removed since then
+     * @param include_unrelayed_txes include changes to unrelayed txes
+     *
+     * @return false if the changes since then are not known anymore, true otherwise
+     */
+    bool get_changes(uint64_t since, std::vector<crypto::hash>& added, std::vector<crypto::hash>& removed, bool include_unrelayed_txes) const;
+
+    /**
+     * @brief get the sequence number of the last change
+     */
+    uint64_t sequence() const { return m_sequence; }
+
+  private:
+    struct change
+    {
+      crypto::hash id;
+      bool added;
+      bool do_not_relay;
+    };
+
+    uint64_t m_sequence;  //!< sequence number of the last change
+    size_t m_max_size;
+    std::deque<change> m_changes;  //!< the most recent changes, oldest first, with consecutive sequence numbers
+  };
+}
@@ -30,6 +30,7 @@
 
 #include <algorithm>
 #include <boost/filesystem.hpp>
+#include <memory>
 #include <unordered_set>
 #include <vector>
 
@@ -65,6 +66,8 @@ namespace cryptonote
     time_t const MIN_RELAY_TIME = (60 * 5); // only start re-relaying transactions after that many seconds
     time_t const MAX_RELAY_TIME = (60 * 60 * 4); // at most that many seconds between resends
     float const ACCEPT_THRESHOLD = 1.0f;
+    size_t const POOL_CHANGES_MAX_SIZE = 20000; // how many pool changes to remember for get_transaction_changes
+    unsigned const POOL_SEQUENCE_TIME_SHIFT = 20; // pool sequence numbers start at the creation time shifted by that many bits
 
     // a kind of increasing backoff within min/max bounds
     uint64_t get_relay_delay(time_t now, time_t received)
@@ -102,9 +105,9 @@ namespace cryptonote
   }
   //---------------------------------------------------------------------------------
   //---------------------------------------------------------------------------------
-  tx_memory_pool::tx_memory_pool(Blockchain& bchs): m_blockchain(bchs)
+  tx_memory_pool::tx_memory_pool(Blockchain& bchs): m_blockchain(bchs), m_pool_changes(((uint64_t)time(NULL)) << POOL_SEQUENCE_TIME_SHIFT, POOL_CHANGES_MAX_SIZE), m_template_top_id(null_hash), m_template_version(0)
   {
-
+    m_template_snapshot.valid = false;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::add_tx(transaction &tx, /*const crypto::hash& tx_prefix_hash,*/ const crypto::hash &id, size_t blob_size, tx_verification_context& tvc, bool kept_by_block, bool relayed, bool do_not_relay, uint8_t version)
@@ -241,6 +244,7 @@ namespace cryptonote
           if (!insert_key_images(tx, kept_by_block))
             return false;
           m_txs_by_fee_and_receive_time.emplace(std::pair<double, std::time_t>(fee / (double)blob_size, receive_time), id);
+          add_template_tx(id, tx, blob_size, fee);
         }
         catch (const std::exception &e)
         {
@@ -282,6 +286,7 @@ namespace cryptonote
         if (!insert_key_images(tx, kept_by_block))
           return false;
         m_txs_by_fee_and_receive_time.emplace(std::pair<double, std::time_t>(fee / (double)blob_size, receive_time), id);
+        add_template_tx(id, tx, blob_size, fee);
       }
       catch (const std::exception &e)
       {
@@ -297,6 +302,12 @@ namespace cryptonote
     tvc.m_verifivation_failed = false;
 
     MINFO("Transaction added to pool: txid " << id << " bytes: " << blob_size << " fee/byte: " << (fee / (double)blob_size));
+
+    m_pool_changes.record(id, true, do_not_relay);
+
+    for (const auto& notify: m_tx_notifiers)
+      notify(id, tx);
+
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -309,6 +320,35 @@ namespace cryptonote
     return add_tx(tx, h, blob_size, tvc, keeped_by_block, relayed, do_not_relay, version);
   }
   //---------------------------------------------------------------------------------
+  void tx_memory_pool::add_template_tx(const crypto::hash &id, const transaction &tx, size_t blob_size, uint64_t fee)
+  {
+    template_tx &ttx = m_template_txs[id];
+    ttx.blob_size = blob_size;
+    ttx.fee = fee;
+    ttx.key_images.clear();
+    ttx.key_images.reserve(tx.vin.size());
+    for (const auto &in: tx.vin)
+    {
+      if (in.type() == typeid(txin_to_key))
+        ttx.key_images.push_back(boost::get<txin_to_key>(in).k_image);
+    }
+    ttx.checked = false;
+    ttx.ready = false;
+    m_template_snapshot.valid = false;
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::remove_template_tx(const crypto::hash &id)
+  {
+    m_template_txs.erase(id);
+    m_template_snapshot.valid = false;
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::add_tx_notify(tx_notify_t&& notify)
+  {
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    m_tx_notifiers.push_back(std::move(notify));
+  }
+  //---------------------------------------------------------------------------------
   bool tx_memory_pool::insert_key_images(const transaction &tx, bool kept_by_block)
   {
     for(const auto& in: tx.vin)
@@ -386,6 +426,7 @@ namespace cryptonote
 
       // remove first, in case this throws, so key images aren't removed
       m_blockchain.remove_txpool_tx(id);
+      m_pool_changes.record(id, false, do_not_relay);
       remove_transaction_keyimages(tx);
     }
     catch (const std::exception &e)
@@ -395,6 +436,7 @@ namespace cryptonote
     }
 
     m_txs_by_fee_and_receive_time.erase(sorted_it);
+    remove_template_tx(id);
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -417,7 +459,7 @@ namespace cryptonote
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     CRITICAL_REGION_LOCAL1(m_blockchain);
-    std::unordered_set<crypto::hash> remove;
+    std::unordered_map<crypto::hash, bool> remove; // txid -> do_not_relay
     m_blockchain.for_all_txpool_txes([this, &remove](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata*) {
       uint64_t tx_age = time(nullptr) - meta.receive_time;
 
@@ -434,8 +476,9 @@ namespace cryptonote
         {
           m_txs_by_fee_and_receive_time.erase(sorted_it);
         }
+        remove_template_tx(txid);
         m_timed_out_transactions.insert(txid);
-        remove.insert(txid);
+        remove.emplace(txid, meta.do_not_relay);
       }
       return true;
     }, false);
@@ -443,8 +486,9 @@ namespace cryptonote
     if (!remove.empty())
     {
       LockedTXN lock(m_blockchain);
-      for (const crypto::hash &txid: remove)
+      for (const auto &entry: remove)
       {
+        const crypto::hash &txid = entry.first;
         try
         {
           cryptonote::blobdata bd = m_blockchain.get_txpool_tx_blob(txid);
@@ -458,6 +502,7 @@ namespace cryptonote
           {
             // remove first, so we only remove key images if the tx removal succeeds
             m_blockchain.remove_txpool_tx(txid);
+            m_pool_changes.record(txid, false, entry.second);
             remove_transaction_keyimages(tx);
           }
         }
@@ -561,6 +606,18 @@ namespace cryptonote
     }, false, include_unrelayed_txes);
   }
   //------------------------------------------------------------------
+  bool tx_memory_pool::get_transaction_changes(uint64_t since, std::vector<crypto::hash>& added, std::vector<crypto::hash>& removed, uint64_t& sequence, bool include_unrelayed_txes) const
+  {
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    sequence = m_pool_changes.sequence();
+    if (since == 0 || !m_pool_changes.get_changes(since, added, removed, include_unrelayed_txes))
+    {
+      get_transaction_hashes(added, include_unrelayed_txes);
+      return false;
+    }
+    return true;
+  }
+  //------------------------------------------------------------------
   void tx_memory_pool::get_transaction_backlog(std::vector<tx_backlog_entry>& backlog, bool include_unrelayed_txes) const
   {
     CRITICAL_REGION_LOCAL(m_transactions_lock);
@@ -792,11 +849,53 @@ namespace cryptonote
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const crypto::hash& top_block_id)
   {
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    CRITICAL_REGION_LOCAL1(m_blockchain);
+    m_template_snapshot.valid = false;
+    if (new_block_height < 2 || m_template_top_id != m_blockchain.get_block_id_by_height(new_block_height - 2) ||
+        m_template_version != m_blockchain.get_current_hard_fork_version())
+    {
+      // not checked on top of the previous block, or the rules may have
+      // changed: check everything again
+      for (auto &e: m_template_txs)
+        e.second.checked = false;
+      return true;
+    }
+
+    // the new block can only make a ready transaction not ready by spending
+    // one of its key images, but may have unlocked what the others wait for
+    const BlockchainDB &db = m_blockchain.get_db();
+    for (auto &e: m_template_txs)
+    {
+      template_tx &ttx = e.second;
+      if (!ttx.checked)
+        continue;
+      if (ttx.ready)
+      {
+        for (const crypto::key_image &ki: ttx.key_images)
+        {
+          if (db.has_key_image(ki))
+          {
+            ttx.checked = false;
+            break;
+          }
+        }
+      }
+      else
+      {
+        ttx.checked = false;
+      }
+    }
+    m_template_top_id = top_block_id;
     return true;
   }
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_dec(uint64_t new_block_height, const crypto::hash& top_block_id)
   {
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    m_template_snapshot.valid = false;
+    for (auto &e: m_template_txs)
+      e.second.checked = false;
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -883,24 +982,22 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::have_key_images(const std::unordered_set<crypto::key_image>& k_images, const transaction& tx)
+  bool tx_memory_pool::have_key_images(const std::unordered_set<crypto::key_image>& k_images, const std::vector<crypto::key_image>& key_images)
   {
-    for(size_t i = 0; i!= tx.vin.size(); i++)
+    for(const crypto::key_image &ki: key_images)
     {
-      CHECKED_GET_SPECIFIC_VARIANT(tx.vin[i], const txin_to_key, itk, false);
-      if(k_images.count(itk.k_image))
+      if(k_images.count(ki))
         return true;
     }
     return false;
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::append_key_images(std::unordered_set<crypto::key_image>& k_images, const transaction& tx)
+  bool tx_memory_pool::append_key_images(std::unordered_set<crypto::key_image>& k_images, const std::vector<crypto::key_image>& key_images)
   {
-    for(size_t i = 0; i!= tx.vin.size(); i++)
+    for(const crypto::key_image &ki: key_images)
     {
-      CHECKED_GET_SPECIFIC_VARIANT(tx.vin[i], const txin_to_key, itk, false);
-      auto i_res = k_images.insert(itk.k_image);
-      CHECK_AND_ASSERT_MES(i_res.second, false, "internal error: key images pool cache - inserted duplicate image in set: " << itk.k_image);
+      auto i_res = k_images.insert(ki);
+      CHECK_AND_ASSERT_MES(i_res.second, false, "internal error: key images pool cache - inserted duplicate image in set: " << ki);
     }
     return true;
   }
@@ -991,18 +1088,50 @@ namespace cryptonote
     size_t max_total_size = version >= 5 ? max_total_size_v5 : max_total_size_pre_v5;
     std::unordered_set<crypto::key_image> k_images;
 
+    // reuse the last template if neither the pool nor the chain changed since
+    const crypto::hash top_id = m_blockchain.get_tail_id();
+    block_template_snapshot &snapshot = m_template_snapshot;
+    if (snapshot.valid && top_id == m_template_top_id && snapshot.median_size == median_size &&
+        snapshot.already_generated_coins == already_generated_coins && snapshot.version == version)
+    {
+      bl.tx_hashes.insert(bl.tx_hashes.end(), snapshot.tx_hashes.begin(), snapshot.tx_hashes.end());
+      total_size = snapshot.total_size;
+      fee = snapshot.fee;
+      expected_reward = snapshot.expected_reward;
+      LOG_PRINT_L2("Block template reused with " << snapshot.tx_hashes.size() << " txes, size " << total_size);
+      return true;
+    }
+
+    // readiness was checked on top of another block, check again
+    if (top_id != m_template_top_id || version != m_template_version)
+    {
+      for (auto &e: m_template_txs)
+        e.second.checked = false;
+      m_template_top_id = top_id;
+      m_template_version = version;
+    }
+
     LOG_PRINT_L2("Filling block template, median size " << median_size << ", " << m_txs_by_fee_and_receive_time.size() << " txes in the pool");
 
-    LockedTXN lock(m_blockchain);
+    // only needed to check transactions not checked on top of this block yet
+    std::unique_ptr<LockedTXN> lock;
+    const size_t first_tx = bl.tx_hashes.size();
 
     auto sorted_it = m_txs_by_fee_and_receive_time.begin();
     while (sorted_it != m_txs_by_fee_and_receive_time.end())
     {
-      txpool_tx_meta_t meta = m_blockchain.get_txpool_tx_meta(sorted_it->second);
-      LOG_PRINT_L2("Considering " << sorted_it->second << ", size " << meta.blob_size << ", current block size " << total_size << "/" << max_total_size << ", current coinbase " << print_money(best_coinbase));
+      auto ttx_it = m_template_txs.find(sorted_it->second);
+      if (ttx_it == m_template_txs.end())
+      {
+        MERROR("Tx " << sorted_it->second << " missing from the block template cache");
+        sorted_it++;
+        continue;
+      }
+      template_tx &ttx = ttx_it->second;
+      LOG_PRINT_L2("Considering " << sorted_it->second << ", size " << ttx.blob_size << ", current block size " << total_size << "/" << max_total_size << ", current coinbase " << print_money(best_coinbase));
 
       // Can not exceed maximum block size
-      if (max_total_size < total_size + meta.blob_size)
+      if (max_total_size < total_size + ttx.blob_size)
       {
         LOG_PRINT_L2("  would exceed maximum block size");
         sorted_it++;
@@ -1015,13 +1144,13 @@ namespace cryptonote
         // If we're getting lower coinbase tx,
         // stop including more tx
         uint64_t block_reward;
-        if(!get_block_reward(median_size, total_size + meta.blob_size, already_generated_coins, block_reward, version))
+        if(!get_block_reward(median_size, total_size + ttx.blob_size, already_generated_coins, block_reward, version))
         {
           LOG_PRINT_L2("  would exceed maximum block size");
           sorted_it++;
           continue;
         }
-        coinbase = block_reward + fee + meta.fee;
+        coinbase = block_reward + fee + ttx.fee;
         if (coinbase < template_accept_threshold(best_coinbase))
         {
           LOG_PRINT_L2("  would decrease coinbase to " << print_money(coinbase));
@@ -1040,39 +1169,46 @@ namespace cryptonote
         }
       }
 
-      cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(sorted_it->second);
-      cryptonote::transaction tx;
-      if (!parse_and_validate_tx_from_blob(txblob, tx))
-      {
-        MERROR("Failed to parse tx from txpool");
-        sorted_it++;
-        continue;
-      }
-
       // Skip transactions that are not ready to be
       // included into the blockchain or that are
       // missing key images
-      const cryptonote::txpool_tx_meta_t original_meta = meta;
-      bool ready = is_transaction_ready_to_go(meta, tx);
-      if (memcmp(&original_meta, &meta, sizeof(meta)))
+      if (!ttx.checked)
       {
-        try
-	{
-	  m_blockchain.update_txpool_tx(sorted_it->second, meta);
-	}
-        catch (const std::exception &e)
-	{
-	  MERROR("Failed to update tx meta: " << e.what());
-	  // continue, not fatal
-	}
+        if (!lock)
+          lock.reset(new LockedTXN(m_blockchain));
+        txpool_tx_meta_t meta = m_blockchain.get_txpool_tx_meta(sorted_it->second);
+        cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(sorted_it->second);
+        cryptonote::transaction tx;
+        if (!parse_and_validate_tx_from_blob(txblob, tx))
+        {
+          MERROR("Failed to parse tx from txpool");
+          sorted_it++;
+          continue;
+        }
+
+        const cryptonote::txpool_tx_meta_t original_meta = meta;
+        ttx.ready = is_transaction_ready_to_go(meta, tx);
+        ttx.checked = true;
+        if (memcmp(&original_meta, &meta, sizeof(meta)))
+        {
+          try
+          {
+            m_blockchain.update_txpool_tx(sorted_it->second, meta);
+          }
+          catch (const std::exception &e)
+          {
+            MERROR("Failed to update tx meta: " << e.what());
+            // continue, not fatal
+          }
+        }
       }
-      if (!ready)
+      if (!ttx.ready)
       {
         LOG_PRINT_L2("  not ready to go");
         sorted_it++;
         continue;
       }
-      if (have_key_images(k_images, tx))
+      if (have_key_images(k_images, ttx.key_images))
       {
         LOG_PRINT_L2("  key images already seen");
         sorted_it++;
@@ -1080,14 +1216,23 @@ namespace cryptonote
       }
 
       bl.tx_hashes.push_back(sorted_it->second);
-      total_size += meta.blob_size;
-      fee += meta.fee;
+      total_size += ttx.blob_size;
+      fee += ttx.fee;
       best_coinbase = coinbase;
-      append_key_images(k_images, tx);
+      append_key_images(k_images, ttx.key_images);
       sorted_it++;
       LOG_PRINT_L2("  added, new block size " << total_size << "/" << max_total_size << ", coinbase " << print_money(best_coinbase));
     }
 
+    snapshot.valid = true;
+    snapshot.median_size = median_size;
+    snapshot.already_generated_coins = already_generated_coins;
+    snapshot.version = version;
+    snapshot.tx_hashes.assign(bl.tx_hashes.begin() + first_tx, bl.tx_hashes.end());
+    snapshot.total_size = total_size;
+    snapshot.fee = fee;
+    snapshot.expected_reward = best_coinbase;
+
     expected_reward = best_coinbase;
     LOG_PRINT_L2("Block template filled with " << bl.tx_hashes.size() << " txes, size "
         << total_size << "/" << max_total_size << ", coinbase " << print_money(best_coinbase)
@@ -1100,16 +1245,16 @@ namespace cryptonote
     CRITICAL_REGION_LOCAL(m_transactions_lock);
     CRITICAL_REGION_LOCAL1(m_blockchain);
     size_t tx_size_limit = get_transaction_size_limit(version);
-    std::unordered_set<crypto::hash> remove;
+    std::unordered_map<crypto::hash, bool> remove; // txid -> do_not_relay
 
     m_blockchain.for_all_txpool_txes([this, &remove, tx_size_limit](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata*) {
       if (meta.blob_size >= tx_size_limit) {
         LOG_PRINT_L1("Transaction " << txid << " is too big (" << meta.blob_size << " bytes), removing it from pool");
-        remove.insert(txid);
+        remove.emplace(txid, meta.do_not_relay);
       }
       else if (m_blockchain.have_tx(txid)) {
         LOG_PRINT_L1("Transaction " << txid << " is in the blockchain, removing it from pool");
-        remove.insert(txid);
+        remove.emplace(txid, meta.do_not_relay);
       }
       return true;
     }, false);
@@ -1118,8 +1263,9 @@ namespace cryptonote
     if (!remove.empty())
     {
       LockedTXN lock(m_blockchain);
-      for (const crypto::hash &txid: remove)
+      for (const auto &entry: remove)
       {
+        const crypto::hash &txid = entry.first;
         try
         {
           cryptonote::blobdata txblob = m_blockchain.get_txpool_tx_blob(txid);
@@ -1131,6 +1277,7 @@ namespace cryptonote
           }
           // remove tx from db first
           m_blockchain.remove_txpool_tx(txid);
+          m_pool_changes.record(txid, false, entry.second);
           remove_transaction_keyimages(tx);
           auto sorted_it = find_tx_in_sorted_container(txid);
           if (sorted_it == m_txs_by_fee_and_receive_time.end())
@@ -1141,6 +1288,7 @@ namespace cryptonote
           {
             m_txs_by_fee_and_receive_time.erase(sorted_it);
           }
+          remove_template_tx(txid);
           ++n_removed;
         }
         catch (const std::exception &e)
@@ -1160,6 +1308,7 @@ namespace cryptonote
 
     m_txs_by_fee_and_receive_time.clear();
     m_spent_key_images.clear();
+    m_template_txs.clear();
     std::vector<crypto::hash> remove;
     bool r = m_blockchain.for_all_txpool_txes([this, &remove](const crypto::hash &txid, const txpool_tx_meta_t &meta, const cryptonote::blobdata *bd) {
       cryptonote::transaction tx;
@@ -1174,6 +1323,7 @@ namespace cryptonote
         return false;
       }
       m_txs_by_fee_and_receive_time.emplace(std::pair<double, time_t>(meta.fee / (double)meta.blob_size, meta.receive_time), txid);
+      add_template_tx(txid, tx, meta.blob_size, meta.fee);
       return true;
     }, true);
     if (!r)
@@ -31,6 +31,8 @@
 #pragma once
 #include "include_base_utils.h"
 
+#include <deque>
+#include <functional>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -44,10 +46,13 @@
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 #include "cryptonote_basic/verification_context.h"
 #include "blockchain_db/blockchain_db.h"
+#include "cryptonote_core/pool_change_log.h"
 #include "crypto/hash.h"
 #include "rpc/core_rpc_server_commands_defs.h"
 #include "rpc/message_data_structs.h"
 
+class gen_tx_pool_block_template;
+
 namespace cryptonote
 {
   class Blockchain;
@@ -92,6 +97,7 @@ namespace cryptonote
    */
   class tx_memory_pool: boost::noncopyable
   {
+    friend class ::gen_tx_pool_block_template;
   public:
     /**
      * @brief Constructor
@@ -128,6 +134,19 @@ namespace cryptonote
      */
     bool add_tx(transaction &tx, tx_verification_context& tvc, bool kept_by_block, bool relayed, bool do_not_relay, uint8_t version);
 
+    //! called with the hash and the transaction of each transaction added to the pool
+    typedef std::function<void(const crypto::hash&, const transaction&)> tx_notify_t;
+
+    /**
+     * @brief registers a function to call when a transaction is added to the pool
+     *
+     * The function is called with the pool lock held, so it should not
+     * take long.
+     *
+     * @param notify the function to call
+     */
+    void add_tx_notify(tx_notify_t&& notify);
+
     /**
      * @brief takes a transaction with the given hash from the pool
      *
@@ -155,7 +174,9 @@ namespace cryptonote
     /**
      * @brief action to take when notified of a block added to the blockchain
      *
-     * Currently does nothing
+     * Transactions found ready to go for block templates stay so, unless
+     * one of their key images was just spent; the others are checked again
+     * next time a template is filled.
      *
      * @param new_block_height the height of the blockchain after the change
      * @param top_block_id the hash of the new top block
@@ -167,7 +188,7 @@ namespace cryptonote
     /**
      * @brief action to take when notified of a block removed from the blockchain
      *
-     * Currently does nothing
+     * All transactions are checked again next time a template is filled.
      *
      * @param new_block_height the height of the blockchain after the change
      * @param top_block_id the hash of the new top block
@@ -248,6 +269,24 @@ namespace cryptonote
      */
     void get_transaction_hashes(std::vector<crypto::hash>& txs, bool include_unrelayed_txes = true) const;
 
+    /**
+     * @brief get the transactions added to and removed from the pool since a given point
+     *
+     * Every change to the pool bumps a sequence number, and the most recent
+     * changes are kept so clients can follow the pool without fetching
+     * all of it every time. Sequence numbers start from the time the pool
+     * was created, so numbers from a previous run are never taken as valid.
+     *
+     * @param since the sequence number the caller last synced to, 0 for a full list
+     * @param added return-by-reference the transactions added since then, or all of them
+     * @param removed return-by-reference the transactions removed since then
+     * @param sequence return-by-reference the current sequence number
+     * @param include_unrelayed_txes include unrelayed txes in the result
+     *
+     * @return true if added and removed are changes, false if added is the whole pool
+     */
+    bool get_transaction_changes(uint64_t since, std::vector<crypto::hash>& added, std::vector<crypto::hash>& removed, uint64_t& sequence, bool include_unrelayed_txes = true) const;
+
     /**
      * @brief get (size, fee, receive time) for all transaction in the pool
      *
@@ -466,21 +505,38 @@ namespace cryptonote
      * @brief check if any of a transaction's spent key images are present in a given set
      *
      * @param kic the set of key images to check against
-     * @param tx the transaction to check
+     * @param key_images the key images spent by the transaction
      *
      * @return true if any key images present in the set, otherwise false
      */
-    static bool have_key_images(const std::unordered_set<crypto::key_image>& kic, const transaction& tx);
+    static bool have_key_images(const std::unordered_set<crypto::key_image>& kic, const std::vector<crypto::key_image>& key_images);
 
     /**
      * @brief append the key images from a transaction to the given set
      *
      * @param kic the set of key images to append to
-     * @param tx the transaction
+     * @param key_images the key images spent by the transaction
      *
      * @return false if any append fails, otherwise true
      */
-    static bool append_key_images(std::unordered_set<crypto::key_image>& kic, const transaction& tx);
+    static bool append_key_images(std::unordered_set<crypto::key_image>& kic, const std::vector<crypto::key_image>& key_images);
+
+    /**
+     * @brief remembers what block templates need of a transaction added to the pool
+     *
+     * @param id the transaction's hash
+     * @param tx the transaction
+     * @param blob_size the transaction's size
+     * @param fee the transaction's fee
+     */
+    void add_template_tx(const crypto::hash &id, const transaction &tx, size_t blob_size, uint64_t fee);
+
+    /**
+     * @brief forgets a transaction leaving the pool
+     *
+     * @param id the transaction's hash
+     */
+    void remove_template_tx(const crypto::hash &id);
 
     /**
      * @brief check if a transaction is a valid candidate for inclusion in a block
@@ -518,6 +574,12 @@ private:
     //! container for spent key images from the transactions in the pool
     key_images_container m_spent_key_images;  
 
+    //! functions to call when a transaction is added to the pool
+    std::vector<tx_notify_t> m_tx_notifiers;
+
+    //! the most recent transactions entering and leaving the pool
+    pool_change_log m_pool_changes;
+
     //TODO: this time should be a named constant somewhere, not hard-coded
     //! interval on which to check for stale/"stuck" transactions
     epee::math_helper::once_a_time_seconds<30> m_remove_stuck_tx_interval;
@@ -535,6 +597,38 @@ private:
      */
     sorted_tx_container::iterator find_tx_in_sorted_container(const crypto::hash& id) const;
 
+    //! what fill_block_template needs of a pool transaction
+    /*! Kept so that filling a template does not have to read, parse and
+     *  check every transaction again each time it is asked for one.
+     */
+    struct template_tx
+    {
+      size_t blob_size;
+      uint64_t fee;
+      std::vector<crypto::key_image> key_images;
+      bool checked;  //!< whether readiness was checked on top of m_template_top_id
+      bool ready;    //!< whether the transaction was then ready to go
+    };
+
+    //! the pool transactions, by hash
+    std::unordered_map<crypto::hash, template_tx> m_template_txs;
+    crypto::hash m_template_top_id;  //!< the top block the readiness in m_template_txs is for
+    uint8_t m_template_version;      //!< the hard fork version it is for
+
+    //! the result of the last fill_block_template, reused until the pool or the chain changes
+    struct block_template_snapshot
+    {
+      bool valid;
+      size_t median_size;
+      uint64_t already_generated_coins;
+      uint8_t version;
+      std::vector<crypto::hash> tx_hashes;
+      size_t total_size;
+      uint64_t fee;
+      uint64_t expected_reward;
+    };
+    block_template_snapshot m_template_snapshot;
+
     //! transactions which are unlikely to be included in blocks
     /*! These transactions are kept in RAM in case they *are* included
      *  in a block eventually, but this container is not saved to disk.
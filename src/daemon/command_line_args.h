@@ -88,6 +88,24 @@ namespace daemon_args
       , std::to_string(config::testnet::ZMQ_RPC_DEFAULT_PORT)
   };
 
+  const command_line::arg_descriptor<std::string> arg_zmq_pub_bind_port = {
+    "zmq-pub-bind-port"
+      , "Port for the ZMQ block and transaction notifications, disabled if empty"
+      , ""
+  };
+
+  const command_line::arg_descriptor<bool> arg_zmq_pub_pruned = {
+    "zmq-pub-pruned"
+      , "Send pruned transactions with ZMQ block notifications"
+      , false
+  };
+
+  const command_line::arg_descriptor<unsigned> arg_zmq_rpc_threads = {
+    "zmq-rpc-threads"
+      , "Number of threads serving ZMQ RPC requests (0 for the default)"
+      , 0
+  };
+
 }  // namespace daemon_args
 
 #endif // DAEMON_COMMAND_LINE_ARGS_H
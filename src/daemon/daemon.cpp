@@ -35,6 +35,7 @@
 #include "daemon/daemon.h"
 #include "rpc/daemon_handler.h"
 #include "rpc/zmq_server.h"
+#include "rpc/zmq_pub.h"
 
 #include "common/password.h"
 #include "common/util.h"
@@ -111,6 +112,9 @@ t_daemon::t_daemon(
     zmq_rpc_bind_port = command_line::get_arg(vm, daemon_args::arg_zmq_rpc_bind_port);
   }
   zmq_rpc_bind_address = command_line::get_arg(vm, daemon_args::arg_zmq_rpc_bind_ip);
+  zmq_rpc_threads = command_line::get_arg(vm, daemon_args::arg_zmq_rpc_threads);
+  zmq_pub_bind_port = command_line::get_arg(vm, daemon_args::arg_zmq_pub_bind_port);
+  zmq_pub_pruned = command_line::get_arg(vm, daemon_args::arg_zmq_pub_pruned);
 }
 
 t_daemon::~t_daemon() = default;
@@ -161,7 +165,7 @@ bool t_daemon::run(bool interactive)
     }
 
     cryptonote::rpc::DaemonHandler rpc_daemon_handler(mp_internals->core.get(), mp_internals->p2p.get());
-    cryptonote::rpc::ZmqServer zmq_server(rpc_daemon_handler);
+    cryptonote::rpc::ZmqServer zmq_server(rpc_daemon_handler, zmq_rpc_threads);
 
     if (!zmq_server.addTCPSocket(zmq_rpc_bind_address, zmq_rpc_bind_port))
     {
@@ -183,11 +187,39 @@ bool t_daemon::run(bool interactive)
     MINFO(std::string("ZMQ server started at ") + zmq_rpc_bind_address
           + ":" + zmq_rpc_bind_port + ".");
 
+    std::unique_ptr<cryptonote::rpc::ZmqPublisher> zmq_publisher;
+    if (!zmq_pub_bind_port.empty())
+    {
+      zmq_publisher.reset(new cryptonote::rpc::ZmqPublisher(mp_internals->core.get(), zmq_pub_pruned));
+      if (!zmq_publisher->addTCPSocket(zmq_rpc_bind_address, zmq_pub_bind_port))
+      {
+        LOG_ERROR(std::string("Failed to add TCP Socket (") + zmq_rpc_bind_address
+            + ":" + zmq_pub_bind_port + ") to ZMQ publisher");
+
+        zmq_server.stop();
+
+        if (rpc_commands)
+          rpc_commands->stop_handling();
+
+        for(auto& rpc : mp_internals->rpcs)
+          rpc->stop();
+
+        return false;
+      }
+      zmq_publisher->run();
+
+      MINFO(std::string("ZMQ publisher started at ") + zmq_rpc_bind_address
+            + ":" + zmq_pub_bind_port + ".");
+    }
+
     mp_internals->p2p.run(); // blocks until p2p goes down
 
     if (rpc_commands)
       rpc_commands->stop_handling();
 
+    if (zmq_publisher)
+      zmq_publisher->stop();
+
     zmq_server.stop();
 
     for(auto& rpc : mp_internals->rpcs)
@@ -45,6 +45,9 @@ private:
   std::unique_ptr<t_internals> mp_internals;
   std::string zmq_rpc_bind_address;
   std::string zmq_rpc_bind_port;
+  unsigned zmq_rpc_threads;
+  std::string zmq_pub_bind_port;
+  bool zmq_pub_pruned;
 public:
   t_daemon(
       boost::program_options::variables_map const & vm
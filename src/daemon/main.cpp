@@ -93,6 +93,9 @@ int main(int argc, char const * argv[])
       command_line::add_arg(core_settings, daemon_args::arg_zmq_rpc_bind_ip);
       command_line::add_arg(core_settings, daemon_args::arg_zmq_rpc_bind_port);
       command_line::add_arg(core_settings, daemon_args::arg_zmq_testnet_rpc_bind_port);
+      command_line::add_arg(core_settings, daemon_args::arg_zmq_rpc_threads);
+      command_line::add_arg(core_settings, daemon_args::arg_zmq_pub_bind_port);
+      command_line::add_arg(core_settings, daemon_args::arg_zmq_pub_pruned);
 
       daemonizer::init_options(hidden_options, visible_options);
       daemonize::t_executor::init_options(core_settings);
@@ -38,6 +38,7 @@ extern "C"
 #include "crypto/crypto-ops.h"
 }
 #include "rctOps.h"
+#include "multiexp.h"
 #include "bulletproofs.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
@@ -56,7 +57,9 @@ static rct::key inner_product(const rct::keyV &a, const rct::keyV &b);
 
 static constexpr size_t maxN = 64;
 static rct::key Hi[maxN], Gi[maxN];
-static ge_dsmp Gprecomp[64], Hprecomp[64];
+static ge_p3 Hi_p3[maxN], Gi_p3[maxN];
+static std::shared_ptr<pippenger_cached_data> pippenger_HiGi_cache;
+static rct::fixedBaseTable Hi_table[maxN], Gi_table[maxN];
 static const rct::key TWO = { {0x02, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00  } };
 static const rct::keyV oneN = vector_powers(rct::identity(), maxN);
 static const rct::keyV twoN = vector_powers(TWO, maxN);
@@ -77,12 +80,40 @@ static void init_exponents()
   static bool init_done = false;
   if (init_done)
     return;
+  std::vector<MultiexpData> data;
+  data.reserve(maxN * 2 + 2);
   for (size_t i = 0; i < maxN; ++i)
   {
     Hi[i] = get_exponent(rct::H, i * 2);
-    rct::precomp(Hprecomp[i], Hi[i]);
+    CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&Hi_p3[i], Hi[i].bytes) == 0, "ge_frombytes_vartime failed");
     Gi[i] = get_exponent(rct::H, i * 2 + 1);
-    rct::precomp(Gprecomp[i], Gi[i]);
+    CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&Gi_p3[i], Gi[i].bytes) == 0, "ge_frombytes_vartime failed");
+    data.push_back({rct::zero(), Gi_p3[i]});
+    data.push_back({rct::zero(), Hi_p3[i]});
+  }
+  data.push_back(MultiexpData(rct::zero(), rct::G));
+  data.push_back(MultiexpData(rct::zero(), rct::H));
+
+  // the generators, then G and H, always come first in verification multiexps
+  pippenger_HiGi_cache = pippenger_init_cache(data);
+  init_done = true;
+}
+
+// proving multiplies each generator by a single scalar, the tables for that
+// take a few MB so they are only built by processes which make proofs
+static void init_prove_tables()
+{
+  init_exponents();
+
+  boost::lock_guard<boost::mutex> lock(init_mutex);
+
+  static bool init_done = false;
+  if (init_done)
+    return;
+  for (size_t i = 0; i < maxN; ++i)
+  {
+    rct::precompFixedBase(Hi_table[i], Hi[i]);
+    rct::precompFixedBase(Gi_table[i], Gi[i]);
   }
   init_done = true;
 }
@@ -92,14 +123,14 @@ static rct::key vector_exponent(const rct::keyV &a, const rct::keyV &b)
 {
   CHECK_AND_ASSERT_THROW_MES(a.size() == b.size(), "Incompatible sizes of a and b");
   CHECK_AND_ASSERT_THROW_MES(a.size() <= maxN, "Incompatible sizes of a and maxN");
-  rct::key res = rct::identity();
+  std::vector<MultiexpData> multiexp_data;
+  multiexp_data.reserve(a.size() * 2);
   for (size_t i = 0; i < a.size(); ++i)
   {
-    rct::key term;
-    rct::addKeys3(term, a[i], Gprecomp[i], b[i], Hprecomp[i]);
-    rct::addKeys(res, res, term);
+    multiexp_data.push_back({a[i], Gi_p3[i]});
+    multiexp_data.push_back({b[i], Hi_p3[i]});
   }
-  return res;
+  return pippenger(multiexp_data, pippenger_HiGi_cache);
 }
 
 /* Compute a custom vector-scalar commitment */
@@ -109,39 +140,14 @@ static rct::key vector_exponent_custom(const rct::keyV &A, const rct::keyV &B, c
   CHECK_AND_ASSERT_THROW_MES(a.size() == b.size(), "Incompatible sizes of a and b");
   CHECK_AND_ASSERT_THROW_MES(a.size() == A.size(), "Incompatible sizes of a and A");
   CHECK_AND_ASSERT_THROW_MES(a.size() <= maxN, "Incompatible sizes of a and maxN");
-  rct::key res = rct::identity();
+  std::vector<MultiexpData> multiexp_data;
+  multiexp_data.reserve(a.size() * 2);
   for (size_t i = 0; i < a.size(); ++i)
   {
-    rct::key term;
-#if 0
-    // we happen to know where A and B might fall, so don't bother checking the rest
-    ge_dsmp *Acache = NULL, *Bcache = NULL;
-    ge_dsmp Acache_custom[1], Bcache_custom[1];
-    if (Gi[i] == A[i])
-      Acache = Gprecomp + i;
-    else if (i<32 && Gi[i+32] == A[i])
-      Acache = Gprecomp + i + 32;
-    else
-    {
-      rct::precomp(Acache_custom[0], A[i]);
-      Acache = Acache_custom;
-    }
-    if (i == 0 && B[i] == Hi[0])
-      Bcache = Hprecomp;
-    else
-    {
-      rct::precomp(Bcache_custom[0], B[i]);
-      Bcache = Bcache_custom;
-    }
-    rct::addKeys3(term, a[i], *Acache, b[i], *Bcache);
-#else
-    ge_dsmp Acache, Bcache;
-    rct::precomp(Bcache, B[i]);
-    rct::addKeys3(term, a[i], A[i], b[i], Bcache);
-#endif
-    rct::addKeys(res, res, term);
+    multiexp_data.push_back({a[i], A[i]});
+    multiexp_data.push_back({b[i], B[i]});
   }
-  return res;
+  return multiexp(multiexp_data);
 }
 
 /* Given a scalar, construct a vector of powers */
@@ -300,7 +306,7 @@ static rct::keyV slice(const rct::keyV &a, size_t start, size_t stop)
 /* Given a value v (0..2^N-1) and a mask gamma, construct a range proof */
 Bulletproof bulletproof_PROVE(const rct::key &sv, const rct::key &gamma)
 {
-  init_exponents();
+  init_prove_tables();
 
   PERF_TIMER_UNIT(PROVE, 1000000);
 
@@ -311,7 +317,7 @@ Bulletproof bulletproof_PROVE(const rct::key &sv, const rct::key &gamma)
   rct::keyV aL(N), aR(N);
 
   PERF_TIMER_START_BP(PROVE_v);
-  rct::addKeys2(V, gamma, sv, rct::H);
+  rct::addKeys2(V, gamma, sv, rct::getHTable());
   PERF_TIMER_STOP(PROVE_v);
 
   PERF_TIMER_START_BP(PROVE_aLaR);
@@ -423,8 +429,9 @@ Bulletproof bulletproof_PROVE(const rct::key &sv, const rct::key &gamma)
   // PAPER LINES 47-48
   rct::key tau1 = rct::skGen(), tau2 = rct::skGen();
 
-  rct::key T1 = rct::addKeys(rct::scalarmultKey(rct::H, t1), rct::scalarmultBase(tau1));
-  rct::key T2 = rct::addKeys(rct::scalarmultKey(rct::H, t2), rct::scalarmultBase(tau2));
+  rct::key T1, T2;
+  rct::addKeys2(T1, tau1, t1, rct::getHTable());
+  rct::addKeys2(T2, tau2, t2, rct::getHTable());
 
   // PAPER LINES 49-51
   hashed.clear();
@@ -474,12 +481,11 @@ Bulletproof bulletproof_PROVE(const rct::key &sv, const rct::key &gamma)
   rct::keyV aprime(N);
   rct::keyV bprime(N);
   const rct::key yinv = invert(y);
-  rct::key yinvpow = rct::identity();
+  const rct::keyV yinvpow = vector_powers(yinv, N);
   for (size_t i = 0; i < N; ++i)
   {
     Gprime[i] = Gi[i];
-    Hprime[i] = scalarmultKey(Hi[i], yinvpow);
-    sc_mul(yinvpow.bytes, yinvpow.bytes, yinv.bytes);
+    Hprime[i] = rct::scalarmultKey(Hi_table[i], yinvpow[i]);
     aprime[i] = l[i];
     bprime[i] = r[i];
   }
@@ -503,10 +509,10 @@ Bulletproof bulletproof_PROVE(const rct::key &sv, const rct::key &gamma)
     // PAPER LINES 18-19
     L[round] = vector_exponent_custom(slice(Gprime, nprime, Gprime.size()), slice(Hprime, 0, nprime), slice(aprime, 0, nprime), slice(bprime, nprime, bprime.size()));
     sc_mul(tmp.bytes, cL.bytes, x_ip.bytes);
-    rct::addKeys(L[round], L[round], rct::scalarmultKey(rct::H, tmp));
+    rct::addKeys(L[round], L[round], rct::scalarmultH(tmp));
     R[round] = vector_exponent_custom(slice(Gprime, 0, nprime), slice(Hprime, nprime, Hprime.size()), slice(aprime, nprime, aprime.size()), slice(bprime, 0, nprime));
     sc_mul(tmp.bytes, cR.bytes, x_ip.bytes);
-    rct::addKeys(R[round], R[round], rct::scalarmultKey(rct::H, tmp));
+    rct::addKeys(R[round], R[round], rct::scalarmultH(tmp));
 
     // PAPER LINES 21-22
     hashed.clear();
@@ -526,8 +532,27 @@ Bulletproof bulletproof_PROVE(const rct::key &sv, const rct::key &gamma)
 
     // PAPER LINES 24-25
     const rct::key winv = invert(w[round]);
-    Gprime = hadamard2(vector_scalar2(slice(Gprime, 0, nprime), winv), vector_scalar2(slice(Gprime, nprime, Gprime.size()), w[round]));
-    Hprime = hadamard2(vector_scalar2(slice(Hprime, 0, nprime), w[round]), vector_scalar2(slice(Hprime, nprime, Hprime.size()), winv));
+    if (round == 0)
+    {
+      // Gprime and Hprime are still multiples of the generators, so the
+      // fixed base tables can be used: Hprime[i] = y^-i Hi[i]
+      rct::keyV G0(nprime), H0(nprime);
+      rct::key s0, s1;
+      for (size_t i = 0; i < nprime; ++i)
+      {
+        G0[i] = rct::addKeys(rct::scalarmultKey(Gi_table[i], winv), rct::scalarmultKey(Gi_table[nprime + i], w[0]));
+        sc_mul(s0.bytes, yinvpow[i].bytes, w[0].bytes);
+        sc_mul(s1.bytes, yinvpow[nprime + i].bytes, winv.bytes);
+        H0[i] = rct::addKeys(rct::scalarmultKey(Hi_table[i], s0), rct::scalarmultKey(Hi_table[nprime + i], s1));
+      }
+      Gprime = std::move(G0);
+      Hprime = std::move(H0);
+    }
+    else
+    {
+      Gprime = hadamard2(vector_scalar2(slice(Gprime, 0, nprime), winv), vector_scalar2(slice(Gprime, nprime, Gprime.size()), w[round]));
+      Hprime = hadamard2(vector_scalar2(slice(Hprime, 0, nprime), w[round]), vector_scalar2(slice(Hprime, nprime, Hprime.size()), winv));
+    }
 
     // PAPER LINES 28-29
     aprime = vector_add(vector_scalar(slice(aprime, 0, nprime), w[round]), vector_scalar(slice(aprime, nprime, aprime.size()), winv));
@@ -558,199 +583,219 @@ Bulletproof bulletproof_PROVE(uint64_t v, const rct::key &gamma)
   return bulletproof_PROVE(sv, gamma);
 }
 
-/* Given a range proof, determine if it is valid */
-bool bulletproof_VERIFY(const Bulletproof &proof)
+/* Given a set of range proofs, determine if they are all valid */
+bool bulletproof_VERIFY(const std::vector<const Bulletproof*> &proofs)
 {
   init_exponents();
 
-  CHECK_AND_ASSERT_MES(proof.L.size() == proof.R.size(), false, "Mismatched L and R sizes");
-  CHECK_AND_ASSERT_MES(proof.L.size() > 0, false, "Empty proof");
-  CHECK_AND_ASSERT_MES(proof.L.size() == 6, false, "Proof is not for 64 bits");
-
-  const size_t logN = proof.L.size();
-  const size_t N = 1 << logN;
-
-  // Reconstruct the challenges
-  PERF_TIMER_START_BP(VERIFY);
-  PERF_TIMER_START_BP(VERIFY_start);
-  rct::keyV hashed;
-  hashed.push_back(proof.A);
-  hashed.push_back(proof.S);
-  rct::key y = rct::hash_to_scalar(hashed);
-  rct::key z = rct::hash_to_scalar(y);
-  hashed.clear();
-  hashed.push_back(z);
-  hashed.push_back(proof.T1);
-  hashed.push_back(proof.T2);
-  rct::key x = rct::hash_to_scalar(hashed);
-  PERF_TIMER_STOP(VERIFY_start);
-
-  PERF_TIMER_START_BP(VERIFY_line_60);
-  // Reconstruct the challenges
-  hashed.clear();
-  hashed.push_back(x);
-  hashed.push_back(proof.taux);
-  hashed.push_back(proof.mu);
-  hashed.push_back(proof.t);
-  rct::key x_ip = hash_to_scalar(hashed);
-  PERF_TIMER_STOP(VERIFY_line_60);
-
-  PERF_TIMER_START_BP(VERIFY_line_61);
-  // PAPER LINE 61
-  rct::key L61Left = rct::addKeys(rct::scalarmultBase(proof.taux), rct::scalarmultKey(rct::H, proof.t));
-
-  rct::key k = rct::zero();
-  const auto yN = vector_powers(y, N);
-  rct::key ip1y = inner_product(oneN, yN);
-  rct::key zsq;
-  sc_mul(zsq.bytes, z.bytes, z.bytes);
-  rct::key tmp, tmp2;
-  sc_mulsub(k.bytes, zsq.bytes, ip1y.bytes, k.bytes);
-  rct::key zcu;
-  sc_mul(zcu.bytes, zsq.bytes, z.bytes);
-  sc_mulsub(k.bytes, zcu.bytes, ip12.bytes, k.bytes);
-  PERF_TIMER_STOP(VERIFY_line_61);
-
-  PERF_TIMER_START_BP(VERIFY_line_61rl);
-  sc_muladd(tmp.bytes, z.bytes, ip1y.bytes, k.bytes);
-  rct::key L61Right = rct::scalarmultKey(rct::H, tmp);
-
-  CHECK_AND_ASSERT_MES(proof.V.size() == 1, false, "proof.V does not have exactly one element");
-  tmp = rct::scalarmultKey(proof.V[0], zsq);
-  rct::addKeys(L61Right, L61Right, tmp);
-
-  tmp = rct::scalarmultKey(proof.T1, x);
-  rct::addKeys(L61Right, L61Right, tmp);
-
-  rct::key xsq;
-  sc_mul(xsq.bytes, x.bytes, x.bytes);
-  tmp = rct::scalarmultKey(proof.T2, xsq);
-  rct::addKeys(L61Right, L61Right, tmp);
-  PERF_TIMER_STOP(VERIFY_line_61rl);
-
-  if (!(L61Right == L61Left))
+  for (const Bulletproof *p: proofs)
   {
-    MERROR("Verification failure at step 1");
-    return false;
+    const Bulletproof &proof = *p;
+    CHECK_AND_ASSERT_MES(proof.L.size() == proof.R.size(), false, "Mismatched L and R sizes");
+    CHECK_AND_ASSERT_MES(proof.L.size() > 0, false, "Empty proof");
+    CHECK_AND_ASSERT_MES(proof.L.size() == 6, false, "Proof is not for 64 bits");
+    CHECK_AND_ASSERT_MES(proof.V.size() == 1, false, "proof.V does not have exactly one element");
   }
 
-  PERF_TIMER_START_BP(VERIFY_line_62);
-  // PAPER LINE 62
-  rct::key P = rct::addKeys(proof.A, rct::scalarmultKey(proof.S, x));
-  PERF_TIMER_STOP(VERIFY_line_62);
+  const size_t logN = 6;
+  const size_t N = 1 << logN;
 
-  // Compute the number of rounds for the inner product
-  const size_t rounds = proof.L.size();
-  CHECK_AND_ASSERT_MES(rounds > 0, false, "Zero rounds");
+  // The two checks of each proof are weighted by random scalars and summed
+  // over all proofs, so the per generator terms are only computed once for
+  // the whole batch, and a single comparison against the identity remains
+  PERF_TIMER_START_BP(VERIFY);
+  rct::key G_scalar = rct::zero(), H_scalar = rct::zero();
+  rct::keyV Gi_scalars(N, rct::zero()), Hi_scalars(N, rct::zero());
+  std::vector<MultiexpData> terms;
+  terms.reserve(proofs.size() * (5 + 2 * logN));
 
-  PERF_TIMER_START_BP(VERIFY_line_21_22);
-  // PAPER LINES 21-22
-  // The inner product challenges are computed per round
-  rct::keyV w(rounds);
-  hashed.clear();
-  hashed.push_back(proof.L[0]);
-  hashed.push_back(proof.R[0]);
-  w[0] = rct::hash_to_scalar(hashed);
-  for (size_t i = 1; i < rounds; ++i)
+  for (const Bulletproof *p: proofs)
   {
+    const Bulletproof &proof = *p;
+
+    // Reconstruct the challenges
+    PERF_TIMER_START_BP(VERIFY_start);
+    rct::keyV hashed;
+    hashed.push_back(proof.A);
+    hashed.push_back(proof.S);
+    rct::key y = rct::hash_to_scalar(hashed);
+    rct::key z = rct::hash_to_scalar(y);
     hashed.clear();
-    hashed.push_back(w[i-1]);
-    hashed.push_back(proof.L[i]);
-    hashed.push_back(proof.R[i]);
-    w[i] = rct::hash_to_scalar(hashed);
-  }
-  PERF_TIMER_STOP(VERIFY_line_21_22);
-
-  PERF_TIMER_START_BP(VERIFY_line_24_25);
-  // Basically PAPER LINES 24-25
-  // Compute the curvepoints from G[i] and H[i]
-  rct::key inner_prod = rct::identity();
-  rct::key yinvpow = rct::identity();
-  rct::key ypow = rct::identity();
-
-  PERF_TIMER_START_BP(VERIFY_line_24_25_invert);
-  const rct::key yinv = invert(y);
-  rct::keyV winv(rounds);
-  for (size_t i = 0; i < rounds; ++i)
-    winv[i] = invert(w[i]);
-  PERF_TIMER_STOP(VERIFY_line_24_25_invert);
-
-  for (size_t i = 0; i < N; ++i)
-  {
-    // Convert the index to binary IN REVERSE and construct the scalar exponent
-    rct::key g_scalar = proof.a;
-    rct::key h_scalar;
-    sc_mul(h_scalar.bytes, proof.b.bytes, yinvpow.bytes);
-
-    for (size_t j = rounds; j-- > 0; )
+    hashed.push_back(z);
+    hashed.push_back(proof.T1);
+    hashed.push_back(proof.T2);
+    rct::key x = rct::hash_to_scalar(hashed);
+    PERF_TIMER_STOP(VERIFY_start);
+
+    PERF_TIMER_START_BP(VERIFY_line_60);
+    // Reconstruct the challenges
+    hashed.clear();
+    hashed.push_back(x);
+    hashed.push_back(proof.taux);
+    hashed.push_back(proof.mu);
+    hashed.push_back(proof.t);
+    rct::key x_ip = hash_to_scalar(hashed);
+    PERF_TIMER_STOP(VERIFY_line_60);
+
+    // so proofs in a batch cannot cancel each other out
+    const rct::key weight_y = rct::skGen();
+    const rct::key weight_z = rct::skGen();
+
+    PERF_TIMER_START_BP(VERIFY_line_61);
+    // PAPER LINE 61
+    // taux G + (t - k - z <1,y^N>) H - z^2 V - x T1 - x^2 T2 == 0
+    rct::key k = rct::zero();
+    const auto yN = vector_powers(y, N);
+    rct::key ip1y = inner_product(oneN, yN);
+    rct::key zsq;
+    sc_mul(zsq.bytes, z.bytes, z.bytes);
+    rct::key tmp;
+    sc_mulsub(k.bytes, zsq.bytes, ip1y.bytes, k.bytes);
+    rct::key zcu;
+    sc_mul(zcu.bytes, zsq.bytes, z.bytes);
+    sc_mulsub(k.bytes, zcu.bytes, ip12.bytes, k.bytes);
+    sc_muladd(tmp.bytes, z.bytes, ip1y.bytes, k.bytes);
+
+    sc_muladd(G_scalar.bytes, proof.taux.bytes, weight_y.bytes, G_scalar.bytes);
+    sc_sub(tmp.bytes, proof.t.bytes, tmp.bytes);
+    sc_muladd(H_scalar.bytes, tmp.bytes, weight_y.bytes, H_scalar.bytes);
+
+    sc_mul(tmp.bytes, zsq.bytes, weight_y.bytes);
+    sc_sub(tmp.bytes, rct::zero().bytes, tmp.bytes);
+    terms.push_back(MultiexpData(tmp, proof.V[0]));
+
+    sc_mul(tmp.bytes, x.bytes, weight_y.bytes);
+    sc_sub(tmp.bytes, rct::zero().bytes, tmp.bytes);
+    terms.push_back(MultiexpData(tmp, proof.T1));
+
+    rct::key xsq;
+    sc_mul(xsq.bytes, x.bytes, x.bytes);
+    sc_mul(tmp.bytes, xsq.bytes, weight_y.bytes);
+    sc_sub(tmp.bytes, rct::zero().bytes, tmp.bytes);
+    terms.push_back(MultiexpData(tmp, proof.T2));
+    PERF_TIMER_STOP(VERIFY_line_61);
+
+    PERF_TIMER_START_BP(VERIFY_line_62);
+    // PAPER LINE 62
+    terms.push_back(MultiexpData(weight_z, proof.A));
+    sc_mul(tmp.bytes, x.bytes, weight_z.bytes);
+    terms.push_back(MultiexpData(tmp, proof.S));
+    PERF_TIMER_STOP(VERIFY_line_62);
+
+    // Compute the number of rounds for the inner product
+    const size_t rounds = proof.L.size();
+    CHECK_AND_ASSERT_MES(rounds > 0, false, "Zero rounds");
+
+    PERF_TIMER_START_BP(VERIFY_line_21_22);
+    // PAPER LINES 21-22
+    // The inner product challenges are computed per round
+    rct::keyV w(rounds);
+    hashed.clear();
+    hashed.push_back(proof.L[0]);
+    hashed.push_back(proof.R[0]);
+    w[0] = rct::hash_to_scalar(hashed);
+    for (size_t i = 1; i < rounds; ++i)
     {
-      size_t J = w.size() - j - 1;
+      hashed.clear();
+      hashed.push_back(w[i-1]);
+      hashed.push_back(proof.L[i]);
+      hashed.push_back(proof.R[i]);
+      w[i] = rct::hash_to_scalar(hashed);
+    }
+    PERF_TIMER_STOP(VERIFY_line_21_22);
+
+    PERF_TIMER_START_BP(VERIFY_line_24_25);
+    // Basically PAPER LINES 24-25
+    // Compute the scalars for G[i] and H[i]
+    rct::key yinvpow = rct::identity();
+    rct::key ypow = rct::identity();
+
+    PERF_TIMER_START_BP(VERIFY_line_24_25_invert);
+    const rct::key yinv = invert(y);
+    rct::keyV winv(rounds);
+    for (size_t i = 0; i < rounds; ++i)
+      winv[i] = invert(w[i]);
+    PERF_TIMER_STOP(VERIFY_line_24_25_invert);
+
+    for (size_t i = 0; i < N; ++i)
+    {
+      // Convert the index to binary IN REVERSE and construct the scalar exponent
+      rct::key g_scalar = proof.a;
+      rct::key h_scalar;
+      sc_mul(h_scalar.bytes, proof.b.bytes, yinvpow.bytes);
 
-      if ((i & (((size_t)1)<<j)) == 0)
+      for (size_t j = rounds; j-- > 0; )
       {
-        sc_mul(g_scalar.bytes, g_scalar.bytes, winv[J].bytes);
-        sc_mul(h_scalar.bytes, h_scalar.bytes, w[J].bytes);
+        size_t J = w.size() - j - 1;
+
+        if ((i & (((size_t)1)<<j)) == 0)
+        {
+          sc_mul(g_scalar.bytes, g_scalar.bytes, winv[J].bytes);
+          sc_mul(h_scalar.bytes, h_scalar.bytes, w[J].bytes);
+        }
+        else
+        {
+          sc_mul(g_scalar.bytes, g_scalar.bytes, w[J].bytes);
+          sc_mul(h_scalar.bytes, h_scalar.bytes, winv[J].bytes);
+        }
       }
-      else
+
+      // Adjust the scalars using the exponents from PAPER LINE 62
+      sc_add(g_scalar.bytes, g_scalar.bytes, z.bytes);
+      sc_mul(tmp.bytes, zsq.bytes, twoN[i].bytes);
+      sc_muladd(tmp.bytes, z.bytes, ypow.bytes, tmp.bytes);
+      sc_mulsub(h_scalar.bytes, tmp.bytes, yinvpow.bytes, h_scalar.bytes);
+
+      // These are subtracted, since they are on the other side of the equation
+      sc_mulsub(Gi_scalars[i].bytes, g_scalar.bytes, weight_z.bytes, Gi_scalars[i].bytes);
+      sc_mulsub(Hi_scalars[i].bytes, h_scalar.bytes, weight_z.bytes, Hi_scalars[i].bytes);
+
+      if (i != N-1)
       {
-        sc_mul(g_scalar.bytes, g_scalar.bytes, w[J].bytes);
-        sc_mul(h_scalar.bytes, h_scalar.bytes, winv[J].bytes);
+        sc_mul(yinvpow.bytes, yinvpow.bytes, yinv.bytes);
+        sc_mul(ypow.bytes, ypow.bytes, y.bytes);
       }
     }
+    PERF_TIMER_STOP(VERIFY_line_24_25);
 
-    // Adjust the scalars using the exponents from PAPER LINE 62
-    sc_add(g_scalar.bytes, g_scalar.bytes, z.bytes);
-    sc_mul(tmp.bytes, zsq.bytes, twoN[i].bytes);
-    sc_muladd(tmp.bytes, z.bytes, ypow.bytes, tmp.bytes);
-    sc_mulsub(h_scalar.bytes, tmp.bytes, yinvpow.bytes, h_scalar.bytes);
-
-    // Now compute the basepoint's scalar multiplication
-    // Each of these could be written as a multiexp operation instead
-    rct::addKeys3(tmp, g_scalar, Gprecomp[i], h_scalar, Hprecomp[i]);
-    rct::addKeys(inner_prod, inner_prod, tmp);
-
-    if (i != N-1)
+    PERF_TIMER_START_BP(VERIFY_line_26);
+    // PAPER LINE 26
+    sc_mulsub(G_scalar.bytes, proof.mu.bytes, weight_z.bytes, G_scalar.bytes);
+    for (size_t i = 0; i < rounds; ++i)
     {
-      sc_mul(yinvpow.bytes, yinvpow.bytes, yinv.bytes);
-      sc_mul(ypow.bytes, ypow.bytes, y.bytes);
+      sc_mul(tmp.bytes, w[i].bytes, w[i].bytes);
+      sc_mul(tmp.bytes, tmp.bytes, weight_z.bytes);
+      terms.push_back(MultiexpData(tmp, proof.L[i]));
+      sc_mul(tmp.bytes, winv[i].bytes, winv[i].bytes);
+      sc_mul(tmp.bytes, tmp.bytes, weight_z.bytes);
+      terms.push_back(MultiexpData(tmp, proof.R[i]));
     }
-  }
-  PERF_TIMER_STOP(VERIFY_line_24_25);
-
-  PERF_TIMER_START_BP(VERIFY_line_26);
-  // PAPER LINE 26
-  rct::key pprime;
-  sc_sub(tmp.bytes, rct::zero().bytes, proof.mu.bytes);
-  rct::addKeys(pprime, P, rct::scalarmultBase(tmp));
 
-  for (size_t i = 0; i < rounds; ++i)
-  {
-    sc_mul(tmp.bytes, w[i].bytes, w[i].bytes);
-    sc_mul(tmp2.bytes, winv[i].bytes, winv[i].bytes);
-#if 1
-    ge_dsmp cacheL, cacheR;
-    rct::precomp(cacheL, proof.L[i]);
-    rct::precomp(cacheR, proof.R[i]);
-    rct::addKeys3(tmp, tmp, cacheL, tmp2, cacheR);
-    rct::addKeys(pprime, pprime, tmp);
-#else
-    rct::addKeys(pprime, pprime, rct::scalarmultKey(proof.L[i], tmp));
-    rct::addKeys(pprime, pprime, rct::scalarmultKey(proof.R[i], tmp2));
-#endif
+    // (t - ab) x_ip H
+    sc_mul(tmp.bytes, proof.a.bytes, proof.b.bytes);
+    sc_sub(tmp.bytes, proof.t.bytes, tmp.bytes);
+    sc_mul(tmp.bytes, tmp.bytes, x_ip.bytes);
+    sc_muladd(H_scalar.bytes, tmp.bytes, weight_z.bytes, H_scalar.bytes);
+    PERF_TIMER_STOP(VERIFY_line_26);
   }
-  sc_mul(tmp.bytes, proof.t.bytes, x_ip.bytes);
-  rct::addKeys(pprime, pprime, rct::scalarmultKey(rct::H, tmp));
-  PERF_TIMER_STOP(VERIFY_line_26);
 
   PERF_TIMER_START_BP(VERIFY_step2_check);
-  sc_mul(tmp.bytes, proof.a.bytes, proof.b.bytes);
-  sc_mul(tmp.bytes, tmp.bytes, x_ip.bytes);
-  tmp = rct::scalarmultKey(rct::H, tmp);
-  rct::addKeys(tmp, tmp, inner_prod);
+  std::vector<MultiexpData> data;
+  data.reserve(2 * N + 2 + terms.size());
+  for (size_t i = 0; i < N; ++i)
+  {
+    data.push_back({Gi_scalars[i], Gi_p3[i]});
+    data.push_back({Hi_scalars[i], Hi_p3[i]});
+  }
+  data.push_back({G_scalar, rct::G});
+  data.push_back({H_scalar, rct::H});
+  data.insert(data.end(), terms.begin(), terms.end());
+  // even a single proof has enough terms for Pippenger to beat Straus
+  const rct::key check = pippenger(data, pippenger_HiGi_cache);
   PERF_TIMER_STOP(VERIFY_step2_check);
-  if (!(pprime == tmp))
+  if (!(check == rct::identity()))
   {
-    MERROR("Verification failure at step 2");
+    MERROR("Verification failure");
     return false;
   }
 
@@ -758,4 +803,12 @@ bool bulletproof_VERIFY(const Bulletproof &proof)
   return true;
 }
 
+/* Given a range proof, determine if it is valid */
+bool bulletproof_VERIFY(const Bulletproof &proof)
+{
+  std::vector<const Bulletproof*> proofs;
+  proofs.push_back(&proof);
+  return bulletproof_VERIFY(proofs);
+}
+
 }
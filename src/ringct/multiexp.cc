@@ -0,0 +1,308 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "misc_log_ex.h"
+#include "common/perf_timer.h"
+extern "C"
+{
+#include "crypto/crypto-ops.h"
+}
+#include "rctOps.h"
+#include "multiexp.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "multiexp"
+
+// Straus interleaves the scalars in windows of STRAUS_C bits, with a table
+// of the 2^STRAUS_C - 1 first multiples of each point. Pippenger sorts the
+// points in 2^c - 1 buckets for each window instead, which costs a couple
+// additions per point per window, but needs no per point tables, so it
+// wins once there are enough points for the buckets to amortize, which
+// is around 80 points in the multiexp performance tests.
+#define STRAUS_C 4
+#define STRAUS_SIZE_LIMIT 80
+
+namespace rct
+{
+
+struct straus_cached_data
+{
+  size_t size;
+  std::vector<std::vector<ge_cached>> multiples;
+};
+
+struct pippenger_cached_data
+{
+  size_t size;
+  std::vector<ge_cached> cached;
+};
+
+static ge_p3 make_identity()
+{
+  ge_p3 identity;
+  CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&identity, rct::identity().bytes) == 0, "ge_frombytes_vartime failed");
+  return identity;
+}
+
+static const ge_p3 &get_identity()
+{
+  static const ge_p3 identity = make_identity();
+  return identity;
+}
+
+static inline void add(ge_p3 &p, const ge_cached &q)
+{
+  ge_p1p1 p1;
+  ge_add(&p1, &p, &q);
+  ge_p1p1_to_p3(&p, &p1);
+}
+
+static inline void add(ge_p3 &p, const ge_p3 &q)
+{
+  ge_cached cached;
+  ge_p3_to_cached(&cached, &q);
+  add(p, cached);
+}
+
+// p = 2^n p
+static inline void double_n(ge_p3 &p, size_t n)
+{
+  if (n == 0)
+    return;
+  ge_p2 p2;
+  ge_p1p1 p1;
+  ge_p3_to_p2(&p2, &p);
+  for (size_t i = 0; i < n; ++i)
+  {
+    ge_p2_dbl(&p1, &p2);
+    if (i + 1 < n)
+      ge_p1p1_to_p2(&p2, &p1);
+  }
+  ge_p1p1_to_p3(&p, &p1);
+}
+
+// the c bits of a scalar starting at bit start, c <= 16
+static inline size_t get_bits(const rct::key &s, size_t start, size_t c)
+{
+  const size_t byte = start >> 3;
+  uint32_t v = s.bytes[byte];
+  if (byte + 1 < 32)
+    v |= ((uint32_t)s.bytes[byte + 1]) << 8;
+  if (byte + 2 < 32)
+    v |= ((uint32_t)s.bytes[byte + 2]) << 16;
+  return (v >> (start & 7)) & ((1u << c) - 1);
+}
+
+static rct::key to_key(const ge_p3 &p)
+{
+  rct::key res;
+  ge_p3_tobytes(res.bytes, &p);
+  return res;
+}
+
+// the multiples 1..2^STRAUS_C-1 of a point
+static void straus_multiples(std::vector<ge_cached> &multiples, const ge_p3 &point)
+{
+  multiples.resize(1 << STRAUS_C);
+  ge_p3 p = point;
+  ge_p3_to_cached(&multiples[1], &p);
+  for (size_t i = 2; i < multiples.size(); ++i)
+  {
+    add(p, multiples[1]);
+    ge_p3_to_cached(&multiples[i], &p);
+  }
+}
+
+std::shared_ptr<straus_cached_data> straus_init_cache(const std::vector<MultiexpData> &data, size_t N)
+{
+  if (N == 0)
+    N = data.size();
+  CHECK_AND_ASSERT_THROW_MES(N <= data.size(), "Bad cache base data");
+  std::shared_ptr<straus_cached_data> cache(new straus_cached_data());
+  cache->size = N;
+  cache->multiples.resize(N);
+  for (size_t i = 0; i < N; ++i)
+    straus_multiples(cache->multiples[i], data[i].point);
+  return cache;
+}
+
+size_t straus_get_cache_size(const std::shared_ptr<straus_cached_data> &cache)
+{
+  size_t sz = 0;
+  for (const auto &m: cache->multiples)
+    sz += m.size() * sizeof(ge_cached);
+  return sz;
+}
+
+rct::key straus(const std::vector<MultiexpData> &data, const std::shared_ptr<straus_cached_data> &cache)
+{
+  const size_t cached = cache ? std::min(cache->size, data.size()) : 0;
+
+  std::vector<std::vector<ge_cached>> local_multiples(data.size() - cached);
+  for (size_t i = cached; i < data.size(); ++i)
+    straus_multiples(local_multiples[i - cached], data[i].point);
+
+  ge_p3 res = get_identity();
+  bool res_init = false;
+  for (size_t start = 256; start > 0; )
+  {
+    start -= STRAUS_C;
+    if (res_init)
+      double_n(res, STRAUS_C);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+      const size_t digit = get_bits(data[i].scalar, start, STRAUS_C);
+      if (digit == 0)
+        continue;
+      const ge_cached &multiple = i < cached ? cache->multiples[i][digit] : local_multiples[i - cached][digit];
+      add(res, multiple);
+      res_init = true;
+    }
+  }
+  return to_key(res);
+}
+
+size_t get_pippenger_c(size_t N)
+{
+  if (N <= 13) return 2;
+  if (N <= 29) return 3;
+  if (N <= 83) return 4;
+  if (N <= 185) return 5;
+  if (N <= 465) return 6;
+  if (N <= 1180) return 7;
+  if (N <= 2295) return 8;
+  return 9;
+}
+
+std::shared_ptr<pippenger_cached_data> pippenger_init_cache(const std::vector<MultiexpData> &data, size_t N)
+{
+  if (N == 0)
+    N = data.size();
+  CHECK_AND_ASSERT_THROW_MES(N <= data.size(), "Bad cache base data");
+  std::shared_ptr<pippenger_cached_data> cache(new pippenger_cached_data());
+  cache->size = N;
+  cache->cached.resize(N);
+  for (size_t i = 0; i < N; ++i)
+    ge_p3_to_cached(&cache->cached[i], &data[i].point);
+  return cache;
+}
+
+size_t pippenger_get_cache_size(const std::shared_ptr<pippenger_cached_data> &cache)
+{
+  return cache->cached.size() * sizeof(ge_cached);
+}
+
+rct::key pippenger(const std::vector<MultiexpData> &data, const std::shared_ptr<pippenger_cached_data> &cache, size_t c)
+{
+  if (c == 0)
+    c = get_pippenger_c(data.size());
+  CHECK_AND_ASSERT_THROW_MES(c >= 1 && c <= 16, "c must be between 1 and 16");
+
+  const size_t cached = cache ? std::min(cache->size, data.size()) : 0;
+  std::vector<ge_cached> local_cached(data.size() - cached);
+  for (size_t i = cached; i < data.size(); ++i)
+    ge_p3_to_cached(&local_cached[i - cached], &data[i].point);
+
+  // skip the windows above the highest bit set in any scalar
+  size_t top_byte = 0;
+  for (const MultiexpData &d: data)
+    for (size_t b = 32; b > top_byte; --b)
+      if (d.scalar.bytes[b - 1])
+      {
+        top_byte = b;
+        break;
+      }
+  const size_t groups = (top_byte * 8 + c - 1) / c;
+
+  std::vector<ge_p3> buckets(1 << c);
+  std::vector<uint8_t> bucket_used(1 << c);
+  ge_p3 res = get_identity();
+  bool res_init = false;
+  for (size_t k = groups; k-- > 0; )
+  {
+    if (res_init)
+      double_n(res, c);
+
+    std::fill(bucket_used.begin(), bucket_used.end(), 0);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+      const size_t bucket = get_bits(data[i].scalar, k * c, c);
+      if (bucket == 0)
+        continue;
+      if (bucket_used[bucket])
+        add(buckets[bucket], i < cached ? cache->cached[i] : local_cached[i - cached]);
+      else
+      {
+        buckets[bucket] = data[i].point;
+        bucket_used[bucket] = 1;
+      }
+    }
+
+    // sum of bucket * index, as a running sum from the top bucket down
+    ge_p3 sum, total;
+    bool sum_init = false, total_init = false;
+    for (size_t b = buckets.size() - 1; b > 0; --b)
+    {
+      if (bucket_used[b])
+      {
+        if (sum_init)
+          add(sum, buckets[b]);
+        else
+          sum = buckets[b];
+        sum_init = true;
+      }
+      if (sum_init)
+      {
+        if (total_init)
+          add(total, sum);
+        else
+          total = sum;
+        total_init = true;
+      }
+    }
+
+    if (total_init)
+    {
+      if (res_init)
+        add(res, total);
+      else
+        res = total;
+      res_init = true;
+    }
+  }
+  return to_key(res);
+}
+
+rct::key multiexp(const std::vector<MultiexpData> &data)
+{
+  if (data.size() <= STRAUS_SIZE_LIMIT)
+    return straus(data);
+  return pippenger(data);
+}
+
+}
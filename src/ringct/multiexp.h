@@ -0,0 +1,95 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#ifndef MULTIEXP_H
+#define MULTIEXP_H
+
+#include <memory>
+#include <vector>
+extern "C"
+{
+#include "crypto/crypto-ops.h"
+}
+#include "rctTypes.h"
+#include "misc_log_ex.h"
+
+namespace rct
+{
+
+/**
+ * @brief a scalar and the point it multiplies, in a multi-exponentiation
+ */
+struct MultiexpData {
+  rct::key scalar;
+  ge_p3 point;
+
+  MultiexpData() {}
+  MultiexpData(const rct::key &s, const ge_p3 &p): scalar(s), point(p) {}
+  MultiexpData(const rct::key &s, const rct::key &p): scalar(s)
+  {
+    CHECK_AND_ASSERT_THROW_MES(ge_frombytes_vartime(&point, p.bytes) == 0, "ge_frombytes_vartime failed");
+  }
+};
+
+struct straus_cached_data;
+struct pippenger_cached_data;
+
+/**
+ * @brief computes the sum of scalar * point over all entries
+ *
+ * Picks Straus or Pippenger depending on the number of entries.
+ */
+rct::key multiexp(const std::vector<MultiexpData> &data);
+
+/**
+ * @brief computes the sum of scalar * point over all entries, with Straus' method
+ *
+ * If a cache is given, it must have been built from the points at the
+ * start of data, which then use the cached tables instead of building them.
+ */
+rct::key straus(const std::vector<MultiexpData> &data, const std::shared_ptr<straus_cached_data> &cache = NULL);
+std::shared_ptr<straus_cached_data> straus_init_cache(const std::vector<MultiexpData> &data, size_t N = 0);
+size_t straus_get_cache_size(const std::shared_ptr<straus_cached_data> &cache);
+
+/**
+ * @brief computes the sum of scalar * point over all entries, with Pippenger's bucket method
+ *
+ * If a cache is given, it must have been built from the points at the
+ * start of data. c is the window size in bits, 0 to pick one from the
+ * number of entries.
+ */
+rct::key pippenger(const std::vector<MultiexpData> &data, const std::shared_ptr<pippenger_cached_data> &cache = NULL, size_t c = 0);
+std::shared_ptr<pippenger_cached_data> pippenger_init_cache(const std::vector<MultiexpData> &data, size_t N = 0);
+size_t pippenger_get_cache_size(const std::shared_ptr<pippenger_cached_data> &cache);
+size_t get_pippenger_c(size_t N);
+
+}
+
+#endif
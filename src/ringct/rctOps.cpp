@@ -108,8 +108,7 @@ namespace rct {
 
     //generates C =aG + bH from b, a is given..
     void genC(key & C, const key & a, xmr_amount amount) {
-        key bH = scalarmultH(d2h(amount));
-        addKeys1(C, a, bH);
+        addKeys2(C, a, d2h(amount), getHTable());
     }
 
     //generates a <secret , public> / Pedersen commitment to the amount
@@ -134,19 +133,14 @@ namespace rct {
     }
     
     key zeroCommit(xmr_amount amount) {
-        key mask = identity();
-        mask = scalarmultBase(mask);
-        key am = d2h(amount);
-        key bH = scalarmultH(am);
-        addKeys(mask, mask, bH);
-        return mask;
+        key c;
+        addKeys2(c, identity(), d2h(amount), getHTable());
+        return c;
     }
 
     key commit(xmr_amount amount, const key &mask) {
-        key c = scalarmultBase(mask);
-        key am = d2h(amount);
-        key bH = scalarmultH(am);
-        addKeys(c, c, bH);
+        key c;
+        addKeys2(c, mask, d2h(amount), getHTable());
         return c;
     }
 
@@ -198,12 +192,39 @@ namespace rct {
 
     //Computes aH where H= toPoint(cn_fast_hash(G)), G the basepoint
     key scalarmultH(const key & a) {
+        return scalarmultKey(getHTable(), a);
+    }
+
+    //Fills a fixedBaseTable for the point P
+    void precompFixedBase(fixedBaseTable &rv, const key &P) {
         ge_p3 A;
-        ge_p2 R;
-        CHECK_AND_ASSERT_THROW_MES_L1(ge_frombytes_vartime(&A, H.bytes) == 0, "ge_frombytes_vartime failed at "+boost::lexical_cast<std::string>(__LINE__));
-        ge_scalarmult(&R, a.bytes, &A);
+        CHECK_AND_ASSERT_THROW_MES_L1(ge_frombytes_vartime(&A, P.bytes) == 0, "ge_frombytes_vartime failed at "+boost::lexical_cast<std::string>(__LINE__));
+        ge_precomp_fixed(rv.table, &A);
+    }
+
+    namespace {
+        struct HTable: public fixedBaseTable {
+            HTable() { precompFixedBase(*this, H); }
+        };
+    }
+
+    //the fixedBaseTable for H, built on first use
+    const fixedBaseTable &getHTable() {
+        static const HTable table;
+        return table;
+    }
+
+    //does a * P where a is a scalar and P is given by its fixedBaseTable
+    void scalarmultKey(key &aP, const fixedBaseTable &P, const key &a) {
+        ge_p3 R;
+        ge_scalarmult_fixed(&R, a.bytes, P.table);
+        ge_p3_tobytes(aP.bytes, &R);
+    }
+
+    //does a * P where a is a scalar and P is given by its fixedBaseTable
+    key scalarmultKey(const fixedBaseTable &P, const key &a) {
         key aP;
-        ge_tobytes(aP.bytes, &R);
+        scalarmultKey(aP, P, a);
         return aP;
     }
 
@@ -245,6 +266,21 @@ namespace rct {
         ge_tobytes(aGbB.bytes, &rv);
     }
 
+    //aGbB = aG + bB where a, b are scalars, G is the basepoint and B is given by its fixedBaseTable
+    void addKeys2(key &aGbB, const key &a, const key &b, const fixedBaseTable &B) {
+        ge_p3 aG, bB;
+        ge_cached tmp2;
+        ge_p1p1 tmp3;
+        key a2;
+        sc_reduce32copy(a2.bytes, a.bytes); //as scalarmultBase does
+        ge_scalarmult_base(&aG, a2.bytes);
+        ge_scalarmult_fixed(&bB, b.bytes, B.table);
+        ge_p3_to_cached(&tmp2, &bB);
+        ge_add(&tmp3, &aG, &tmp2);
+        ge_p1p1_to_p3(&aG, &tmp3);
+        ge_p3_tobytes(aGbB.bytes, &aG);
+    }
+
     //Does some precomputation to make addKeys3 more efficient
     // input B a curve point and output a ge_dsmp which has precomputation applied
     void precomp(ge_dsmp rv, const key & B) {
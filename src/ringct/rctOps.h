@@ -62,6 +62,7 @@ namespace rct {
     static const key Z = { {0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00  } };
     static const key I = { {0x01, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00 , 0x00, 0x00, 0x00,0x00  } };
     static const key L = { {0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58, 0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10 } };
+    static const key G = { {0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66 } };
 
     //Creates a zero scalar
     inline key zero() { return Z; }
@@ -119,6 +120,19 @@ namespace rct {
     //Computes aH where H= toPoint(cn_fast_hash(G)), G the basepoint
     key scalarmultH(const key & a);
 
+    //Multiples of a point which gets multiplied by many scalars, laid out like
+    // ge_base so a multiplication costs about as much as one by G
+    struct alignas(64) fixedBaseTable {
+        ge_precomp table[32][8];
+    };
+    //Fills a fixedBaseTable for the point P (this costs about 250 additions)
+    void precompFixedBase(fixedBaseTable &rv, const key &P);
+    //the fixedBaseTable for H, built on first use and shared by all threads
+    const fixedBaseTable &getHTable();
+    //does a * P where a is a scalar and P is given by its fixedBaseTable
+    void scalarmultKey(key &aP, const fixedBaseTable &P, const key &a);
+    key scalarmultKey(const fixedBaseTable &P, const key &a);
+
     //Curve addition / subtractions
 
     //for curve points: AB = A + B
@@ -128,6 +142,8 @@ namespace rct {
     void addKeys1(key &aGB, const key &a, const key & B);
     //aGbB = aG + bB where a, b are scalars, G is the basepoint and B is a point
     void addKeys2(key &aGbB, const key &a, const key &b, const key &B);
+    //same, with B given by its fixedBaseTable, eg getHTable() for commitments
+    void addKeys2(key &aGbB, const key &a, const key &b, const fixedBaseTable &B);
     //Does some precomputation to make addKeys3 more efficient
     // input B a curve point and output a ge_dsmp which has precomputation applied
     void precomp(ge_dsmp rv, const key &B);
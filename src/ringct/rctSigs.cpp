@@ -290,7 +290,6 @@ namespace rct {
     //verRange verifies that \sum Ci = C and that each Ci is a commitment to 0 or 2^i
     rangeSig proveRange(key & C, key & mask, const xmr_amount & amount) {
         sc_0(mask.bytes);
-        identity(C);
         bits b;
         d2b(b, amount);
         rangeSig sig;
@@ -307,8 +306,9 @@ namespace rct {
             }
             subKeys(CiH[i], sig.Ci[i], H2[i]);
             sc_add(mask.bytes, mask.bytes, ai[i].bytes);
-            addKeys(C, C, sig.Ci[i]);
         }
+        // \sum Ci = (\sum ai) G + amount H, cheaper to compute directly
+        addKeys2(C, mask, d2h(amount), getHTable());
         sig.asig = genBorromean(ai, sig.Ci, CiH, b);
         return sig;
     }
@@ -793,55 +793,19 @@ namespace rct {
         PERF_TIMER(verRct);
         CHECK_AND_ASSERT_MES(rv.type == RCTTypeFull || rv.type == RCTTypeFullBulletproof, false, "verRct called on non-full rctSig");
         if (semantics)
-        {
-          if (rv.type == RCTTypeFullBulletproof)
-            CHECK_AND_ASSERT_MES(rv.outPk.size() == rv.p.bulletproofs.size(), false, "Mismatched sizes of outPk and rv.p.bulletproofs");
-          else
-            CHECK_AND_ASSERT_MES(rv.outPk.size() == rv.p.rangeSigs.size(), false, "Mismatched sizes of outPk and rv.p.rangeSigs");
-          CHECK_AND_ASSERT_MES(rv.outPk.size() == rv.ecdhInfo.size(), false, "Mismatched sizes of outPk and rv.ecdhInfo");
-          CHECK_AND_ASSERT_MES(rv.p.MGs.size() == 1, false, "full rctSig has not one MG");
-        }
-        else
-        {
-          // semantics check is early, we don't have the MGs resolved yet
-        }
+          return verRctSemantics(std::vector<const rctSig*>(1, &rv));
 
         // some rct ops can throw
         try
         {
-          if (semantics) {
-            tools::threadpool& tpool = tools::threadpool::getInstance();
-            tools::threadpool::waiter waiter;
-            std::deque<bool> results(rv.outPk.size(), false);
-            DP("range proofs verified?");
-            for (size_t i = 0; i < rv.outPk.size(); i++) {
-              tpool.submit(&waiter, [&, i] {
-                if (rv.p.rangeSigs.empty())
-                  results[i] = bulletproof_VERIFY(rv.p.bulletproofs[i]);
-                else
-                  results[i] = verRange(rv.outPk[i].mask, rv.p.rangeSigs[i]);
-              });
-            }
-            waiter.wait();
-
-            for (size_t i = 0; i < rv.outPk.size(); ++i) {
-              if (!results[i]) {
-                LOG_PRINT_L1("Range proof verified failed for output " << i);
-                return false;
-              }
-            }
-          }
-
-          if (!semantics) {
-            //compute txn fee
-            key txnFeeKey = scalarmultH(d2h(rv.txnFee));
-            bool mgVerd = verRctMG(rv.p.MGs[0], rv.mixRing, rv.outPk, txnFeeKey, get_pre_mlsag_hash(rv));
-            DP("mg sig verified?");
-            DP(mgVerd);
-            if (!mgVerd) {
-              LOG_PRINT_L1("MG signature verification failed");
-              return false;
-            }
+          //compute txn fee
+          key txnFeeKey = scalarmultH(d2h(rv.txnFee));
+          bool mgVerd = verRctMG(rv.p.MGs[0], rv.mixRing, rv.outPk, txnFeeKey, get_pre_mlsag_hash(rv));
+          DP("mg sig verified?");
+          DP(mgVerd);
+          if (!mgVerd) {
+            LOG_PRINT_L1("MG signature verification failed");
+            return false;
           }
 
           return true;
@@ -858,92 +822,133 @@ namespace rct {
         }
     }
 
-    //ver RingCT simple
-    //assumes only post-rct style inputs (at least for max anonymity)
-    bool verRctSimple(const rctSig & rv, bool semantics) {
+    bool verRctSemantics(const std::vector<const rctSig*> & rvv) {
       try
       {
-        PERF_TIMER(verRctSimple);
+        PERF_TIMER(verRctSemantics);
 
-        CHECK_AND_ASSERT_MES(rv.type == RCTTypeSimple || rv.type == RCTTypeSimpleBulletproof, false, "verRctSimple called on non simple rctSig");
-        if (semantics)
+        std::vector<const Bulletproof*> proofs;
+        std::vector<std::pair<const key*, const rangeSig*>> ranges;
+        for (const rctSig *rvp: rvv)
         {
-          if (rv.type == RCTTypeSimpleBulletproof)
+          CHECK_AND_ASSERT_MES(rvp, false, "rctSig pointer is NULL");
+          const rctSig &rv = *rvp;
+          const bool simple = rv.type == RCTTypeSimple || rv.type == RCTTypeSimpleBulletproof;
+          CHECK_AND_ASSERT_MES(simple || rv.type == RCTTypeFull || rv.type == RCTTypeFullBulletproof, false, "verRctSemantics called on unknown rctSig type");
+          const bool bulletproof = rv.type == RCTTypeSimpleBulletproof || rv.type == RCTTypeFullBulletproof;
+          if (bulletproof)
             CHECK_AND_ASSERT_MES(rv.outPk.size() == rv.p.bulletproofs.size(), false, "Mismatched sizes of outPk and rv.p.bulletproofs");
           else
             CHECK_AND_ASSERT_MES(rv.outPk.size() == rv.p.rangeSigs.size(), false, "Mismatched sizes of outPk and rv.p.rangeSigs");
           CHECK_AND_ASSERT_MES(rv.outPk.size() == rv.ecdhInfo.size(), false, "Mismatched sizes of outPk and rv.ecdhInfo");
-          CHECK_AND_ASSERT_MES(rv.pseudoOuts.size() == rv.p.MGs.size(), false, "Mismatched sizes of rv.pseudoOuts and rv.p.MGs");
-        }
-        else
-        {
-          // semantics check is early, and mixRing/MGs aren't resolved yet
-          CHECK_AND_ASSERT_MES(rv.pseudoOuts.size() == rv.mixRing.size(), false, "Mismatched sizes of rv.pseudoOuts and mixRing");
-        }
 
-        const size_t threads = std::max(rv.outPk.size(), rv.mixRing.size());
+          if (simple)
+          {
+            CHECK_AND_ASSERT_MES(rv.pseudoOuts.size() == rv.p.MGs.size(), false, "Mismatched sizes of rv.pseudoOuts and rv.p.MGs");
 
-        std::deque<bool> results(threads);
-        tools::threadpool& tpool = tools::threadpool::getInstance();
-        tools::threadpool::waiter waiter;
+            key sumOutpks = identity();
+            for (size_t i = 0; i < rv.outPk.size(); i++) {
+                addKeys(sumOutpks, sumOutpks, rv.outPk[i].mask);
+            }
+            DP(sumOutpks);
+            key txnFeeKey = scalarmultH(d2h(rv.txnFee));
+            addKeys(sumOutpks, txnFeeKey, sumOutpks);
 
-        if (semantics) {
-          key sumOutpks = identity();
-          for (size_t i = 0; i < rv.outPk.size(); i++) {
-              addKeys(sumOutpks, sumOutpks, rv.outPk[i].mask);
-          }
-          DP(sumOutpks);
-          key txnFeeKey = scalarmultH(d2h(rv.txnFee));
-          addKeys(sumOutpks, txnFeeKey, sumOutpks);
+            key sumPseudoOuts = identity();
+            for (size_t i = 0 ; i < rv.pseudoOuts.size() ; i++) {
+                addKeys(sumPseudoOuts, sumPseudoOuts, rv.pseudoOuts[i]);
+            }
+            DP(sumPseudoOuts);
 
-          key sumPseudoOuts = identity();
-          for (size_t i = 0 ; i < rv.pseudoOuts.size() ; i++) {
-              addKeys(sumPseudoOuts, sumPseudoOuts, rv.pseudoOuts[i]);
+            //check pseudoOuts vs Outs..
+            if (!equalKeys(sumPseudoOuts, sumOutpks)) {
+                LOG_PRINT_L1("Sum check failed");
+                return false;
+            }
           }
-          DP(sumPseudoOuts);
-
-          //check pseudoOuts vs Outs..
-          if (!equalKeys(sumPseudoOuts, sumOutpks)) {
-              LOG_PRINT_L1("Sum check failed");
-              return false;
+          else
+          {
+            CHECK_AND_ASSERT_MES(rv.p.MGs.size() == 1, false, "full rctSig has not one MG");
           }
 
-          results.clear();
-          results.resize(rv.outPk.size());
           for (size_t i = 0; i < rv.outPk.size(); i++) {
-            tpool.submit(&waiter, [&, i] {
-              if (rv.p.rangeSigs.empty())
-                results[i] = bulletproof_VERIFY(rv.p.bulletproofs[i]);
-              else
-                results[i] = verRange(rv.outPk[i].mask, rv.p.rangeSigs[i]);
-            });
+            if (bulletproof)
+              proofs.push_back(&rv.p.bulletproofs[i]);
+            else
+              ranges.push_back(std::make_pair(&rv.outPk[i].mask, &rv.p.rangeSigs[i]));
           }
-          waiter.wait();
+        }
 
-          for (size_t i = 0; i < results.size(); ++i) {
-            if (!results[i]) {
-              LOG_PRINT_L1("Range proof verified failed for output " << i);
-              return false;
-            }
-          }
+        // borromean range sigs go to the pool, while the bulletproofs
+        // are all checked together on this thread
+        std::deque<bool> results(ranges.size(), false);
+        tools::threadpool& tpool = tools::threadpool::getInstance();
+        tools::threadpool::waiter waiter;
+        DP("range proofs verified?");
+        for (size_t i = 0; i < ranges.size(); i++) {
+          tpool.submit(&waiter, [&, i] {
+            results[i] = verRange(*ranges[i].first, *ranges[i].second);
+          });
         }
-        else {
-          const key message = get_pre_mlsag_hash(rv);
-
-          results.clear();
-          results.resize(rv.mixRing.size());
-          for (size_t i = 0 ; i < rv.mixRing.size() ; i++) {
-            tpool.submit(&waiter, [&, i] {
-                results[i] = verRctMGSimple(message, rv.p.MGs[i], rv.mixRing[i], rv.pseudoOuts[i]);
-            });
+        const bool bulletproofs_verified = proofs.empty() || bulletproof_VERIFY(proofs);
+        waiter.wait();
+
+        if (!bulletproofs_verified) {
+          LOG_PRINT_L1("Batch bulletproof verification failed");
+          return false;
+        }
+        for (size_t i = 0; i < results.size(); ++i) {
+          if (!results[i]) {
+            LOG_PRINT_L1("Range proof verified failed for proof " << i);
+            return false;
           }
-          waiter.wait();
+        }
 
-          for (size_t i = 0; i < results.size(); ++i) {
-            if (!results[i]) {
-              LOG_PRINT_L1("verRctMGSimple failed for input " << i);
-              return false;
-            }
+        return true;
+      }
+      // we can get deep throws from ge_frombytes_vartime if input isn't valid
+      catch (const std::exception &e)
+      {
+        LOG_PRINT_L1("Error in verRctSemantics: " << e.what());
+        return false;
+      }
+      catch (...)
+      {
+        LOG_PRINT_L1("Error in verRctSemantics, but not an actual exception");
+        return false;
+      }
+    }
+
+    //ver RingCT simple
+    //assumes only post-rct style inputs (at least for max anonymity)
+    bool verRctSimple(const rctSig & rv, bool semantics) {
+      try
+      {
+        PERF_TIMER(verRctSimple);
+
+        CHECK_AND_ASSERT_MES(rv.type == RCTTypeSimple || rv.type == RCTTypeSimpleBulletproof, false, "verRctSimple called on non simple rctSig");
+        if (semantics)
+          return verRctSemantics(std::vector<const rctSig*>(1, &rv));
+
+        // semantics check is early, and mixRing/MGs aren't resolved yet
+        CHECK_AND_ASSERT_MES(rv.pseudoOuts.size() == rv.mixRing.size(), false, "Mismatched sizes of rv.pseudoOuts and mixRing");
+
+        const key message = get_pre_mlsag_hash(rv);
+
+        std::deque<bool> results(rv.mixRing.size());
+        tools::threadpool& tpool = tools::threadpool::getInstance();
+        tools::threadpool::waiter waiter;
+        for (size_t i = 0 ; i < rv.mixRing.size() ; i++) {
+          tpool.submit(&waiter, [&, i] {
+              results[i] = verRctMGSimple(message, rv.p.MGs[i], rv.mixRing[i], rv.pseudoOuts[i]);
+          });
+        }
+        waiter.wait();
+
+        for (size_t i = 0; i < results.size(); ++i) {
+          if (!results[i]) {
+            LOG_PRINT_L1("verRctMGSimple failed for input " << i);
+            return false;
           }
         }
 
@@ -986,7 +991,7 @@ namespace rct {
         DP("C");
         DP(C);
         key Ctmp;
-        addKeys2(Ctmp, mask, amount, H);
+        addKeys2(Ctmp, mask, amount, getHTable());
         DP("Ctmp");
         DP(Ctmp);
         if (equalKeys(C, Ctmp) == false) {
@@ -1014,7 +1019,7 @@ namespace rct {
         DP("C");
         DP(C);
         key Ctmp;
-        addKeys2(Ctmp, mask, amount, H);
+        addKeys2(Ctmp, mask, amount, getHTable());
         DP("Ctmp");
         DP(Ctmp);
         if (equalKeys(C, Ctmp) == false) {
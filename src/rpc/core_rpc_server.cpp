@@ -53,6 +53,7 @@ using namespace epee;
 
 #define MAX_RESTRICTED_FAKE_OUTS_COUNT 40
 #define MAX_RESTRICTED_GLOBAL_FAKE_OUTS_COUNT 5000
+#define LIGHT_WALLET_FEE_ESTIMATE_GRACE_BLOCKS 10
 
 namespace
 {
@@ -62,6 +63,36 @@ namespace
       reasons += ", ";
     reasons += reason;
   }
+
+  template<typename T>
+  void fill_light_wallet_spent_output(const cryptonote::lw_spend& s, T& so)
+  {
+    so.amount = s.amount;
+    so.key_image = epee::string_tools::pod_to_hex(s.key_image);
+    so.tx_pub_key = epee::string_tools::pod_to_hex(s.tx_pub_key);
+    so.out_index = s.out_index;
+    so.mixin = s.mixin;
+  }
+
+  void fill_light_wallet_tx(const cryptonote::lw_tx& t, uint64_t id, bool mempool, cryptonote::COMMAND_RPC_GET_ADDRESS_TXS::transaction& tx)
+  {
+    tx.id = id;
+    tx.hash = epee::string_tools::pod_to_hex(t.hash);
+    tx.timestamp = t.timestamp;
+    tx.total_received = t.total_received;
+    tx.total_sent = t.total_sent;
+    tx.unlock_time = t.unlock_time;
+    tx.height = t.height;
+    for (const cryptonote::lw_spend& s: t.spends)
+    {
+      tx.spent_outputs.push_back(cryptonote::COMMAND_RPC_GET_ADDRESS_TXS::spent_output());
+      fill_light_wallet_spent_output(s, tx.spent_outputs.back());
+    }
+    tx.payment_id = epee::string_tools::pod_to_hex(t.payment_id);
+    tx.coinbase = t.coinbase;
+    tx.mempool = mempool;
+    tx.mixin = t.mixin;
+  }
 }
 
 namespace cryptonote
@@ -159,79 +190,38 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
-  static cryptonote::blobdata get_pruned_tx_blob(const cryptonote::blobdata &blobdata)
-  {
-    cryptonote::transaction tx;
-
-    if (!cryptonote::parse_and_validate_tx_from_blob(blobdata, tx))
-    {
-      MERROR("Failed to parse and validate tx from blob");
-      return blobdata;
-    }
-
-    std::stringstream ss;
-    binary_archive<true> ba(ss);
-    bool r = tx.serialize_base(ba);
-    CHECK_AND_ASSERT_MES(r, blobdata, "Failed to serialize rct signatures base");
-    return ss.str();
-  }
-  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res)
   {
     PERF_TIMER(on_get_blocks);
-    std::list<std::pair<cryptonote::blobdata, std::list<cryptonote::blobdata> > > bs;
+    std::shared_ptr<const std::vector<block_blobs_entry>> bs;
 
-    if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.start_height, COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT))
+    if(!m_core.find_blockchain_supplement(req.start_height, req.block_ids, bs, res.current_height, res.start_height, req.prune, COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT))
     {
       res.status = "Failed";
       return false;
     }
 
-    size_t pruned_size = 0, unpruned_size = 0, ntxes = 0;
-    for(auto& bd: bs)
+    // everything comes straight from the db (or the cache of recently
+    // served ranges), no need to parse blocks or look up txes here
+    size_t size = 0, ntxes = 0;
+    res.output_indices.resize(bs->size());
+    for(size_t n = 0; n < bs->size(); ++n)
     {
+      const block_blobs_entry &bd = (*bs)[n];
       res.blocks.resize(res.blocks.size()+1);
-      res.blocks.back().block = bd.first;
-      pruned_size += bd.first.size();
-      unpruned_size += bd.first.size();
-      res.output_indices.push_back(COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices());
-      res.output_indices.back().indices.push_back(COMMAND_RPC_GET_BLOCKS_FAST::tx_output_indices());
-      block b;
-      if (!parse_and_validate_block_from_blob(bd.first, b))
-      {
-        res.status = "Invalid block";
-        return false;
-      }
-      bool r = m_core.get_tx_outputs_gindexs(get_transaction_hash(b.miner_tx), res.output_indices.back().indices.back().indices);
-      if (!r)
-      {
-        res.status = "Failed";
-        return false;
-      }
-      size_t txidx = 0;
-      ntxes += bd.second.size();
-      for (std::list<cryptonote::blobdata>::iterator i = bd.second.begin(); i != bd.second.end(); ++i)
-      {
-        unpruned_size += i->size();
-        if (req.prune)
-          res.blocks.back().txs.push_back(get_pruned_tx_blob(std::move(*i)));
-        else
-          res.blocks.back().txs.push_back(std::move(*i));
-        i->clear();
-        i->shrink_to_fit();
-        pruned_size += res.blocks.back().txs.back().size();
+      res.blocks.back().block = bd.block;
+      res.blocks.back().txs.assign(bd.txs.begin(), bd.txs.end());
+      size += bd.block.size();
+      for (const auto &t: bd.txs)
+        size += t.size();
+      ntxes += bd.txs.size();
 
-        res.output_indices.back().indices.push_back(COMMAND_RPC_GET_BLOCKS_FAST::tx_output_indices());
-        bool r = m_core.get_tx_outputs_gindexs(b.tx_hashes[txidx++], res.output_indices.back().indices.back().indices);
-        if (!r)
-        {
-          res.status = "Failed";
-          return false;
-        }
-      }
+      res.output_indices[n].indices.resize(bd.output_indices.size());
+      for (size_t i = 0; i < bd.output_indices.size(); ++i)
+        res.output_indices[n].indices[i].indices = bd.output_indices[i];
     }
 
-    MDEBUG("on_get_blocks: " << bs.size() << " blocks, " << ntxes << " txes, pruned size " << pruned_size << ", unpruned size " << unpruned_size);
+    MDEBUG("on_get_blocks: " << bs->size() << " blocks, " << ntxes << " txes, " << (req.prune ? "pruned" : "unpruned") << " size " << size);
     res.status = CORE_RPC_STATUS_OK;
     return true;
   }
@@ -897,6 +887,66 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_transaction_pool_changes(const COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES::request& req, COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES::response& res, bool request_has_rpc_origin)
+  {
+    PERF_TIMER(on_get_transaction_pool_changes);
+    res.full = !m_core.get_pool_transaction_changes(req.since, res.added, res.removed, res.sequence, !request_has_rpc_origin || !m_restricted);
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_output_distribution_bin(const COMMAND_RPC_GET_OUTPUT_DISTRIBUTION::request& req, COMMAND_RPC_GET_OUTPUT_DISTRIBUTION::response& res)
+  {
+    PERF_TIMER(on_get_output_distribution_bin);
+    if (m_restricted)
+    {
+      // pre-rct amounts and arbitrary ranges would let anyone have us walk
+      // most of the output tables, wallets only need the rct distribution
+      if (req.amounts != std::vector<uint64_t>(1, 0))
+      {
+        res.status = "Restricted RPC can only get output distribution for rct outputs";
+        return true;
+      }
+      const uint64_t height = m_core.get_current_blockchain_height();
+      if (req.from_height >= height || req.to_height >= height || (req.to_height && req.from_height > req.to_height))
+      {
+        res.status = "Invalid height range";
+        return true;
+      }
+    }
+    try
+    {
+      for (uint64_t amount: req.amounts)
+      {
+        COMMAND_RPC_GET_OUTPUT_DISTRIBUTION::distribution d = AUTO_VAL_INIT(d);
+        d.amount = amount;
+        d.start_height = req.from_height;
+        if (!m_core.get_blockchain_storage().get_output_distribution(amount, req.from_height, req.to_height, d.distribution, d.base))
+        {
+          res.status = "Failed to get output distribution";
+          return true;
+        }
+        if (!req.cumulative)
+        {
+          // per block counts rather than running totals
+          for (size_t n = d.distribution.size(); n-- > 1; )
+            d.distribution[n] -= d.distribution[n - 1];
+          if (!d.distribution.empty())
+            d.distribution[0] -= d.base;
+        }
+        res.distributions.push_back(std::move(d));
+      }
+    }
+    catch (const std::exception &e)
+    {
+      res.status = "Failed to get output distribution";
+      return true;
+    }
+
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_get_transaction_pool_stats(const COMMAND_RPC_GET_TRANSACTION_POOL_STATS::request& req, COMMAND_RPC_GET_TRANSACTION_POOL_STATS::response& res, bool request_has_rpc_origin)
   {
     PERF_TIMER(on_get_transaction_pool_stats);
@@ -1711,6 +1761,363 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::parse_light_wallet_account(const std::string& address, const std::string& view_key, account_public_address& account_address, crypto::secret_key& view_secret_key, std::string& error) const
+  {
+    if (!m_core.light_wallet_enabled())
+    {
+      error = "Light wallet API is not enabled on this daemon";
+      return false;
+    }
+    cryptonote::address_parse_info info;
+    if (!get_account_address_from_str(info, m_testnet, address))
+    {
+      error = "Invalid address";
+      return false;
+    }
+    if (info.is_subaddress)
+    {
+      error = "Subaddresses are not supported";
+      return false;
+    }
+    if (!epee::string_tools::hex_to_pod(view_key, view_secret_key))
+    {
+      error = "Invalid view key";
+      return false;
+    }
+    account_address = info.address;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_login(const COMMAND_RPC_LOGIN::request& req, COMMAND_RPC_LOGIN::response& res)
+  {
+    PERF_TIMER(on_login);
+    res.new_address = false;
+    account_public_address address;
+    crypto::secret_key view_secret_key;
+    if (!parse_light_wallet_account(req.address, req.view_key, address, view_secret_key, res.reason))
+    {
+      res.status = "error";
+      return true;
+    }
+    light_wallet_scanner& scanner = m_core.get_light_wallet_scanner();
+    if (!scanner.login(address, view_secret_key, req.create_account, res.new_address))
+    {
+      res.status = "error";
+      res.reason = req.create_account && scanner.is_full() ? "No more accounts can be registered on this daemon" : "Unknown account, or wrong view key";
+      return true;
+    }
+    res.status = "success";
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_address_info(const COMMAND_RPC_GET_ADDRESS_INFO::request& req, COMMAND_RPC_GET_ADDRESS_INFO::response& res)
+  {
+    PERF_TIMER(on_get_address_info);
+    account_public_address address;
+    crypto::secret_key view_secret_key;
+    res.locked_funds = 0;
+    res.total_received = 0;
+    res.total_sent = 0;
+    res.scanned_height = 0;
+    res.scanned_block_height = 0;
+    res.start_height = 0;
+    res.transaction_height = 0;
+    res.blockchain_height = 0;
+    if (!parse_light_wallet_account(req.address, req.view_key, address, view_secret_key, res.reason))
+    {
+      res.status = "error";
+      return true;
+    }
+
+    const uint64_t chain_height = m_core.get_current_blockchain_height();
+    res.blockchain_height = chain_height;
+    res.transaction_height = m_core.get_blockchain_storage().get_db().get_tx_count();
+    bool found = m_core.get_light_wallet_scanner().with_account(address, view_secret_key, [&](const lw_account& account)
+    {
+      for (const lw_output& o: account.outputs)
+      {
+        res.total_received += o.amount;
+        if (!light_wallet_scanner::is_output_unlocked(o, chain_height))
+          res.locked_funds += o.amount;
+      }
+      for (const lw_tx& t: account.txs)
+      {
+        for (const lw_spend& s: t.spends)
+        {
+          res.total_sent += s.amount;
+          res.spent_outputs.push_back(COMMAND_RPC_GET_ADDRESS_INFO::spent_output());
+          fill_light_wallet_spent_output(s, res.spent_outputs.back());
+        }
+      }
+      res.scanned_height = account.scanned_height;
+      res.scanned_block_height = account.scanned_height;
+      res.start_height = account.start_height;
+    });
+    if (!found)
+    {
+      res.status = "error";
+      res.reason = "Unknown account, or wrong view key";
+      return true;
+    }
+    res.status = "success";
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_address_txs(const COMMAND_RPC_GET_ADDRESS_TXS::request& req, COMMAND_RPC_GET_ADDRESS_TXS::response& res)
+  {
+    PERF_TIMER(on_get_address_txs);
+    account_public_address address;
+    crypto::secret_key view_secret_key;
+    std::string error;
+    if (!parse_light_wallet_account(req.address, req.view_key, address, view_secret_key, error))
+    {
+      res.status = "error";
+      LOG_PRINT_L1("[on_get_address_txs]: " << error);
+      return true;
+    }
+
+    const uint64_t chain_height = m_core.get_current_blockchain_height();
+    light_wallet_scanner& scanner = m_core.get_light_wallet_scanner();
+    res.total_received = 0;
+    res.total_received_unlocked = 0;
+    res.blockchain_height = chain_height;
+    uint64_t id = 0;
+    bool found = scanner.with_account(address, view_secret_key, [&](const lw_account& account)
+    {
+      for (const lw_tx& t: account.txs)
+      {
+        res.transactions.push_back(COMMAND_RPC_GET_ADDRESS_TXS::transaction());
+        fill_light_wallet_tx(t, id++, false, res.transactions.back());
+        res.total_received += t.total_received;
+      }
+      for (const lw_output& o: account.outputs)
+      {
+        if (light_wallet_scanner::is_output_unlocked(o, chain_height))
+          res.total_received_unlocked += o.amount;
+      }
+      res.scanned_height = account.scanned_height;
+      res.scanned_block_height = account.scanned_height;
+    });
+
+    std::vector<lw_tx> pool_txs;
+    if (!found || !scanner.get_pool_txs(address, view_secret_key, pool_txs))
+    {
+      res.status = "error";
+      LOG_PRINT_L1("[on_get_address_txs]: unknown account " << req.address);
+      return true;
+    }
+    for (const lw_tx& t: pool_txs)
+    {
+      res.transactions.push_back(COMMAND_RPC_GET_ADDRESS_TXS::transaction());
+      fill_light_wallet_tx(t, id++, true, res.transactions.back());
+    }
+
+    res.status = "success";
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_unspent_outs(const COMMAND_RPC_GET_UNSPENT_OUTS::request& req, COMMAND_RPC_GET_UNSPENT_OUTS::response& res)
+  {
+    PERF_TIMER(on_get_unspent_outs);
+    account_public_address address;
+    crypto::secret_key view_secret_key;
+    res.amount = 0;
+    res.per_kb_fee = 0;
+    if (!parse_light_wallet_account(req.address, req.view_key, address, view_secret_key, res.reason))
+    {
+      res.status = "error";
+      return true;
+    }
+
+    uint64_t dust_threshold = 0;
+    if (!req.use_dust && !req.dust_threshold.empty() && !epee::string_tools::get_xtype_from_string(dust_threshold, req.dust_threshold))
+    {
+      res.status = "error";
+      res.reason = "Invalid dust threshold";
+      return true;
+    }
+
+    bool found = m_core.get_light_wallet_scanner().with_account(address, view_secret_key, [&](const lw_account& account)
+    {
+      // every input which might spend an output, by the output's tx public key
+      std::unordered_map<crypto::public_key, std::vector<const lw_spend*>> spends;
+      for (const lw_tx& t: account.txs)
+        for (const lw_spend& s: t.spends)
+          spends[s.tx_pub_key].push_back(&s);
+
+      for (const lw_output& o: account.outputs)
+      {
+        if (!o.rct && o.amount < dust_threshold)
+          continue;
+        res.outputs.push_back(COMMAND_RPC_GET_UNSPENT_OUTS::output());
+        COMMAND_RPC_GET_UNSPENT_OUTS::output& out = res.outputs.back();
+        out.amount = o.amount;
+        out.public_key = epee::string_tools::pod_to_hex(o.public_key);
+        out.index = o.index;
+        out.global_index = o.global_index;
+        if (o.rct)
+          out.rct = epee::string_tools::pod_to_hex(o.commitment) + epee::string_tools::pod_to_hex(o.encrypted_mask) + epee::string_tools::pod_to_hex(o.encrypted_amount);
+        out.tx_hash = epee::string_tools::pod_to_hex(o.tx_hash);
+        out.tx_pub_key = epee::string_tools::pod_to_hex(o.tx_pub_key);
+        out.tx_prefix_hash = epee::string_tools::pod_to_hex(o.tx_prefix_hash);
+        out.timestamp = o.timestamp;
+        out.height = o.height;
+        const auto i = spends.find(o.tx_pub_key);
+        if (i != spends.end())
+        {
+          for (const lw_spend* s: i->second)
+            if (s->out_index == o.index)
+              out.spend_key_images.push_back(epee::string_tools::pod_to_hex(s->key_image));
+        }
+        res.amount += o.amount;
+      }
+    });
+    if (!found)
+    {
+      res.status = "error";
+      res.reason = "Unknown account, or wrong view key";
+      return true;
+    }
+
+    res.per_kb_fee = m_core.get_blockchain_storage().get_dynamic_per_kb_fee_estimate(LIGHT_WALLET_FEE_ESTIMATE_GRACE_BLOCKS);
+    res.status = "success";
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_light_wallet_random_outs(const COMMAND_RPC_GET_RANDOM_OUTS::request& req, COMMAND_RPC_GET_RANDOM_OUTS::response& res)
+  {
+    PERF_TIMER(on_get_light_wallet_random_outs);
+    if (!m_core.light_wallet_enabled())
+    {
+      res.Error = "Light wallet API is not enabled on this daemon";
+      return true;
+    }
+    if (m_restricted && (req.amounts.size() > 100 || req.count > MAX_RESTRICTED_FAKE_OUTS_COUNT))
+    {
+      res.Error = "Too many outs requested";
+      return true;
+    }
+
+    // fake outputs carry their commitment, and a zero mask and amount the client does not use
+    static const std::string zero_ecdh = epee::string_tools::pod_to_hex(rct::zero()) + epee::string_tools::pod_to_hex(rct::zero());
+
+    COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request oreq;
+    oreq.outs_count = req.count;
+    bool want_rct = false;
+    for (const std::string& amount_str: req.amounts)
+    {
+      uint64_t amount;
+      if (!epee::string_tools::get_xtype_from_string(amount, amount_str))
+      {
+        res.Error = "Invalid amount: " + amount_str;
+        return true;
+      }
+      if (amount == 0)
+        want_rct = true;
+      else
+        oreq.amounts.push_back(amount);
+    }
+
+    if (want_rct)
+    {
+      COMMAND_RPC_GET_RANDOM_RCT_OUTPUTS::request rreq;
+      COMMAND_RPC_GET_RANDOM_RCT_OUTPUTS::response rres;
+      rreq.outs_count = req.count;
+      if (!m_core.get_random_rct_outs(rreq, rres))
+      {
+        res.Error = "Failed to get random rct outputs";
+        return true;
+      }
+      res.amount_outs.push_back(COMMAND_RPC_GET_RANDOM_OUTS::amount_out());
+      COMMAND_RPC_GET_RANDOM_OUTS::amount_out& ao = res.amount_outs.back();
+      ao.amount = 0;
+      for (const auto& oe: rres.outs)
+      {
+        COMMAND_RPC_GET_RANDOM_OUTS::output out;
+        out.public_key = epee::string_tools::pod_to_hex(oe.out_key);
+        out.global_index = oe.global_amount_index;
+        out.rct = epee::string_tools::pod_to_hex(oe.commitment) + zero_ecdh;
+        ao.outputs.push_back(out);
+      }
+    }
+
+    if (!oreq.amounts.empty())
+    {
+      COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response ores;
+      if (!m_core.get_random_outs_for_amounts(oreq, ores))
+      {
+        res.Error = "Failed to get random outputs";
+        return true;
+      }
+      for (const auto& ofa: ores.outs)
+      {
+        res.amount_outs.push_back(COMMAND_RPC_GET_RANDOM_OUTS::amount_out());
+        COMMAND_RPC_GET_RANDOM_OUTS::amount_out& ao = res.amount_outs.back();
+        ao.amount = ofa.amount;
+        for (const auto& oe: ofa.outs)
+        {
+          COMMAND_RPC_GET_RANDOM_OUTS::output out;
+          out.public_key = epee::string_tools::pod_to_hex(oe.out_key);
+          out.global_index = oe.global_amount_index;
+          ao.outputs.push_back(out);
+        }
+      }
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_submit_raw_tx(const COMMAND_RPC_SUBMIT_RAW_TX::request& req, COMMAND_RPC_SUBMIT_RAW_TX::response& res)
+  {
+    PERF_TIMER(on_submit_raw_tx);
+    if (!m_core.light_wallet_enabled())
+    {
+      res.status = "error";
+      res.error = "Light wallet API is not enabled on this daemon";
+      return true;
+    }
+
+    COMMAND_RPC_SEND_RAW_TX::request sreq;
+    COMMAND_RPC_SEND_RAW_TX::response sres;
+    sreq.tx_as_hex = req.tx;
+    sreq.do_not_relay = false;
+    if (!on_send_raw_tx(sreq, sres) || sres.status != CORE_RPC_STATUS_OK)
+    {
+      res.status = "error";
+      res.error = sres.reason.empty() ? sres.status : sres.reason;
+      return true;
+    }
+    res.status = "success";
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_import_wallet_request(const COMMAND_RPC_IMPORT_WALLET_REQUEST::request& req, COMMAND_RPC_IMPORT_WALLET_REQUEST::response& res)
+  {
+    PERF_TIMER(on_import_wallet_request);
+    account_public_address address;
+    crypto::secret_key view_secret_key;
+    std::string error;
+    res.import_fee = 0;
+    res.new_request = false;
+    res.request_fulfilled = false;
+    if (!parse_light_wallet_account(req.address, req.view_key, address, view_secret_key, error))
+    {
+      res.status = "error";
+      LOG_PRINT_L1("[on_import_wallet_request]: " << error);
+      return true;
+    }
+    // the daemon does not charge for imports, so the rescan is scheduled right away
+    if (!m_core.get_light_wallet_scanner().rescan(address, view_secret_key))
+    {
+      res.status = "error";
+      LOG_PRINT_L1("[on_import_wallet_request]: unknown account " << req.address);
+      return true;
+    }
+    res.new_request = true;
+    res.request_fulfilled = true;
+    res.status = "success";
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_relay_tx(const COMMAND_RPC_RELAY_TX::request& req, COMMAND_RPC_RELAY_TX::response& res, epee::json_rpc::error& error_resp)
   {
     PERF_TIMER(on_relay_tx);
@@ -1799,6 +2206,19 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_output_distribution(const COMMAND_RPC_GET_OUTPUT_DISTRIBUTION::request& req, COMMAND_RPC_GET_OUTPUT_DISTRIBUTION::response& res, epee::json_rpc::error& error_resp)
+  {
+    PERF_TIMER(on_get_output_distribution);
+    on_get_output_distribution_bin(req, res);
+    if (res.status != CORE_RPC_STATUS_OK)
+    {
+      error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
+      error_resp.message = res.status;
+      return false;
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
 
   const command_line::arg_descriptor<std::string> core_rpc_server::arg_rpc_bind_port = {
       "rpc-bind-port"
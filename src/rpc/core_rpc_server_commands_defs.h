@@ -49,7 +49,7 @@ namespace cryptonote
 // advance which version they will stop working with
 // Don't go over 32767 for any of these
 #define CORE_RPC_VERSION_MAJOR 1
-#define CORE_RPC_VERSION_MINOR 17
+#define CORE_RPC_VERSION_MINOR 19
 #define MAKE_CORE_RPC_VERSION(major,minor) (((major)<<16)|(minor))
 #define CORE_RPC_VERSION MAKE_CORE_RPC_VERSION(CORE_RPC_VERSION_MAJOR, CORE_RPC_VERSION_MINOR)
 
@@ -323,6 +323,8 @@ namespace cryptonote
         uint64_t transaction_height;
         uint64_t blockchain_height;
         std::list<spent_output> spent_outputs;
+        std::string status;
+        std::string reason;
         BEGIN_KV_SERIALIZE_MAP()
           KV_SERIALIZE(locked_funds)
           KV_SERIALIZE(total_received)
@@ -333,6 +335,8 @@ namespace cryptonote
           KV_SERIALIZE(transaction_height)
           KV_SERIALIZE(blockchain_height)
           KV_SERIALIZE(spent_outputs)
+          KV_SERIALIZE(status)
+          KV_SERIALIZE(reason)
         END_KV_SERIALIZE_MAP()
       };
   };
@@ -1442,6 +1446,35 @@ namespace cryptonote
     };
   };
 
+  struct COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES
+  {
+    struct request
+    {
+      uint64_t since;   // pool sequence number from a previous call, 0 for the whole pool
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_OPT(since, (uint64_t)0)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      std::string status;
+      bool full;        // true if added is the whole pool, because the changes since then are not known
+      uint64_t sequence;
+      std::vector<crypto::hash> added;
+      std::vector<crypto::hash> removed;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(status)
+        KV_SERIALIZE(full)
+        KV_SERIALIZE(sequence)
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(added)
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(removed)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
   struct tx_backlog_entry
   {
     uint64_t blob_size;
@@ -2113,4 +2146,48 @@ namespace cryptonote
       END_KV_SERIALIZE_MAP()
     };
   };
+
+  struct COMMAND_RPC_GET_OUTPUT_DISTRIBUTION
+  {
+    struct request
+    {
+      std::vector<uint64_t> amounts;
+      uint64_t from_height;
+      uint64_t to_height;
+      bool cumulative;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(amounts)
+        KV_SERIALIZE_OPT(from_height, (uint64_t)0)
+        KV_SERIALIZE_OPT(to_height, (uint64_t)0)
+        KV_SERIALIZE_OPT(cumulative, false)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct distribution
+    {
+      uint64_t amount;
+      uint64_t start_height;
+      std::vector<uint64_t> distribution;
+      uint64_t base;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(amount)
+        KV_SERIALIZE(start_height)
+        KV_SERIALIZE(distribution)
+        KV_SERIALIZE(base)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      std::string status;
+      std::vector<distribution> distributions;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(status)
+        KV_SERIALIZE(distributions)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
 }
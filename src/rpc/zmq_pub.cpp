@@ -0,0 +1,341 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "zmq_pub.h"
+
+#include <boost/bind.hpp>
+#include <cstring>
+
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/cryptonote_core.h"
+#include "storages/portable_storage_template_helper.h"
+#include "zmq_server.h"
+
+namespace cryptonote
+{
+
+namespace rpc
+{
+
+namespace
+{
+  // events beyond this are dropped until the publisher thread catches up
+  constexpr size_t MAX_QUEUED_EVENTS = 1000;
+
+  // how often (un)subscriptions are picked up when there are no events
+  constexpr int SUBSCRIPTIONS_POLL_MS = 100;
+
+  void free_string(void *data, void *hint)
+  {
+    delete static_cast<std::string*>(hint);
+  }
+}
+
+ZmqPublisher::publisher::publisher(bool pruned) :
+    context(DEFAULT_NUM_ZMQ_THREADS),
+    pruned(pruned),
+    running(false)
+{
+}
+
+bool ZmqPublisher::publisher::wants(const char *topic)
+{
+  boost::lock_guard<boost::mutex> guard(lock);
+  if (!running || !pub_socket)
+    return false;
+
+  // subscriptions are topic prefixes
+  const std::string t(topic);
+  for (const std::string& subscription: subscriptions)
+    if (t.compare(0, subscription.size(), subscription) == 0)
+      return true;
+  return false;
+}
+
+void ZmqPublisher::publisher::push(event&& e)
+{
+  {
+    boost::lock_guard<boost::mutex> guard(lock);
+    if (queue.size() >= MAX_QUEUED_EVENTS)
+    {
+      MWARNING("ZMQ publisher queue full, dropping event");
+      return;
+    }
+    queue.push_back(std::move(e));
+  }
+  queue_changed.notify_one();
+}
+
+void ZmqPublisher::publisher::publish(const char *topic, std::string&& payload)
+{
+  try
+  {
+    pub_socket->send(topic, strlen(topic), ZMQ_SNDMORE);
+
+    // the message takes ownership of the payload rather than copying it
+    std::unique_ptr<std::string> data(new std::string(std::move(payload)));
+    zmq::message_t message(&(*data)[0], data->size(), free_string, data.get());
+    data.release();
+    pub_socket->send(message);
+  }
+  catch (const zmq::error_t& e)
+  {
+    MERROR(std::string("ZMQ error publishing ") + topic + ": " + e.what());
+  }
+}
+
+void ZmqPublisher::publisher::update_subscriptions()
+{
+  // the XPUB socket hands up a message for the first subscription to a
+  // topic and for the last unsubscription from it
+  try
+  {
+    zmq::message_t message;
+    while (pub_socket->recv(&message, ZMQ_DONTWAIT))
+    {
+      if (message.size() == 0)
+        continue;
+      const char *data = static_cast<const char*>(message.data());
+      std::string topic(data + 1, message.size() - 1);
+      boost::lock_guard<boost::mutex> guard(lock);
+      if (data[0])
+        subscriptions.insert(std::move(topic));
+      else
+        subscriptions.erase(topic);
+    }
+  }
+  catch (const zmq::error_t& e)
+  {
+    MERROR(std::string("ZMQ error reading subscriptions: ") + e.what());
+  }
+}
+
+void ZmqPublisher::publisher::block_added(const BlockchainDB& db, uint64_t height, const crypto::hash& id, const block& b)
+{
+  if (!wants("block"))
+    return;
+  event e{event::block_added, height, id, blobdata()};
+  if (!make_block_notification(db, height, id, b, e.block))
+    return;
+  push(std::move(e));
+}
+
+bool ZmqPublisher::publisher::make_block_notification(const BlockchainDB& db, uint64_t height, const crypto::hash& id, const block& b, block_notification& n)
+{
+  n.height = height;
+  n.hash = id;
+
+  // this runs on the thread adding the block, which sees it even if the
+  // batch adding it is not committed yet
+  try
+  {
+    n.block.block = db.get_block_blob(id);
+    n.output_indices.indices.resize(b.tx_hashes.size() + 1);
+    uint64_t tx_index;
+    if (!db.tx_exists(get_transaction_hash(b.miner_tx), tx_index))
+    {
+      MERROR("Failed to find the miner tx of block " << id);
+      return false;
+    }
+    n.output_indices.indices[0].indices = db.get_tx_amount_output_indices(tx_index);
+    for (size_t i = 0; i < b.tx_hashes.size(); ++i)
+    {
+      const crypto::hash& tx_hash = b.tx_hashes[i];
+      n.block.txs.push_back(blobdata());
+      if (!(pruned && db.get_pruned_tx_blob(tx_hash, n.block.txs.back())) && !db.get_tx_blob(tx_hash, n.block.txs.back()))
+      {
+        MERROR("Failed to get tx " << tx_hash << " of block " << id);
+        return false;
+      }
+      if (!db.tx_exists(tx_hash, tx_index))
+      {
+        MERROR("Failed to find tx " << tx_hash << " of block " << id);
+        return false;
+      }
+      n.output_indices.indices[i + 1].indices = db.get_tx_amount_output_indices(tx_index);
+    }
+  }
+  catch (const std::exception& e)
+  {
+    MERROR("Failed to read block " << id << " to publish: " << e.what());
+    return false;
+  }
+  return true;
+}
+
+void ZmqPublisher::publisher::run()
+{
+  std::deque<event> events;
+  while (true)
+  {
+    {
+      boost::unique_lock<boost::mutex> guard(lock);
+      if (running && queue.empty())
+        queue_changed.timed_wait(guard, boost::posix_time::milliseconds(SUBSCRIPTIONS_POLL_MS));
+      if (!running)
+        break;
+      events.swap(queue);
+    }
+
+    update_subscriptions();
+
+    for (event& e: events)
+    {
+      std::string payload;
+      switch (e.kind)
+      {
+        case event::block_added:
+        {
+          epee::serialization::store_t_to_binary(e.block, payload);
+          publish("block", std::move(payload));
+          break;
+        }
+        case event::tx_added:
+        {
+          tx_notification n;
+          n.hash = e.hash;
+          n.tx = std::move(e.tx);
+          epee::serialization::store_t_to_binary(n, payload);
+          publish("tx", std::move(payload));
+          break;
+        }
+        case event::block_detached:
+        {
+          detach_notification n;
+          n.height = e.height;
+          n.hash = e.hash;
+          epee::serialization::store_t_to_binary(n, payload);
+          publish("detach", std::move(payload));
+          break;
+        }
+      }
+    }
+    events.clear();
+  }
+}
+
+ZmqPublisher::ZmqPublisher(core& c, bool pruned) :
+    core_instance(c),
+    state(std::make_shared<publisher>(pruned)),
+    hooked(false)
+{
+}
+
+ZmqPublisher::~ZmqPublisher()
+{
+  stop();
+}
+
+bool ZmqPublisher::addTCPSocket(std::string address, std::string port)
+{
+  try
+  {
+    std::string addr_prefix("tcp://");
+
+    boost::lock_guard<boost::mutex> guard(state->lock);
+    // XPUB rather than PUB, to hear about subscriptions
+    state->pub_socket.reset(new zmq::socket_t(state->context, ZMQ_XPUB));
+
+    // do not hang on to unsent events when stopping
+    state->pub_socket->setsockopt(ZMQ_LINGER, 0);
+
+    std::string bind_address = addr_prefix + address + std::string(":") + port;
+    state->pub_socket->bind(bind_address.c_str());
+  }
+  catch (const std::exception& e)
+  {
+    MERROR(std::string("Error creating ZMQ publisher socket: ") + e.what());
+    return false;
+  }
+  return true;
+}
+
+void ZmqPublisher::run()
+{
+  Blockchain& blockchain = core_instance.get_blockchain_storage();
+  {
+    boost::lock_guard<boost::mutex> guard(state->lock);
+    if (state->running || !state->pub_socket)
+      return;
+    state->running = true;
+  }
+  publisher_thread = boost::thread(boost::bind(&publisher::run, state));
+
+  if (hooked)
+    return;
+  hooked = true;
+
+  // the hooks can't be removed, so they only keep the shared state alive,
+  // and they do little more than queue events, as they run under the
+  // blockchain or pool lock
+  std::shared_ptr<publisher> pub = state;
+  core& c = core_instance;
+
+  blockchain.add_block_notify([pub, &c, &blockchain](uint64_t height, const crypto::hash& id, const block& b, const std::vector<transaction>& txs)
+  {
+    // nobody wants a flood of old blocks while syncing
+    if (c.get_target_blockchain_height() > height + 1)
+      return;
+    pub->block_added(blockchain.get_db(), height, id, b);
+  });
+
+  blockchain.add_detach_notify([pub](uint64_t height, const crypto::hash& id)
+  {
+    if (!pub->wants("detach"))
+      return;
+    pub->push({event::block_detached, height, id, blobdata()});
+  });
+
+  core_instance.get_pool().add_tx_notify([pub](const crypto::hash& id, const transaction& tx)
+  {
+    if (!pub->wants("tx"))
+      return;
+    pub->push({event::tx_added, 0, id, tx_to_blob(tx)});
+  });
+}
+
+void ZmqPublisher::stop()
+{
+  {
+    boost::lock_guard<boost::mutex> guard(state->lock);
+    state->running = false;
+  }
+  state->queue_changed.notify_all();
+  if (publisher_thread.joinable())
+    publisher_thread.join();
+
+  boost::lock_guard<boost::mutex> guard(state->lock);
+  state->pub_socket.reset();
+  state->subscriptions.clear();
+  state->queue.clear();
+}
+
+
+}  // namespace cryptonote
+
+}  // namespace rpc
@@ -0,0 +1,175 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <zmq.hpp>
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "cryptonote_basic/cryptonote_basic.h"
+#include "cryptonote_protocol/cryptonote_protocol_defs.h"
+#include "rpc/core_rpc_server_commands_defs.h"
+
+class zmq_pub_test;
+
+namespace cryptonote
+{
+
+class core;
+class BlockchainDB;
+
+namespace rpc
+{
+
+/**
+ * @brief Publishes blockchain and pool events on a ZMQ PUB socket
+ *
+ * Each event is a two part message: a topic subscribers can filter on,
+ * then an epee binary payload.
+ *
+ *  - "block": a block added to the main chain, with its transactions
+ *    and their output indices, as returned by getblocks.bin
+ *  - "tx": a transaction added to the pool
+ *  - "detach": a block popped off the main chain, e.g. by a reorg
+ *
+ * The core's hooks only queue events, which are then serialized and sent
+ * by the publisher thread, away from the blockchain and pool locks. A
+ * block's data is read from the database by its hook though: the block
+ * may be added as part of a batch which the publisher thread could only
+ * see once committed. Events nobody subscribed to are not queued, nor are
+ * blocks added while the daemon is syncing. Events are dropped rather than
+ * queued without bound when the publisher or a subscriber cannot keep up.
+ */
+class ZmqPublisher
+{
+  friend class ::zmq_pub_test;
+
+  public:
+
+    struct block_notification
+    {
+      uint64_t height;
+      crypto::hash hash;
+      block_complete_entry block;
+      COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices output_indices; //!< miner tx first
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(height)
+        KV_SERIALIZE_VAL_POD_AS_BLOB(hash)
+        KV_SERIALIZE(block)
+        KV_SERIALIZE(output_indices)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct tx_notification
+    {
+      crypto::hash hash;
+      blobdata tx;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_VAL_POD_AS_BLOB(hash)
+        KV_SERIALIZE(tx)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct detach_notification
+    {
+      uint64_t height; //!< height of the popped block, and the new chain height
+      crypto::hash hash;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(height)
+        KV_SERIALIZE_VAL_POD_AS_BLOB(hash)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    /**
+     * @param c the core to publish events of
+     * @param pruned whether to send pruned transactions with blocks
+     */
+    ZmqPublisher(core& c, bool pruned);
+
+    ~ZmqPublisher();
+
+    bool addTCPSocket(std::string address, std::string port);
+
+    void run();
+    void stop();
+
+  private:
+    // an event queued by the core's hooks, for the publisher thread
+    struct event
+    {
+      enum kind_t { block_added, tx_added, block_detached };
+
+      kind_t kind;
+      uint64_t height;
+      crypto::hash hash;
+      blobdata tx; //!< only for tx_added
+      block_notification block; //!< only for block_added
+    };
+
+    // the part the core's hooks refer to, which may outlive the publisher
+    struct publisher
+    {
+      explicit publisher(bool pruned);
+
+      bool wants(const char *topic);
+      void push(event&& e);
+      void block_added(const BlockchainDB& db, uint64_t height, const crypto::hash& id, const block& b);
+      void publish(const char *topic, std::string&& payload);
+      void update_subscriptions();
+      bool make_block_notification(const BlockchainDB& db, uint64_t height, const crypto::hash& id, const block& b, block_notification& n);
+      void run();
+
+      boost::mutex lock;
+      boost::condition_variable queue_changed;
+      zmq::context_t context;
+      std::unique_ptr<zmq::socket_t> pub_socket; //!< only used by the publisher thread once it runs
+      std::set<std::string> subscriptions;
+      std::deque<event> queue;
+      const bool pruned;
+      bool running;
+    };
+
+    core& core_instance;
+    std::shared_ptr<publisher> state;
+    boost::thread publisher_thread;
+    bool hooked;
+};
+
+
+}  // namespace cryptonote
+
+}  // namespace rpc
@@ -27,6 +27,8 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "zmq_server.h"
+#include <deque>
+#include <vector>
 #include <boost/chrono/chrono.hpp>
 
 namespace cryptonote
@@ -35,11 +37,22 @@ namespace cryptonote
 namespace rpc
 {
 
-ZmqServer::ZmqServer(RpcHandler& h) :
+namespace
+{
+  const char* const WORKERS_ADDRESS = "inproc://zmq-rpc-workers";
+
+  void free_string(void *data, void *hint)
+  {
+    delete static_cast<std::string*>(hint);
+  }
+}
+
+ZmqServer::ZmqServer(RpcHandler& h, unsigned num_workers) :
     handler(h),
     stop_signal(false),
     running(false),
-    context(DEFAULT_NUM_ZMQ_THREADS) // TODO: make this configurable
+    num_workers(num_workers ? num_workers : DEFAULT_NUM_ZMQ_RPC_WORKERS),
+    context(DEFAULT_NUM_ZMQ_THREADS)
 {
 }
 
@@ -47,38 +60,150 @@ ZmqServer::~ZmqServer()
 {
 }
 
+bool ZmqServer::has_more(zmq::socket_t& socket)
+{
+  int more = 0;
+  size_t more_size = sizeof(more);
+  socket.getsockopt(ZMQ_RCVMORE, &more, &more_size);
+  return more;
+}
+
+bool ZmqServer::forward(zmq::socket_t& from, zmq::socket_t& to)
+{
+  // pass each frame of a multipart message on as is, the message
+  // data is handed over rather than copied
+  bool more = false;
+  do
+  {
+    zmq::message_t message;
+    if (!from.recv(&message, ZMQ_DONTWAIT))
+      return false;
+    more = has_more(from);
+    to.send(message, more ? ZMQ_SNDMORE : 0);
+  } while (more);
+  return true;
+}
+
 void ZmqServer::serve()
 {
+  // workers which have nothing to do, least recently busy first
+  std::deque<std::string> idle_workers;
 
-  while (1)
+  while (!stop_signal)
   {
     try
     {
-      zmq::message_t message;
-
-      if (!rep_socket)
+      if (!router_socket || !worker_socket)
       {
-        throw std::runtime_error("ZMQ RPC server reply socket is null");
+        throw std::runtime_error("ZMQ RPC server socket is null");
       }
-      while (rep_socket->recv(&message))
+      zmq::pollitem_t items[] = {
+        { static_cast<void*>(*worker_socket), 0, ZMQ_POLLIN, 0 },
+        { static_cast<void*>(*router_socket), 0, ZMQ_POLLIN, 0 },
+      };
+      while (!stop_signal)
       {
+        // requests are left with the clients' socket until a worker is idle
+        items[1].revents = 0;
+        zmq::poll(items, idle_workers.empty() ? 1 : 2, DEFAULT_RPC_RECV_TIMEOUT_MS);
+
+        if (items[0].revents & ZMQ_POLLIN)
+        {
+          // worker identity, empty delimiter, then either READY or a reply
+          // with the client's routing envelope
+          zmq::message_t worker, delimiter, first;
+          if (worker_socket->recv(&worker, ZMQ_DONTWAIT) && worker_socket->recv(&delimiter) && worker_socket->recv(&first))
+          {
+            idle_workers.emplace_back(static_cast<const char*>(worker.data()), worker.size());
+            if (has_more(*worker_socket))
+            {
+              router_socket->send(first, ZMQ_SNDMORE);
+              forward(*worker_socket, *router_socket);
+            }
+          }
+        }
+
+        if (!idle_workers.empty() && (items[1].revents & ZMQ_POLLIN))
+        {
+          zmq::message_t worker(idle_workers.front().data(), idle_workers.front().size());
+          zmq::message_t delimiter;
+          worker_socket->send(worker, ZMQ_SNDMORE);
+          worker_socket->send(delimiter, ZMQ_SNDMORE);
+          forward(*router_socket, *worker_socket);
+          idle_workers.pop_front();
+        }
+      }
+    }
+    catch (const boost::thread_interrupted& e)
+    {
+      MDEBUG("ZMQ Server thread interrupted.");
+    }
+    catch (const zmq::error_t& e)
+    {
+      MERROR(std::string("ZMQ error: ") + e.what());
+    }
+    boost::this_thread::interruption_point();
+  }
+}
+
+void ZmqServer::serve_worker()
+{
+  static const char ready[] = "READY";
+
+  std::unique_ptr<zmq::socket_t> socket;
+  try
+  {
+    socket.reset(new zmq::socket_t(context, ZMQ_REQ));
+    socket->setsockopt(ZMQ_RCVTIMEO, DEFAULT_RPC_RECV_TIMEOUT_MS);
+    socket->connect(WORKERS_ADDRESS);
+    socket->send(ready, sizeof(ready) - 1);
+  }
+  catch (const zmq::error_t& e)
+  {
+    MERROR(std::string("Error creating ZMQ worker socket: ") + e.what());
+    return;
+  }
+
+  while (!stop_signal)
+  {
+    try
+    {
+      // the client's routing envelope, then the request
+      std::vector<zmq::message_t> frames;
+      frames.emplace_back();
+      while (!stop_signal && socket->recv(&frames.back()))
+      {
+        if (has_more(*socket))
+        {
+          frames.emplace_back();
+          continue;
+        }
+
+        const zmq::message_t& message = frames.back();
         std::string message_string(reinterpret_cast<const char *>(message.data()), message.size());
 
         MDEBUG(std::string("Received RPC request: \"") + message_string + "\"");
 
-        std::string response = handler.handle(message_string);
+        std::unique_ptr<std::string> response(new std::string(handler.handle(message_string)));
+
+        MDEBUG(std::string("Sending RPC reply: \"") + *response + "\"");
 
-        zmq::message_t reply(response.size());
-        memcpy((void *) reply.data(), response.c_str(), response.size());
+        // the reply takes ownership of the response buffer
+        zmq::message_t reply(&(*response)[0], response->size(), free_string, response.get());
+        response.release();
 
-        rep_socket->send(reply);
-        MDEBUG(std::string("Sent RPC reply: \"") + response + "\"");
+        // sending the reply also tells the broker this worker is idle again
+        for (size_t n = 0; n + 1 < frames.size(); ++n)
+          socket->send(frames[n], ZMQ_SNDMORE);
+        socket->send(reply);
 
+        frames.clear();
+        frames.emplace_back();
       }
     }
     catch (const boost::thread_interrupted& e)
     {
-      MDEBUG("ZMQ Server thread interrupted.");
+      MDEBUG("ZMQ Server worker thread interrupted.");
     }
     catch (const zmq::error_t& e)
     {
@@ -100,12 +225,13 @@ bool ZmqServer::addTCPSocket(std::string address, std::string port)
   {
     std::string addr_prefix("tcp://");
 
-    rep_socket.reset(new zmq::socket_t(context, ZMQ_REP));
-
-    rep_socket->setsockopt(ZMQ_RCVTIMEO, DEFAULT_RPC_RECV_TIMEOUT_MS);
+    router_socket.reset(new zmq::socket_t(context, ZMQ_ROUTER));
 
     std::string bind_address = addr_prefix + address + std::string(":") + port;
-    rep_socket->bind(bind_address.c_str());
+    router_socket->bind(bind_address.c_str());
+
+    worker_socket.reset(new zmq::socket_t(context, ZMQ_ROUTER));
+    worker_socket->bind(WORKERS_ADDRESS);
   }
   catch (const std::exception& e)
   {
@@ -118,6 +244,9 @@ bool ZmqServer::addTCPSocket(std::string address, std::string port)
 void ZmqServer::run()
 {
   running = true;
+  stop_signal = false;
+  for (unsigned i = 0; i < num_workers; ++i)
+    worker_threads.create_thread(boost::bind(&ZmqServer::serve_worker, this));
   run_thread = boost::thread(boost::bind(&ZmqServer::serve, this));
 }
 
@@ -130,6 +259,9 @@ void ZmqServer::stop()
   run_thread.interrupt();
   run_thread.join();
 
+  worker_threads.interrupt_all();
+  worker_threads.join_all();
+
   running = false;
 
   return;
@@ -37,6 +37,8 @@
 
 #include "rpc_handler.h"
 
+class zmq_server_test;
+
 namespace cryptonote
 {
 
@@ -44,13 +46,25 @@ namespace rpc
 {
 
 static constexpr int DEFAULT_NUM_ZMQ_THREADS = 1;
+static constexpr int DEFAULT_NUM_ZMQ_RPC_WORKERS = 4;
 static constexpr int DEFAULT_RPC_RECV_TIMEOUT_MS = 1000;
 
+/**
+ * @brief ZMQ RPC server
+ *
+ * Clients connect to a ROUTER socket. Requests are passed, with their
+ * routing envelope, to a set of worker threads through a second ROUTER
+ * socket. Each worker has its own REQ socket, announces itself as ready,
+ * then sends back each reply as its request for more work. Requests only
+ * go to idle workers, in the order they became idle, so a cheap request
+ * is never queued behind a slow one while another worker is free. The
+ * handler must be safe to call from several threads.
+ */
 class ZmqServer
 {
   public:
 
-    ZmqServer(RpcHandler& h);
+    ZmqServer(RpcHandler& h, unsigned num_workers = DEFAULT_NUM_ZMQ_RPC_WORKERS);
 
     ~ZmqServer();
 
@@ -65,16 +79,26 @@ class ZmqServer
     void stop();
 
   private:
+    friend class ::zmq_server_test;
+
+    void serve_worker();
+    static bool forward(zmq::socket_t& from, zmq::socket_t& to);
+    static bool has_more(zmq::socket_t& socket);
+
     RpcHandler& handler;
 
     volatile bool stop_signal;
     volatile bool running;
 
+    unsigned num_workers;
+
     zmq::context_t context;
 
     boost::thread run_thread;
+    boost::thread_group worker_threads;
 
-    std::unique_ptr<zmq::socket_t> rep_socket;
+    std::unique_ptr<zmq::socket_t> router_socket; //!< ROUTER socket the clients connect to
+    std::unique_ptr<zmq::socket_t> worker_socket; //!< ROUTER socket the workers connect to
 };
 
 
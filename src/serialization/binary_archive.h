@@ -34,11 +34,13 @@
 #pragma once
 
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <iterator>
 #include <boost/type_traits/make_unsigned.hpp>
 
 #include "common/varint.h"
+#include "span.h"
 #include "warnings.h"
 
 /* I have no clue what these lines means */
@@ -95,16 +97,69 @@ struct binary_archive;
 
 
 template <>
-struct binary_archive<false> : public binary_archive_base<std::istream, false>
+struct binary_archive<false>;
+
+/*! \class span_istream
+ *
+ * \brief reads from a span of bytes, without copying them
+ *
+ * \detailed Only has the part of the std::istream interface the
+ * serialization code uses (the state functions and peek), with the same
+ * semantics, so it can stand in for it. The archive reads the bytes
+ * directly, instead of through a stream buffer one virtual call at a time.
+ */
+class span_istream
 {
+public:
+  explicit span_istream(epee::span<const std::uint8_t> s) : pos_(s.data()), end_(s.data() + s.size()), state_(std::ios_base::goodbit) { }
+
+  bool good() const { return state_ == std::ios_base::goodbit; }
+  bool eof() const { return state_ & std::ios_base::eofbit; }
+  bool fail() const { return state_ & (std::ios_base::failbit | std::ios_base::badbit); }
+  std::ios_base::iostate rdstate() const { return state_; }
+  void setstate(std::ios_base::iostate state) { state_ |= state; }
+  void clear(std::ios_base::iostate state = std::ios_base::goodbit) { state_ = state; }
 
-  explicit binary_archive(stream_type &s) : base_type(s) {
-    stream_type::streampos pos = stream_.tellg();
-    stream_.seekg(0, std::ios_base::end);
-    eof_pos_ = stream_.tellg();
-    stream_.seekg(pos);
+  int peek()
+  {
+    if (!good())
+      return EOF;
+    if (pos_ == end_)
+    {
+      state_ |= std::ios_base::eofbit;
+      return EOF;
+    }
+    return *pos_;
   }
 
+  size_t remaining() const { return end_ - pos_; }
+
+private:
+  friend struct binary_archive<false>;
+
+  const std::uint8_t *pos_;
+  const std::uint8_t *end_;
+  std::ios_base::iostate state_;
+};
+
+template <>
+struct binary_archive<false>
+{
+  typedef span_istream stream_type;
+  typedef boost::mpl::bool_<false> is_saving;
+
+  typedef uint8_t variant_tag_type;
+
+  explicit binary_archive(epee::span<const std::uint8_t> s) : stream_(s), begin_(s.data()), canonical_(true) { }
+
+  /* definition of standard API functions */
+  void tag(const char *) { }
+  void begin_object() { }
+  void end_object() { }
+  void begin_variant() { }
+  void end_variant() { }
+  stream_type &stream() { return stream_; }
+
   template <class T>
   void serialize_int(T &v)
   {
@@ -118,22 +173,35 @@ struct binary_archive<false> : public binary_archive_base<std::istream, false>
   template <class T>
   void serialize_uint(T &v, size_t width = sizeof(T))
   {
+    if (!stream_.good() || stream_.remaining() < width)
+    {
+      stream_.pos_ = stream_.end_;
+      stream_.setstate(std::ios_base::eofbit | std::ios_base::failbit);
+      return;
+    }
     T ret = 0;
     unsigned shift = 0;
     for (size_t i = 0; i < width; i++) {
-      //std::cerr << "tell: " << stream_.tellg() << " value: " << ret << std::endl;
-      char c;
-      stream_.get(c);
-      T b = (unsigned char)c;
-      ret += (b << shift);	// can this be changed to OR, i think it can.
+      T b = stream_.pos_[i];
+      ret |= (b << shift);
       shift += 8;
     }
+    stream_.pos_ += width;
     v = ret;
   }
   
   void serialize_blob(void *buf, size_t len, const char *delimiter="")
   {
-    stream_.read((char *)buf, len);
+    if (!stream_.good())
+      return;
+    if (stream_.remaining() < len)
+    {
+      // like std::istream::read, keep what there was
+      len = stream_.remaining();
+      stream_.setstate(std::ios_base::eofbit | std::ios_base::failbit);
+    }
+    memcpy(buf, stream_.pos_, len);
+    stream_.pos_ += len;
   }
   
   template <class T>
@@ -145,8 +213,9 @@ struct binary_archive<false> : public binary_archive_base<std::istream, false>
   template <class T>
   void serialize_uvarint(T &v)
   {
-    typedef std::istreambuf_iterator<char> it;
-    tools::read_varint(it(stream_), it(), v); // XXX handle failure
+    const int read = tools::read_varint<std::numeric_limits<T>::digits>(stream_.pos_, stream_.end_, v); // XXX handle failure
+    if (read <= 0 || (stream_.pos_[-1] & 0x80))
+      canonical_ = false;
   }
 
   void begin_array(size_t &s)
@@ -168,12 +237,28 @@ struct binary_archive<false> : public binary_archive_base<std::istream, false>
   size_t remaining_bytes() {
     if (!stream_.good())
       return 0;
-    //std::cerr << "tell: " << stream_.tellg() << std::endl;
-    assert(stream_.tellg() <= eof_pos_);
-    return eof_pos_ - stream_.tellg();
+    return stream_.remaining();
   }
+
+  /*! \fn getpos
+   *
+   * \brief the number of bytes read so far
+   */
+  size_t getpos() const { return stream_.pos_ - begin_; }
+
+  /*! \fn is_canonical
+   *
+   * \brief whether every varint read so far was well formed
+   *
+   * \detailed Malformed varints are not treated as errors, but a blob with
+   * some does not serialize back to the same bytes, so its hashes are not
+   * those of the object read from it.
+   */
+  bool is_canonical() const { return canonical_; }
 protected:
-  std::streamoff eof_pos_;
+  stream_type stream_;
+  const std::uint8_t *begin_;
+  bool canonical_;
 };
 
 template <>
@@ -212,6 +297,9 @@ struct binary_archive<true> : public binary_archive_base<std::ostream, true>
     typedef std::ostreambuf_iterator<char> it;
     tools::write_varint(it(stream_), v);
   }
+
+  size_t getpos() { return stream_.tellp(); }
+
   void begin_array(size_t s)
   {
     serialize_varint(s);
@@ -83,6 +83,7 @@ struct json_archive_base
   void begin_variant() { begin_object(); }
   void end_variant() { end_object(); }
   Stream &stream() { return stream_; }
+  size_t getpos() { return stream_.tellp(); }
 
 protected:
   void make_indent()
@@ -58,6 +58,7 @@ using namespace epee;
 #include "common/i18n.h"
 #include "common/util.h"
 #include "common/apply_permutation.h"
+#include "common/int-util.h"
 #include "rapidjson/document.h"
 #include "rapidjson/writer.h"
 #include "rapidjson/stringbuffer.h"
@@ -105,6 +106,8 @@ using namespace cryptonote;
 
 #define MULTISIG_EXPORT_FILE_MAGIC "Monero multisig export\001"
 
+#define WALLET_CACHE_TRANSFERS_PER_CHUNK 1024
+
 namespace
 {
 // Create on-demand to prevent static initialization order fiasco issues.
@@ -133,6 +136,67 @@ void do_prepare_file_names(const std::string& file_path, std::string& keys_file,
   }
 }
 
+// a transfer_details without its tx prefix and multisig data, as stored in the cache
+#pragma pack(push, 1)
+struct cached_transfer
+{
+  enum
+  {
+    flag_spent = 1,
+    flag_rct = 2,
+    flag_key_image_known = 4,
+    flag_key_image_partial = 8,
+  };
+
+  uint64_t block_height;
+  crypto::hash txid;
+  uint64_t internal_output_index;
+  uint64_t global_output_index;
+  uint64_t spent_height;
+  crypto::key_image key_image;
+  rct::key mask;
+  uint64_t amount;
+  uint64_t pk_index;
+  uint32_t subaddr_major;
+  uint32_t subaddr_minor;
+  uint32_t prefix_index;  //!< index of the tx prefix in the matching tx prefixes chunk
+  uint8_t flags;
+};
+#pragma pack(pop)
+
+struct cached_multisig_transfer
+{
+  uint64_t index;  //!< index of the transfer in its chunk
+  std::vector<rct::key> multisig_k;
+  std::vector<tools::wallet2::multisig_info> multisig_info;
+
+  BEGIN_SERIALIZE_OBJECT()
+    VARINT_FIELD(index)
+    FIELD(multisig_k)
+    FIELD(multisig_info)
+  END_SERIALIZE()
+};
+
+struct cached_transfers_chunk
+{
+  std::string records;  //!< packed cached_transfer records
+  std::vector<cached_multisig_transfer> multisig;
+
+  BEGIN_SERIALIZE_OBJECT()
+    FIELD(records)
+    FIELD(multisig)
+  END_SERIALIZE()
+};
+
+struct cached_tx_prefixes_chunk
+{
+  std::vector<std::string> prefixes;
+
+  BEGIN_SERIALIZE_OBJECT()
+    FIELD(prefixes)
+  END_SERIALIZE()
+};
+
 uint64_t calculate_fee(uint64_t fee_per_kb, size_t bytes, uint64_t fee_multiplier)
 {
   uint64_t kB = (bytes + 1023) / 1024;
@@ -615,6 +679,7 @@ wallet2::wallet2(bool testnet, bool restricted):
   m_restricted(restricted),
   is_old_file_format(false),
   m_node_rpc_proxy(m_http_client, m_daemon_rpc_mutex),
+  m_pool_sequence(0),
   m_subaddress_lookahead_major(SUBADDRESS_LOOKAHEAD_MAJOR),
   m_subaddress_lookahead_minor(SUBADDRESS_LOOKAHEAD_MINOR),
   m_light_wallet(false),
@@ -694,6 +759,9 @@ bool wallet2::init(std::string daemon_address, boost::optional<epee::net_utils::
   m_upper_transaction_size_limit = upper_transaction_size_limit;
   m_daemon_address = std::move(daemon_address);
   m_daemon_login = std::move(daemon_login);
+  // pool sequence numbers are only meaningful to the daemon which gave them
+  m_pool_sequence = 0;
+  m_pool_hashes.clear();
   // When switching from light wallet to full wallet, we need to reset the height we got from lw node.
   if(m_light_wallet)
     m_local_bc_height = m_blockchain.size();
@@ -884,6 +952,7 @@ void wallet2::expand_subaddresses(const cryptonote::subaddress_index& index)
   if (m_subaddress_labels.size() <= index.major)
   {
     // add new accounts
+    m_subaddresses.reserve(m_subaddresses.size() + (index.major + m_subaddress_lookahead_major - m_subaddress_labels.size()) * m_subaddress_lookahead_minor + index.minor);
     cryptonote::subaddress_index index2;
     for (index2.major = m_subaddress_labels.size(); index2.major < index.major + m_subaddress_lookahead_major; ++index2.major)
     {
@@ -903,6 +972,7 @@ void wallet2::expand_subaddresses(const cryptonote::subaddress_index& index)
   else if (m_subaddress_labels[index.major].size() <= index.minor)
   {
     // add new subaddresses
+    m_subaddresses.reserve(m_subaddresses.size() + index.minor + m_subaddress_lookahead_minor - m_subaddress_labels[index.major].size());
     cryptonote::subaddress_index index2 = index;
     for (index2.minor = m_subaddress_labels[index.major].size(); index2.minor < index.minor + m_subaddress_lookahead_minor; ++index2.minor)
     {
@@ -984,6 +1054,146 @@ void wallet2::check_acc_out_precomp(const tx_out &o, const crypto::key_derivatio
   tx_scan_info.error = false;
 }
 //----------------------------------------------------------------------------------------------------
+void wallet2::check_acc_outs_precomp(const cryptonote::transaction &tx, size_t begin, size_t end, const crypto::key_derivation &derivation, const std::vector<crypto::key_derivation> &additional_derivations, std::vector<tx_scan_info_t> &tx_scan_info) const
+{
+  // the spend public keys the outputs would have been sent to, with the shared
+  // tx public key then the additional ones, all derived as a single batch
+  std::vector<crypto::public_key> out_keys;
+  std::vector<crypto::key_derivation> derivations;
+  std::vector<size_t> output_indices;
+  for (size_t i = begin; i < end; ++i)
+  {
+    if (tx.vout[i].target.type() != typeid(txout_to_key))
+      continue;
+    const crypto::public_key &out_key = boost::get<txout_to_key>(tx.vout[i].target).key;
+    out_keys.push_back(out_key);
+    derivations.push_back(derivation);
+    output_indices.push_back(i);
+    if (i < additional_derivations.size())
+    {
+      out_keys.push_back(out_key);
+      derivations.push_back(additional_derivations[i]);
+      output_indices.push_back(i);
+    }
+  }
+  std::vector<crypto::public_key> spend_keys(out_keys.size());
+  std::unique_ptr<bool[]> valid(new bool[out_keys.size()]);
+  crypto::derive_subaddress_public_keys(out_keys.data(), derivations.data(), output_indices.data(), out_keys.size(), spend_keys.data(), valid.get());
+
+  size_t n = 0;
+  for (size_t i = begin; i < end; ++i)
+  {
+    tx_scan_info_t &info = tx_scan_info[i];
+    if (tx.vout[i].target.type() != typeid(txout_to_key))
+    {
+      info.error = true;
+      LOG_ERROR("wrong type id in transaction out");
+      continue;
+    }
+    info.received = boost::none;
+    for (size_t k = 0; k < (i < additional_derivations.size() ? 2 : 1); ++k, ++n)
+    {
+      if (info.received || !valid[n])
+        continue;
+      auto found = m_subaddresses.find(spend_keys[n]);
+      if (found != m_subaddresses.end())
+        info.received = cryptonote::subaddress_receive_info{ found->second, derivations[n] };
+    }
+    if (!info.received && !additional_derivations.empty() && i >= additional_derivations.size())
+      LOG_ERROR("wrong number of additional derivations");
+    info.money_transfered = info.received ? tx.vout[i].amount : 0; // may be 0 for ringct outputs
+    info.error = false;
+  }
+}
+//----------------------------------------------------------------------------------------------------
+size_t wallet2::get_tx_pub_keys(const cryptonote::transaction& tx, tx_cache_data &tx_cache, std::vector<crypto::public_key> &tx_pub_keys) const
+{
+  // Extra may only be partially parsed, it's OK if tx_extra_fields contains public key
+  tx_cache.extra_parsed = parse_tx_extra(tx.extra, tx_cache.tx_extra_fields);
+
+  // Don't try to extract tx public key if tx has no ouputs
+  if (tx.vout.empty())
+    return 0;
+
+  const size_t first = tx_pub_keys.size();
+  tx_extra_pub_key pub_key_field;
+  for (size_t pk_index = 0; find_tx_extra_field_by_type(tx_cache.tx_extra_fields, pub_key_field, pk_index); ++pk_index)
+    tx_pub_keys.push_back(pub_key_field.pub_key);
+  const size_t num_primary = tx_pub_keys.size() - first;
+
+  // additional tx pubkeys and derivations for multi-destination transfers involving one or more subaddresses
+  tx_extra_additional_pub_keys additional_tx_pub_keys;
+  if (num_primary > 0 && find_tx_extra_field_by_type(tx_cache.tx_extra_fields, additional_tx_pub_keys))
+    tx_pub_keys.insert(tx_pub_keys.end(), additional_tx_pub_keys.data.begin(), additional_tx_pub_keys.data.end());
+  return num_primary;
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::set_tx_derivations(tx_cache_data &tx_cache, const crypto::public_key *tx_pub_keys, size_t count, size_t num_primary, const crypto::key_derivation *derivations, const bool *valid) const
+{
+  tx_cache.primary.clear();
+  tx_cache.additional_derivations.clear();
+  for (size_t i = 0; i < count; ++i)
+  {
+    crypto::key_derivation derivation = derivations[i];
+    if (!valid[i])
+    {
+      MWARNING("Failed to generate key derivation from tx pubkey, skipping");
+      if (i >= num_primary)
+        continue;
+      static_assert(sizeof(derivation) == sizeof(rct::key), "Mismatched sizes of key_derivation and rct::key");
+      memcpy(&derivation, rct::identity().bytes, sizeof(derivation));
+    }
+    if (i < num_primary)
+      tx_cache.primary.push_back({tx_pub_keys[i], derivation, {}});
+    else
+      tx_cache.additional_derivations.push_back(derivation);
+  }
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::cache_tx_data(const cryptonote::transaction& tx, bool miner_tx, tx_cache_data &tx_cache) const
+{
+  std::vector<crypto::public_key> tx_pub_keys;
+  const size_t num_primary = get_tx_pub_keys(tx, tx_cache, tx_pub_keys);
+
+  std::vector<crypto::key_derivation> derivations(tx_pub_keys.size());
+  std::unique_ptr<bool[]> valid(new bool[tx_pub_keys.size()]);
+  crypto::generate_key_derivations(tx_pub_keys.data(), tx_pub_keys.size(), m_account.get_keys().m_view_secret_key, derivations.data(), valid.get());
+  set_tx_derivations(tx_cache, tx_pub_keys.data(), tx_pub_keys.size(), num_primary, derivations.data(), valid.get());
+
+  scan_tx_outputs(tx, miner_tx, tx_cache);
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::scan_tx_outputs(const cryptonote::transaction& tx, bool miner_tx, tx_cache_data &tx_cache) const
+{
+  tx_cache.num_subaddresses = m_subaddresses.size();
+  for (is_out_data &out_data: tx_cache.primary)
+  {
+    out_data.scan_info.clear();
+    if (miner_tx && m_refresh_type == RefreshNoCoinbase)
+    {
+      // assume coinbase isn't for us
+      continue;
+    }
+    out_data.scan_info.resize(tx.vout.size());
+    if (miner_tx && m_refresh_type == RefreshOptimizeCoinbase)
+    {
+      // this assumes that the miner tx pays a single address, so the other outs
+      // are only checked if the first one is ours
+      check_acc_outs_precomp(tx, 0, 1, out_data.derivation, tx_cache.additional_derivations, out_data.scan_info);
+      if (!out_data.scan_info[0].received)
+      {
+        out_data.scan_info.resize(1);
+        continue;
+      }
+      check_acc_outs_precomp(tx, 1, tx.vout.size(), out_data.derivation, tx_cache.additional_derivations, out_data.scan_info);
+    }
+    else
+    {
+      check_acc_outs_precomp(tx, 0, tx.vout.size(), out_data.derivation, tx_cache.additional_derivations, out_data.scan_info);
+    }
+  }
+}
+//----------------------------------------------------------------------------------------------------
 static uint64_t decodeRct(const rct::rctSig & rv, const crypto::key_derivation &derivation, unsigned int i, rct::key & mask)
 {
   crypto::secret_key scalar1;
@@ -1037,7 +1247,7 @@ void wallet2::scan_output(const cryptonote::account_keys &keys, const cryptonote
   ++num_vouts_received;
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote::transaction& tx, const std::vector<uint64_t> &o_indices, uint64_t height, uint64_t ts, bool miner_tx, bool pool, bool double_spend_seen)
+void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote::transaction& tx, const std::vector<uint64_t> &o_indices, uint64_t height, uint64_t ts, bool miner_tx, bool pool, bool double_spend_seen, const tx_cache_data &tx_cache)
 {
   // In this function, tx (probably) only contains the base information
   // (that is, the prunable stuff may or may not be included)
@@ -1048,116 +1258,51 @@ void wallet2::process_new_transaction(const crypto::hash &txid, const cryptonote
   std::unordered_map<cryptonote::subaddress_index, uint64_t> tx_money_got_in_outs;  // per receiving subaddress index
   crypto::public_key tx_pub_key = null_pkey;
 
-  std::vector<tx_extra_field> tx_extra_fields;
-  if(!parse_tx_extra(tx.extra, tx_extra_fields))
+  const std::vector<tx_extra_field> &tx_extra_fields = tx_cache.tx_extra_fields;
+  if(!tx_cache.extra_parsed)
   {
     // Extra may only be partially parsed, it's OK if tx_extra_fields contains public key
     LOG_PRINT_L0("Transaction extra has unsupported format: " << txid);
   }
 
-  // Don't try to extract tx public key if tx has no ouputs
+  // outputs were checked ahead of time, check them again if an earlier
+  // transaction made us look out for more subaddresses since
+  const tx_cache_data *cache = &tx_cache;
+  tx_cache_data rescanned_cache;
+  if (tx_cache.num_subaddresses != m_subaddresses.size())
+  {
+    rescanned_cache = tx_cache;
+    scan_tx_outputs(tx, miner_tx, rescanned_cache);
+    cache = &rescanned_cache;
+  }
+
   size_t pk_index = 0;
   std::vector<tx_scan_info_t> tx_scan_info(tx.vout.size());
   while (!tx.vout.empty())
   {
     // if tx.vout is not empty, we loop through all tx pubkeys
 
-    tx_extra_pub_key pub_key_field;
-    if(!find_tx_extra_field_by_type(tx_extra_fields, pub_key_field, pk_index++))
+    if (pk_index >= cache->primary.size())
     {
-      if (pk_index > 1)
+      if (pk_index > 0)
         break;
       LOG_PRINT_L0("Public key wasn't found in the transaction extra. Skipping transaction " << txid);
       if(0 != m_callback)
 	m_callback->on_skip_transaction(height, txid, tx);
       break;
     }
+    const is_out_data &out_data = cache->primary[pk_index++];
 
     int num_vouts_received = 0;
-    tx_pub_key = pub_key_field.pub_key;
-    tools::threadpool& tpool = tools::threadpool::getInstance();
-    tools::threadpool::waiter waiter;
+    tx_pub_key = out_data.pkey;
     const cryptonote::account_keys& keys = m_account.get_keys();
-    crypto::key_derivation derivation;
-    if (!generate_key_derivation(tx_pub_key, keys.m_view_secret_key, derivation))
-    {
-      MWARNING("Failed to generate key derivation from tx pubkey, skipping");
-      static_assert(sizeof(derivation) == sizeof(rct::key), "Mismatched sizes of key_derivation and rct::key");
-      memcpy(&derivation, rct::identity().bytes, sizeof(derivation));
-    }
-
-    // additional tx pubkeys and derivations for multi-destination transfers involving one or more subaddresses
-    std::vector<crypto::public_key> additional_tx_pub_keys = get_additional_tx_pub_keys_from_extra(tx);
-    std::vector<crypto::key_derivation> additional_derivations;
-    for (size_t i = 0; i < additional_tx_pub_keys.size(); ++i)
+    for (size_t i = 0; i < out_data.scan_info.size(); ++i)
     {
-      additional_derivations.push_back({});
-      if (!generate_key_derivation(additional_tx_pub_keys[i], keys.m_view_secret_key, additional_derivations.back()))
+      tx_scan_info[i] = out_data.scan_info[i];
+      THROW_WALLET_EXCEPTION_IF(tx_scan_info[i].error, error::acc_outs_lookup_error, tx, tx_pub_key, m_account.get_keys());
+      if (tx_scan_info[i].received)
       {
-        MWARNING("Failed to generate key derivation from tx pubkey, skipping");
-        additional_derivations.pop_back();
-      }
-    }
-
-    if (miner_tx && m_refresh_type == RefreshNoCoinbase)
-    {
-      // assume coinbase isn't for us
-    }
-    else if (miner_tx && m_refresh_type == RefreshOptimizeCoinbase)
-    {
-      check_acc_out_precomp(tx.vout[0], derivation, additional_derivations, 0, tx_scan_info[0]);
-      THROW_WALLET_EXCEPTION_IF(tx_scan_info[0].error, error::acc_outs_lookup_error, tx, tx_pub_key, m_account.get_keys());
-
-      // this assumes that the miner tx pays a single address
-      if (tx_scan_info[0].received)
-      {
-        // process the other outs from that tx
-        // the first one was already checked
-        for (size_t i = 1; i < tx.vout.size(); ++i)
-        {
-          tpool.submit(&waiter, boost::bind(&wallet2::check_acc_out_precomp, this, std::cref(tx.vout[i]), std::cref(derivation), std::cref(additional_derivations), i,
-            std::ref(tx_scan_info[i])));
-        }
-        waiter.wait();
-
-        // then scan all outputs from 0
-        for (size_t i = 0; i < tx.vout.size(); ++i)
-        {
-          THROW_WALLET_EXCEPTION_IF(tx_scan_info[i].error, error::acc_outs_lookup_error, tx, tx_pub_key, m_account.get_keys());
-          if (tx_scan_info[i].received)
-          {
-            scan_output(keys, tx, tx_pub_key, i, tx_scan_info[i], num_vouts_received, tx_money_got_in_outs, outs);
-          }
-        }
-      }
-    }
-    else if (tx.vout.size() > 1 && tools::threadpool::getInstance().get_max_concurrency() > 1)
-    {
-      for (size_t i = 0; i < tx.vout.size(); ++i)
-      {
-        tpool.submit(&waiter, boost::bind(&wallet2::check_acc_out_precomp, this, std::cref(tx.vout[i]), std::cref(derivation), std::cref(additional_derivations), i,
-            std::ref(tx_scan_info[i])));
-      }
-      waiter.wait();
-      for (size_t i = 0; i < tx.vout.size(); ++i)
-      {
-        THROW_WALLET_EXCEPTION_IF(tx_scan_info[i].error, error::acc_outs_lookup_error, tx, tx_pub_key, m_account.get_keys());
-        if (tx_scan_info[i].received)
-        {
-          scan_output(keys, tx, tx_pub_key, i, tx_scan_info[i], num_vouts_received, tx_money_got_in_outs, outs);
-        }
-      }
-    }
-    else
-    {
-      for (size_t i = 0; i < tx.vout.size(); ++i)
-      {
-        check_acc_out_precomp(tx.vout[i], derivation, additional_derivations, i, tx_scan_info[i]);
-        THROW_WALLET_EXCEPTION_IF(tx_scan_info[i].error, error::acc_outs_lookup_error, tx, tx_pub_key, m_account.get_keys());
-        if (tx_scan_info[i].received)
-        {
-          scan_output(keys, tx, tx_pub_key, i, tx_scan_info[i], num_vouts_received, tx_money_got_in_outs, outs);
-        }
+        scan_output(keys, tx, tx_pub_key, i, tx_scan_info[i], num_vouts_received, tx_money_got_in_outs, outs);
       }
     }
 
@@ -1476,32 +1621,43 @@ void wallet2::process_outgoing(const crypto::hash &txid, const cryptonote::trans
   entry.first->second.m_unlock_time = tx.unlock_time;
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::process_new_blockchain_entry(const cryptonote::block& b, const cryptonote::block_complete_entry& bche, const crypto::hash& bl_id, uint64_t height, const cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices &o_indices)
+void wallet2::process_new_blockchain_entry(const parsed_block &pb, uint64_t height, const std::vector<tx_cache_data> &tx_cache)
 {
+  const cryptonote::block &b = pb.block;
+  const crypto::hash &bl_id = pb.hash;
   size_t txidx = 0;
-  THROW_WALLET_EXCEPTION_IF(bche.txs.size() + 1 != o_indices.indices.size(), error::wallet_internal_error,
-      "block transactions=" + std::to_string(bche.txs.size()) +
-      " not match with daemon response size=" + std::to_string(o_indices.indices.size()));
+  THROW_WALLET_EXCEPTION_IF(pb.txes.size() + 1 != pb.o_indices.indices.size(), error::wallet_internal_error,
+      "block transactions=" + std::to_string(pb.txes.size()) +
+      " not match with daemon response size=" + std::to_string(pb.o_indices.indices.size()));
 
   //handle transactions from new block
     
   //optimization: seeking only for blocks that are not older then the wallet creation time plus 1 day. 1 day is for possible user incorrect time setup
   if(b.timestamp + 60*60*24 > m_account.get_createtime() && height >= m_refresh_from_block_height)
   {
+    // the caller normally scans the block's transactions ahead of time, in parallel
+    std::vector<tx_cache_data> local_tx_cache;
+    const std::vector<tx_cache_data> *cache = &tx_cache;
+    if (tx_cache.size() != pb.txes.size() + 1)
+    {
+      local_tx_cache.resize(pb.txes.size() + 1);
+      cache_tx_data(b.miner_tx, true, local_tx_cache[0]);
+      for (size_t i = 0; i < pb.txes.size(); ++i)
+        cache_tx_data(pb.txes[i], false, local_tx_cache[i + 1]);
+      cache = &local_tx_cache;
+    }
+
     TIME_MEASURE_START(miner_tx_handle_time);
-    process_new_transaction(get_transaction_hash(b.miner_tx), b.miner_tx, o_indices.indices[txidx++].indices, height, b.timestamp, true, false, false);
+    process_new_transaction(get_transaction_hash(b.miner_tx), b.miner_tx, pb.o_indices.indices[txidx].indices, height, b.timestamp, true, false, false, (*cache)[txidx]);
+    ++txidx;
     TIME_MEASURE_FINISH(miner_tx_handle_time);
 
     TIME_MEASURE_START(txs_handle_time);
-    THROW_WALLET_EXCEPTION_IF(bche.txs.size() != b.tx_hashes.size(), error::wallet_internal_error, "Wrong amount of transactions for block");
-    size_t idx = 0;
-    for (const auto& txblob: bche.txs)
+    THROW_WALLET_EXCEPTION_IF(pb.txes.size() != b.tx_hashes.size(), error::wallet_internal_error, "Wrong amount of transactions for block");
+    for (size_t idx = 0; idx < pb.txes.size(); ++idx)
     {
-      cryptonote::transaction tx;
-      bool r = parse_and_validate_tx_base_from_blob(txblob, tx);
-      THROW_WALLET_EXCEPTION_IF(!r, error::tx_parse_error, txblob);
-      process_new_transaction(b.tx_hashes[idx], tx, o_indices.indices[txidx++].indices, height, b.timestamp, false, false, false);
-      ++idx;
+      process_new_transaction(b.tx_hashes[idx], pb.txes[idx], pb.o_indices.indices[txidx].indices, height, b.timestamp, false, false, false, (*cache)[txidx]);
+      ++txidx;
     }
     TIME_MEASURE_FINISH(txs_handle_time);
     LOG_PRINT_L2("Processed block: " << bl_id << ", height " << height << ", " <<  miner_tx_handle_time + txs_handle_time << "(" << miner_tx_handle_time << "/" << txs_handle_time <<")ms");
@@ -1549,11 +1705,44 @@ void wallet2::get_short_chain_history(std::list<crypto::hash>& ids) const
     ids.push_back(m_blockchain.genesis());
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::parse_block_round(const cryptonote::blobdata &blob, cryptonote::block &bl, crypto::hash &bl_id, bool &error) const
+void wallet2::parse_blocks(const std::list<cryptonote::block_complete_entry> &blocks, const std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, std::vector<parsed_block> &parsed_blocks) const
 {
-  error = !cryptonote::parse_and_validate_block_from_blob(blob, bl);
-  if (!error)
-    bl_id = get_block_hash(bl);
+  THROW_WALLET_EXCEPTION_IF(blocks.size() != o_indices.size(), error::wallet_internal_error, "size mismatch");
+
+  tools::threadpool& tpool = tools::threadpool::getInstance();
+  tools::threadpool::waiter waiter;
+  parsed_blocks.clear();
+  parsed_blocks.resize(blocks.size());
+  size_t i = 0;
+  for (const cryptonote::block_complete_entry &bche: blocks)
+  {
+    parsed_block &pb = parsed_blocks[i];
+    pb.o_indices = o_indices[i];
+    tpool.submit(&waiter, [&bche, &pb]() {
+      pb.error = !cryptonote::parse_and_validate_block_from_blob(bche.block, pb.block, pb.hash);
+      if (pb.error)
+        return;
+      pb.txes.resize(bche.txs.size());
+      size_t n = 0;
+      for (const cryptonote::blobdata &txblob: bche.txs)
+      {
+        if (!parse_and_validate_tx_base_from_blob(txblob, pb.txes[n++]))
+        {
+          pb.error = true;
+          return;
+        }
+      }
+    });
+    ++i;
+  }
+  waiter.wait();
+
+  i = 0;
+  for (const cryptonote::block_complete_entry &bche: blocks)
+  {
+    THROW_WALLET_EXCEPTION_IF(parsed_blocks[i].error, error::block_parse_error, bche.block);
+    ++i;
+  }
 }
 //----------------------------------------------------------------------------------------------------
 void wallet2::pull_blocks(uint64_t start_height, uint64_t &blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::list<cryptonote::block_complete_entry> &blocks, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices)
@@ -1624,85 +1813,83 @@ void wallet2::pull_hashes(uint64_t start_height, uint64_t &blocks_start_height,
   hashes = res.m_block_ids;
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::process_blocks(uint64_t start_height, const std::list<cryptonote::block_complete_entry> &blocks, const std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, uint64_t& blocks_added)
+void wallet2::process_parsed_blocks(uint64_t start_height, const std::vector<parsed_block> &blocks, uint64_t& blocks_added)
 {
   size_t current_index = start_height;
   blocks_added = 0;
-  size_t tx_o_indices_idx = 0;
 
-  THROW_WALLET_EXCEPTION_IF(blocks.size() != o_indices.size(), error::wallet_internal_error, "size mismatch");
   THROW_WALLET_EXCEPTION_IF(!m_blockchain.is_in_bounds(current_index), error::wallet_internal_error, "Index out of bounds of hashchain");
 
-  tools::threadpool& tpool = tools::threadpool::getInstance();
-  int threads = tpool.get_max_concurrency();
-  if (threads > 1)
-  {
-    std::vector<crypto::hash> round_block_hashes(threads);
-    std::vector<cryptonote::block> round_blocks(threads);
-    std::deque<bool> error(threads);
-    size_t blocks_size = blocks.size();
-    std::list<block_complete_entry>::const_iterator blocki = blocks.begin();
-    for (size_t b = 0; b < blocks_size; b += threads)
-    {
-      size_t round_size = std::min((size_t)threads, blocks_size - b);
-      tools::threadpool::waiter waiter;
-
-      std::list<block_complete_entry>::const_iterator tmpblocki = blocki;
-      for (size_t i = 0; i < round_size; ++i)
-      {
-        tpool.submit(&waiter, boost::bind(&wallet2::parse_block_round, this, std::cref(tmpblocki->block),
-          std::ref(round_blocks[i]), std::ref(round_block_hashes[i]), std::ref(error[i])));
-        ++tmpblocki;
-      }
-      waiter.wait();
-      tmpblocki = blocki;
-      for (size_t i = 0; i < round_size; ++i)
-      {
-        THROW_WALLET_EXCEPTION_IF(error[i], error::block_parse_error, tmpblocki->block);
-        ++tmpblocki;
-      }
-      for (size_t i = 0; i < round_size; ++i)
-      {
-        const crypto::hash &bl_id = round_block_hashes[i];
-        cryptonote::block &bl = round_blocks[i];
+  // Scan the outputs of all the transactions we are going to process at once, across
+  // the thread pool. The key derivations for the whole batch are computed in one
+  // contiguous slice per thread, so their conversion to bytes is batched too. The
+  // results are then applied block by block, in order.
+  struct tx_to_scan
+  {
+    const cryptonote::transaction *tx;
+    bool miner_tx;
+    tx_cache_data *tx_cache;
+    size_t num_primary;
+    std::vector<crypto::public_key> tx_pub_keys;
+  };
+  std::vector<std::vector<tx_cache_data>> tx_cache(blocks.size());
+  std::vector<tx_to_scan> txes;
+  bool new_blocks = false;
+  for (size_t i = 0; i < blocks.size(); ++i)
+  {
+    const parsed_block &pb = blocks[i];
+    const uint64_t height = start_height + i;
+    // once a block is new, or a split is found, all the following blocks are new too
+    new_blocks = new_blocks || height >= m_blockchain.size() || pb.hash != m_blockchain[height];
+    if (!new_blocks || pb.block.timestamp + 60*60*24 <= m_account.get_createtime() || height < m_refresh_from_block_height)
+      continue;
+    tx_cache[i].resize(pb.txes.size() + 1);
+    txes.push_back({&pb.block.miner_tx, true, &tx_cache[i][0], 0, {}});
+    for (size_t n = 0; n < pb.txes.size(); ++n)
+      txes.push_back({&pb.txes[n], false, &tx_cache[i][n + 1], 0, {}});
+  }
 
-        if(current_index >= m_blockchain.size())
-        {
-          process_new_blockchain_entry(bl, *blocki, bl_id, current_index, o_indices[b+i]);
-          ++blocks_added;
-        }
-        else if(bl_id != m_blockchain[current_index])
-        {
-          //split detected here !!!
-          THROW_WALLET_EXCEPTION_IF(current_index == start_height, error::wallet_internal_error,
-            "wrong daemon response: split starts from the first block in response " + string_tools::pod_to_hex(bl_id) +
-            " (height " + std::to_string(start_height) + "), local block id at this height: " +
-            string_tools::pod_to_hex(m_blockchain[current_index]));
-
-          detach_blockchain(current_index);
-          process_new_blockchain_entry(bl, *blocki, bl_id, current_index, o_indices[b+i]);
-        }
-        else
-        {
-          LOG_PRINT_L2("Block is already in blockchain: " << string_tools::pod_to_hex(bl_id));
-        }
-        ++current_index;
-        ++blocki;
-      }
-    }
+  tools::threadpool& tpool = tools::threadpool::getInstance();
+  tools::threadpool::waiter waiter;
+  for (tx_to_scan &t: txes)
+    tpool.submit(&waiter, [this, &t]() { t.num_primary = get_tx_pub_keys(*t.tx, *t.tx_cache, t.tx_pub_keys); });
+  waiter.wait();
+
+  std::vector<crypto::public_key> tx_pub_keys;
+  for (const tx_to_scan &t: txes)
+    tx_pub_keys.insert(tx_pub_keys.end(), t.tx_pub_keys.begin(), t.tx_pub_keys.end());
+  std::vector<crypto::key_derivation> derivations(tx_pub_keys.size());
+  std::unique_ptr<bool[]> valid(new bool[tx_pub_keys.size()]);
+  const size_t threads = std::max(1, tpool.get_max_concurrency());
+  const size_t slice_size = (tx_pub_keys.size() + threads - 1) / threads;
+  for (size_t start = 0; start < tx_pub_keys.size(); start += slice_size)
+  {
+    const size_t count = std::min(slice_size, tx_pub_keys.size() - start);
+    tpool.submit(&waiter, [this, &tx_pub_keys, &derivations, &valid, start, count]() {
+      crypto::generate_key_derivations(tx_pub_keys.data() + start, count, m_account.get_keys().m_view_secret_key, derivations.data() + start, valid.get() + start);
+    });
   }
-  else
+  waiter.wait();
+
+  size_t offset = 0;
+  for (tx_to_scan &t: txes)
   {
-  for(auto& bl_entry: blocks)
+    tpool.submit(&waiter, [this, &t, &derivations, &valid, offset]() {
+      set_tx_derivations(*t.tx_cache, t.tx_pub_keys.data(), t.tx_pub_keys.size(), t.num_primary, derivations.data() + offset, valid.get() + offset);
+      scan_tx_outputs(*t.tx, t.miner_tx, *t.tx_cache);
+    });
+    offset += t.tx_pub_keys.size();
+  }
+  waiter.wait();
+
+  for (size_t i = 0; i < blocks.size(); ++i)
   {
-    cryptonote::block bl;
-    bool r = cryptonote::parse_and_validate_block_from_blob(bl_entry.block, bl);
-    THROW_WALLET_EXCEPTION_IF(!r, error::block_parse_error, bl_entry.block);
+    const parsed_block &pb = blocks[i];
+    const crypto::hash &bl_id = pb.hash;
 
-    crypto::hash bl_id = get_block_hash(bl);
     if(current_index >= m_blockchain.size())
     {
-      process_new_blockchain_entry(bl, bl_entry, bl_id, current_index, o_indices[tx_o_indices_idx]);
+      process_new_blockchain_entry(pb, current_index, tx_cache[i]);
       ++blocks_added;
     }
     else if(bl_id != m_blockchain[current_index])
@@ -1714,16 +1901,13 @@ void wallet2::process_blocks(uint64_t start_height, const std::list<cryptonote::
         string_tools::pod_to_hex(m_blockchain[current_index]));
 
       detach_blockchain(current_index);
-      process_new_blockchain_entry(bl, bl_entry, bl_id, current_index, o_indices[tx_o_indices_idx]);
+      process_new_blockchain_entry(pb, current_index, tx_cache[i]);
     }
     else
     {
       LOG_PRINT_L2("Block is already in blockchain: " << string_tools::pod_to_hex(bl_id));
     }
-
     ++current_index;
-    ++tx_o_indices_idx;
-  }
   }
 }
 //----------------------------------------------------------------------------------------------------
@@ -1739,7 +1923,7 @@ void wallet2::refresh(uint64_t start_height, uint64_t & blocks_fetched)
   refresh(start_height, blocks_fetched, received_money);
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::pull_next_blocks(uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::list<cryptonote::block_complete_entry> &prev_blocks, std::list<cryptonote::block_complete_entry> &blocks, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, bool &error)
+void wallet2::pull_next_blocks(uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::vector<parsed_block> &prev_blocks, std::vector<parsed_block> &blocks, bool &error)
 {
   error = false;
 
@@ -1748,41 +1932,33 @@ void wallet2::pull_next_blocks(uint64_t start_height, uint64_t &blocks_start_hei
     drop_from_short_history(short_chain_history, 3);
 
     // prepend the last 3 blocks, should be enough to guard against a block or two's reorg
-    cryptonote::block bl;
-    std::list<cryptonote::block_complete_entry>::const_reverse_iterator i = prev_blocks.rbegin();
+    std::vector<parsed_block>::const_reverse_iterator i = prev_blocks.rbegin();
     for (size_t n = 0; n < std::min((size_t)3, prev_blocks.size()); ++n)
     {
-      bool ok = cryptonote::parse_and_validate_block_from_blob(i->block, bl);
-      THROW_WALLET_EXCEPTION_IF(!ok, error::block_parse_error, i->block);
-      short_chain_history.push_front(cryptonote::get_block_hash(bl));
+      short_chain_history.push_front(i->hash);
       ++i;
     }
 
-    // pull the new blocks
-    pull_blocks(start_height, blocks_start_height, short_chain_history, blocks, o_indices);
+    // pull the new blocks, and parse them while the previous ones are being processed
+    std::list<cryptonote::block_complete_entry> new_blocks;
+    std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> o_indices;
+    pull_blocks(start_height, blocks_start_height, short_chain_history, new_blocks, o_indices);
+    parse_blocks(new_blocks, o_indices, blocks);
   }
   catch(...)
   {
     error = true;
   }
 }
-
-void wallet2::remove_obsolete_pool_txs(const std::vector<crypto::hash> &tx_hashes)
+//----------------------------------------------------------------------------------------------------
+void wallet2::remove_obsolete_pool_txs(const std::unordered_set<crypto::hash> &tx_hashes)
 {
   // remove pool txes to us that aren't in the pool anymore
   std::unordered_multimap<crypto::hash, wallet2::pool_payment_details>::iterator uit = m_unconfirmed_payments.begin();
   while (uit != m_unconfirmed_payments.end())
   {
     const crypto::hash &txid = uit->second.m_pd.m_tx_hash;
-    bool found = false;
-    for (const auto &it2: tx_hashes)
-    {
-      if (it2 == txid)
-      {
-        found = true;
-        break;
-      }
-    }
+    bool found = tx_hashes.find(txid) != tx_hashes.end();
     auto pit = uit++;
     if (!found)
     {
@@ -1799,31 +1975,46 @@ void wallet2::update_pool_state(bool refreshed)
 {
   MDEBUG("update_pool_state start");
 
-  // get the pool state
-  cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_HASHES::request req;
-  cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_HASHES::response res;
+  // get the pool state, only what changed since last time if the daemon can tell
+  cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES::request creq;
+  cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_CHANGES::response cres;
+  creq.since = m_pool_sequence;
   m_daemon_rpc_mutex.lock();
-  bool r = epee::net_utils::invoke_http_json("/get_transaction_pool_hashes.bin", req, res, m_http_client, rpc_timeout);
+  bool r = epee::net_utils::invoke_http_bin("/get_transaction_pool_changes.bin", creq, cres, m_http_client, rpc_timeout);
   m_daemon_rpc_mutex.unlock();
-  THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "get_transaction_pool_hashes.bin");
-  THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_transaction_pool_hashes.bin");
-  THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::get_tx_pool_error);
-  MDEBUG("update_pool_state got pool");
+  if (r && cres.status == CORE_RPC_STATUS_OK)
+  {
+    if (cres.full)
+      m_pool_hashes.clear();
+    for (const auto &txid: cres.removed)
+      m_pool_hashes.erase(txid);
+    m_pool_hashes.insert(cres.added.begin(), cres.added.end());
+    m_pool_sequence = cres.sequence;
+    MDEBUG("update_pool_state got pool changes: " << cres.added.size() << " added, " << cres.removed.size() << " removed" << (cres.full ? " (full)" : ""));
+  }
+  else
+  {
+    // older daemon, get the whole pool
+    cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_HASHES::request req;
+    cryptonote::COMMAND_RPC_GET_TRANSACTION_POOL_HASHES::response res;
+    m_daemon_rpc_mutex.lock();
+    r = epee::net_utils::invoke_http_json("/get_transaction_pool_hashes.bin", req, res, m_http_client, rpc_timeout);
+    m_daemon_rpc_mutex.unlock();
+    THROW_WALLET_EXCEPTION_IF(!r, error::no_connection_to_daemon, "get_transaction_pool_hashes.bin");
+    THROW_WALLET_EXCEPTION_IF(res.status == CORE_RPC_STATUS_BUSY, error::daemon_busy, "get_transaction_pool_hashes.bin");
+    THROW_WALLET_EXCEPTION_IF(res.status != CORE_RPC_STATUS_OK, error::get_tx_pool_error);
+    m_pool_hashes.clear();
+    m_pool_hashes.insert(res.tx_hashes.begin(), res.tx_hashes.end());
+    m_pool_sequence = 0;
+    MDEBUG("update_pool_state got pool");
+  }
 
   // remove any pending tx that's not in the pool
   std::unordered_map<crypto::hash, wallet2::unconfirmed_transfer_details>::iterator it = m_unconfirmed_txs.begin();
   while (it != m_unconfirmed_txs.end())
   {
     const crypto::hash &txid = it->first;
-    bool found = false;
-    for (const auto &it2: res.tx_hashes)
-    {
-      if (it2 == txid)
-      {
-        found = true;
-        break;
-      }
-    }
+    bool found = m_pool_hashes.find(txid) != m_pool_hashes.end();
     auto pit = it++;
     if (!found)
     {
@@ -1871,23 +2062,19 @@ void wallet2::update_pool_state(bool refreshed)
   // the in transfers list instead (or nowhere if it just
   // disappeared without being mined)
   if (refreshed)
-    remove_obsolete_pool_txs(res.tx_hashes);
+    remove_obsolete_pool_txs(m_pool_hashes);
 
   MDEBUG("update_pool_state done second loop");
 
+  std::unordered_set<crypto::hash> unconfirmed_payments_txids;
+  for (const auto &up: m_unconfirmed_payments)
+    unconfirmed_payments_txids.insert(up.second.m_pd.m_tx_hash);
+
   // gather txids of new pool txes to us
   std::vector<std::pair<crypto::hash, bool>> txids;
-  for (const auto &txid: res.tx_hashes)
+  for (const auto &txid: m_pool_hashes)
   {
-    bool txid_found_in_up = false;
-    for (const auto &up: m_unconfirmed_payments)
-    {
-      if (up.second.m_pd.m_tx_hash == txid)
-      {
-        txid_found_in_up = true;
-        break;
-      }
-    }
+    bool txid_found_in_up = unconfirmed_payments_txids.find(txid) != unconfirmed_payments_txids.end();
     if (m_scanned_pool_txs[0].find(txid) != m_scanned_pool_txs[0].end() || m_scanned_pool_txs[1].find(txid) != m_scanned_pool_txs[1].end())
     {
       // if it's for us, we want to keep track of whether we saw a double spend, so don't bail out
@@ -1901,24 +2088,21 @@ void wallet2::update_pool_state(bool refreshed)
     {
       LOG_PRINT_L1("Found new pool tx: " << txid);
       bool found = false;
-      for (const auto &i: m_unconfirmed_txs)
+      const auto i = m_unconfirmed_txs.find(txid);
+      if (i != m_unconfirmed_txs.end())
       {
-        if (i.first == txid)
+        found = true;
+        // if this is a payment to yourself at a different subaddress account, don't skip it
+        // so that you can see the incoming pool tx with 'show_transfers' on that receiving subaddress account
+        const unconfirmed_transfer_details& utd = i->second;
+        for (const auto& dst : utd.m_dests)
         {
-          found = true;
-          // if this is a payment to yourself at a different subaddress account, don't skip it
-          // so that you can see the incoming pool tx with 'show_transfers' on that receiving subaddress account
-          const unconfirmed_transfer_details& utd = i.second;
-          for (const auto& dst : utd.m_dests)
+          auto subaddr_index = m_subaddresses.find(dst.addr.m_spend_public_key);
+          if (subaddr_index != m_subaddresses.end() && subaddr_index->second.major != utd.m_subaddr_account)
           {
-            auto subaddr_index = m_subaddresses.find(dst.addr.m_spend_public_key);
-            if (subaddr_index != m_subaddresses.end() && subaddr_index->second.major != utd.m_subaddr_account)
-            {
-              found = false;
-              break;
-            }
+            found = false;
+            break;
           }
-          break;
         }
       }
       if (!found)
@@ -1970,7 +2154,9 @@ void wallet2::update_pool_state(bool refreshed)
                     [tx_hash](const std::pair<crypto::hash, bool> &e) { return e.first == tx_hash; });
                 if (i != txids.end())
                 {
-                  process_new_transaction(tx_hash, tx, std::vector<uint64_t>(), 0, time(NULL), false, true, tx_entry.double_spend_seen);
+                  tx_cache_data tx_cache;
+                  cache_tx_data(tx, false, tx_cache);
+                  process_new_transaction(tx_hash, tx, std::vector<uint64_t>(), 0, time(NULL), false, true, tx_entry.double_spend_seen, tx_cache);
                   m_scanned_pool_txs[0].insert(tx_hash);
                   if (m_scanned_pool_txs[0].size() > 5000)
                   {
@@ -2142,8 +2328,7 @@ void wallet2::refresh(uint64_t start_height, uint64_t & blocks_fetched, bool& re
   tools::threadpool& tpool = tools::threadpool::getInstance();
   tools::threadpool::waiter waiter;
   uint64_t blocks_start_height;
-  std::list<cryptonote::block_complete_entry> blocks;
-  std::vector<COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> o_indices;
+  std::vector<parsed_block> parsed_blocks;
   bool refreshed = false;
 
   // pull the first set of blocks
@@ -2164,7 +2349,12 @@ void wallet2::refresh(uint64_t start_height, uint64_t & blocks_fetched, bool& re
   // If stop() is called during fast refresh we don't need to continue
   if(!m_run.load(std::memory_order_relaxed))
     return;
-  pull_blocks(start_height, blocks_start_height, short_chain_history, blocks, o_indices);
+  {
+    std::list<cryptonote::block_complete_entry> blocks;
+    std::vector<COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> o_indices;
+    pull_blocks(start_height, blocks_start_height, short_chain_history, blocks, o_indices);
+    parse_blocks(blocks, o_indices, parsed_blocks);
+  }
   // always reset start_height to 0 to force short_chain_ history to be used on
   // subsequent pulls in this refresh.
   start_height = 0;
@@ -2173,14 +2363,13 @@ void wallet2::refresh(uint64_t start_height, uint64_t & blocks_fetched, bool& re
   {
     try
     {
-      // pull the next set of blocks while we're processing the current one
+      // pull and parse the next set of blocks while we're processing the current one
       uint64_t next_blocks_start_height;
-      std::list<cryptonote::block_complete_entry> next_blocks;
-      std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> next_o_indices;
+      std::vector<parsed_block> next_parsed_blocks;
       bool error = false;
-      tpool.submit(&waiter, [&]{pull_next_blocks(start_height, next_blocks_start_height, short_chain_history, blocks, next_blocks, next_o_indices, error);});
+      tpool.submit(&waiter, [&]{pull_next_blocks(start_height, next_blocks_start_height, short_chain_history, parsed_blocks, next_parsed_blocks, error);});
 
-      process_blocks(blocks_start_height, blocks, o_indices, added_blocks);
+      process_parsed_blocks(blocks_start_height, parsed_blocks, added_blocks);
       blocks_fetched += added_blocks;
       waiter.wait();
       if(blocks_start_height == next_blocks_start_height)
@@ -2192,8 +2381,7 @@ void wallet2::refresh(uint64_t start_height, uint64_t & blocks_fetched, bool& re
 
       // switch to the new blocks from the daemon
       blocks_start_height = next_blocks_start_height;
-      blocks = next_blocks;
-      o_indices = next_o_indices;
+      parsed_blocks = std::move(next_parsed_blocks);
 
       // handle error from async fetching thread
       if (error)
@@ -2333,6 +2521,8 @@ bool wallet2::clear()
   m_unconfirmed_payments.clear();
   m_scanned_pool_txs[0].clear();
   m_scanned_pool_txs[1].clear();
+  m_pool_sequence = 0;
+  m_pool_hashes.clear();
   m_address_book.clear();
   m_local_bc_height = 1;
   m_subaddresses.clear();
@@ -3478,6 +3668,7 @@ bool wallet2::generate_chacha_key_from_secret_keys(crypto::chacha_key &key) cons
 void wallet2::load(const std::string& wallet_, const epee::wipeable_string& password)
 {
   clear();
+  m_cache = wallet_cache();
   prepare_file_names(wallet_);
 
   boost::system::error_code e;
@@ -3492,11 +3683,17 @@ void wallet2::load(const std::string& wallet_, const epee::wipeable_string& pass
 
   //keys loaded ok!
   //try to load wallet file. but even if we failed, it is not big problem
+  crypto::chacha_key key;
+  generate_chacha_key_from_secret_keys(key);
   if(!boost::filesystem::exists(m_wallet_file, e) || e)
   {
     LOG_PRINT_L0("file not found: " << m_wallet_file << ", starting with empty blockchain");
     m_account_public_address = m_account.get_keys().m_account_address;
   }
+  else if (load_cache(m_wallet_file, key))
+  {
+    LOG_PRINT_L1("Loaded chunked cache");
+  }
   else
   {
     wallet2::cache_file_data cache_file_data;
@@ -3511,8 +3708,6 @@ void wallet2::load(const std::string& wallet_, const epee::wipeable_string& pass
 
       r = ::serialization::parse_binary(buf, cache_file_data);
       THROW_WALLET_EXCEPTION_IF(!r, error::wallet_internal_error, "internal error: failed to deserialize \"" + m_wallet_file + '\"');
-      crypto::chacha_key key;
-      generate_chacha_key_from_secret_keys(key);
       std::string cache_data;
       cache_data.resize(cache_file_data.cache_data.size());
       crypto::chacha20(cache_file_data.cache_data.data(), cache_file_data.cache_data.size(), key, cache_file_data.iv, &cache_data[0]);
@@ -3565,11 +3760,11 @@ void wallet2::load(const std::string& wallet_, const epee::wipeable_string& pass
         ar >> *this;
       }
     }
-    THROW_WALLET_EXCEPTION_IF(
-      m_account_public_address.m_spend_public_key != m_account.get_keys().m_account_address.m_spend_public_key ||
-      m_account_public_address.m_view_public_key  != m_account.get_keys().m_account_address.m_view_public_key,
-      error::wallet_files_doesnt_correspond, m_keys_file, m_wallet_file);
   }
+  THROW_WALLET_EXCEPTION_IF(
+    m_account_public_address.m_spend_public_key != m_account.get_keys().m_account_address.m_spend_public_key ||
+    m_account_public_address.m_view_public_key  != m_account.get_keys().m_account_address.m_view_public_key,
+    error::wallet_files_doesnt_correspond, m_keys_file, m_wallet_file);
 
   cryptonote::block genesis;
   generate_genesis(genesis);
@@ -3646,10 +3841,9 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
 {
   trim_hashchain();
 
-  // if file is the same, we do:
-  // 1. save wallet to the *.new file
-  // 2. remove old wallet file
-  // 3. rename *.new to wallet_name
+  // if file is the same, only the cache chunks which changed are appended to it,
+  // otherwise the cache, keys and address files are written to the new path and
+  // the old ones removed
 
   // handle if we want just store wallet state to current files (ex store() replacement);
   bool same_file = true;
@@ -3676,22 +3870,9 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
       }
     }
   }
-  // preparing wallet data
-  std::stringstream oss;
-  boost::archive::portable_binary_oarchive ar(oss);
-  ar << *this;
-
-  wallet2::cache_file_data cache_file_data = boost::value_initialized<wallet2::cache_file_data>();
-  cache_file_data.cache_data = oss.str();
   crypto::chacha_key key;
   generate_chacha_key_from_secret_keys(key);
-  std::string cipher;
-  cipher.resize(cache_file_data.cache_data.size());
-  cache_file_data.iv = crypto::rand<crypto::chacha_iv>();
-  crypto::chacha20(cache_file_data.cache_data.data(), cache_file_data.cache_data.size(), key, cache_file_data.iv, &cipher[0]);
-  cache_file_data.cache_data = cipher;
 
-  const std::string new_file = same_file ? m_wallet_file + ".new" : path;
   const std::string old_file = m_wallet_file;
   const std::string old_keys_file = m_keys_file;
   const std::string old_address_file = m_wallet_file + ".address.txt";
@@ -3700,6 +3881,7 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
   // if we here, main wallet file is saved and we only need to save keys and address files
   if (!same_file) {
     prepare_file_names(path);
+    store_cache(m_wallet_file, key);
     bool r = store_keys(m_keys_file, password, false);
     THROW_WALLET_EXCEPTION_IF(!r, error::file_save_error, m_keys_file);
     // save address to the new file
@@ -3722,18 +3904,160 @@ void wallet2::store_to(const std::string &path, const epee::wipeable_string &pas
       LOG_ERROR("error removing file: " << old_address_file);
     }
   } else {
-    // save to new file
-    std::ofstream ostr;
-    ostr.open(new_file, std::ios_base::binary | std::ios_base::out | std::ios_base::trunc);
-    binary_archive<true> oar(ostr);
-    bool success = ::serialization::serialize(oar, cache_file_data);
-    ostr.close();
-    THROW_WALLET_EXCEPTION_IF(!success || !ostr.good(), error::file_save_error, new_file);
+    // only the chunks which changed since the last store are written
+    store_cache(m_wallet_file, key);
+  }
+}
+//----------------------------------------------------------------------------------------------------
+void wallet2::store_cache(const std::string& path, const crypto::chacha_key &key)
+{
+  std::vector<std::vector<std::string>> sections(wallet_cache::num_sections);
+
+  // everything but the transfers is serialized as before, in a single chunk
+  {
+    transfer_container transfers;
+    std::swap(transfers, m_transfers);
+    auto restore_transfers = epee::misc_utils::create_scope_leave_handler([&](){ std::swap(transfers, m_transfers); });
+    std::stringstream oss;
+    boost::archive::portable_binary_oarchive ar(oss);
+    ar << *this;
+    sections[wallet_cache::section_state].push_back(oss.str());
+  }
+
+  // transfers go in fixed size chunks, so new transfers only change the last one, and
+  // each chunk comes with the prefixes of its transactions, once per transaction
+  for (size_t begin = 0; begin < m_transfers.size(); begin += WALLET_CACHE_TRANSFERS_PER_CHUNK)
+  {
+    const size_t end = std::min<size_t>(begin + WALLET_CACHE_TRANSFERS_PER_CHUNK, m_transfers.size());
+    cached_transfers_chunk chunk;
+    cached_tx_prefixes_chunk prefixes;
+    std::unordered_map<crypto::hash, uint32_t> prefix_indices;
+    chunk.records.resize((end - begin) * sizeof(cached_transfer));
+    for (size_t i = begin; i < end; ++i)
+    {
+      const transfer_details &td = m_transfers[i];
+
+      // light wallet transfers may have different prefixes for the same txid
+      const cryptonote::blobdata prefix = cryptonote::t_serializable_object_to_blob(td.m_tx);
+      const auto it = prefix_indices.find(td.m_txid);
+      uint32_t prefix_index;
+      if (it != prefix_indices.end() && prefixes.prefixes[it->second] == prefix)
+      {
+        prefix_index = it->second;
+      }
+      else
+      {
+        prefix_index = prefixes.prefixes.size();
+        prefix_indices[td.m_txid] = prefix_index;
+        prefixes.prefixes.push_back(prefix);
+      }
 
-    // here we have "*.new" file, we need to rename it to be without ".new"
-    std::error_code e = tools::replace_file(new_file, m_wallet_file);
-    THROW_WALLET_EXCEPTION_IF(e, error::file_save_error, m_wallet_file, e);
+      cached_transfer ct;
+      ct.block_height = SWAP64LE(td.m_block_height);
+      ct.txid = td.m_txid;
+      ct.internal_output_index = SWAP64LE((uint64_t)td.m_internal_output_index);
+      ct.global_output_index = SWAP64LE(td.m_global_output_index);
+      ct.spent_height = SWAP64LE(td.m_spent_height);
+      ct.key_image = td.m_key_image;
+      ct.mask = td.m_mask;
+      ct.amount = SWAP64LE(td.m_amount);
+      ct.pk_index = SWAP64LE((uint64_t)td.m_pk_index);
+      ct.subaddr_major = SWAP32LE(td.m_subaddr_index.major);
+      ct.subaddr_minor = SWAP32LE(td.m_subaddr_index.minor);
+      ct.prefix_index = SWAP32LE(prefix_index);
+      ct.flags = (td.m_spent ? cached_transfer::flag_spent : 0) | (td.m_rct ? cached_transfer::flag_rct : 0) |
+          (td.m_key_image_known ? cached_transfer::flag_key_image_known : 0) | (td.m_key_image_partial ? cached_transfer::flag_key_image_partial : 0);
+      memcpy(&chunk.records[(i - begin) * sizeof(ct)], &ct, sizeof(ct));
+
+      if (!td.m_multisig_k.empty() || !td.m_multisig_info.empty())
+        chunk.multisig.push_back({i - begin, td.m_multisig_k, td.m_multisig_info});
+    }
+
+    std::string blob;
+    THROW_WALLET_EXCEPTION_IF(!::serialization::dump_binary(chunk, blob), error::wallet_internal_error, "Failed to serialize transfers");
+    sections[wallet_cache::section_transfers].push_back(std::move(blob));
+    THROW_WALLET_EXCEPTION_IF(!::serialization::dump_binary(prefixes, blob), error::wallet_internal_error, "Failed to serialize transaction prefixes");
+    sections[wallet_cache::section_tx_prefixes].push_back(std::move(blob));
+  }
+
+  const uint64_t written = m_cache.store(path, key, sections);
+  LOG_PRINT_L1("Stored wallet cache " << path << ", " << written << " bytes written");
+}
+//----------------------------------------------------------------------------------------------------
+bool wallet2::load_cache(const std::string& path, const crypto::chacha_key &key)
+{
+  if (!m_cache.load_index(path, key))
+    return false;
+
+  THROW_WALLET_EXCEPTION_IF(m_cache.num_chunks(wallet_cache::section_state) != 1 ||
+      m_cache.num_chunks(wallet_cache::section_transfers) != m_cache.num_chunks(wallet_cache::section_tx_prefixes),
+      error::wallet_internal_error, "Unexpected layout of wallet cache " + path);
+
+  {
+    std::stringstream iss;
+    iss << m_cache.load_chunk(wallet_cache::section_state, 0, key);
+    boost::archive::portable_binary_iarchive ar(iss);
+    ar >> *this;
   }
+
+  m_transfers.clear();
+  for (size_t n = 0; n < m_cache.num_chunks(wallet_cache::section_transfers); ++n)
+  {
+    cached_transfers_chunk chunk;
+    cached_tx_prefixes_chunk prefixes;
+    THROW_WALLET_EXCEPTION_IF(!::serialization::parse_binary(m_cache.load_chunk(wallet_cache::section_transfers, n, key), chunk) ||
+        chunk.records.size() % sizeof(cached_transfer) != 0,
+        error::wallet_internal_error, "Failed to parse transfers from wallet cache " + path);
+    THROW_WALLET_EXCEPTION_IF(!::serialization::parse_binary(m_cache.load_chunk(wallet_cache::section_tx_prefixes, n, key), prefixes),
+        error::wallet_internal_error, "Failed to parse transaction prefixes from wallet cache " + path);
+
+    std::vector<cryptonote::transaction_prefix> txes(prefixes.prefixes.size());
+    for (size_t i = 0; i < txes.size(); ++i)
+      THROW_WALLET_EXCEPTION_IF(!::serialization::parse_binary(prefixes.prefixes[i], txes[i]),
+          error::wallet_internal_error, "Failed to parse transaction prefix from wallet cache " + path);
+
+    const size_t begin = m_transfers.size();
+    const size_t count = chunk.records.size() / sizeof(cached_transfer);
+    m_transfers.resize(begin + count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      cached_transfer ct;
+      memcpy(&ct, &chunk.records[i * sizeof(ct)], sizeof(ct));
+      const uint32_t prefix_index = SWAP32LE(ct.prefix_index);
+      THROW_WALLET_EXCEPTION_IF(prefix_index >= txes.size(), error::wallet_internal_error, "Invalid transaction prefix index in wallet cache " + path);
+
+      transfer_details &td = m_transfers[begin + i];
+      td.m_block_height = SWAP64LE(ct.block_height);
+      td.m_tx = txes[prefix_index];
+      td.m_txid = ct.txid;
+      td.m_internal_output_index = SWAP64LE(ct.internal_output_index);
+      td.m_global_output_index = SWAP64LE(ct.global_output_index);
+      td.m_spent = ct.flags & cached_transfer::flag_spent;
+      td.m_spent_height = SWAP64LE(ct.spent_height);
+      td.m_key_image = ct.key_image;
+      td.m_mask = ct.mask;
+      td.m_amount = SWAP64LE(ct.amount);
+      td.m_rct = ct.flags & cached_transfer::flag_rct;
+      td.m_key_image_known = ct.flags & cached_transfer::flag_key_image_known;
+      td.m_pk_index = SWAP64LE(ct.pk_index);
+      td.m_subaddr_index.major = SWAP32LE(ct.subaddr_major);
+      td.m_subaddr_index.minor = SWAP32LE(ct.subaddr_minor);
+      td.m_key_image_partial = ct.flags & cached_transfer::flag_key_image_partial;
+      THROW_WALLET_EXCEPTION_IF(td.m_internal_output_index >= td.m_tx.vout.size(),
+          error::wallet_internal_error, "Invalid output index in wallet cache " + path);
+    }
+
+    for (cached_multisig_transfer &m: chunk.multisig)
+    {
+      THROW_WALLET_EXCEPTION_IF(m.index >= count, error::wallet_internal_error, "Invalid multisig transfer index in wallet cache " + path);
+      transfer_details &td = m_transfers[begin + m.index];
+      td.m_multisig_k = std::move(m.multisig_k);
+      td.m_multisig_info = std::move(m.multisig_info);
+    }
+  }
+
+  LOG_PRINT_L1("Loaded wallet cache " << path << " with " << m_transfers.size() << " transfers");
+  return true;
 }
 //----------------------------------------------------------------------------------------------------
 uint64_t wallet2::balance(uint32_t index_major) const
@@ -6257,15 +6581,15 @@ void wallet2::light_wallet_get_address_txs()
   std::vector<crypto::hash> payments_txs;
   for(const auto &p: m_payments)
     payments_txs.push_back(p.second.m_tx_hash);
-  std::vector<crypto::hash> unconfirmed_payments_txs;
+  std::unordered_set<crypto::hash> unconfirmed_payments_txs;
   for(const auto &up: m_unconfirmed_payments)
-    unconfirmed_payments_txs.push_back(up.second.m_pd.m_tx_hash);
+    unconfirmed_payments_txs.insert(up.second.m_pd.m_tx_hash);
 
   // for balance calculation
   uint64_t wallet_total_sent = 0;
   uint64_t wallet_total_unlocked_sent = 0;
   // txs in pool
-  std::vector<crypto::hash> pool_txs;
+  std::unordered_set<crypto::hash> pool_txs;
 
   for (const auto &t: ires.transactions) {
     const uint64_t total_received = t.total_received;
@@ -6323,8 +6647,8 @@ void wallet2::light_wallet_get_address_txs()
       payment.m_timestamp = t.timestamp;
         
       if (t.mempool) {   
-        if (std::find(unconfirmed_payments_txs.begin(), unconfirmed_payments_txs.end(), tx_hash) == unconfirmed_payments_txs.end()) {
-          pool_txs.push_back(tx_hash);
+        if (unconfirmed_payments_txs.find(tx_hash) == unconfirmed_payments_txs.end()) {
+          pool_txs.insert(tx_hash);
           // assume false as we don't get that info from the light wallet server
           crypto::hash payment_id;
           THROW_WALLET_EXCEPTION_IF(!epee::string_tools::hex_to_pod(t.payment_id, payment_id),
@@ -7652,7 +7976,7 @@ void wallet2::check_tx_key_helper(const crypto::hash &txid, const crypto::key_de
         rct::ecdhDecode(ecdh_info, rct::sk2rct(scalar1));
         const rct::key C = tx.rct_signatures.outPk[n].mask;
         rct::key Ctmp;
-        rct::addKeys2(Ctmp, ecdh_info.mask, ecdh_info.amount, rct::H);
+        rct::addKeys2(Ctmp, ecdh_info.mask, ecdh_info.amount, rct::getHTable());
         if (rct::equalKeys(C, Ctmp))
           amount = rct::h2d(ecdh_info.amount);
         else
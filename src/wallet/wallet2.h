@@ -58,11 +58,14 @@
 #include "wallet_errors.h"
 #include "common/password.h"
 #include "node_rpc_proxy.h"
+#include "wallet_cache.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "wallet.wallet2"
 
 class Serialization_portability_wallet_Test;
+class wallet_refresh_test;
+class wallet_cache_test;
 
 namespace tools
 {
@@ -134,6 +137,8 @@ namespace tools
   class wallet2
   {
     friend class ::Serialization_portability_wallet_Test;
+    friend class ::wallet_refresh_test;
+    friend class ::wallet_cache_test;
   public:
     static constexpr const std::chrono::seconds rpc_timeout = std::chrono::minutes(3) + std::chrono::seconds(30);
 
@@ -767,7 +772,20 @@ namespace tools
       a & m_scanned_pool_txs[1];
       if (ver < 20)
         return;
-      a & m_subaddresses;
+      if (ver < 24)
+      {
+        // we're loading an old version, where m_subaddresses was a std::unordered_map
+        std::unordered_map<crypto::public_key, cryptonote::subaddress_index> m;
+        a & m;
+        m_subaddresses.clear();
+        m_subaddresses.reserve(m.size());
+        for (const auto &i: m)
+          m_subaddresses[i.first] = i.second;
+      }
+      else
+      {
+        a & m_subaddresses;
+      }
       a & m_subaddresses_inv;
       a & m_subaddress_labels;
       a & m_additional_tx_keys;
@@ -911,7 +929,7 @@ namespace tools
     uint64_t import_key_images(const std::string &filename, uint64_t &spent, uint64_t &unspent);
 
     void update_pool_state(bool refreshed = false);
-    void remove_obsolete_pool_txs(const std::vector<crypto::hash> &tx_hashes);
+    void remove_obsolete_pool_txs(const std::unordered_set<crypto::hash> &tx_hashes);
 
     std::string encrypt(const std::string &plaintext, const crypto::secret_key &skey, bool authenticated = true) const;
     std::string encrypt_with_view_secret_key(const std::string &plaintext, bool authenticated = true) const;
@@ -974,6 +992,34 @@ namespace tools
     crypto::public_key get_multisig_signing_public_key(const crypto::secret_key &skey) const;
 
   private:
+    //! the result of scanning a transaction's outputs with one of its tx public keys
+    struct is_out_data
+    {
+      crypto::public_key pkey;
+      crypto::key_derivation derivation;
+      std::vector<tx_scan_info_t> scan_info;  //!< for the outputs checked, from the first
+    };
+
+    //! what scanning a transaction needs, computed in parallel ahead of processing it
+    struct tx_cache_data
+    {
+      bool extra_parsed;
+      std::vector<cryptonote::tx_extra_field> tx_extra_fields;
+      std::vector<is_out_data> primary;  //!< one per tx public key
+      std::vector<crypto::key_derivation> additional_derivations;
+      size_t num_subaddresses;  //!< size of m_subaddresses the outputs were checked against
+    };
+
+    //! a block received from the daemon, with its transactions parsed
+    struct parsed_block
+    {
+      crypto::hash hash;
+      cryptonote::block block;
+      std::vector<cryptonote::transaction> txes;
+      cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices o_indices;
+      bool error;
+    };
+
     /*!
      * \brief  Stores wallet information to wallet file.
      * \param  keys_file_name Name of wallet file
@@ -988,8 +1034,8 @@ namespace tools
      * \param password       Password of wallet file
      */
     bool load_keys(const std::string& keys_file_name, const epee::wipeable_string& password);
-    void process_new_transaction(const crypto::hash &txid, const cryptonote::transaction& tx, const std::vector<uint64_t> &o_indices, uint64_t height, uint64_t ts, bool miner_tx, bool pool, bool double_spend_seen);
-    void process_new_blockchain_entry(const cryptonote::block& b, const cryptonote::block_complete_entry& bche, const crypto::hash& bl_id, uint64_t height, const cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices &o_indices);
+    void process_new_transaction(const crypto::hash &txid, const cryptonote::transaction& tx, const std::vector<uint64_t> &o_indices, uint64_t height, uint64_t ts, bool miner_tx, bool pool, bool double_spend_seen, const tx_cache_data &tx_cache);
+    void process_new_blockchain_entry(const parsed_block &pb, uint64_t height, const std::vector<tx_cache_data> &tx_cache);
     void detach_blockchain(uint64_t height);
     void get_short_chain_history(std::list<crypto::hash>& ids) const;
     bool is_tx_spendtime_unlocked(uint64_t unlock_time, uint64_t block_height) const;
@@ -997,10 +1043,13 @@ namespace tools
     void pull_blocks(uint64_t start_height, uint64_t& blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::list<cryptonote::block_complete_entry> &blocks, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices);
     void pull_hashes(uint64_t start_height, uint64_t& blocks_start_height, const std::list<crypto::hash> &short_chain_history, std::list<crypto::hash> &hashes);
     void fast_refresh(uint64_t stop_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history);
-    void pull_next_blocks(uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::list<cryptonote::block_complete_entry> &prev_blocks, std::list<cryptonote::block_complete_entry> &blocks, std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, bool &error);
-    void process_blocks(uint64_t start_height, const std::list<cryptonote::block_complete_entry> &blocks, const std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, uint64_t& blocks_added);
+    void pull_next_blocks(uint64_t start_height, uint64_t &blocks_start_height, std::list<crypto::hash> &short_chain_history, const std::vector<parsed_block> &prev_blocks, std::vector<parsed_block> &blocks, bool &error);
+    void parse_blocks(const std::list<cryptonote::block_complete_entry> &blocks, const std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> &o_indices, std::vector<parsed_block> &parsed_blocks) const;
+    void process_parsed_blocks(uint64_t start_height, const std::vector<parsed_block> &blocks, uint64_t& blocks_added);
     uint64_t select_transfers(uint64_t needed_money, std::vector<size_t> unused_transfers_indices, std::vector<size_t>& selected_transfers, bool trusted_daemon);
     bool prepare_file_names(const std::string& file_path);
+    void store_cache(const std::string& path, const crypto::chacha_key &key);
+    bool load_cache(const std::string& path, const crypto::chacha_key &key);
     void process_unconfirmed(const crypto::hash &txid, const cryptonote::transaction& tx, uint64_t height);
     void process_outgoing(const crypto::hash &txid, const cryptonote::transaction& tx, uint64_t height, uint64_t ts, uint64_t spent, uint64_t received, uint32_t subaddr_account, const std::set<uint32_t>& subaddr_indices);
     void add_unconfirmed_tx(const cryptonote::transaction& tx, uint64_t amount_in, const std::vector<cryptonote::tx_destination_entry> &dests, const crypto::hash &payment_id, uint64_t change_amount, uint32_t subaddr_account, const std::set<uint32_t>& subaddr_indices);
@@ -1009,7 +1058,11 @@ namespace tools
     bool generate_chacha_key_from_secret_keys(crypto::chacha_key &key) const;
     crypto::hash get_payment_id(const pending_tx &ptx) const;
     void check_acc_out_precomp(const cryptonote::tx_out &o, const crypto::key_derivation &derivation, const std::vector<crypto::key_derivation> &additional_derivations, size_t i, tx_scan_info_t &tx_scan_info) const;
-    void parse_block_round(const cryptonote::blobdata &blob, cryptonote::block &bl, crypto::hash &bl_id, bool &error) const;
+    void check_acc_outs_precomp(const cryptonote::transaction &tx, size_t begin, size_t end, const crypto::key_derivation &derivation, const std::vector<crypto::key_derivation> &additional_derivations, std::vector<tx_scan_info_t> &tx_scan_info) const;
+    size_t get_tx_pub_keys(const cryptonote::transaction& tx, tx_cache_data &tx_cache, std::vector<crypto::public_key> &tx_pub_keys) const;
+    void set_tx_derivations(tx_cache_data &tx_cache, const crypto::public_key *tx_pub_keys, size_t count, size_t num_primary, const crypto::key_derivation *derivations, const bool *valid) const;
+    void cache_tx_data(const cryptonote::transaction& tx, bool miner_tx, tx_cache_data &tx_cache) const;
+    void scan_tx_outputs(const cryptonote::transaction& tx, bool miner_tx, tx_cache_data &tx_cache) const;
     uint64_t get_upper_transaction_size_limit();
     std::vector<uint64_t> get_unspent_amounts_vector();
     uint64_t get_dynamic_per_kb_fee_estimate();
@@ -1035,6 +1088,7 @@ namespace tools
     std::string m_daemon_address;
     std::string m_wallet_file;
     std::string m_keys_file;
+    wallet_cache m_cache;
     epee::net_utils::http::http_simple_client m_http_client;
     hashchain m_blockchain;
     std::atomic<uint64_t> m_local_bc_height; //temporary workaround
@@ -1050,7 +1104,7 @@ namespace tools
     std::unordered_map<crypto::key_image, size_t> m_key_images;
     std::unordered_map<crypto::public_key, size_t> m_pub_keys;
     cryptonote::account_public_address m_account_public_address;
-    std::unordered_map<crypto::public_key, cryptonote::subaddress_index> m_subaddresses;
+    cryptonote::subaddress_map m_subaddresses;
     std::unordered_map<cryptonote::subaddress_index, crypto::public_key> m_subaddresses_inv;
     std::vector<std::vector<std::string>> m_subaddress_labels;
     std::unordered_map<crypto::hash, std::string> m_tx_notes;
@@ -1092,6 +1146,8 @@ namespace tools
     bool m_is_initialized;
     NodeRPCProxy m_node_rpc_proxy;
     std::unordered_set<crypto::hash> m_scanned_pool_txs[2];
+    uint64_t m_pool_sequence; // daemon pool sequence number m_pool_hashes is up to date with, 0 if none
+    std::unordered_set<crypto::hash> m_pool_hashes; // the daemon's pool, as of the last update_pool_state
     size_t m_subaddress_lookahead_major, m_subaddress_lookahead_minor;
 
     // Light wallet
@@ -1109,7 +1165,7 @@ namespace tools
     std::unordered_map<crypto::public_key, std::map<uint64_t, crypto::key_image> > m_key_image_cache;
   };
 }
-BOOST_CLASS_VERSION(tools::wallet2, 23)
+BOOST_CLASS_VERSION(tools::wallet2, 24)
 BOOST_CLASS_VERSION(tools::wallet2::transfer_details, 9)
 BOOST_CLASS_VERSION(tools::wallet2::multisig_info, 1)
 BOOST_CLASS_VERSION(tools::wallet2::multisig_info::LR, 0)
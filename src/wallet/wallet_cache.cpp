@@ -0,0 +1,256 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <fstream>
+#include "common/int-util.h"
+#include "common/util.h"
+#include "crypto/crypto.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "misc_log_ex.h"
+#include "wallet_cache.h"
+#include "wallet_errors.h"
+#include "serialization/binary_utils.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "wallet.cache"
+
+#define WALLET_CACHE_MAGIC "Monero chunked wallet cache\001"
+
+// dead space always tolerated before a store rewrites the whole file
+#define WALLET_CACHE_MIN_DEAD_SIZE (1024 * 1024)
+
+namespace
+{
+  const size_t magic_size = sizeof(WALLET_CACHE_MAGIC) - 1;
+  const size_t header_size = magic_size + 2 * sizeof(uint64_t) + sizeof(crypto::hash);
+
+  std::string make_header(const tools::wallet_cache::chunk_ref &index_ref)
+  {
+    const uint64_t offset = SWAP64LE(index_ref.offset);
+    const uint64_t size = SWAP64LE(index_ref.size);
+    std::string header(WALLET_CACHE_MAGIC, magic_size);
+    header.append((const char*)&offset, sizeof(offset));
+    header.append((const char*)&size, sizeof(size));
+    header.append((const char*)&index_ref.hash, sizeof(index_ref.hash));
+    return header;
+  }
+
+  bool read_header(std::istream &f, tools::wallet_cache::chunk_ref &index_ref)
+  {
+    std::string header(header_size, 0);
+    if (!f.read(&header[0], header_size) || memcmp(header.data(), WALLET_CACHE_MAGIC, magic_size))
+      return false;
+    const char *p = header.data() + magic_size;
+    memcpy(&index_ref.offset, p, sizeof(index_ref.offset));
+    index_ref.offset = SWAP64LE(index_ref.offset);
+    p += sizeof(index_ref.offset);
+    memcpy(&index_ref.size, p, sizeof(index_ref.size));
+    index_ref.size = SWAP64LE(index_ref.size);
+    p += sizeof(index_ref.size);
+    memcpy(&index_ref.hash, p, sizeof(index_ref.hash));
+    return true;
+  }
+
+  uint64_t get_file_size(std::istream &f)
+  {
+    f.seekg(0, std::ios::end);
+    return f.tellg();
+  }
+
+  tools::wallet_cache::chunk_ref write_chunk(std::ostream &f, uint64_t offset, const std::string &plaintext, const crypto::hash &hash, const crypto::chacha_key &key)
+  {
+    const crypto::chacha_iv iv = crypto::rand<crypto::chacha_iv>();
+    std::string cipher(plaintext.size(), 0);
+    crypto::chacha20(plaintext.data(), plaintext.size(), key, iv, &cipher[0]);
+    f.write((const char*)&iv, sizeof(iv));
+    f.write(cipher.data(), cipher.size());
+    return {offset, sizeof(iv) + cipher.size(), hash};
+  }
+
+  std::string read_chunk(std::istream &f, uint64_t file_size, const tools::wallet_cache::chunk_ref &ref, const crypto::chacha_key &key, const std::string &path)
+  {
+    THROW_WALLET_EXCEPTION_IF(ref.size < sizeof(crypto::chacha_iv) || ref.offset < header_size || ref.offset > file_size || ref.size > file_size - ref.offset,
+        tools::error::wallet_internal_error, "Invalid chunk in wallet cache " + path);
+    crypto::chacha_iv iv;
+    std::string cipher(ref.size - sizeof(iv), 0);
+    f.seekg(ref.offset);
+    f.read((char*)&iv, sizeof(iv));
+    f.read(&cipher[0], cipher.size());
+    THROW_WALLET_EXCEPTION_IF(!f, tools::error::file_read_error, path);
+    std::string plaintext(cipher.size(), 0);
+    crypto::chacha20(cipher.data(), cipher.size(), key, iv, &plaintext[0]);
+    THROW_WALLET_EXCEPTION_IF(crypto::cn_fast_hash(plaintext.data(), plaintext.size()) != ref.hash,
+        tools::error::wallet_internal_error, "Wallet cache " + path + " is corrupt, or was encrypted with another key");
+    return plaintext;
+  }
+}
+
+namespace tools
+{
+  //------------------------------------------------------------------------------------------------------------------------------
+  wallet_cache::wallet_cache():
+    m_index_ref({0, 0, crypto::null_hash}),
+    m_end(0),
+    m_live_size(0)
+  {
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_cache::load_index(const std::string &path, const crypto::chacha_key &key)
+  {
+    std::ifstream f(path, std::ios::in | std::ios::binary);
+    chunk_ref index_ref;
+    if (!f || !read_header(f, index_ref))
+      return false;
+
+    index_t index;
+    const std::string blob = read_chunk(f, get_file_size(f), index_ref, key, path);
+    THROW_WALLET_EXCEPTION_IF(!::serialization::parse_binary(blob, index) || index.sections.size() != num_sections,
+        error::wallet_internal_error, "Failed to parse the index of wallet cache " + path);
+
+    uint64_t live_size = 0;
+    for (const auto &section: index.sections)
+      for (const chunk_ref &ref: section)
+        live_size += ref.size;
+
+    m_path = path;
+    m_index = std::move(index);
+    m_index_ref = index_ref;
+    m_end = index_ref.offset + index_ref.size;
+    m_live_size = live_size + index_ref.size;
+    MDEBUG("Loaded index of " << path << ": " << m_live_size << " live bytes out of " << m_end);
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  size_t wallet_cache::num_chunks(section_t section) const
+  {
+    return section < m_index.sections.size() ? m_index.sections[section].size() : 0;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  std::string wallet_cache::load_chunk(section_t section, size_t index, const crypto::chacha_key &key) const
+  {
+    THROW_WALLET_EXCEPTION_IF(index >= num_chunks(section), error::wallet_internal_error, "Wallet cache chunk out of range");
+    std::ifstream f(m_path, std::ios::in | std::ios::binary);
+    THROW_WALLET_EXCEPTION_IF(!f, error::file_read_error, m_path);
+    return read_chunk(f, get_file_size(f), m_index.sections[section][index], key, m_path);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  uint64_t wallet_cache::store(const std::string &path, const crypto::chacha_key &key, const std::vector<std::vector<std::string>> &sections)
+  {
+    THROW_WALLET_EXCEPTION_IF(sections.size() != num_sections, error::wallet_internal_error, "Wrong number of wallet cache sections");
+
+    const bool append = path == m_path && m_end <= 2 * m_live_size + WALLET_CACHE_MIN_DEAD_SIZE && is_unchanged_since_stored();
+    const std::string filename = append ? path : path + ".new";
+    std::fstream f;
+    if (append)
+      f.open(filename, std::ios::in | std::ios::out | std::ios::binary);
+    else
+      f.open(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    THROW_WALLET_EXCEPTION_IF(!f.is_open(), error::file_save_error, filename);
+
+    // the header is written last, once everything it points to is on disk
+    uint64_t offset;
+    if (append)
+    {
+      offset = m_end;
+      f.seekp(offset);
+    }
+    else
+    {
+      offset = header_size;
+      f.write(std::string(header_size, 0).data(), header_size);
+    }
+
+    index_t index;
+    index.sections.resize(num_sections);
+    uint64_t written = 0, live_size = 0;
+    for (size_t s = 0; s < num_sections; ++s)
+    {
+      for (size_t i = 0; i < sections[s].size(); ++i)
+      {
+        const std::string &chunk = sections[s][i];
+        const crypto::hash hash = crypto::cn_fast_hash(chunk.data(), chunk.size());
+        if (append && i < m_index.sections[s].size() && m_index.sections[s][i].hash == hash)
+        {
+          index.sections[s].push_back(m_index.sections[s][i]);
+        }
+        else
+        {
+          index.sections[s].push_back(write_chunk(f, offset, chunk, hash, key));
+          offset += index.sections[s].back().size;
+          written += index.sections[s].back().size;
+        }
+        live_size += index.sections[s].back().size;
+      }
+    }
+
+    std::string blob;
+    THROW_WALLET_EXCEPTION_IF(!::serialization::dump_binary(index, blob), error::wallet_internal_error, "Failed to serialize wallet cache index");
+    const chunk_ref index_ref = write_chunk(f, offset, blob, crypto::cn_fast_hash(blob.data(), blob.size()), key);
+    offset += index_ref.size;
+    written += index_ref.size;
+    live_size += index_ref.size;
+
+    // the data must reach the disk before the header pointing to it, or a
+    // crash could leave an in place update with a header pointing to garbage
+    f.flush();
+    THROW_WALLET_EXCEPTION_IF(!f, error::file_save_error, filename);
+    std::error_code e = tools::sync_file(filename);
+    THROW_WALLET_EXCEPTION_IF(e, error::file_save_error, filename, e);
+
+    f.seekp(0);
+    const std::string header = make_header(index_ref);
+    f.write(header.data(), header.size());
+    written += header.size();
+    f.close();
+    THROW_WALLET_EXCEPTION_IF(!f, error::file_save_error, filename);
+    e = tools::sync_file(filename);
+    THROW_WALLET_EXCEPTION_IF(e, error::file_save_error, filename, e);
+
+    if (!append)
+    {
+      e = tools::replace_file(filename, path);
+      THROW_WALLET_EXCEPTION_IF(e, error::file_save_error, path, e);
+    }
+
+    MDEBUG("Stored " << path << (append ? " incrementally" : "") << ": wrote " << written << " bytes, " << live_size << " live bytes out of " << offset);
+    m_path = path;
+    m_index = std::move(index);
+    m_index_ref = index_ref;
+    m_end = offset;
+    m_live_size = live_size;
+    return written;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_cache::is_unchanged_since_stored() const
+  {
+    std::ifstream f(m_path, std::ios::in | std::ios::binary);
+    chunk_ref index_ref;
+    return f && read_header(f, index_ref) && index_ref.offset == m_index_ref.offset && index_ref.size == m_index_ref.size && index_ref.hash == m_index_ref.hash;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+}
@@ -0,0 +1,145 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "crypto/chacha.h"
+#include "crypto/hash.h"
+#include "serialization/serialization.h"
+#include "serialization/vector.h"
+#include "serialization/crypto.h"
+
+namespace tools
+{
+  /**
+   * @brief An encrypted wallet cache file, stored as independent chunks
+   *
+   * The file starts with a fixed size header pointing at an index, which
+   * lists the chunks of each section with their position and the hash of
+   * their plaintext. Every chunk, and the index, is encrypted on its own,
+   * with its own IV.
+   *
+   * When storing over the file last loaded or stored, chunks whose
+   * plaintext did not change are left where they are: only the changed
+   * chunks and a new index are appended after the live data, then the
+   * header is rewritten in place. An interrupted store therefore leaves
+   * the previous state readable. Once more than half the file is taken by
+   * chunks no longer referenced, the next store rewrites it from scratch.
+   */
+  class wallet_cache
+  {
+  public:
+    enum section_t
+    {
+      section_state,        //!< everything which is not stored in its own section
+      section_transfers,    //!< the received outputs, a fixed number per chunk
+      section_tx_prefixes,  //!< the prefixes of the transactions of the outputs, in the same chunks
+      num_sections
+    };
+
+    struct chunk_ref
+    {
+      uint64_t offset;
+      uint64_t size;
+      crypto::hash hash;  //!< hash of the plaintext
+
+      BEGIN_SERIALIZE_OBJECT()
+        VARINT_FIELD(offset)
+        VARINT_FIELD(size)
+        FIELD(hash)
+      END_SERIALIZE()
+    };
+
+    wallet_cache();
+
+    /**
+     * @brief reads the index of a cache file
+     *
+     * @param path the cache file
+     * @param key the key the cache was encrypted with
+     *
+     * @return false if the file is not a chunked cache
+     *
+     * Throws if the file is a chunked cache but cannot be read, or was
+     * encrypted with another key.
+     */
+    bool load_index(const std::string &path, const crypto::chacha_key &key);
+
+    /**
+     * @brief gets the number of chunks of a section in the loaded index
+     */
+    size_t num_chunks(section_t section) const;
+
+    /**
+     * @brief reads and decrypts a chunk of the loaded index
+     *
+     * @param section the section of the chunk
+     * @param index the index of the chunk in its section
+     * @param key the key the cache was encrypted with
+     *
+     * @return the plaintext of the chunk
+     */
+    std::string load_chunk(section_t section, size_t index, const crypto::chacha_key &key) const;
+
+    /**
+     * @brief stores chunks to a cache file
+     *
+     * Only the chunks which changed are written if path is the file the
+     * cache was last loaded from or stored to, and it was not modified
+     * since. Otherwise the whole file is written to a temporary file, which
+     * then replaces it.
+     *
+     * @param path the cache file
+     * @param key the key to encrypt the cache with
+     * @param sections the plaintext of the chunks, num_sections lists of them
+     *
+     * @return the number of bytes written
+     */
+    uint64_t store(const std::string &path, const crypto::chacha_key &key, const std::vector<std::vector<std::string>> &sections);
+
+  private:
+    struct index_t
+    {
+      std::vector<std::vector<chunk_ref>> sections;
+
+      BEGIN_SERIALIZE_OBJECT()
+        FIELD(sections)
+      END_SERIALIZE()
+    };
+
+    bool is_unchanged_since_stored() const;
+
+    std::string m_path;       //!< the file the index was read from or written to
+    index_t m_index;
+    chunk_ref m_index_ref;
+    uint64_t m_end;           //!< end of the live data in m_path
+    uint64_t m_live_size;     //!< size of the chunks m_index refers to
+  };
+}
@@ -0,0 +1,330 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <array>
+#include <boost/bind.hpp>
+#include "misc_log_ex.h"
+#include "string_tools.h"
+#include "crypto/crypto.h"
+#include "wallet_pool.h"
+
+#undef MONERO_DEFAULT_LOG_CATEGORY
+#define MONERO_DEFAULT_LOG_CATEGORY "wallet.pool"
+
+namespace tools
+{
+  //------------------------------------------------------------------------------------------------------------------------------
+  wallet_pool::wallet_pool(size_t max_loaded, loader_t loader):
+    m_max_loaded(std::max<size_t>(max_loaded, 1)),
+    m_loader(std::move(loader)),
+    m_loaded(0),
+    m_use_counter(0),
+    m_running(false),
+    m_refresh_interval(0)
+  {
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  wallet_pool::~wallet_pool()
+  {
+    try
+    {
+      stop();
+    }
+    catch (...) {}
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  const std::string &wallet_pool::handle::token() const
+  {
+    static const std::string empty;
+    return m_entry ? m_entry->token : empty;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_pool::handle::authorized(const std::string &token) const
+  {
+    if (!m_entry || m_entry->token.size() != token.size())
+      return false;
+    // do not leak how much of the token matched
+    unsigned char diff = 0;
+    for (size_t n = 0; n < token.size(); ++n)
+      diff |= m_entry->token[n] ^ token[n];
+    return diff == 0;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_pool::add(const std::string &id, const epee::wipeable_string &password, std::unique_ptr<wallet2> wallet, std::string &token)
+  {
+    std::array<uint8_t, 16> rand_128bit;
+    crypto::rand(rand_128bit.size(), rand_128bit.data());
+
+    std::shared_ptr<entry> e = std::make_shared<entry>();
+    e->id = id;
+    e->password = password;
+    e->token = epee::string_tools::buff_to_hex_nodelimer(std::string((const char*)rand_128bit.data(), rand_128bit.size()));
+    e->wallet = std::move(wallet);
+    e->closed = false;
+    e->last_refresh = 0;
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      if (!m_wallets.emplace(id, e).second)
+        return false;
+      e->last_used = ++m_use_counter;
+      ++m_loaded;
+    }
+    MDEBUG("Added wallet " << id);
+    token = e->token;
+    evict(e);
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  wallet_pool::handle wallet_pool::acquire(const std::string &id)
+  {
+    handle h;
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      auto i = m_wallets.find(id);
+      if (i == m_wallets.end())
+        return h;
+      h.m_entry = i->second;
+      h.m_entry->last_used = ++m_use_counter;
+    }
+
+    h.m_lock = boost::unique_lock<boost::mutex>(h.m_entry->lock);
+    // it may have been closed while we waited
+    if (h.m_entry->closed)
+      return handle();
+    if (!h.m_entry->wallet)
+    {
+      load(*h.m_entry);
+      if (h.m_entry->wallet)
+        evict(h.m_entry);
+    }
+    return h;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_pool::close(handle &h)
+  {
+    if (!h.m_entry)
+      return false;
+
+    entry &e = *h.m_entry;
+    if (e.wallet && !unload(e))
+      return false;
+    e.closed = true;
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      auto i = m_wallets.find(e.id);
+      if (i != m_wallets.end() && i->second == h.m_entry)
+        m_wallets.erase(i);
+    }
+    MDEBUG("Closed wallet " << e.id);
+
+    // unlock before dropping what may be the last reference to the entry
+    h.m_lock.unlock();
+    h.m_entry.reset();
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void wallet_pool::load(entry &e)
+  {
+    try
+    {
+      std::unique_ptr<wallet2> wallet = m_loader(e.id, e.password);
+      if (!wallet)
+      {
+        MERROR("Failed to load wallet " << e.id);
+        return;
+      }
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      e.wallet = std::move(wallet);
+      ++m_loaded;
+    }
+    catch (const std::exception &ex)
+    {
+      MERROR("Failed to load wallet " << e.id << ": " << ex.what());
+      return;
+    }
+    MDEBUG("Loaded wallet " << e.id);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_pool::unload(entry &e)
+  {
+    try
+    {
+      e.wallet->store();
+    }
+    catch (const std::exception &ex)
+    {
+      MERROR("Failed to store wallet " << e.id << ", keeping it loaded: " << ex.what());
+      return false;
+    }
+
+    std::unique_ptr<wallet2> wallet;
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      wallet = std::move(e.wallet);
+      --m_loaded;
+    }
+    MDEBUG("Unloaded wallet " << e.id);
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void wallet_pool::evict(const std::shared_ptr<entry> &keep)
+  {
+    while (1)
+    {
+      std::shared_ptr<entry> victim;
+      boost::unique_lock<boost::mutex> victim_lock;
+      {
+        boost::unique_lock<boost::mutex> lock(m_lock);
+        if (m_loaded <= m_max_loaded)
+          return;
+
+        std::vector<std::shared_ptr<entry>> candidates;
+        for (const auto &i: m_wallets)
+          if (i.second != keep && i.second->wallet)
+            candidates.push_back(i.second);
+        std::sort(candidates.begin(), candidates.end(), [](const std::shared_ptr<entry> &a, const std::shared_ptr<entry> &b) {
+          return a->last_used < b->last_used;
+        });
+
+        // wallets in use are skipped, we never wait for one with the pool locked
+        for (const auto &c: candidates)
+        {
+          boost::unique_lock<boost::mutex> l(c->lock, boost::try_to_lock);
+          if (l.owns_lock())
+          {
+            victim = c;
+            victim_lock = std::move(l);
+            break;
+          }
+        }
+      }
+
+      if (!victim)
+      {
+        MDEBUG("All loaded wallets are in use, staying above the limit for now");
+        return;
+      }
+      if (!unload(*victim))
+        return;
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void wallet_pool::start_refresh(size_t threads, uint64_t interval)
+  {
+    m_refresh_interval = interval;
+    m_running = true;
+    for (size_t n = 0; n < threads; ++n)
+      m_refresh_threads.create_thread(boost::bind(&wallet_pool::refresh_loop, this));
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  std::shared_ptr<wallet_pool::entry> wallet_pool::next_refresh()
+  {
+    const uint64_t now = time(NULL);
+    std::shared_ptr<entry> e;
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    for (const auto &i: m_wallets)
+    {
+      const std::shared_ptr<entry> &c = i.second;
+      if (c->wallet && c->last_refresh + m_refresh_interval <= now && (!e || c->last_refresh < e->last_refresh))
+        e = c;
+    }
+    if (e)
+      e->last_refresh = now;
+    return e;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void wallet_pool::refresh_loop()
+  {
+    while (m_running)
+    {
+      std::shared_ptr<entry> e = next_refresh();
+      if (!e)
+      {
+        boost::unique_lock<boost::mutex> lock(m_refresh_lock);
+        if (m_running)
+          m_refresh_cond.wait_for(lock, boost::chrono::seconds(1));
+        continue;
+      }
+
+      // a wallet in use is left for the next round
+      boost::unique_lock<boost::mutex> lock(e->lock, boost::try_to_lock);
+      if (!lock.owns_lock() || e->closed || !e->wallet)
+        continue;
+      try
+      {
+        e->wallet->refresh();
+      }
+      catch (const std::exception &ex)
+      {
+        MERROR("Failed to refresh wallet " << e->id << ": " << ex.what());
+      }
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void wallet_pool::stop()
+  {
+    {
+      boost::unique_lock<boost::mutex> lock(m_refresh_lock);
+      m_running = false;
+      m_refresh_cond.notify_all();
+    }
+
+    std::vector<std::shared_ptr<entry>> entries;
+    {
+      boost::unique_lock<boost::mutex> lock(m_lock);
+      for (const auto &i: m_wallets)
+      {
+        // make refreshes in progress return early
+        if (i.second->wallet)
+          i.second->wallet->stop();
+        entries.push_back(i.second);
+      }
+    }
+    m_refresh_threads.join_all();
+
+    for (const auto &e: entries)
+    {
+      boost::unique_lock<boost::mutex> lock(e->lock);
+      if (e->wallet)
+        unload(*e);
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  size_t wallet_pool::size() const
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    return m_wallets.size();
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  size_t wallet_pool::loaded() const
+  {
+    boost::unique_lock<boost::mutex> lock(m_lock);
+    return m_loaded;
+  }
+}
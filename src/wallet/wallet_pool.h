@@ -0,0 +1,199 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/utility.hpp>
+#include "wipeable_string.h"
+#include "wallet2.h"
+
+namespace tools
+{
+  /**
+   * @brief A set of open wallets, for serving many wallets from one process
+   *
+   * Wallets are known by an id, their file name. Each has its own lock,
+   * held by whoever is using it, so work on different wallets runs in
+   * parallel while work on the same wallet is serialized.
+   *
+   * At most a given number of wallets are kept loaded. When more are
+   * needed, the least recently used idle ones are stored and unloaded,
+   * and loaded again with the password they were opened with the next
+   * time they are used. Background threads keep the loaded wallets
+   * refreshed.
+   *
+   * Each wallet gets a random session token when it is added. Anyone
+   * knowing the id can lock the wallet, so users of the pool check the
+   * token a client presents before letting it use the wallet.
+   */
+  class wallet_pool: boost::noncopyable
+  {
+    struct entry
+    {
+      std::string id;
+      epee::wipeable_string password;
+      std::string token;                //!< the session token, set once when added
+      std::unique_ptr<wallet2> wallet;  //!< null while unloaded; reset under both locks
+      boost::mutex lock;                //!< held while the wallet is used
+      bool closed;                      //!< removed from the pool
+      uint64_t last_used;               //!< guarded by the pool lock
+      uint64_t last_refresh;            //!< guarded by the pool lock
+    };
+
+  public:
+    typedef std::function<std::unique_ptr<wallet2>(const std::string &id, const epee::wipeable_string &password)> loader_t;
+
+    /**
+     * @brief exclusive access to a wallet of the pool
+     *
+     * The wallet stays locked and loaded until the handle is destroyed.
+     */
+    class handle
+    {
+    public:
+      wallet2 *get() const { return m_entry ? m_entry->wallet.get() : NULL; }
+      wallet2 *operator->() const { return get(); }
+      explicit operator bool() const { return get() != NULL; }
+
+      /**
+       * @brief get the session token of the wallet
+       */
+      const std::string &token() const;
+
+      /**
+       * @brief checks a token against the wallet's session token
+       *
+       * @param token the token a client presented
+       *
+       * @return true if the handle is not empty and the token matches, false otherwise
+       */
+      bool authorized(const std::string &token) const;
+
+    private:
+      friend class wallet_pool;
+      std::shared_ptr<entry> m_entry;
+      boost::unique_lock<boost::mutex> m_lock;
+    };
+
+    /**
+     * @brief Constructor
+     *
+     * @param max_loaded the number of wallets to keep loaded
+     * @param loader loads an unloaded wallet again
+     */
+    wallet_pool(size_t max_loaded, loader_t loader);
+
+    ~wallet_pool();
+
+    /**
+     * @brief adds an open wallet to the pool
+     *
+     * @param id the wallet's id
+     * @param password the wallet's password, to load it again later
+     * @param wallet the wallet
+     * @param token set to the wallet's new session token
+     *
+     * @return false if a wallet with that id is already in the pool, true otherwise
+     */
+    bool add(const std::string &id, const epee::wipeable_string &password, std::unique_ptr<wallet2> wallet, std::string &token);
+
+    /**
+     * @brief locks a wallet of the pool, loading it if needed
+     *
+     * Blocks while the wallet is used by another thread. The handle is
+     * empty if the wallet is not in the pool or fails to load. This does
+     * not check the session token, see handle::authorized.
+     *
+     * @param id the wallet's id
+     *
+     * @return a handle to the wallet
+     */
+    handle acquire(const std::string &id);
+
+    /**
+     * @brief stores a wallet and removes it from the pool
+     *
+     * @param h a handle to the wallet, released on return
+     *
+     * @return false if storing the wallet failed, true otherwise
+     */
+    bool close(handle &h);
+
+    /**
+     * @brief starts refreshing loaded wallets in the background
+     *
+     * @param threads the number of refresh threads
+     * @param interval the minimum number of seconds between two refreshes of a wallet
+     */
+    void start_refresh(size_t threads, uint64_t interval);
+
+    /**
+     * @brief stops the refresh threads, then stores and unloads all wallets
+     */
+    void stop();
+
+    /**
+     * @brief get the number of wallets in the pool
+     */
+    size_t size() const;
+
+    /**
+     * @brief get the number of wallets currently loaded
+     */
+    size_t loaded() const;
+
+  private:
+    void load(entry &e);
+    bool unload(entry &e);
+    void evict(const std::shared_ptr<entry> &keep);
+    std::shared_ptr<entry> next_refresh();
+    void refresh_loop();
+
+    const size_t m_max_loaded;
+    const loader_t m_loader;
+
+    mutable boost::mutex m_lock;  //!< guards m_wallets and the counters
+    std::unordered_map<std::string, std::shared_ptr<entry>> m_wallets;
+    size_t m_loaded;
+    uint64_t m_use_counter;
+
+    boost::thread_group m_refresh_threads;
+    boost::mutex m_refresh_lock;
+    boost::condition_variable m_refresh_cond;
+    std::atomic<bool> m_running;
+    uint64_t m_refresh_interval;
+  };
+}
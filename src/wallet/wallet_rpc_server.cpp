@@ -61,6 +61,11 @@ namespace
   const command_line::arg_descriptor<bool> arg_trusted_daemon = {"trusted-daemon", "Enable commands which rely on a trusted daemon", false};
   const command_line::arg_descriptor<std::string> arg_wallet_dir = {"wallet-dir", "Directory for newly created wallets"};
   const command_line::arg_descriptor<bool> arg_prompt_for_password = {"prompt-for-password", "Prompts for password when not provided", false};
+  const command_line::arg_descriptor<size_t> arg_max_open_wallets = {"max-open-wallets", "Serve any wallet in --wallet-dir at /wallet/<name>/json_rpc, keeping at most this many loaded (0 to serve a single wallet)", 0};
+  const command_line::arg_descriptor<size_t> arg_rpc_threads = {"rpc-threads", "Number of threads serving requests when serving several wallets (0 for one per CPU)", 0};
+  const command_line::arg_descriptor<size_t> arg_wallet_refresh_threads = {"wallet-refresh-threads", "Number of threads refreshing open wallets when serving several wallets", 2};
+
+  constexpr const uint64_t wallet_refresh_interval = 20; // seconds
 
   constexpr const char default_rpc_username[] = "monero";
 
@@ -82,8 +87,11 @@ namespace tools
     return i18n_translate(str, "tools::wallet_rpc_server");
   }
 
+  __thread wallet2 *wallet_rpc_server::m_wallet = NULL;
+  __thread wallet_rpc_server::routed_wallet *wallet_rpc_server::m_routed = NULL;
+
   //------------------------------------------------------------------------------------------------------------------------------
-  wallet_rpc_server::wallet_rpc_server():m_wallet(NULL), rpc_login_file(), m_stop(false), m_trusted_daemon(false), m_vm(NULL)
+  wallet_rpc_server::wallet_rpc_server():m_single_wallet(NULL), m_rpc_threads(0), m_refresh_threads(0), rpc_login_file(), m_stop(false), m_trusted_daemon(false), m_vm(NULL)
   {
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -93,15 +101,31 @@ namespace tools
   //------------------------------------------------------------------------------------------------------------------------------
   void wallet_rpc_server::set_wallet(wallet2 *cr)
   {
-    m_wallet = cr;
+    m_single_wallet = cr;
   }
   //------------------------------------------------------------------------------------------------------------------------------
   bool wallet_rpc_server::run()
   {
     m_stop = false;
+    if (m_wallet_pool)
+    {
+      m_net_server.add_idle_handler([this](){
+        if (m_stop.load(std::memory_order_relaxed))
+        {
+          send_stop_signal();
+          return false;
+        }
+        return true;
+      }, 500);
+      m_wallet_pool->start_refresh(m_refresh_threads, wallet_refresh_interval);
+
+      // requests lock the wallet they work on, so they can run in parallel
+      return epee::http_server_impl_base<wallet_rpc_server, connection_context>::run(m_rpc_threads, true);
+    }
+
     m_net_server.add_idle_handler([this](){
       try {
-        if (m_wallet) m_wallet->refresh();
+        if (m_single_wallet) m_single_wallet->refresh();
       } catch (const std::exception& ex) {
         LOG_ERROR("Exception at while refreshing, what=" << ex.what());
       }
@@ -122,11 +146,13 @@ namespace tools
   //------------------------------------------------------------------------------------------------------------------------------
   void wallet_rpc_server::stop()
   {
-    if (m_wallet)
+    if (m_wallet_pool)
+      m_wallet_pool->stop();
+    if (m_single_wallet)
     {
-      m_wallet->store();
-      delete m_wallet;
-      m_wallet = NULL;
+      m_single_wallet->store();
+      delete m_single_wallet;
+      m_single_wallet = NULL;
     }
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -140,8 +166,8 @@ namespace tools
     tools::wallet2 *walvars;
     std::unique_ptr<tools::wallet2> tmpwal;
 
-    if (m_wallet)
-      walvars = m_wallet;
+    if (m_single_wallet)
+      walvars = m_single_wallet;
     else
     {
       tmpwal = tools::wallet2::make_dummy(*m_vm, password_prompter);
@@ -178,6 +204,24 @@ namespace tools
       }
     }
 
+    const size_t max_open_wallets = command_line::get_arg(*m_vm, arg_max_open_wallets);
+    if (max_open_wallets > 0)
+    {
+      if (m_wallet_dir.empty() || m_single_wallet)
+      {
+        LOG_ERROR(tr("--") << arg_max_open_wallets.name << tr(" requires --") << arg_wallet_dir.name << tr(" and no wallet file"));
+        return false;
+      }
+      m_rpc_threads = command_line::get_arg(*m_vm, arg_rpc_threads);
+      if (m_rpc_threads == 0)
+        m_rpc_threads = std::max(tools::get_max_concurrency(), 1u);
+      m_refresh_threads = command_line::get_arg(*m_vm, arg_wallet_refresh_threads);
+      m_wallet_pool.reset(new wallet_pool(max_open_wallets, [this](const std::string &id, const epee::wipeable_string &password) {
+        return open_wallet_file(m_wallet_dir + "/" + id, password);
+      }));
+      MINFO("Serving up to " << max_open_wallets << " loaded wallets from " << m_wallet_dir << " on " << m_rpc_threads << " threads");
+    }
+
     if (disable_auth)
     {
       if (rpc_config->login)
@@ -234,10 +278,68 @@ namespace tools
     );
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool wallet_rpc_server::handle_http_request(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response, connection_context& m_conn_context)
+  {
+    LOG_PRINT_L2("HTTP [" << m_conn_context.m_remote_address.host_str() << "] " << query_info.m_http_method_str << " " << query_info.m_URI);
+    response.m_response_code = 200;
+    response.m_response_comment = "Ok";
+
+    auto reset = epee::misc_utils::create_scope_leave_handler([](){
+      m_wallet = NULL;
+      m_routed = NULL;
+    });
+
+    if (!m_wallet_pool)
+    {
+      // only one thread serves requests, and open_wallet/create_wallet may swap the wallet
+      m_wallet = m_single_wallet;
+      const bool handled = handle_http_request_map(query_info, response, m_conn_context);
+      m_single_wallet = m_wallet;
+      if (!handled)
+      {
+        response.m_response_code = 404;
+        response.m_response_comment = "Not found";
+      }
+      return true;
+    }
+
+    // /wallet/<name>/json_rpc, where name is a wallet file in m_wallet_dir
+    static const std::string prefix = "/wallet/";
+    const std::string &uri = query_info.m_URI;
+    const size_t slash = uri.find('/', prefix.size());
+    routed_wallet routed;
+    if (uri.compare(0, prefix.size(), prefix) == 0 && slash != std::string::npos)
+      routed.id = uri.substr(prefix.size(), slash - prefix.size());
+    if (routed.id.empty() || routed.id[0] == '.' || routed.id.find_first_of("\\:") != std::string::npos)
+    {
+      response.m_response_code = 404;
+      response.m_response_comment = "Not found";
+      return true;
+    }
+
+    epee::net_utils::http::http_request_info routed_info = query_info;
+    routed_info.m_URI = uri.substr(slash);
+    // anyone may name the wallet, only those it was opened for have its token
+    std::string token;
+    for (const auto &field: query_info.m_header_info.m_etc_fields)
+      if (boost::iequals(field.first, "X-Wallet-Token"))
+        token = field.second;
+    routed.handle = m_wallet_pool->acquire(routed.id);
+    if (routed.handle.authorized(token))
+      m_wallet = routed.handle.get();
+    m_routed = &routed;
+    if (!handle_http_request_map(routed_info, response, m_conn_context))
+    {
+      response.m_response_code = 404;
+      response.m_response_comment = "Not found";
+    }
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool wallet_rpc_server::not_open(epee::json_rpc::error& er)
   {
       er.code = WALLET_RPC_ERROR_CODE_NOT_OPEN;
-      er.message = "No wallet file";
+      er.message = m_routed && m_routed->handle ? "Missing or invalid wallet token" : "No wallet file";
       return false;
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -1404,6 +1506,18 @@ namespace tools
 
     try
     {
+      if (m_wallet_pool)
+      {
+        // only this wallet is closed, the others are still served
+        if (!m_wallet_pool->close(m_routed->handle))
+        {
+          er.code = WALLET_RPC_ERROR_CODE_UNKNOWN_ERROR;
+          er.message = "Failed to store wallet";
+          return false;
+        }
+        m_wallet = NULL;
+        return true;
+      }
       m_wallet->store();
       m_stop.store(true, std::memory_order_relaxed);
     }
@@ -2142,7 +2256,11 @@ namespace tools
     daemon_req.ignore_battery       = req.ignore_battery;
 
     cryptonote::COMMAND_RPC_START_MINING::response daemon_res;
-    bool r = net_utils::invoke_http_json("/start_mining", daemon_req, daemon_res, m_http_client);
+    bool r;
+    {
+      boost::lock_guard<boost::mutex> lock(m_http_client_lock);
+      r = net_utils::invoke_http_json("/start_mining", daemon_req, daemon_res, m_http_client);
+    }
     if (!r || daemon_res.status != CORE_RPC_STATUS_OK)
     {
       er.code = WALLET_RPC_ERROR_CODE_UNKNOWN_ERROR;
@@ -2156,7 +2274,11 @@ namespace tools
   {
     cryptonote::COMMAND_RPC_STOP_MINING::request daemon_req;
     cryptonote::COMMAND_RPC_STOP_MINING::response daemon_res;
-    bool r = net_utils::invoke_http_json("/stop_mining", daemon_req, daemon_res, m_http_client);
+    bool r;
+    {
+      boost::lock_guard<boost::mutex> lock(m_http_client_lock);
+      r = net_utils::invoke_http_json("/stop_mining", daemon_req, daemon_res, m_http_client);
+    }
     if (!r || daemon_res.status != CORE_RPC_STATUS_OK)
     {
       er.code = WALLET_RPC_ERROR_CODE_UNKNOWN_ERROR;
@@ -2181,14 +2303,26 @@ namespace tools
       return false;
     }
 
+    std::string filename = req.filename;
+    if (m_wallet_pool)
+    {
+      if (!filename.empty() && filename != m_routed->id)
+      {
+        er.code = WALLET_RPC_ERROR_CODE_UNKNOWN_ERROR;
+        er.message = "Filename does not match the wallet in the URI";
+        return false;
+      }
+      filename = m_routed->id;
+    }
+
     namespace po = boost::program_options;
     po::variables_map vm2;
-    const char *ptr = strchr(req.filename.c_str(), '/');
+    const char *ptr = strchr(filename.c_str(), '/');
 #ifdef _WIN32
     if (!ptr)
-      ptr = strchr(req.filename.c_str(), '\\');
+      ptr = strchr(filename.c_str(), '\\');
     if (!ptr)
-      ptr = strchr(req.filename.c_str(), ':');
+      ptr = strchr(filename.c_str(), ':');
 #endif
     if (ptr)
     {
@@ -2196,7 +2330,7 @@ namespace tools
       er.message = "Invalid filename";
       return false;
     }
-    std::string wallet_file = m_wallet_dir + "/" + req.filename;
+    std::string wallet_file = m_wallet_dir + "/" + filename;
     {
       std::vector<std::string> languages;
       crypto::ElectrumWords::get_language_list(languages);
@@ -2236,7 +2370,11 @@ namespace tools
     cryptonote::COMMAND_RPC_GET_HEIGHT::request hreq;
     cryptonote::COMMAND_RPC_GET_HEIGHT::response hres;
     hres.height = 0;
-    bool r = net_utils::invoke_http_json("/getheight", hreq, hres, m_http_client);
+    bool r;
+    {
+      boost::lock_guard<boost::mutex> lock(m_http_client_lock);
+      r = net_utils::invoke_http_json("/getheight", hreq, hres, m_http_client);
+    }
     wal->set_refresh_from_block_height(hres.height);
     crypto::secret_key dummy_key;
     try {
@@ -2253,6 +2391,16 @@ namespace tools
       er.message = "Failed to generate wallet";
       return false;
     }
+    if (m_wallet_pool)
+    {
+      if (!m_wallet_pool->add(filename, req.password, std::move(wal), res.token))
+      {
+        er.code = WALLET_RPC_ERROR_CODE_UNKNOWN_ERROR;
+        er.message = "Wallet is already open";
+        return false;
+      }
+      return true;
+    }
     if (m_wallet)
       delete m_wallet;
     m_wallet = wal.release();
@@ -2268,14 +2416,36 @@ namespace tools
       return false;
     }
 
-    namespace po = boost::program_options;
-    po::variables_map vm2;
-    const char *ptr = strchr(req.filename.c_str(), '/');
+    std::string filename = req.filename;
+    if (m_wallet_pool)
+    {
+      if (!filename.empty() && filename != m_routed->id)
+      {
+        er.code = WALLET_RPC_ERROR_CODE_UNKNOWN_ERROR;
+        er.message = "Filename does not match the wallet in the URI";
+        return false;
+      }
+      filename = m_routed->id;
+      if (m_routed->handle)
+      {
+        // already open, eg by another session for the same wallet
+        if (!m_routed->handle->verify_password(req.password))
+        {
+          er.code = WALLET_RPC_ERROR_CODE_UNKNOWN_ERROR;
+          er.message = "Invalid password";
+          return false;
+        }
+        res.token = m_routed->handle.token();
+        return true;
+      }
+    }
+
+    const char *ptr = strchr(filename.c_str(), '/');
 #ifdef _WIN32
     if (!ptr)
-      ptr = strchr(req.filename.c_str(), '\\');
+      ptr = strchr(filename.c_str(), '\\');
     if (!ptr)
-      ptr = strchr(req.filename.c_str(), ':');
+      ptr = strchr(filename.c_str(), ':');
 #endif
     if (ptr)
     {
@@ -2283,23 +2453,10 @@ namespace tools
       er.message = "Invalid filename";
       return false;
     }
-    std::string wallet_file = m_wallet_dir + "/" + req.filename;
-    {
-      po::options_description desc("dummy");
-      const command_line::arg_descriptor<std::string, true> arg_password = {"password", "password"};
-      const char *argv[4];
-      int argc = 3;
-      argv[0] = "wallet-rpc";
-      argv[1] = "--password";
-      argv[2] = req.password.c_str();
-      argv[3] = NULL;
-      vm2 = *m_vm;
-      command_line::add_arg(desc, arg_password);
-      po::store(po::parse_command_line(argc, argv, desc), vm2);
-    }
+    std::string wallet_file = m_wallet_dir + "/" + filename;
     std::unique_ptr<tools::wallet2> wal = nullptr;
     try {
-      wal = tools::wallet2::make_from_file(vm2, wallet_file, nullptr).first;
+      wal = open_wallet_file(wallet_file, req.password);
     }
     catch (const std::exception& e)
     {
@@ -2311,12 +2468,43 @@ namespace tools
       er.message = "Failed to open wallet";
       return false;
     }
+    if (m_wallet_pool)
+    {
+      if (!m_wallet_pool->add(filename, req.password, std::move(wal), res.token))
+      {
+        er.code = WALLET_RPC_ERROR_CODE_UNKNOWN_ERROR;
+        er.message = "Wallet is already open";
+        return false;
+      }
+      return true;
+    }
     if (m_wallet)
       delete m_wallet;
     m_wallet = wal.release();
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  std::unique_ptr<wallet2> wallet_rpc_server::open_wallet_file(const std::string &wallet_file, const epee::wipeable_string &password)
+  {
+    namespace po = boost::program_options;
+    po::variables_map vm2;
+    {
+      po::options_description desc("dummy");
+      const command_line::arg_descriptor<std::string, true> arg_password = {"password", "password"};
+      const std::string password_string(password.data(), password.size());
+      const char *argv[4];
+      int argc = 3;
+      argv[0] = "wallet-rpc";
+      argv[1] = "--password";
+      argv[2] = password_string.c_str();
+      argv[3] = NULL;
+      vm2 = *m_vm;
+      command_line::add_arg(desc, arg_password);
+      po::store(po::parse_command_line(argc, argv, desc), vm2);
+    }
+    return tools::wallet2::make_from_file(vm2, wallet_file, nullptr).first;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   void wallet_rpc_server::handle_rpc_exception(const std::exception_ptr& e, epee::json_rpc::error& er, int default_error_code) {
     try
     {
@@ -2771,6 +2959,9 @@ int main(int argc, char** argv) {
   command_line::add_arg(desc_params, arg_from_json);
   command_line::add_arg(desc_params, arg_wallet_dir);
   command_line::add_arg(desc_params, arg_prompt_for_password);
+  command_line::add_arg(desc_params, arg_max_open_wallets);
+  command_line::add_arg(desc_params, arg_rpc_threads);
+  command_line::add_arg(desc_params, arg_wallet_refresh_threads);
 
   const auto vm = wallet_args::main(
     argc, argv,
@@ -33,10 +33,12 @@
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include <string>
+#include <boost/thread/mutex.hpp>
 #include "common/util.h"
 #include "net/http_server_impl_base.h"
 #include "wallet_rpc_server_commands_defs.h"
 #include "wallet2.h"
+#include "wallet_pool.h"
 
 #undef MONERO_DEFAULT_LOG_CATEGORY
 #define MONERO_DEFAULT_LOG_CATEGORY "wallet.rpc"
@@ -63,7 +65,8 @@ namespace tools
 
   private:
 
-    CHAIN_HTTP_TO_MAP2(connection_context); //forward http requests to uri map
+    // picks the wallet for a request, then forwards it to the uri map
+    bool handle_http_request(const epee::net_utils::http::http_request_info& query_info, epee::net_utils::http::http_response_info& response, connection_context& m_conn_context);
 
     BEGIN_URI_MAP2()
       BEGIN_JSON_RPC_MAP("/json_rpc")
@@ -205,6 +208,7 @@ namespace tools
       void fill_transfer_entry(tools::wallet_rpc::transfer_entry &entry, const crypto::hash &txid, const tools::wallet2::unconfirmed_transfer_details &pd);
       void fill_transfer_entry(tools::wallet_rpc::transfer_entry &entry, const crypto::hash &payment_id, const tools::wallet2::pool_payment_details &pd);
       bool not_open(epee::json_rpc::error& er);
+      std::unique_ptr<wallet2> open_wallet_file(const std::string &wallet_file, const epee::wipeable_string &password);
       void handle_rpc_exception(const std::exception_ptr& e, epee::json_rpc::error& er, int default_error_code);
 
       template<typename Ts, typename Tu>
@@ -212,12 +216,28 @@ namespace tools
           bool get_tx_key, Ts& tx_key, Tu &amount, Tu &fee, std::string &multisig_txset, bool do_not_relay,
           Ts &tx_hash, bool get_tx_hex, Ts &tx_blob, bool get_tx_metadata, Ts &tx_metadata, epee::json_rpc::error &er);
 
-      wallet2 *m_wallet;
+      //! the wallet a request in multi wallet mode was routed to
+      struct routed_wallet
+      {
+        std::string id;
+        wallet_pool::handle handle;
+      };
+
+      //! the wallet the current request works on. Requests for different
+      //! wallets are served concurrently, so this is per thread
+      static __thread wallet2 *m_wallet;
+      static __thread routed_wallet *m_routed;
+
+      wallet2 *m_single_wallet;                     //!< the wallet, when serving a single one
+      std::unique_ptr<wallet_pool> m_wallet_pool;   //!< the wallets, when serving any in m_wallet_dir
+      size_t m_rpc_threads;
+      size_t m_refresh_threads;
       std::string m_wallet_dir;
       tools::private_file rpc_login_file;
       std::atomic<bool> m_stop;
       bool m_trusted_daemon;
       epee::net_utils::http::http_simple_client m_http_client;
+      boost::mutex m_http_client_lock;
       const boost::program_options::variables_map *m_vm;
   };
 }
@@ -1580,7 +1580,10 @@ namespace wallet_rpc
     };
     struct response
     {
+      std::string token; // with --max-open-wallets, to be sent as X-Wallet-Token with each request for this wallet
+
       BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(token)
       END_KV_SERIALIZE_MAP()
     };
   };
@@ -1599,7 +1602,10 @@ namespace wallet_rpc
     };
     struct response
     {
+      std::string token; // with --max-open-wallets, to be sent as X-Wallet-Token with each request for this wallet
+
       BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(token)
       END_KV_SERIALIZE_MAP()
     };
   };
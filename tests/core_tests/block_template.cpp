@@ -0,0 +1,283 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "chaingen.h"
+#include "block_template.h"
+
+using namespace cryptonote;
+
+namespace
+{
+  bool hash_less(const crypto::hash& a, const crypto::hash& b)
+  {
+    return memcmp(&a, &b, sizeof(a)) < 0;
+  }
+
+  struct block_template
+  {
+    std::vector<crypto::hash> tx_hashes;  //!< sorted, ties in fee per byte may be ordered differently
+    size_t total_size;
+    uint64_t fee;
+    uint64_t expected_reward;
+
+    bool operator==(const block_template& t) const
+    {
+      return tx_hashes == t.tx_hashes && total_size == t.total_size && fee == t.fee && expected_reward == t.expected_reward;
+    }
+  };
+
+  bool fill(tx_memory_pool& pool, core& c, uint8_t version, block_template& t)
+  {
+    const uint64_t height = c.get_current_blockchain_height();
+    const uint64_t already_generated_coins = c.get_blockchain_storage().get_db().get_block_already_generated_coins(height - 1);
+    block b;
+    if (!pool.fill_block_template(b, CRYPTONOTE_BLOCK_GRANTED_FULL_REWARD_ZONE_V1, already_generated_coins, t.total_size, t.fee, t.expected_reward, version))
+      return false;
+    t.tx_hashes = b.tx_hashes;
+    std::sort(t.tx_hashes.begin(), t.tx_hashes.end(), hash_less);
+    return true;
+  }
+
+  // fills a template with the core's pool, and checks it against what a pool
+  // with nothing cached, loaded from the same database, makes
+  bool fill_and_compare(core& c, uint8_t version, block_template& t)
+  {
+    if (!fill(c.get_pool(), c, version, t))
+      return false;
+    tx_memory_pool fresh(c.get_blockchain_storage());
+    block_template expected;
+    if (!fresh.init() || !fill(fresh, c, version, expected))
+      return false;
+    return t == expected;
+  }
+
+  bool fill_and_compare(core& c, block_template& t)
+  {
+    return fill_and_compare(c, c.get_blockchain_storage().get_current_hard_fork_version(), t);
+  }
+
+  bool contains(const block_template& t, const transaction& tx)
+  {
+    return std::binary_search(t.tx_hashes.begin(), t.tx_hashes.end(), get_transaction_hash(tx), hash_less);
+  }
+}
+
+////////
+// class gen_tx_pool_block_template;
+
+gen_tx_pool_block_template::gen_tx_pool_block_template()
+{
+  REGISTER_CALLBACK_METHOD(gen_tx_pool_block_template, check_reuse);
+  REGISTER_CALLBACK_METHOD(gen_tx_pool_block_template, check_add_take);
+  REGISTER_CALLBACK_METHOD(gen_tx_pool_block_template, check_double_spend);
+  REGISTER_CALLBACK_METHOD(gen_tx_pool_block_template, check_spent_by_block);
+  REGISTER_CALLBACK_METHOD(gen_tx_pool_block_template, check_reorg);
+  REGISTER_CALLBACK_METHOD(gen_tx_pool_block_template, check_version_change);
+}
+
+bool gen_tx_pool_block_template::snapshot_valid(cryptonote::core& c)
+{
+  return c.get_pool().m_template_snapshot.valid;
+}
+
+bool gen_tx_pool_block_template::generate(std::vector<test_event_entry>& events) const
+{
+  uint64_t ts_start = 1338224400;
+
+  GENERATE_ACCOUNT(miner);
+  MAKE_GENESIS_BLOCK(events, blk_0, miner, ts_start);
+  MAKE_ACCOUNT(events, alice);
+  MAKE_ACCOUNT(events, bob);
+  MAKE_ACCOUNT(events, carol);
+  MAKE_ACCOUNT(events, dave);
+  MAKE_NEXT_BLOCK(events, blk_1, blk_0, alice);
+  MAKE_NEXT_BLOCK(events, blk_2, blk_1, bob);
+  MAKE_NEXT_BLOCK(events, blk_3, blk_2, carol);
+  MAKE_NEXT_BLOCK(events, blk_4, blk_3, dave);
+  REWIND_BLOCKS(events, blk_4r, blk_4, miner);
+
+  // each sender has a single output, so each tx spends a different one
+  MAKE_TX(events, tx_a, alice, miner, MK_COINS(1), blk_4r);
+  MAKE_TX(events, tx_b, bob, miner, MK_COINS(1), blk_4r);
+  DO_CALLBACK(events, "check_reuse");
+
+  MAKE_TX(events, tx_c, carol, miner, MK_COINS(1), blk_4r);
+  DO_CALLBACK(events, "check_add_take");
+
+  // tx_d2 spends the same output as tx_d, with a higher fee so it is
+  // preferred; both are made before either is added so they pick that output.
+  // The pool only keeps such double spends for txes from popped blocks.
+  transaction tx_d, tx_d2;
+  construct_tx_to_key(events, tx_d, blk_4r, dave, miner, MK_COINS(1), TESTS_DEFAULT_FEE, 0);
+  construct_tx_to_key(events, tx_d2, blk_4r, dave, miner, MK_COINS(2), TESTS_DEFAULT_FEE * 2, 0);
+  SET_EVENT_VISITOR_SETT(events, event_visitor_settings::set_txs_keeped_by_block, true);
+  events.push_back(tx_d);
+  events.push_back(tx_d2);
+  SET_EVENT_VISITOR_SETT(events, event_visitor_settings::set_txs_keeped_by_block, false);
+  DO_CALLBACK(events, "check_double_spend");
+
+  // mining tx_d2 spends tx_d's key image
+  MAKE_NEXT_BLOCK_TX1(events, blk_5, blk_4r, miner, tx_d2);
+  DO_CALLBACK(events, "check_spent_by_block");
+
+  // a longer chain without tx_d2 pops blk_5, and tx_d2 goes back to the pool
+  MAKE_NEXT_BLOCK(events, blk_5a, blk_4r, miner);
+  MAKE_NEXT_BLOCK(events, blk_6a, blk_5a, miner);
+  DO_CALLBACK(events, "check_reorg");
+  DO_CALLBACK(events, "check_version_change");
+
+  return true;
+}
+
+bool gen_tx_pool_block_template::check_reuse(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_tx_pool_block_template::check_reuse");
+
+  const transaction& tx_a = boost::get<transaction>(events[ev_index - 2]);
+  const transaction& tx_b = boost::get<transaction>(events[ev_index - 1]);
+
+  block_template t;
+  CHECK_TEST_CONDITION(fill_and_compare(c, t));
+  CHECK_EQ(t.tx_hashes.size(), 2);
+  CHECK_TEST_CONDITION(contains(t, tx_a));
+  CHECK_TEST_CONDITION(contains(t, tx_b));
+  CHECK_TEST_CONDITION(snapshot_valid(c));
+
+  // nothing changed, so the snapshot is reused as is
+  block_template reused;
+  CHECK_TEST_CONDITION(fill_and_compare(c, reused));
+  CHECK_TEST_CONDITION(reused == t);
+  CHECK_TEST_CONDITION(snapshot_valid(c));
+
+  return true;
+}
+
+bool gen_tx_pool_block_template::check_add_take(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_tx_pool_block_template::check_add_take");
+
+  const transaction& tx_c = boost::get<transaction>(events[ev_index - 1]);
+
+  // adding tx_c dropped the snapshot
+  CHECK_TEST_CONDITION(!snapshot_valid(c));
+  block_template t;
+  CHECK_TEST_CONDITION(fill_and_compare(c, t));
+  CHECK_EQ(t.tx_hashes.size(), 3);
+  CHECK_TEST_CONDITION(contains(t, tx_c));
+
+  // as does taking it out again
+  transaction tx;
+  size_t blob_size;
+  uint64_t fee;
+  bool relayed, do_not_relay, double_spend_seen;
+  CHECK_TEST_CONDITION(c.get_pool().take_tx(get_transaction_hash(tx_c), tx, blob_size, fee, relayed, do_not_relay, double_spend_seen));
+  CHECK_TEST_CONDITION(!snapshot_valid(c));
+  CHECK_TEST_CONDITION(fill_and_compare(c, t));
+  CHECK_EQ(t.tx_hashes.size(), 2);
+  CHECK_TEST_CONDITION(!contains(t, tx_c));
+
+  return true;
+}
+
+bool gen_tx_pool_block_template::check_double_spend(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_tx_pool_block_template::check_double_spend");
+
+  const transaction& tx_d = boost::get<transaction>(events[ev_index - 3]);
+  const transaction& tx_d2 = boost::get<transaction>(events[ev_index - 2]);
+
+  // both are checked and ready, but only one can go in a block
+  CHECK_EQ(c.get_pool_transactions_count(), 4);
+  block_template t;
+  CHECK_TEST_CONDITION(fill_and_compare(c, t));
+  CHECK_EQ(t.tx_hashes.size(), 3);
+  CHECK_TEST_CONDITION(contains(t, tx_d2));
+  CHECK_TEST_CONDITION(!contains(t, tx_d));
+
+  return true;
+}
+
+bool gen_tx_pool_block_template::check_spent_by_block(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_tx_pool_block_template::check_spent_by_block");
+
+  const transaction& tx_d = boost::get<transaction>(events[ev_index - 5]);
+
+  // tx_d was ready on the previous tip, but the new block spent its key image
+  CHECK_TEST_CONDITION(!snapshot_valid(c));
+  CHECK_TEST_CONDITION(c.get_pool().have_tx(get_transaction_hash(tx_d)));
+  block_template t;
+  CHECK_TEST_CONDITION(fill_and_compare(c, t));
+  CHECK_EQ(t.tx_hashes.size(), 2);
+  CHECK_TEST_CONDITION(!contains(t, tx_d));
+
+  return true;
+}
+
+bool gen_tx_pool_block_template::check_reorg(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_tx_pool_block_template::check_reorg");
+
+  const transaction& tx_d2 = boost::get<transaction>(events[ev_index - 7]);
+  const block& blk_6a = boost::get<block>(events[ev_index - 1]);
+  CHECK_TEST_CONDITION(c.get_tail_id() == get_block_hash(blk_6a));
+
+  // popping blk_5 unspent tx_d2's inputs and gave it back to the pool
+  CHECK_TEST_CONDITION(!snapshot_valid(c));
+  CHECK_EQ(c.get_pool_transactions_count(), 4);
+  block_template t;
+  CHECK_TEST_CONDITION(fill_and_compare(c, t));
+  CHECK_EQ(t.tx_hashes.size(), 3);
+  CHECK_TEST_CONDITION(contains(t, tx_d2));
+
+  return true;
+}
+
+bool gen_tx_pool_block_template::check_version_change(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_tx_pool_block_template::check_version_change");
+
+  const uint8_t version = c.get_blockchain_storage().get_current_hard_fork_version();
+  block_template t;
+  CHECK_TEST_CONDITION(fill_and_compare(c, version, t));
+  CHECK_TEST_CONDITION(snapshot_valid(c));
+
+  // a template for another version is filled again, with its own rules,
+  // and so is the one for the original version afterwards
+  const uint8_t other_version = version < 5 ? 5 : 1;
+  block_template other;
+  CHECK_TEST_CONDITION(fill_and_compare(c, other_version, other));
+  CHECK_EQ(c.get_pool().m_template_version, other_version);
+  CHECK_EQ(c.get_pool().m_template_snapshot.version, other_version);
+  block_template again;
+  CHECK_TEST_CONDITION(fill_and_compare(c, version, again));
+  CHECK_TEST_CONDITION(again == t);
+  CHECK_EQ(c.get_pool().m_template_version, version);
+
+  return true;
+}
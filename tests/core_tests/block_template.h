@@ -0,0 +1,49 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+#include "chaingen.h"
+
+/************************************************************************/
+/*                                                                      */
+/************************************************************************/
+class gen_tx_pool_block_template : public test_chain_unit_base
+{
+public:
+  gen_tx_pool_block_template();
+  bool generate(std::vector<test_event_entry>& events) const;
+  bool check_reuse(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_add_take(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_double_spend(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_spent_by_block(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_reorg(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+  bool check_version_change(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events);
+
+private:
+  static bool snapshot_valid(cryptonote::core& c);
+};
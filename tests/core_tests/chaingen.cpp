@@ -366,7 +366,7 @@ bool init_spent_output_indices(map_output_idx_t& outs, map_output_t& outs_mine,
             crypto::key_image img;
             keypair in_ephemeral;
             crypto::public_key out_key = boost::get<txout_to_key>(oi.out).key;
-            std::unordered_map<crypto::public_key, cryptonote::subaddress_index> subaddresses;
+            cryptonote::subaddress_map subaddresses;
             subaddresses[from.get_keys().m_account_address.m_spend_public_key] = {0,0};
             generate_key_image_helper(from.get_keys(), subaddresses, out_key, get_tx_pub_key_from_extra(*oi.p_tx), get_additional_tx_pub_keys_from_extra(*oi.p_tx), oi.out_no, in_ephemeral, img);
 
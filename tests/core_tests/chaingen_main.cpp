@@ -218,6 +218,11 @@ int main(int argc, char* argv[])
     GENERATE_AND_PLAY(gen_multisig_tx_invalid_33_1_2_no_threshold);
     GENERATE_AND_PLAY(gen_multisig_tx_invalid_33_1_3_no_threshold);
 
+    GENERATE_AND_PLAY(gen_light_wallet_login);
+    GENERATE_AND_PLAY(gen_light_wallet_scan);
+
+    GENERATE_AND_PLAY(gen_tx_pool_block_template);
+
     el::Level level = (failed_tests.empty() ? el::Level::Info : el::Level::Error);
     MLOG(level, "\nREPORT:");
     MLOG(level, "  Test run: " << tests_count);
@@ -0,0 +1,231 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <unordered_set>
+
+#include "chaingen.h"
+#include "light_wallet.h"
+
+using namespace cryptonote;
+
+////////
+// class gen_light_wallet_login;
+
+gen_light_wallet_login::gen_light_wallet_login()
+{
+  REGISTER_CALLBACK_METHOD(gen_light_wallet_login, check_login);
+}
+
+bool gen_light_wallet_login::generate(std::vector<test_event_entry>& events) const
+{
+  uint64_t ts_start = 1338224400;
+
+  GENERATE_ACCOUNT(miner);
+  MAKE_GENESIS_BLOCK(events, blk_0, miner, ts_start);
+  MAKE_ACCOUNT(events, alice);
+  MAKE_ACCOUNT(events, bob);
+  MAKE_ACCOUNT(events, carol);
+  MAKE_NEXT_BLOCK(events, blk_1, blk_0, miner);
+  DO_CALLBACK(events, "check_login");
+
+  return true;
+}
+
+bool gen_light_wallet_login::check_login(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_light_wallet_login::check_login");
+
+  const account_keys& alice = boost::get<account_base>(events[1]).get_keys();
+  const account_keys& bob = boost::get<account_base>(events[2]).get_keys();
+  const account_keys& carol = boost::get<account_base>(events[3]).get_keys();
+
+  light_wallet_scanner scanner(c.get_blockchain_storage(), c.get_pool());
+  scanner.set_max_accounts(2);
+  bool new_address;
+
+  // unknown accounts are only registered when asked to
+  CHECK_TEST_CONDITION(!scanner.login(alice.m_account_address, alice.m_view_secret_key, false, new_address));
+  CHECK_TEST_CONDITION(!new_address);
+  CHECK_EQ(scanner.get_account_count(), 0);
+  CHECK_TEST_CONDITION(scanner.login(alice.m_account_address, alice.m_view_secret_key, true, new_address));
+  CHECK_TEST_CONDITION(new_address);
+  CHECK_EQ(scanner.get_account_count(), 1);
+
+  // new accounts cannot have received anything before they were registered
+  uint64_t start_height = 0;
+  CHECK_TEST_CONDITION(scanner.with_account(alice.m_account_address, alice.m_view_secret_key, [&](const lw_account& account) {
+    start_height = account.start_height;
+  }));
+  CHECK_EQ(start_height, c.get_current_blockchain_height());
+
+  // logging in again finds the same account
+  CHECK_TEST_CONDITION(scanner.login(alice.m_account_address, alice.m_view_secret_key, false, new_address));
+  CHECK_TEST_CONDITION(!new_address);
+  CHECK_TEST_CONDITION(scanner.login(alice.m_account_address, alice.m_view_secret_key, true, new_address));
+  CHECK_TEST_CONDITION(!new_address);
+  CHECK_EQ(scanner.get_account_count(), 1);
+
+  // a view key which does not match the address is refused, even when creating
+  CHECK_TEST_CONDITION(!scanner.login(alice.m_account_address, bob.m_view_secret_key, true, new_address));
+  CHECK_TEST_CONDITION(!new_address);
+  CHECK_TEST_CONDITION(!scanner.with_account(alice.m_account_address, bob.m_view_secret_key, [](const lw_account&) {}));
+
+  // as is a matching view key for the spend key of another account
+  account_public_address mixed = alice.m_account_address;
+  mixed.m_view_public_key = bob.m_account_address.m_view_public_key;
+  CHECK_TEST_CONDITION(!scanner.login(mixed, bob.m_view_secret_key, true, new_address));
+  CHECK_TEST_CONDITION(!new_address);
+  CHECK_EQ(scanner.get_account_count(), 1);
+
+  // past the limit, accounts can log in but no new one is registered
+  CHECK_TEST_CONDITION(!scanner.is_full());
+  CHECK_TEST_CONDITION(scanner.login(bob.m_account_address, bob.m_view_secret_key, true, new_address));
+  CHECK_TEST_CONDITION(new_address);
+  CHECK_TEST_CONDITION(scanner.is_full());
+  CHECK_TEST_CONDITION(!scanner.login(carol.m_account_address, carol.m_view_secret_key, true, new_address));
+  CHECK_TEST_CONDITION(!new_address);
+  CHECK_EQ(scanner.get_account_count(), 2);
+  CHECK_TEST_CONDITION(scanner.login(bob.m_account_address, bob.m_view_secret_key, false, new_address));
+
+  return true;
+}
+
+////////
+// class gen_light_wallet_scan;
+
+gen_light_wallet_scan::gen_light_wallet_scan()
+{
+  REGISTER_CALLBACK_METHOD(gen_light_wallet_scan, check_scan);
+}
+
+bool gen_light_wallet_scan::generate(std::vector<test_event_entry>& events) const
+{
+  uint64_t ts_start = 1338224400;
+
+  GENERATE_ACCOUNT(miner);
+  MAKE_GENESIS_BLOCK(events, blk_0, miner, ts_start);
+  MAKE_ACCOUNT(events, alice);
+  MAKE_ACCOUNT(events, bob);
+  MAKE_ACCOUNT(events, carol);
+  MAKE_NEXT_BLOCK(events, blk_1, blk_0, alice);
+  MAKE_NEXT_BLOCK(events, blk_2, blk_1, carol);
+  REWIND_BLOCKS(events, blk_2r, blk_2, miner);
+  MAKE_TX_LIST_START(events, txs_3, alice, bob, MK_COINS(1), blk_2r);
+  MAKE_TX_LIST(events, txs_3, carol, alice, MK_COINS(2), blk_2r);
+  MAKE_NEXT_BLOCK_TX_LIST(events, blk_3, blk_2r, miner, txs_3);
+  MAKE_TX_LIST_START(events, txs_4, bob, carol, MK_COINS(1) / 2, blk_3);
+  MAKE_NEXT_BLOCK_TX_LIST(events, blk_4, blk_3, miner, txs_4);
+  DO_CALLBACK(events, "check_scan");
+
+  return true;
+}
+
+bool gen_light_wallet_scan::check_scan(cryptonote::core& c, size_t ev_index, const std::vector<test_event_entry>& events)
+{
+  DEFINE_TESTS_ERROR_CONTEXT("gen_light_wallet_scan::check_scan");
+
+  std::vector<block> chain;
+  map_hash2tx_t mtx;
+  CHECK_TEST_CONDITION(find_block_chain(events, chain, mtx, get_block_hash(boost::get<block>(events[ev_index - 1]))));
+  const uint64_t chain_height = c.get_current_blockchain_height();
+  CHECK_EQ(chain.size(), chain_height);
+
+  // all accounts are scanned in the same pass over the chain
+  light_wallet_scanner scanner(c.get_blockchain_storage(), c.get_pool());
+  bool new_address;
+  for (size_t n = 1; n <= 3; ++n)
+  {
+    const account_keys& keys = boost::get<account_base>(events[n]).get_keys();
+    CHECK_TEST_CONDITION(scanner.login(keys.m_account_address, keys.m_view_secret_key, true, new_address));
+    CHECK_TEST_CONDITION(scanner.rescan(keys.m_account_address, keys.m_view_secret_key));
+  }
+  CHECK_TEST_CONDITION(scanner.scan_to_tip());
+
+  for (size_t n = 1; n <= 3; ++n)
+  {
+    const account_keys& keys = boost::get<account_base>(events[n]).get_keys();
+
+    // what a wallet with the spend key would find on its own
+    std::vector<std::pair<crypto::hash, uint64_t>> expected_outputs;
+    std::unordered_set<crypto::key_image> own_key_images;
+    std::vector<crypto::key_image> expected_spends;
+    uint64_t expected_received = 0;
+    for (size_t h = 0; h < chain.size(); ++h)
+    {
+      std::vector<const transaction*> txs(1, &chain[h].miner_tx);
+      for (const crypto::hash& txid: chain[h].tx_hashes)
+        txs.push_back(mtx.at(txid));
+      for (const transaction* tx: txs)
+      {
+        for (const txin_v& in: tx->vin)
+          if (in.type() == typeid(txin_to_key) && own_key_images.count(boost::get<txin_to_key>(in).k_image))
+            expected_spends.push_back(boost::get<txin_to_key>(in).k_image);
+
+        std::vector<size_t> outs;
+        uint64_t money = 0;
+        CHECK_TEST_CONDITION(lookup_acc_outs(keys, *tx, outs, money));
+        const crypto::hash txid = get_transaction_hash(*tx);
+        for (size_t i: outs)
+        {
+          keypair in_ephemeral;
+          crypto::key_image ki;
+          subaddress_map subaddresses;
+          subaddresses[keys.m_account_address.m_spend_public_key] = {0, 0};
+          CHECK_TEST_CONDITION(generate_key_image_helper(keys, subaddresses, boost::get<txout_to_key>(tx->vout[i].target).key, get_tx_pub_key_from_extra(*tx), {}, i, in_ephemeral, ki));
+          own_key_images.insert(ki);
+          expected_outputs.push_back(std::make_pair(txid, i));
+        }
+        expected_received += money;
+      }
+    }
+    CHECK_TEST_CONDITION(!expected_outputs.empty());
+
+    std::vector<std::pair<crypto::hash, uint64_t>> outputs;
+    std::vector<crypto::key_image> spends;
+    uint64_t received = 0, scanned_height = 0;
+    CHECK_TEST_CONDITION(scanner.with_account(keys.m_account_address, keys.m_view_secret_key, [&](const lw_account& account) {
+      scanned_height = account.scanned_height;
+      for (const lw_output& o: account.outputs)
+      {
+        outputs.push_back(std::make_pair(o.tx_hash, o.index));
+        received += o.amount;
+      }
+      for (const lw_tx& tx: account.txs)
+        for (const lw_spend& spend: tx.spends)
+          spends.push_back(spend.key_image);
+    }));
+
+    CHECK_EQ(scanned_height, chain_height);
+    CHECK_TEST_CONDITION(outputs == expected_outputs);
+    CHECK_EQ(received, expected_received);
+    // rings have no decoys here, so every recorded spend is a real one
+    CHECK_TEST_CONDITION(spends == expected_spends);
+  }
+
+  return true;
+}
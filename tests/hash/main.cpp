@@ -29,6 +29,7 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #include <cstddef>
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <ios>
@@ -51,6 +52,20 @@ extern "C" {
     }
     tree_hash((const char (*)[32]) data, length >> 5, hash);
   }
+
+  static void hash_slow_multi(const void *data, size_t length, char *hash) {
+    // the test data goes in the second lane, and the first one is checked against cn_slow_hash
+    static const char other[] = "cn_slow_hash_multi";
+    const void *inputs[2] = {other, data};
+    const size_t lengths[2] = {sizeof(other) - 1, length};
+    char hashes[2 * 32], expected[32];
+    cn_slow_hash_multi(inputs, lengths, 2, hashes);
+    cn_slow_hash(other, sizeof(other) - 1, expected);
+    if (memcmp(hashes, expected, 32) != 0) {
+      throw ios_base::failure("Mismatched hash in the first lane");
+    }
+    memcpy(hash, hashes + 32, 32);
+  }
 }
 POP_WARNINGS
 
@@ -58,7 +73,7 @@ extern "C" typedef void hash_f(const void *, size_t, char *);
 struct hash_func {
   const string name;
   hash_f &f;
-} hashes[] = {{"fast", cn_fast_hash}, {"slow", cn_slow_hash}, {"tree", hash_tree},
+} hashes[] = {{"fast", cn_fast_hash}, {"slow", cn_slow_hash}, {"slow-multi", hash_slow_multi}, {"tree", hash_tree},
   {"extra-blake", hash_extra_blake}, {"extra-groestl", hash_extra_groestl},
   {"extra-jh", hash_extra_jh}, {"extra-skein", hash_extra_skein}};
 
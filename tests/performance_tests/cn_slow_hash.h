@@ -70,3 +70,42 @@ private:
   data_t m_data;
   crypto::hash m_expected_hash;
 };
+
+template<size_t count>
+class test_cn_slow_hash_multi
+{
+public:
+  static const size_t loop_count = 10;
+
+  bool init()
+  {
+    if (!epee::string_tools::hex_to_pod("63617665617420656d70746f72", m_data))
+      return false;
+
+    if (!epee::string_tools::hex_to_pod("bbec2cacf69866a8e740380fe7b818fc78f8571221742d729d9d02d7f8989b87", m_expected_hash))
+      return false;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+      m_inputs[i] = &m_data;
+      m_lengths[i] = sizeof(m_data);
+    }
+    return true;
+  }
+
+  bool test()
+  {
+    crypto::hash hashes[count];
+    crypto::cn_slow_hash_multi(m_inputs, m_lengths, count, hashes);
+    for (size_t i = 0; i < count; ++i)
+      if (hashes[i] != m_expected_hash)
+        return false;
+    return true;
+  }
+
+private:
+  test_cn_slow_hash::data_t m_data;
+  crypto::hash m_expected_hash;
+  const void *m_inputs[count];
+  size_t m_lengths[count];
+};
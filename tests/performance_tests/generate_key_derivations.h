@@ -0,0 +1,93 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "crypto/crypto.h"
+
+template<size_t count, bool batched>
+class test_generate_key_derivations
+{
+public:
+  static const size_t loop_count = count >= 256 ? 10 : 100;
+
+  bool init()
+  {
+    crypto::generate_keys(m_view_public_key, m_view_secret_key);
+    crypto::public_key spend_public_key;
+    crypto::secret_key spend_secret_key;
+    crypto::generate_keys(spend_public_key, spend_secret_key);
+    m_tx_pub_keys.resize(count);
+    m_out_keys.resize(count);
+    m_output_indices.resize(count);
+    m_derivations.resize(count);
+    for (size_t n = 0; n < count; ++n)
+    {
+      crypto::secret_key tx_secret_key;
+      crypto::generate_keys(m_tx_pub_keys[n], tx_secret_key);
+      if (!crypto::generate_key_derivation(m_tx_pub_keys[n], m_view_secret_key, m_derivations[n]))
+        return false;
+      m_output_indices[n] = n;
+      if (!crypto::derive_public_key(m_derivations[n], n, spend_public_key, m_out_keys[n]))
+        return false;
+    }
+    m_valid.reset(new bool[count]);
+    m_spend_keys.resize(count);
+    return true;
+  }
+
+  bool test()
+  {
+    if (batched)
+    {
+      crypto::generate_key_derivations(m_tx_pub_keys.data(), count, m_view_secret_key, m_derivations.data(), m_valid.get());
+      crypto::derive_subaddress_public_keys(m_out_keys.data(), m_derivations.data(), m_output_indices.data(), count, m_spend_keys.data(), m_valid.get());
+    }
+    else
+    {
+      for (size_t n = 0; n < count; ++n)
+      {
+        crypto::generate_key_derivation(m_tx_pub_keys[n], m_view_secret_key, m_derivations[n]);
+        crypto::derive_subaddress_public_key(m_out_keys[n], m_derivations[n], n, m_spend_keys[n]);
+      }
+    }
+    return true;
+  }
+
+private:
+  crypto::public_key m_view_public_key;
+  crypto::secret_key m_view_secret_key;
+  std::vector<crypto::public_key> m_tx_pub_keys;
+  std::vector<crypto::public_key> m_out_keys;
+  std::vector<size_t> m_output_indices;
+  std::vector<crypto::key_derivation> m_derivations;
+  std::vector<crypto::public_key> m_spend_keys;
+  std::unique_ptr<bool[]> m_valid;
+};
@@ -40,13 +40,19 @@
 #include "derive_secret_key.h"
 #include "ge_frombytes_vartime.h"
 #include "generate_key_derivation.h"
+#include "generate_key_derivations.h"
 #include "generate_key_image.h"
 #include "generate_key_image_helper.h"
 #include "generate_keypair.h"
 #include "is_out_to_acc.h"
+#include "multiexp.h"
+#include "parse_tx.h"
+#include "scalarmult_fixed.h"
 #include "subaddress_expand.h"
+#include "subaddress_lookup.h"
 #include "sc_reduce32.h"
 #include "cn_fast_hash.h"
+#include "portable_storage.h"
 
 int main(int argc, char** argv)
 {
@@ -102,6 +108,11 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE2(test_check_tx_signature, 10, true);
   TEST_PERFORMANCE2(test_check_tx_signature, 100, true);
 
+  TEST_PERFORMANCE2(test_parse_tx, 1, false);
+  TEST_PERFORMANCE2(test_parse_tx, 10, false);
+  TEST_PERFORMANCE2(test_parse_tx, 2, true);
+  TEST_PERFORMANCE2(test_parse_tx, 10, true);
+
   TEST_PERFORMANCE0(test_is_out_to_acc);
   TEST_PERFORMANCE0(test_is_out_to_acc_precomp);
   TEST_PERFORMANCE0(test_generate_key_image_helper);
@@ -114,11 +125,100 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE0(test_sc_reduce32);
 
   TEST_PERFORMANCE2(test_wallet2_expand_subaddresses, 50, 200);
+  TEST_PERFORMANCE2(test_subaddress_lookup, 10000, false);
+  TEST_PERFORMANCE2(test_subaddress_lookup, 10000, true);
+  TEST_PERFORMANCE2(test_subaddress_lookup, 1000000, false);
+  TEST_PERFORMANCE2(test_subaddress_lookup, 1000000, true);
+
+  TEST_PERFORMANCE2(test_generate_key_derivations, 16, false);
+  TEST_PERFORMANCE2(test_generate_key_derivations, 16, true);
+  TEST_PERFORMANCE2(test_generate_key_derivations, 256, false);
+  TEST_PERFORMANCE2(test_generate_key_derivations, 256, true);
+
+  TEST_PERFORMANCE1(test_scalarmult_H, false);
+  TEST_PERFORMANCE1(test_scalarmult_H, true);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 2);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 2);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 2);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 2);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 4);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 4);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 4);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 4);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 8);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 8);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 8);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 8);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 16);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 16);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 16);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 16);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 32);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 32);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 32);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 32);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 64);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 64);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 64);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 64);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 80);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 80);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 80);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 80);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 128);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 128);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 128);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 128);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 256);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 256);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 256);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 256);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 512);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 512);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 512);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 512);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 1024);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 1024);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 1024);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 1024);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 2048);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 2048);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 2048);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 2048);
+
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus, 4096);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_straus_cached, 4096);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger, 4096);
+  TEST_PERFORMANCE2(test_multiexp, multiexp_pippenger_cached, 4096);
 
   TEST_PERFORMANCE0(test_cn_slow_hash);
+  TEST_PERFORMANCE1(test_cn_slow_hash_multi, 1);
+  TEST_PERFORMANCE1(test_cn_slow_hash_multi, 2);
+  TEST_PERFORMANCE1(test_cn_slow_hash_multi, 4);
   TEST_PERFORMANCE1(test_cn_fast_hash, 32);
   TEST_PERFORMANCE1(test_cn_fast_hash, 16384);
 
+  TEST_PERFORMANCE3(test_portable_storage, 10, false, true);
+  TEST_PERFORMANCE3(test_portable_storage, 10, true, true);
+  TEST_PERFORMANCE3(test_portable_storage, 10, false, false);
+  TEST_PERFORMANCE3(test_portable_storage, 10, true, false);
+  TEST_PERFORMANCE3(test_portable_storage, 1000, false, true);
+  TEST_PERFORMANCE3(test_portable_storage, 1000, true, true);
+  TEST_PERFORMANCE3(test_portable_storage, 1000, false, false);
+  TEST_PERFORMANCE3(test_portable_storage, 1000, true, false);
+
   std::cout << "Tests finished. Elapsed time: " << timer.elapsed_ms() / 1000 << " sec" << std::endl;
 
   return 0;
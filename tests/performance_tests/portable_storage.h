@@ -0,0 +1,102 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "rpc/core_rpc_server_commands_defs.h"
+#include "storages/portable_storage_template_helper.h"
+
+// a getblocks.bin response, stored and loaded with either the portable_storage
+// tree or the streaming writer and reader
+template<size_t blocks, bool streaming, bool store>
+class test_portable_storage
+{
+public:
+  static const size_t loop_count = blocks < 100 ? 100 : 10;
+  static const size_t txes_per_block = 10;
+
+  bool init()
+  {
+    for (size_t b = 0; b < blocks; ++b)
+    {
+      cryptonote::block_complete_entry bce;
+      bce.block = random_blob(200);
+      cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices boi;
+      boi.indices.resize(txes_per_block + 1);
+      boi.indices[0].indices.push_back(b);
+      for (size_t t = 0; t < txes_per_block; ++t)
+      {
+        bce.txs.push_back(random_blob(1500));
+        boi.indices[t + 1].indices = {b * 100 + t, b * 100 + t + 1};
+      }
+      m_response.blocks.push_back(bce);
+      m_response.output_indices.push_back(boi);
+    }
+    m_response.start_height = 1000000;
+    m_response.current_height = 1000000 + blocks;
+    m_response.status = CORE_RPC_STATUS_OK;
+    return epee::serialization::store_t_to_binary(m_response, m_buffer);
+  }
+
+  bool test()
+  {
+    if (store)
+    {
+      std::string buffer;
+      if (streaming)
+      {
+        epee::serialization::portable_storage_writer ps;
+        m_response.store(ps);
+        return ps.store_to_binary(buffer);
+      }
+      epee::serialization::portable_storage ps;
+      m_response.store(ps);
+      return ps.store_to_binary(buffer);
+    }
+
+    cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::response response;
+    if (streaming)
+    {
+      epee::serialization::portable_storage_reader ps;
+      return ps.load_from_binary(m_buffer) && response.load(ps) && response.blocks.size() == blocks;
+    }
+    epee::serialization::portable_storage ps;
+    return ps.load_from_binary(m_buffer) && response.load(ps) && response.blocks.size() == blocks;
+  }
+
+private:
+  static std::string random_blob(size_t size)
+  {
+    std::string blob(size, 0);
+    crypto::rand(size, (uint8_t*)&blob[0]);
+    return blob;
+  }
+
+  cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::response m_response;
+  std::string m_buffer;
+};
@@ -0,0 +1,72 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+#include "crypto/crypto.h"
+#include "cryptonote_basic/subaddress_map.h"
+
+template<size_t entries, bool flat>
+class test_subaddress_lookup
+{
+public:
+  static const size_t loop_count = 100;
+  static const size_t lookups = 10000;
+
+  bool init()
+  {
+    for (uint32_t i = 0; i < entries; ++i)
+    {
+      const crypto::public_key key = crypto::rand<crypto::public_key>();
+      if (flat)
+        m_map[key] = {0, i};
+      else
+        m_unordered_map[key] = {0, i};
+    }
+    // most looked up keys are not subaddresses of the wallet
+    m_keys.resize(lookups);
+    for (size_t n = 0; n < lookups; ++n)
+      m_keys[n] = crypto::rand<crypto::public_key>();
+    return true;
+  }
+
+  bool test()
+  {
+    size_t found = 0;
+    for (const crypto::public_key &key: m_keys)
+      found += flat ? m_map.count(key) : m_unordered_map.count(key);
+    return found == 0;
+  }
+
+private:
+  cryptonote::subaddress_map m_map;
+  std::unordered_map<crypto::public_key, cryptonote::subaddress_index> m_unordered_map;
+  std::vector<crypto::public_key> m_keys;
+};
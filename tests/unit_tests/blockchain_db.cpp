@@ -30,6 +30,7 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <cstdio>
 #include <iostream>
+#include <map>
 #include <chrono>
 #include <thread>
 
@@ -152,6 +153,32 @@ std::string h2b(const std::string& s)
   return result;
 }
 
+// a block paying the given amounts to random keys, on top of prev
+block make_block(const block *prev, uint64_t height, const std::vector<uint64_t>& amounts)
+{
+  block b;
+  b.major_version = 1;
+  b.minor_version = 0;
+  b.timestamp = 0;
+  b.prev_id = prev ? get_block_hash(*prev) : crypto::null_hash;
+  b.nonce = 0;
+  b.miner_tx.version = 1;
+  b.miner_tx.unlock_time = height + CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW;
+  txin_gen in;
+  in.height = height;
+  b.miner_tx.vin.push_back(in);
+  for (uint64_t amount: amounts)
+  {
+    crypto::public_key pub;
+    crypto::secret_key sec;
+    crypto::generate_keys(pub, sec);
+    txout_to_key out;
+    out.key = pub;
+    b.miner_tx.vout.push_back(tx_out{amount, out});
+  }
+  return b;
+}
+
 template <typename T>
 class BlockchainDBTest : public testing::Test
 {
@@ -344,4 +371,264 @@ TYPED_TEST(BlockchainDBTest, RetrieveBlockData)
   ASSERT_HASH_EQ(get_block_hash(this->m_blocks[1]), hashes[1]);
 }
 
+TYPED_TEST(BlockchainDBTest, RetrievePrunedTxData)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  // make sure open does not throw
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+
+  for (auto& h : this->m_blocks[0].tx_hashes)
+  {
+    blobdata bd, pruned, prunable;
+    ASSERT_TRUE(this->m_db->get_tx_blob(h, bd));
+    ASSERT_TRUE(this->m_db->get_pruned_tx_blob(h, pruned));
+    ASSERT_TRUE(this->m_db->get_prunable_tx_blob(h, prunable));
+
+    // the full blob is the pruned blob followed by the prunable one
+    ASSERT_EQ(bd, pruned + prunable);
+
+    transaction tx;
+    ASSERT_TRUE(parse_and_validate_tx_base_from_blob(pruned, tx));
+    ASSERT_HASH_EQ(get_transaction_prefix_hash(this->m_db->get_tx(h)), get_transaction_prefix_hash(tx));
+  }
+
+  blobdata bd;
+  ASSERT_FALSE(this->m_db->get_pruned_tx_blob(crypto::null_hash, bd));
+  ASSERT_FALSE(this->m_db->get_prunable_tx_blob(crypto::null_hash, bd));
+}
+
+TYPED_TEST(BlockchainDBTest, RetrieveBlocksFrom)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  // make sure open does not throw
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+
+  for (bool pruned: {false, true})
+  {
+    std::vector<block_blobs_entry> blocks;
+    ASSERT_TRUE(this->m_db->get_blocks_from(0, 1, 10, 1000000, pruned, blocks));
+    ASSERT_EQ(2, blocks.size());
+
+    for (size_t n = 0; n < blocks.size(); ++n)
+    {
+      ASSERT_EQ(this->m_db->get_block_blob_from_height(n), blocks[n].block);
+      ASSERT_EQ(this->m_blocks[n].tx_hashes.size(), blocks[n].txs.size());
+      ASSERT_EQ(this->m_blocks[n].tx_hashes.size() + 1, blocks[n].output_indices.size());
+
+      ASSERT_EQ(this->m_blocks[n].miner_tx.vout.size(), blocks[n].output_indices[0].size());
+      for (size_t i = 0; i < blocks[n].txs.size(); ++i)
+      {
+        const crypto::hash &h = this->m_blocks[n].tx_hashes[i];
+        blobdata bd;
+        if (pruned)
+          ASSERT_TRUE(this->m_db->get_pruned_tx_blob(h, bd));
+        else
+          ASSERT_TRUE(this->m_db->get_tx_blob(h, bd));
+        ASSERT_EQ(bd, blocks[n].txs[i]);
+        ASSERT_EQ(this->m_db->get_tx(h).vout.size(), blocks[n].output_indices[i + 1].size());
+      }
+    }
+  }
+
+  // limits
+  std::vector<block_blobs_entry> blocks;
+  ASSERT_TRUE(this->m_db->get_blocks_from(1, 1, 10, 1000000, true, blocks));
+  ASSERT_EQ(1, blocks.size());
+  ASSERT_TRUE(this->m_db->get_blocks_from(0, 1, 1, 1000000, true, blocks));
+  ASSERT_EQ(1, blocks.size());
+  ASSERT_TRUE(this->m_db->get_blocks_from(0, 1, 10, 0, true, blocks));
+  ASSERT_EQ(1, blocks.size());
+  ASSERT_FALSE(this->m_db->get_blocks_from(2, 1, 10, 1000000, true, blocks));
+}
+
+TYPED_TEST(BlockchainDBTest, OutputDistribution)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  // make sure open does not throw
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+
+  // count the outputs of each amount in each block
+  std::map<uint64_t, std::vector<uint64_t>> expected;
+  for (size_t n = 0; n < this->m_blocks.size(); ++n)
+  {
+    std::vector<tx_out> outs = this->m_blocks[n].miner_tx.vout;
+    for (const auto &tx: this->m_txs[n])
+      outs.insert(outs.end(), tx.vout.begin(), tx.vout.end());
+    for (const auto &o: outs)
+    {
+      std::vector<uint64_t> &counts = expected[o.amount];
+      counts.resize(this->m_blocks.size(), 0);
+      for (size_t h = n; h < counts.size(); ++h)
+        ++counts[h];
+    }
+  }
+  ASSERT_FALSE(expected.empty());
+
+  for (const auto &e: expected)
+  {
+    for (size_t h = 0; h < e.second.size(); ++h)
+      ASSERT_EQ(e.second[h], this->m_db->get_cumulative_num_outputs(e.first, h));
+
+    std::vector<uint64_t> distribution;
+    uint64_t base;
+    ASSERT_TRUE(this->m_db->get_output_distribution(e.first, 0, 1, distribution, base));
+    ASSERT_EQ(0, base);
+    ASSERT_EQ(e.second, distribution);
+    ASSERT_TRUE(this->m_db->get_output_distribution(e.first, 1, 1, distribution, base));
+    ASSERT_EQ(e.second[0], base);
+    ASSERT_EQ(1, distribution.size());
+    ASSERT_EQ(e.second[1], distribution[0]);
+    ASSERT_EQ(e.second[1], this->m_db->get_num_outputs(e.first));
+  }
+
+  std::vector<uint64_t> distribution;
+  uint64_t base;
+  ASSERT_FALSE(this->m_db->get_output_distribution(0, 1, 0, distribution, base));
+  ASSERT_FALSE(this->m_db->get_output_distribution(0, 0, 2, distribution, base));
+  ASSERT_EQ(0, this->m_db->get_cumulative_num_outputs(1, 1));
+
+  // popping a block takes its outputs out again
+  block blk;
+  std::vector<transaction> txs;
+  ASSERT_NO_THROW(this->m_db->pop_block(blk, txs));
+  for (const auto &e: expected)
+  {
+    ASSERT_EQ(e.second[0], this->m_db->get_cumulative_num_outputs(e.first, 0));
+    ASSERT_EQ(e.second[0], this->m_db->get_cumulative_num_outputs(e.first, 1));
+  }
+}
+
+
+TYPED_TEST(BlockchainDBTest, OutputDistributionRepeatedAmounts)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  // amounts paid again in the same block and in later ones, and enough of
+  // them that the database spans several pages
+  std::vector<block> blocks;
+  for (uint64_t height = 0; height < 8; ++height)
+  {
+    std::vector<uint64_t> amounts;
+    for (uint64_t amount = 1; amount <= 200; ++amount)
+      for (uint64_t n = 0; n < (amount + height) % 3; ++n)
+        amounts.push_back(amount * 1000);
+    blocks.push_back(make_block(blocks.empty() ? NULL : &blocks.back(), height, amounts));
+    ASSERT_NO_THROW(this->m_db->add_block(blocks.back(), 1000, 1, 0, std::vector<transaction>()));
+  }
+
+  std::map<uint64_t, std::vector<uint64_t>> expected;
+  for (size_t n = 0; n < blocks.size(); ++n)
+  {
+    for (const auto &o: blocks[n].miner_tx.vout)
+    {
+      std::vector<uint64_t> &counts = expected[o.amount];
+      counts.resize(blocks.size(), 0);
+      for (size_t h = n; h < counts.size(); ++h)
+        ++counts[h];
+    }
+  }
+
+  // pop the blocks one by one, checking what is left each time
+  for (size_t height = blocks.size(); height-- > 0; )
+  {
+    for (const auto &e: expected)
+    {
+      std::vector<uint64_t> distribution;
+      uint64_t base;
+      ASSERT_TRUE(this->m_db->get_output_distribution(e.first, 0, height, distribution, base));
+      ASSERT_EQ(std::vector<uint64_t>(e.second.begin(), e.second.begin() + height + 1), distribution);
+      ASSERT_EQ(e.second[height], this->m_db->get_num_outputs(e.first));
+    }
+
+    block blk;
+    std::vector<transaction> txs;
+    ASSERT_NO_THROW(this->m_db->pop_block(blk, txs));
+    ASSERT_HASH_EQ(get_block_hash(blocks[height]), get_block_hash(blk));
+  }
+  for (const auto &e: expected)
+    ASSERT_EQ(0, this->m_db->get_num_outputs(e.first));
+}
+
+
+TYPED_TEST(BlockchainDBTest, SpentKeyImages)
+{
+  boost::filesystem::path tempPath = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+  std::string dirPath = tempPath.string();
+
+  this->set_prefix(dirPath);
+
+  // make sure open does not throw
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  this->get_filenames();
+  this->init_hard_fork();
+
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[0], t_sizes[0], t_diffs[0], t_coins[0], this->m_txs[0]));
+  ASSERT_NO_THROW(this->m_db->add_block(this->m_blocks[1], t_sizes[1], t_diffs[1], t_coins[1], this->m_txs[1]));
+
+  std::vector<std::vector<crypto::key_image>> key_images(this->m_blocks.size());
+  for (size_t n = 0; n < this->m_blocks.size(); ++n)
+    for (const auto &tx: this->m_txs[n])
+      for (const auto &in: tx.vin)
+        if (in.type() == typeid(txin_to_key))
+          key_images[n].push_back(boost::get<txin_to_key>(in).k_image);
+  ASSERT_FALSE(key_images[0].empty());
+  ASSERT_TRUE(key_images[1].empty());
+
+  for (const auto &block_key_images: key_images)
+    for (const auto &ki: block_key_images)
+      ASSERT_TRUE(this->m_db->has_key_image(ki));
+  for (int i = 0; i < 1000; ++i)
+    ASSERT_FALSE(this->m_db->has_key_image(crypto::rand<crypto::key_image>()));
+
+  // key images are found again after reopening
+  ASSERT_NO_THROW(this->m_db->close());
+  ASSERT_NO_THROW(this->m_db->open(dirPath));
+  for (const auto &block_key_images: key_images)
+    for (const auto &ki: block_key_images)
+      ASSERT_TRUE(this->m_db->has_key_image(ki));
+
+  // popping a block unspends its key images, and only those
+  block blk;
+  std::vector<transaction> txs;
+  ASSERT_NO_THROW(this->m_db->pop_block(blk, txs));
+  for (const auto &ki: key_images[0])
+    ASSERT_TRUE(this->m_db->has_key_image(ki));
+  ASSERT_NO_THROW(this->m_db->pop_block(blk, txs));
+  for (const auto &ki: key_images[0])
+    ASSERT_FALSE(this->m_db->has_key_image(ki));
+}
+
 }  // anonymous namespace
@@ -0,0 +1,253 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <boost/filesystem.hpp>
+#include "gtest/gtest.h"
+
+#include "blockchain_utilities/bootstrap_file.h"
+
+namespace
+{
+  // writes chunks of made up data, as an export would write serialized blocks
+  class test_bootstrap_writer: public BootstrapFile
+  {
+  public:
+    ~test_bootstrap_writer() { delete m_raw_data_file; }
+
+    bool open(const boost::filesystem::path& path) { return open_writer(path, 0); }
+
+    void write(const std::string& data)
+    {
+      chunk c;
+      c.data = data;
+      c.hash = crypto::cn_fast_hash(data.data(), data.size());
+      write_chunk(c);
+    }
+
+    bool finish() { return close(); }
+
+    // stops writing as an interrupted export would, with half of a chunk written
+    void interrupt(const std::string& data)
+    {
+      const uint32_t size = data.size();
+      m_raw_data_file->write((const char*)&size, sizeof(size));
+      m_raw_data_file->write(data.data(), data.size() / 2);
+      delete m_raw_data_file;
+      m_raw_data_file = NULL;
+    }
+  };
+
+  std::string make_chunk(size_t n)
+  {
+    return std::string(100 + n, 'a' + n % 26);
+  }
+}
+
+class bootstrap_file_test: public ::testing::Test
+{
+protected:
+  bootstrap_file_test():
+    m_dir(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()),
+    m_path(m_dir / "blockchain.raw")
+  {
+    boost::filesystem::create_directory(m_dir);
+  }
+
+  ~bootstrap_file_test()
+  {
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(m_dir, ec);
+  }
+
+  void write(size_t first, size_t count)
+  {
+    test_bootstrap_writer writer;
+    ASSERT_TRUE(writer.open(m_path));
+    for (size_t n = first; n < first + count; ++n)
+      writer.write(make_chunk(n));
+    ASSERT_TRUE(writer.finish());
+  }
+
+  // reads each chunk at the position the index has for it
+  void check_chunks(size_t count)
+  {
+    BootstrapFile reader;
+    std::ifstream f(m_path.string(), std::ios_base::binary);
+    reader.seek_to_first_chunk(f);
+    ASSERT_TRUE(reader.load_index(f));
+    ASSERT_EQ(0, reader.get_block_first());
+    ASSERT_EQ(count, reader.get_index().chunks.size());
+    for (size_t n = 0; n < count; ++n)
+    {
+      std::string data;
+      ASSERT_TRUE(read_chunk(f, reader.get_index().chunks[n].pos, data));
+      ASSERT_EQ(make_chunk(n), data);
+      ASSERT_TRUE(reader.check_chunk(n, data));
+    }
+    ASSERT_EQ(count, BootstrapFile().count_blocks(m_path.string()));
+  }
+
+  static bool read_chunk(std::ifstream& f, uint64_t pos, std::string& data)
+  {
+    uint32_t size;
+    f.seekg(pos);
+    if (!f.read((char*)&size, sizeof(size)))
+      return false;
+    data.resize(size);
+    return (bool)f.read(&data[0], size);
+  }
+
+  boost::filesystem::path m_dir;
+  boost::filesystem::path m_path;
+};
+
+TEST_F(bootstrap_file_test, index_round_trip)
+{
+  write(0, 10);
+  check_chunks(10);
+}
+
+TEST_F(bootstrap_file_test, appends_to_complete_file)
+{
+  write(0, 10);
+  write(10, 5);
+  check_chunks(15);
+}
+
+TEST_F(bootstrap_file_test, resumes_interrupted_export)
+{
+  {
+    test_bootstrap_writer writer;
+    ASSERT_TRUE(writer.open(m_path));
+    for (size_t n = 0; n < 10; ++n)
+      writer.write(make_chunk(n));
+    writer.interrupt(make_chunk(10));
+  }
+
+  // without an index, chunks are not checked
+  {
+    BootstrapFile reader;
+    std::ifstream f(m_path.string(), std::ios_base::binary);
+    reader.seek_to_first_chunk(f);
+    ASSERT_FALSE(reader.load_index(f));
+    ASSERT_TRUE(reader.check_chunk(0, "anything"));
+  }
+
+  // the partial chunk is written over
+  write(10, 5);
+  check_chunks(15);
+}
+
+TEST_F(bootstrap_file_test, interrupted_append_drops_index)
+{
+  write(0, 10);
+
+  // the old index is cut off when appending, so the header must stop
+  // pointing at it even if nothing else gets written
+  {
+    test_bootstrap_writer writer;
+    ASSERT_TRUE(writer.open(m_path));
+    writer.interrupt(make_chunk(10));
+  }
+  {
+    BootstrapFile reader;
+    std::ifstream f(m_path.string(), std::ios_base::binary);
+    reader.seek_to_first_chunk(f);
+    ASSERT_FALSE(reader.load_index(f));
+  }
+
+  write(10, 5);
+  check_chunks(15);
+}
+
+TEST_F(bootstrap_file_test, stale_index_is_written_over)
+{
+  write(0, 10);
+
+  // an append interrupted after the header was rewritten, but before the old
+  // index was cut off, leaves a header without an index before it
+  const boost::filesystem::path other = m_dir / "other.raw";
+  {
+    test_bootstrap_writer writer;
+    ASSERT_TRUE(writer.open(other));
+    writer.interrupt(make_chunk(0));
+  }
+  std::string header;
+  {
+    std::ifstream f(other.string(), std::ios_base::binary);
+    header.resize(BootstrapFile().seek_to_first_chunk(f));
+    f.seekg(0);
+    ASSERT_TRUE((bool)f.read(&header[0], header.size()));
+  }
+  {
+    std::fstream f(m_path.string(), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    ASSERT_TRUE((bool)f.write(header.data(), header.size()));
+  }
+
+  write(10, 5);
+  check_chunks(15);
+}
+
+TEST_F(bootstrap_file_test, chunk_checksum_mismatch)
+{
+  write(0, 10);
+
+  BootstrapFile reader;
+  std::ifstream f(m_path.string(), std::ios_base::binary);
+  reader.seek_to_first_chunk(f);
+  ASSERT_TRUE(reader.load_index(f));
+  std::string data;
+  ASSERT_TRUE(read_chunk(f, reader.get_index().chunks[3].pos, data));
+  ASSERT_TRUE(reader.check_chunk(3, data));
+
+  data[data.size() / 2] ^= 1;
+  ASSERT_FALSE(reader.check_chunk(3, data));
+  ASSERT_FALSE(reader.check_chunk(4, make_chunk(3)));
+  ASSERT_FALSE(reader.check_chunk(10, make_chunk(10)));
+}
+
+TEST_F(bootstrap_file_test, index_checksum_mismatch)
+{
+  write(0, 10);
+
+  // flip a byte of the index, which is at the end of the file
+  {
+    std::fstream f(m_path.string(), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    f.seekg(-1, std::ios_base::end);
+    char c;
+    f.read(&c, 1);
+    c ^= 1;
+    f.seekp(-1, std::ios_base::end);
+    f.write(&c, 1);
+  }
+
+  BootstrapFile reader;
+  std::ifstream f(m_path.string(), std::ios_base::binary);
+  reader.seek_to_first_chunk(f);
+  ASSERT_THROW(reader.load_index(f), std::runtime_error);
+}
@@ -69,3 +69,28 @@ TEST(bulletproofs, invalid_31)
   rct::Bulletproof proof = bulletproof_PROVE(invalid_amount, rct::skGen());
   ASSERT_FALSE(rct::bulletproof_VERIFY(proof));
 }
+
+TEST(bulletproofs, valid_batch)
+{
+  std::vector<rct::Bulletproof> proofs;
+  for (int n = 0; n < 8; ++n)
+    proofs.push_back(bulletproof_PROVE(crypto::rand<uint64_t>(), rct::skGen()));
+  std::vector<const rct::Bulletproof*> proof_ptrs;
+  for (const rct::Bulletproof &proof: proofs)
+    proof_ptrs.push_back(&proof);
+  ASSERT_TRUE(rct::bulletproof_VERIFY(proof_ptrs));
+}
+
+TEST(bulletproofs, invalid_batch)
+{
+  std::vector<rct::Bulletproof> proofs;
+  for (int n = 0; n < 8; ++n)
+    proofs.push_back(bulletproof_PROVE(crypto::rand<uint64_t>(), rct::skGen()));
+  rct::key invalid_amount = rct::zero();
+  invalid_amount[8] = 1;
+  proofs.push_back(bulletproof_PROVE(invalid_amount, rct::skGen()));
+  std::vector<const rct::Bulletproof*> proof_ptrs;
+  for (const rct::Bulletproof &proof: proofs)
+    proof_ptrs.push_back(&proof);
+  ASSERT_FALSE(rct::bulletproof_VERIFY(proof_ptrs));
+}
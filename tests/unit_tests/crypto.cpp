@@ -27,10 +27,12 @@
 // THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <cstdint>
+#include <cstring>
 #include <gtest/gtest.h>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "cryptonote_basic/cryptonote_basic_impl.h"
 
@@ -73,3 +75,47 @@ TEST(Crypto, Ostream)
   EXPECT_TRUE(is_formatted<crypto::key_derivation>());
   EXPECT_TRUE(is_formatted<crypto::key_image>());
 }
+
+TEST(Crypto, batched_key_derivations)
+{
+  crypto::public_key pub;
+  crypto::secret_key sec;
+  crypto::generate_keys(pub, sec);
+
+  std::vector<crypto::public_key> keys(100);
+  for (crypto::public_key &key: keys)
+  {
+    crypto::secret_key unused;
+    crypto::generate_keys(key, unused);
+  }
+  do
+    keys[42] = crypto::rand<crypto::public_key>();
+  while (crypto::check_key(keys[42]));
+
+  std::vector<crypto::key_derivation> derivations(keys.size());
+  std::unique_ptr<bool[]> valid(new bool[keys.size()]);
+  crypto::generate_key_derivations(keys.data(), keys.size(), sec, derivations.data(), valid.get());
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    crypto::key_derivation expected;
+    ASSERT_EQ(crypto::generate_key_derivation(keys[i], sec, expected), valid[i]);
+    if (valid[i])
+      ASSERT_EQ(0, memcmp(&expected, &derivations[i], sizeof(expected)));
+  }
+  ASSERT_FALSE(valid[42]);
+
+  // derive from the output keys, reusing the random keys as outputs
+  std::vector<size_t> indices(keys.size());
+  std::vector<crypto::public_key> spend_keys(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i)
+    indices[i] = i % 16;
+  crypto::derive_subaddress_public_keys(keys.data(), derivations.data(), indices.data(), keys.size(), spend_keys.data(), valid.get());
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    crypto::public_key expected;
+    ASSERT_EQ(crypto::derive_subaddress_public_key(keys[i], derivations[i], indices[i], expected), valid[i]);
+    if (valid[i])
+      ASSERT_EQ(expected, spend_keys[i]);
+  }
+  ASSERT_FALSE(valid[42]);
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+#include "blockchain_db/key_image_filter.h"
+
+TEST(key_image_filter, no_false_negatives)
+{
+  cryptonote::key_image_filter filter(10000);
+  std::vector<crypto::key_image> key_images;
+  for (int i = 0; i < 10000; ++i)
+  {
+    key_images.push_back(crypto::rand<crypto::key_image>());
+    filter.add(key_images.back());
+  }
+  ASSERT_EQ(10000, filter.size());
+  for (const auto &ki: key_images)
+    ASSERT_TRUE(filter.may_contain(ki));
+}
+
+TEST(key_image_filter, false_positives)
+{
+  cryptonote::key_image_filter filter(100000);
+  for (int i = 0; i < 100000; ++i)
+    filter.add(crypto::rand<crypto::key_image>());
+  size_t false_positives = 0;
+  for (int i = 0; i < 100000; ++i)
+    false_positives += filter.may_contain(crypto::rand<crypto::key_image>());
+  ASSERT_LT(false_positives, 2000);
+}
+
+TEST(key_image_filter, tiny)
+{
+  cryptonote::key_image_filter filter(0);
+  ASSERT_FALSE(filter.may_contain(crypto::rand<crypto::key_image>()));
+  const crypto::key_image ki = crypto::rand<crypto::key_image>();
+  filter.add(ki);
+  ASSERT_TRUE(filter.may_contain(ki));
+}
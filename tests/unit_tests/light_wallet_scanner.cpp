@@ -0,0 +1,67 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "cryptonote_core/light_wallet_scanner.h"
+#include "cryptonote_config.h"
+
+using namespace cryptonote;
+
+namespace
+{
+  lw_output make_output(uint64_t height, uint64_t unlock_time)
+  {
+    lw_output o = AUTO_VAL_INIT(o);
+    o.height = height;
+    o.unlock_time = unlock_time;
+    return o;
+  }
+}
+
+TEST(light_wallet_scanner, spendable_age)
+{
+  const lw_output o = make_output(100, 0);
+  ASSERT_FALSE(light_wallet_scanner::is_output_unlocked(o, 100));
+  ASSERT_FALSE(light_wallet_scanner::is_output_unlocked(o, 100 + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE - 1));
+  ASSERT_TRUE(light_wallet_scanner::is_output_unlocked(o, 100 + CRYPTONOTE_DEFAULT_TX_SPENDABLE_AGE));
+}
+
+TEST(light_wallet_scanner, unlock_height)
+{
+  const uint64_t unlock = 100 + CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW;
+  const lw_output o = make_output(100, unlock);
+  ASSERT_FALSE(light_wallet_scanner::is_output_unlocked(o, unlock - CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_BLOCKS));
+  ASSERT_TRUE(light_wallet_scanner::is_output_unlocked(o, unlock + 1 - CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_BLOCKS));
+}
+
+TEST(light_wallet_scanner, unlock_timestamp)
+{
+  ASSERT_TRUE(light_wallet_scanner::is_output_unlocked(make_output(100, CRYPTONOTE_MAX_BLOCK_NUMBER), 1000));
+  ASSERT_FALSE(light_wallet_scanner::is_output_unlocked(make_output(100, std::numeric_limits<uint64_t>::max()), 1000));
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "ringct/rctOps.h"
+#include "ringct/multiexp.h"
+
+static rct::key naive_multiexp(const std::vector<rct::MultiexpData> &data)
+{
+  rct::key res = rct::identity();
+  for (const rct::MultiexpData &d: data)
+  {
+    rct::key point;
+    ge_p3_tobytes(point.bytes, &d.point);
+    rct::addKeys(res, res, rct::scalarmultKey(point, d.scalar));
+  }
+  return res;
+}
+
+static std::vector<rct::MultiexpData> make_data(size_t n)
+{
+  std::vector<rct::MultiexpData> data;
+  for (size_t i = 0; i < n; ++i)
+    data.push_back({rct::skGen(), rct::scalarmultBase(rct::skGen())});
+  return data;
+}
+
+TEST(multiexp, empty)
+{
+  std::vector<rct::MultiexpData> data;
+  ASSERT_TRUE(rct::straus(data) == rct::identity());
+  ASSERT_TRUE(rct::pippenger(data) == rct::identity());
+  ASSERT_TRUE(rct::multiexp(data) == rct::identity());
+}
+
+TEST(multiexp, zero_and_one)
+{
+  std::vector<rct::MultiexpData> data = make_data(4);
+  data[0].scalar = rct::zero();
+  data[1].scalar = rct::identity();
+  const rct::key res = naive_multiexp(data);
+  ASSERT_TRUE(rct::straus(data) == res);
+  ASSERT_TRUE(rct::pippenger(data) == res);
+}
+
+TEST(multiexp, straus)
+{
+  for (size_t n: {1, 2, 3, 16, 100})
+  {
+    std::vector<rct::MultiexpData> data = make_data(n);
+    ASSERT_TRUE(rct::straus(data) == naive_multiexp(data));
+  }
+}
+
+TEST(multiexp, pippenger)
+{
+  for (size_t n: {1, 2, 3, 16, 100, 300})
+  {
+    std::vector<rct::MultiexpData> data = make_data(n);
+    const rct::key res = naive_multiexp(data);
+    ASSERT_TRUE(rct::pippenger(data) == res);
+    for (size_t c = 1; c <= 10; ++c)
+      ASSERT_TRUE(rct::pippenger(data, NULL, c) == res);
+  }
+}
+
+TEST(multiexp, cached)
+{
+  std::vector<rct::MultiexpData> data = make_data(64);
+  std::shared_ptr<rct::straus_cached_data> straus_cache = rct::straus_init_cache(data, 32);
+  std::shared_ptr<rct::pippenger_cached_data> pippenger_cache = rct::pippenger_init_cache(data, 32);
+
+  // the cache is only tied to the points, not to the scalars
+  for (rct::MultiexpData &d: data)
+    d.scalar = rct::skGen();
+  const rct::key res = naive_multiexp(data);
+  ASSERT_TRUE(rct::straus(data, straus_cache) == res);
+  ASSERT_TRUE(rct::pippenger(data, pippenger_cache) == res);
+
+  // fewer points than the cache holds
+  data.resize(16);
+  ASSERT_TRUE(rct::straus(data, straus_cache) == naive_multiexp(data));
+  ASSERT_TRUE(rct::pippenger(data, pippenger_cache) == naive_multiexp(data));
+}
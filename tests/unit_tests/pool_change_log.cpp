@@ -0,0 +1,166 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <limits>
+#include "gtest/gtest.h"
+
+#include "cryptonote_core/pool_change_log.h"
+
+using cryptonote::pool_change_log;
+
+namespace
+{
+  crypto::hash make_hash(int n)
+  {
+    crypto::hash h = crypto::null_hash;
+    memcpy(&h, &n, sizeof(n));
+    return h;
+  }
+
+  bool less(const crypto::hash &a, const crypto::hash &b)
+  {
+    return memcmp(&a, &b, sizeof(a)) < 0;
+  }
+
+  bool changes(const pool_change_log &log, uint64_t since, std::vector<crypto::hash> &added, std::vector<crypto::hash> &removed, bool include_unrelayed_txes = true)
+  {
+    added.clear();
+    removed.clear();
+    const bool r = log.get_changes(since, added, removed, include_unrelayed_txes);
+    std::sort(added.begin(), added.end(), less);
+    std::sort(removed.begin(), removed.end(), less);
+    return r;
+  }
+}
+
+TEST(pool_change_log, empty)
+{
+  pool_change_log log(1000, 10);
+  std::vector<crypto::hash> added, removed;
+  ASSERT_EQ(log.sequence(), 1000);
+  ASSERT_TRUE(changes(log, 1000, added, removed));
+  ASSERT_TRUE(added.empty());
+  ASSERT_TRUE(removed.empty());
+  ASSERT_FALSE(changes(log, 999, added, removed));
+  ASSERT_FALSE(changes(log, 1001, added, removed));
+}
+
+TEST(pool_change_log, added_and_removed)
+{
+  pool_change_log log(1000, 10);
+  std::vector<crypto::hash> added, removed;
+  log.record(make_hash(1), true, false);
+  log.record(make_hash(2), true, false);
+  const uint64_t synced = log.sequence();
+  ASSERT_EQ(synced, 1002);
+  log.record(make_hash(3), true, false);
+  log.record(make_hash(1), false, false);
+
+  ASSERT_TRUE(changes(log, synced, added, removed));
+  ASSERT_EQ(added, std::vector<crypto::hash>{make_hash(3)});
+  ASSERT_EQ(removed, std::vector<crypto::hash>{make_hash(1)});
+
+  // a tx which came and went since is only reported as removed
+  ASSERT_TRUE(changes(log, 1000, added, removed));
+  ASSERT_EQ(added, (std::vector<crypto::hash>{make_hash(2), make_hash(3)}));
+  ASSERT_EQ(removed, std::vector<crypto::hash>{make_hash(1)});
+
+  // and one which went and came back as added
+  log.record(make_hash(1), true, false);
+  ASSERT_TRUE(changes(log, synced, added, removed));
+  ASSERT_EQ(added, (std::vector<crypto::hash>{make_hash(1), make_hash(3)}));
+  ASSERT_TRUE(removed.empty());
+
+  // nothing new for an up to date caller
+  ASSERT_TRUE(changes(log, log.sequence(), added, removed));
+  ASSERT_TRUE(added.empty());
+  ASSERT_TRUE(removed.empty());
+}
+
+TEST(pool_change_log, stale)
+{
+  pool_change_log log(1000, 10);
+  std::vector<crypto::hash> added, removed;
+  for (int n = 0; n < 25; ++n)
+    log.record(make_hash(n), true, false);
+  ASSERT_EQ(log.sequence(), 1025);
+
+  // only the last 10 changes are known, anything older needs a full resync
+  ASSERT_FALSE(changes(log, 1000, added, removed));
+  ASSERT_FALSE(changes(log, 1014, added, removed));
+  ASSERT_TRUE(changes(log, 1015, added, removed));
+  ASSERT_EQ(added.size(), 10);
+  ASSERT_EQ(added.front(), make_hash(15));
+
+  // as does a sequence number from the future, eg from a previous run
+  ASSERT_FALSE(changes(log, 1026, added, removed));
+  ASSERT_FALSE(changes(log, 123456789, added, removed));
+}
+
+TEST(pool_change_log, sequence_wrap)
+{
+  const uint64_t start = std::numeric_limits<uint64_t>::max() - 2;
+  pool_change_log log(start, 10);
+  std::vector<crypto::hash> added, removed;
+  for (int n = 0; n < 5; ++n)
+    log.record(make_hash(n), true, false);
+  ASSERT_EQ(log.sequence(), 2);
+
+  ASSERT_TRUE(changes(log, start, added, removed));
+  ASSERT_EQ(added.size(), 5);
+  ASSERT_TRUE(changes(log, std::numeric_limits<uint64_t>::max(), added, removed));
+  ASSERT_EQ(added.size(), 3);
+  ASSERT_TRUE(changes(log, 1, added, removed));
+  ASSERT_EQ(added, std::vector<crypto::hash>{make_hash(4)});
+  ASSERT_FALSE(changes(log, start - 1, added, removed));
+  ASSERT_FALSE(changes(log, 3, added, removed));
+}
+
+TEST(pool_change_log, do_not_relay)
+{
+  pool_change_log log(1000, 10);
+  std::vector<crypto::hash> added, removed;
+  log.record(make_hash(1), true, true);
+  log.record(make_hash(2), true, false);
+  log.record(make_hash(3), true, true);
+  const uint64_t synced = log.sequence();
+  log.record(make_hash(1), false, true);
+  log.record(make_hash(2), false, false);
+
+  ASSERT_TRUE(changes(log, 1000, added, removed, false));
+  ASSERT_TRUE(added.empty());
+  ASSERT_EQ(removed, std::vector<crypto::hash>{make_hash(2)});
+  ASSERT_TRUE(changes(log, synced, added, removed, false));
+  ASSERT_TRUE(added.empty());
+  ASSERT_EQ(removed, std::vector<crypto::hash>{make_hash(2)});
+
+  ASSERT_TRUE(changes(log, 1000, added, removed, true));
+  ASSERT_EQ(added, std::vector<crypto::hash>{make_hash(3)});
+  ASSERT_EQ(removed, (std::vector<crypto::hash>{make_hash(1), make_hash(2)}));
+}
@@ -1060,3 +1060,26 @@ TEST(ringct, key_ostream)
     out.str()
   );
 }
+
+TEST(ringct, fixed_base_table)
+{
+  rct::fixedBaseTable table;
+  for (int n = 0; n < 8; ++n)
+  {
+    const rct::key P = rct::scalarmultBase(rct::skGen());
+    const rct::key a = rct::skGen(), b = rct::skGen();
+    rct::precompFixedBase(table, P);
+    ASSERT_EQ(rct::scalarmultKey(table, a), rct::scalarmultKey(P, a));
+    ASSERT_EQ(rct::scalarmultH(a), rct::scalarmultKey(rct::H, a));
+    rct::key fixed, generic;
+    rct::addKeys2(fixed, a, b, table);
+    rct::addKeys2(generic, a, b, P);
+    ASSERT_EQ(fixed, generic);
+  }
+  rct::precompFixedBase(table, rct::G);
+  ASSERT_EQ(rct::scalarmultKey(table, rct::identity()), rct::G);
+  ASSERT_EQ(rct::scalarmultKey(table, rct::zero()), rct::identity());
+  ASSERT_EQ(rct::zeroCommit(12345), rct::addKeys(rct::G, rct::scalarmultKey(rct::H, rct::d2h(12345))));
+  const rct::key mask = rct::skGen();
+  ASSERT_EQ(rct::commit(12345, mask), rct::addKeys(rct::scalarmultBase(mask), rct::scalarmultKey(rct::H, rct::d2h(12345))));
+}
@@ -37,6 +37,7 @@
 #include <boost/archive/portable_binary_iarchive.hpp>
 #include "cryptonote_basic/cryptonote_basic.h"
 #include "cryptonote_basic/cryptonote_basic_impl.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
 #include "ringct/rctSigs.h"
 #include "serialization/serialization.h"
 #include "serialization/binary_archive.h"
@@ -132,11 +133,11 @@ TEST(Serialization, BinaryArchiveInts) {
   ASSERT_EQ(8, oss.str().size());
   ASSERT_EQ(string("\0\0\0\0\xff\0\0\0", 8), oss.str());
 
-  istringstream iss(oss.str());
-  binary_archive<false> iar(iss);
+  const std::string blob = oss.str();
+  binary_archive<false> iar{epee::strspan<std::uint8_t>(blob)};
   iar.serialize_int(x1);
-  ASSERT_EQ(8, iss.tellg());
-  ASSERT_TRUE(iss.good());
+  ASSERT_EQ(0, iar.remaining_bytes());
+  ASSERT_TRUE(iar.stream().good());
 
   ASSERT_EQ(x, x1);
 }
@@ -151,10 +152,11 @@ TEST(Serialization, BinaryArchiveVarInts) {
   ASSERT_EQ(6, oss.str().size());
   ASSERT_EQ(string("\x80\x80\x80\x80\xF0\x1F", 6), oss.str());
 
-  istringstream iss(oss.str());
-  binary_archive<false> iar(iss);
+  const std::string blob = oss.str();
+  binary_archive<false> iar{epee::strspan<std::uint8_t>(blob)};
   iar.serialize_varint(x1);
-  ASSERT_TRUE(iss.good());
+  ASSERT_EQ(0, iar.remaining_bytes());
+  ASSERT_TRUE(iar.stream().good());
   ASSERT_EQ(x, x1);
 }
 
@@ -668,6 +670,91 @@ TEST(Serialization, serializes_ringct_types)
   ASSERT_TRUE(blob == blob2);
 }
 
+TEST(Serialization, hashes_from_blob)
+{
+  using namespace cryptonote;
+
+  // a v2 tx with a full rct signature
+  rct::ctkeyV sc, pc;
+  rct::ctkey sctmp, pctmp;
+  tie(sctmp, pctmp) = rct::ctskpkGen(6000);
+  sc.push_back(sctmp);
+  pc.push_back(pctmp);
+  tie(sctmp, pctmp) = rct::ctskpkGen(7000);
+  sc.push_back(sctmp);
+  pc.push_back(pctmp);
+  vector<uint64_t> amounts;
+  rct::keyV amount_keys, destinations;
+  rct::key Sk, Pk;
+  amounts.push_back(500);
+  amount_keys.push_back(rct::hash_to_scalar(rct::zero()));
+  rct::skpkGen(Sk, Pk);
+  destinations.push_back(Pk);
+  amounts.push_back(12500);
+  amount_keys.push_back(rct::hash_to_scalar(rct::zero()));
+  rct::skpkGen(Sk, Pk);
+  destinations.push_back(Pk);
+
+  transaction tx0, tx1, tx2;
+  tx0.set_null();
+  tx0.version = 2;
+  txin_to_key txin{};
+  txin.amount = 0;
+  txin.key_offsets.resize(4, 1);
+  tx0.vin.push_back(txin);
+  tx0.vin.push_back(txin);
+  tx0.vout.resize(2);
+  tx0.extra.resize(33, 1);
+  tx0.rct_signatures = rct::genRct(rct::zero(), sc, pc, destinations, amounts, amount_keys, NULL, NULL, 3);
+  string blob;
+  ASSERT_TRUE(serialization::dump_binary(tx0, blob));
+
+  crypto::hash tx_hash, tx_prefix_hash, expected;
+  size_t expected_size;
+  ASSERT_TRUE(serialization::parse_binary(blob, tx1));
+  ASSERT_TRUE(calculate_transaction_hash(tx1, expected, &expected_size));
+  ASSERT_TRUE(parse_and_validate_tx_from_blob(blob, tx2, tx_hash, tx_prefix_hash));
+  ASSERT_EQ(tx_hash, expected);
+  ASSERT_EQ(tx_prefix_hash, get_transaction_prefix_hash(tx1));
+  ASSERT_TRUE(tx2.is_blob_size_valid());
+  ASSERT_EQ(tx2.blob_size, expected_size);
+
+  // a v1 tx, with a non canonical encoding of its unlock time
+  tx0.set_null();
+  txin_gen txin_gen1;
+  txin_gen1.height = 1;
+  tx0.vin.push_back(txin_gen1);
+  tx0.vout.resize(1);
+  ASSERT_TRUE(serialization::dump_binary(tx0, blob));
+  ASSERT_TRUE(parse_and_validate_tx_from_blob(blob, tx2, tx_hash));
+  ASSERT_EQ(tx_hash, get_blob_hash(blob));
+  ASSERT_EQ(0, blob[1]);
+  std::string blob_nc = blob;
+  blob_nc.replace(1, 1, "\x80\x00", 2);
+  ASSERT_TRUE(parse_and_validate_tx_from_blob(blob_nc, tx2, tx_hash));
+  ASSERT_EQ(tx_hash, get_blob_hash(blob));
+
+  // a block, with that tx as miner tx
+  block b0, b1, b2;
+  b0.major_version = 1;
+  b0.minor_version = 2;
+  b0.timestamp = 1234567890;
+  b0.prev_id = crypto::rand<crypto::hash>();
+  b0.nonce = 42;
+  b0.miner_tx = tx0;
+  b0.tx_hashes.push_back(crypto::rand<crypto::hash>());
+  b0.tx_hashes.push_back(crypto::rand<crypto::hash>());
+  blob = block_to_blob(b0);
+  ASSERT_TRUE(serialization::parse_binary(blob, b1));
+  ASSERT_TRUE(calculate_block_hash(b1, expected));
+  crypto::hash block_hash;
+  ASSERT_TRUE(parse_and_validate_block_from_blob(blob, b2, block_hash));
+  ASSERT_EQ(block_hash, expected);
+  ASSERT_EQ(get_block_hash(b2), expected);
+  ASSERT_TRUE(b2.miner_tx.is_hash_valid());
+  ASSERT_EQ(get_transaction_hash(b2.miner_tx), get_transaction_hash(tx0));
+}
+
 TEST(Serialization, portability_wallet)
 {
   const bool testnet = true;
@@ -0,0 +1,156 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <sstream>
+#include <unordered_map>
+#include <boost/archive/portable_binary_iarchive.hpp>
+#include <boost/archive/portable_binary_oarchive.hpp>
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+#include "cryptonote_basic/subaddress_map.h"
+
+namespace
+{
+  std::unordered_map<crypto::public_key, cryptonote::subaddress_index> make_subaddresses(size_t n)
+  {
+    std::unordered_map<crypto::public_key, cryptonote::subaddress_index> subaddresses;
+    for (uint32_t i = 0; subaddresses.size() < n; ++i)
+      subaddresses[crypto::rand<crypto::public_key>()] = {i / 100, i % 100};
+    return subaddresses;
+  }
+
+  void check_same(const cryptonote::subaddress_map &map, const std::unordered_map<crypto::public_key, cryptonote::subaddress_index> &reference)
+  {
+    ASSERT_EQ(reference.size(), map.size());
+    for (const auto &i: reference)
+    {
+      auto found = map.find(i.first);
+      ASSERT_TRUE(found != map.end());
+      ASSERT_EQ(i.first, found->first);
+      ASSERT_EQ(i.second, found->second);
+    }
+    size_t n = 0;
+    for (const auto &i: map)
+    {
+      auto found = reference.find(i.first);
+      ASSERT_TRUE(found != reference.end());
+      ASSERT_EQ(found->second, i.second);
+      ++n;
+    }
+    ASSERT_EQ(reference.size(), n);
+    for (int i = 0; i < 1000; ++i)
+      ASSERT_EQ(0, map.count(crypto::rand<crypto::public_key>()));
+  }
+}
+
+TEST(subaddress_map, empty)
+{
+  cryptonote::subaddress_map map;
+  ASSERT_TRUE(map.empty());
+  ASSERT_TRUE(map.begin() == map.end());
+  ASSERT_TRUE(map.find(crypto::rand<crypto::public_key>()) == map.end());
+  cryptonote::subaddress_map loaded;
+  ASSERT_TRUE(loaded.from_blob(map.to_blob()));
+  ASSERT_TRUE(loaded.empty());
+}
+
+TEST(subaddress_map, insert_and_find)
+{
+  const auto reference = make_subaddresses(10000);
+  cryptonote::subaddress_map map;
+  for (const auto &i: reference)
+    map[i.first] = i.second;
+  check_same(map, reference);
+
+  // inserting again only updates
+  const auto &first = *reference.begin();
+  map[first.first] = {12345, 678};
+  ASSERT_EQ(reference.size(), map.size());
+  ASSERT_EQ((cryptonote::subaddress_index{12345, 678}), map.find(first.first)->second);
+}
+
+TEST(subaddress_map, reserve)
+{
+  const auto reference = make_subaddresses(1000);
+  cryptonote::subaddress_map map;
+  map.reserve(10);
+  for (const auto &i: reference)
+  {
+    map[i.first] = i.second;
+    map.reserve(map.size() * 3);
+  }
+  check_same(map, reference);
+  map.clear();
+  ASSERT_TRUE(map.empty());
+  ASSERT_TRUE(map.find(reference.begin()->first) == map.end());
+}
+
+TEST(subaddress_map, blob)
+{
+  const auto reference = make_subaddresses(5000);
+  cryptonote::subaddress_map map;
+  for (const auto &i: reference)
+    map[i.first] = i.second;
+
+  const std::string blob = map.to_blob();
+  cryptonote::subaddress_map loaded;
+  ASSERT_TRUE(loaded.from_blob(blob));
+  check_same(loaded, reference);
+
+  ASSERT_FALSE(loaded.from_blob(blob.substr(0, blob.size() - 1)));
+  std::string corrupt = blob;
+  corrupt[0] ^= 1;
+  ASSERT_FALSE(loaded.from_blob(corrupt));
+  corrupt = blob;
+  // one used slot more or less than the header says
+  const bool first_used = corrupt[24] || corrupt[25];
+  corrupt[24] = first_used ? 0 : 1;
+  corrupt[25] = 0;
+  ASSERT_FALSE(loaded.from_blob(corrupt));
+}
+
+TEST(subaddress_map, boost_serialization)
+{
+  const auto reference = make_subaddresses(100);
+  cryptonote::subaddress_map map;
+  for (const auto &i: reference)
+    map[i.first] = i.second;
+
+  std::stringstream ss;
+  {
+    boost::archive::portable_binary_oarchive ar(ss);
+    ar << map;
+  }
+  cryptonote::subaddress_map loaded;
+  {
+    boost::archive::portable_binary_iarchive ar(ss);
+    ar >> loaded;
+  }
+  check_same(loaded, reference);
+}
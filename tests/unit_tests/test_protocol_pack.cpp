@@ -31,6 +31,7 @@
 #include "gtest/gtest.h"
 
 #include "include_base_utils.h"
+#include "crypto/hash.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
 #include "storages/portable_storage_template_helper.h"
 
@@ -53,3 +54,194 @@ TEST(protocol_pack, protocol_pack_command)
     ASSERT_TRUE(r.total_height == 3);
   }
 }
+
+namespace
+{
+  struct stream_test_inner
+  {
+    std::vector<uint64_t> indices;
+    std::list<std::string> blobs;
+    int32_t delta;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(indices)
+      KV_SERIALIZE(blobs)
+      KV_SERIALIZE(delta)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct stream_test_outer
+  {
+    uint64_t u64;
+    uint32_t u32;
+    uint16_t u16;
+    uint8_t u8;
+    int64_t i64;
+    int8_t i8;
+    double d;
+    bool b;
+    std::string status;
+    crypto::hash hash;
+    std::vector<crypto::hash> hashes;
+    stream_test_inner single;
+    std::vector<stream_test_inner> many;
+    std::vector<uint64_t> empty;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(u64)
+      KV_SERIALIZE(u32)
+      KV_SERIALIZE(u16)
+      KV_SERIALIZE(u8)
+      KV_SERIALIZE(i64)
+      KV_SERIALIZE(i8)
+      KV_SERIALIZE(d)
+      KV_SERIALIZE(b)
+      KV_SERIALIZE(status)
+      KV_SERIALIZE_VAL_POD_AS_BLOB(hash)
+      KV_SERIALIZE_CONTAINER_POD_AS_BLOB(hashes)
+      KV_SERIALIZE(single)
+      KV_SERIALIZE(many)
+      KV_SERIALIZE(empty)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct stream_test_narrow
+  {
+    uint32_t value;
+    std::vector<uint8_t> values;
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(value)
+      KV_SERIALIZE(values)
+    END_KV_SERIALIZE_MAP()
+  };
+  struct stream_test_wide
+  {
+    uint64_t value;
+    std::vector<uint64_t> values;
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(value)
+      KV_SERIALIZE(values)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  stream_test_outer make_stream_test_outer()
+  {
+    stream_test_outer o;
+    o.u64 = 0xfedcba9876543210;
+    o.u32 = 0x89abcdef;
+    o.u16 = 0xbeef;
+    o.u8 = 0x7f;
+    o.i64 = -42;
+    o.i8 = -7;
+    o.d = 3.5;
+    o.b = true;
+    o.status = "OK";
+    o.hash = crypto::cn_fast_hash("hash", 4);
+    for (size_t i = 0; i < 100; ++i)
+      o.hashes.push_back(crypto::cn_fast_hash(&i, sizeof(i)));
+    o.single.indices = {1, 2, 3};
+    o.single.blobs = {"a", std::string(300, 'b')};
+    o.single.delta = -1;
+    // more than 63 elements at several levels, so counts need more than one byte
+    for (size_t i = 0; i < 70; ++i)
+    {
+      stream_test_inner inner;
+      for (size_t j = 0; j < i; ++j)
+        inner.indices.push_back(i * 1000 + j);
+      inner.blobs.push_back(std::string(i, 'x'));
+      inner.delta = i;
+      o.many.push_back(inner);
+    }
+    return o;
+  }
+
+  void check_stream_test_outer(const stream_test_outer& a, const stream_test_outer& b)
+  {
+    ASSERT_EQ(a.u64, b.u64);
+    ASSERT_EQ(a.u32, b.u32);
+    ASSERT_EQ(a.u16, b.u16);
+    ASSERT_EQ(a.u8, b.u8);
+    ASSERT_EQ(a.i64, b.i64);
+    ASSERT_EQ(a.i8, b.i8);
+    ASSERT_EQ(a.d, b.d);
+    ASSERT_EQ(a.b, b.b);
+    ASSERT_EQ(a.status, b.status);
+    ASSERT_EQ(a.hash, b.hash);
+    ASSERT_EQ(a.hashes, b.hashes);
+    ASSERT_EQ(a.single.indices, b.single.indices);
+    ASSERT_EQ(a.single.blobs, b.single.blobs);
+    ASSERT_EQ(a.single.delta, b.single.delta);
+    ASSERT_EQ(a.many.size(), b.many.size());
+    for (size_t i = 0; i < a.many.size(); ++i)
+    {
+      ASSERT_EQ(a.many[i].indices, b.many[i].indices);
+      ASSERT_EQ(a.many[i].blobs, b.many[i].blobs);
+      ASSERT_EQ(a.many[i].delta, b.many[i].delta);
+    }
+    ASSERT_TRUE(b.empty.empty());
+  }
+}
+
+TEST(protocol_pack, stream_writer_read_by_portable_storage)
+{
+  const stream_test_outer o = make_stream_test_outer();
+  std::string buff;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(o, buff));
+
+  epee::serialization::portable_storage ps;
+  ASSERT_TRUE(ps.load_from_binary(buff));
+  stream_test_outer o2;
+  ASSERT_TRUE(o2.load(ps));
+  check_stream_test_outer(o, o2);
+}
+
+TEST(protocol_pack, stream_reader_reads_portable_storage)
+{
+  const stream_test_outer o = make_stream_test_outer();
+  epee::serialization::portable_storage ps;
+  o.store(ps);
+  std::string buff;
+  ASSERT_TRUE(ps.store_to_binary(buff));
+
+  stream_test_outer o2;
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(o2, buff));
+  check_stream_test_outer(o, o2);
+
+  // the same data stored by the stream writer differs only in field order
+  std::string buff2;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(o, buff2));
+  ASSERT_EQ(buff.size(), buff2.size());
+}
+
+TEST(protocol_pack, stream_reader_converts_types)
+{
+  stream_test_narrow n;
+  n.value = 1234567;
+  n.values = {1, 2, 255};
+  std::string buff;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(n, buff));
+  stream_test_wide w;
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(w, buff));
+  ASSERT_EQ(w.value, 1234567u);
+  ASSERT_EQ(w.values, std::vector<uint64_t>({1, 2, 255}));
+
+  w.value = 0x100000000;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(w, buff));
+  ASSERT_FALSE(epee::serialization::load_t_from_binary(n, buff));
+}
+
+TEST(protocol_pack, stream_reader_rejects_bad_data)
+{
+  const stream_test_outer o = make_stream_test_outer();
+  std::string buff;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(o, buff));
+
+  epee::serialization::portable_storage_reader reader;
+  ASSERT_TRUE(reader.load_from_binary(buff));
+  for (size_t len: {size_t(0), size_t(8), size_t(9), size_t(10), buff.size() / 2, buff.size() - 1})
+    ASSERT_FALSE(reader.load_from_binary(buff.substr(0, len)));
+
+  std::string bad_signature = buff;
+  bad_signature[0] ^= 1;
+  ASSERT_FALSE(reader.load_from_binary(bad_signature));
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <stdexcept>
+#include "gtest/gtest.h"
+
+#include "common/threadpool.h"
+
+TEST(threadpool, wait_for_all)
+{
+  tools::threadpool &tpool = tools::threadpool::getInstance();
+  std::atomic<unsigned> count(0);
+  tools::threadpool::waiter waiter;
+  for (int i = 0; i < 1000; ++i)
+    tpool.submit(&waiter, [&count](){ ++count; });
+  waiter.wait();
+  ASSERT_EQ(count, 1000);
+}
+
+TEST(threadpool, nested)
+{
+  // every task waits on its own subtasks, which would starve a pool
+  // whose waiters just block once the nesting is wider than the pool
+  tools::threadpool &tpool = tools::threadpool::getInstance();
+  const int n = 4 * tpool.get_max_concurrency();
+  std::atomic<unsigned> count(0);
+  tools::threadpool::waiter waiter;
+  for (int i = 0; i < n; ++i)
+  {
+    tpool.submit(&waiter, [&tpool, &count, n](){
+      tools::threadpool::waiter inner;
+      for (int j = 0; j < n; ++j)
+        tpool.submit(&inner, [&tpool, &count](){
+          tools::threadpool::waiter leaf;
+          for (int k = 0; k < 4; ++k)
+            tpool.submit(&leaf, [&count](){ ++count; });
+          leaf.wait();
+        });
+      inner.wait();
+    });
+  }
+  waiter.wait();
+  ASSERT_EQ(count, 4 * n * n);
+}
+
+TEST(threadpool, throwing_tasks)
+{
+  // a throwing task must still count as done, and leave its worker alive
+  tools::threadpool &tpool = tools::threadpool::getInstance();
+  std::atomic<unsigned> count(0);
+  tools::threadpool::waiter waiter;
+  for (int i = 0; i < 100; ++i)
+    tpool.submit(&waiter, [&count, i](){ if (i % 2) throw std::runtime_error("test"); ++count; });
+  waiter.wait();
+  ASSERT_EQ(count, 50);
+
+  tools::threadpool::waiter waiter2;
+  for (int i = 0; i < 100; ++i)
+    tpool.submit(&waiter2, [&count](){ ++count; });
+  waiter2.wait();
+  ASSERT_EQ(count, 150);
+}
+
+TEST(threadpool, stats)
+{
+  tools::threadpool &tpool = tools::threadpool::getInstance();
+  const tools::threadpool::stats before = tpool.get_stats();
+  tools::threadpool::waiter waiter;
+  for (int i = 0; i < 100; ++i)
+    tpool.submit(&waiter, [](){});
+  waiter.wait();
+  const tools::threadpool::stats after = tpool.get_stats();
+  ASSERT_EQ(after.submitted - before.submitted, 100);
+  ASSERT_GE(after.executed - before.executed, 100);
+  ASSERT_GE(after.submitted, after.executed);
+}
@@ -0,0 +1,257 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#include <boost/filesystem.hpp>
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "file_io_utils.h"
+#include "ringct/rctOps.h"
+#include "serialization/binary_utils.h"
+#include "wallet/wallet2.h"
+#include "wallet/wallet_cache.h"
+
+namespace
+{
+  crypto::chacha_key make_key()
+  {
+    crypto::chacha_key key;
+    crypto::rand(key.size(), key.data());
+    return key;
+  }
+
+  cryptonote::transaction_prefix make_tx_prefix(size_t outputs)
+  {
+    cryptonote::transaction_prefix tx;
+    tx.version = 2;
+    tx.unlock_time = crypto::rand<uint8_t>();
+    cryptonote::txin_to_key in;
+    in.amount = 0;
+    in.key_offsets = {crypto::rand<uint32_t>(), 1, 2};
+    in.k_image = rct::rct2ki(rct::pkGen());
+    tx.vin.push_back(in);
+    for (size_t i = 0; i < outputs; ++i)
+      tx.vout.push_back(cryptonote::tx_out{0, cryptonote::txout_to_key(rct::rct2pk(rct::pkGen()))});
+    cryptonote::add_tx_pub_key_to_extra(tx, rct::rct2pk(rct::pkGen()));
+    return tx;
+  }
+
+  template<typename T>
+  std::string to_blob(T t)
+  {
+    std::string blob;
+    EXPECT_TRUE(::serialization::dump_binary(t, blob));
+    return blob;
+  }
+}
+
+class wallet_cache_test: public ::testing::Test
+{
+protected:
+  wallet_cache_test():
+    m_dir(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()),
+    m_path((m_dir / "cache").string()),
+    m_key(make_key())
+  {
+    boost::filesystem::create_directory(m_dir);
+    m_sections.resize(tools::wallet_cache::num_sections);
+    m_sections[tools::wallet_cache::section_state].push_back("state");
+    for (int i = 0; i < 8; ++i)
+    {
+      m_sections[tools::wallet_cache::section_transfers].push_back(std::string(1000 + i, 'a' + i));
+      m_sections[tools::wallet_cache::section_tx_prefixes].push_back(std::string(2000 + i, 'A' + i));
+    }
+  }
+
+  ~wallet_cache_test()
+  {
+    boost::system::error_code ec;
+    boost::filesystem::remove_all(m_dir, ec);
+  }
+
+  void check_loads(const std::vector<std::vector<std::string>> &sections)
+  {
+    tools::wallet_cache cache;
+    ASSERT_TRUE(cache.load_index(m_path, m_key));
+    for (size_t s = 0; s < sections.size(); ++s)
+    {
+      const tools::wallet_cache::section_t section = (tools::wallet_cache::section_t)s;
+      ASSERT_EQ(sections[s].size(), cache.num_chunks(section));
+      for (size_t i = 0; i < sections[s].size(); ++i)
+        ASSERT_EQ(sections[s][i], cache.load_chunk(section, i, m_key));
+    }
+  }
+
+  tools::wallet2::transfer_container &transfers(tools::wallet2 &wallet) { return wallet.m_transfers; }
+
+  boost::filesystem::path m_dir;
+  std::string m_path;
+  crypto::chacha_key m_key;
+  std::vector<std::vector<std::string>> m_sections;
+};
+
+TEST_F(wallet_cache_test, round_trip)
+{
+  tools::wallet_cache cache;
+  ASSERT_GT(cache.store(m_path, m_key, m_sections), 8 * 3000);
+  check_loads(m_sections);
+}
+
+TEST_F(wallet_cache_test, writes_only_changed_chunks)
+{
+  tools::wallet_cache cache;
+  cache.store(m_path, m_key, m_sections);
+  ASSERT_LT(cache.store(m_path, m_key, m_sections), 1000);
+
+  m_sections[tools::wallet_cache::section_transfers][7] += "new transfer";
+  m_sections[tools::wallet_cache::section_transfers].push_back("last transfer");
+  m_sections[tools::wallet_cache::section_tx_prefixes].push_back("last prefix");
+  const uint64_t written = cache.store(m_path, m_key, m_sections);
+  ASSERT_GT(written, 1000);
+  ASSERT_LT(written, 2000);
+  check_loads(m_sections);
+
+  // a loaded cache appends too
+  tools::wallet_cache loaded;
+  ASSERT_TRUE(loaded.load_index(m_path, m_key));
+  m_sections[tools::wallet_cache::section_state][0] = "new state";
+  ASSERT_LT(loaded.store(m_path, m_key, m_sections), 1000);
+  check_loads(m_sections);
+}
+
+TEST_F(wallet_cache_test, rewrites_modified_file)
+{
+  tools::wallet_cache cache, other;
+  cache.store(m_path, m_key, m_sections);
+  m_sections[tools::wallet_cache::section_state][0] = "other state";
+  other.store(m_path, m_key, m_sections);
+
+  m_sections[tools::wallet_cache::section_state][0] = "new state";
+  ASSERT_GT(cache.store(m_path, m_key, m_sections), 8 * 3000);
+  check_loads(m_sections);
+}
+
+TEST_F(wallet_cache_test, wrong_key)
+{
+  tools::wallet_cache cache;
+  cache.store(m_path, m_key, m_sections);
+  ASSERT_THROW(cache.load_index(m_path, make_key()), tools::error::wallet_internal_error);
+}
+
+TEST_F(wallet_cache_test, not_a_cache)
+{
+  tools::wallet_cache cache;
+  ASSERT_FALSE(cache.load_index(m_path, m_key));
+  ASSERT_TRUE(epee::file_io_utils::save_string_to_file(m_path, std::string(100, 'x')));
+  ASSERT_FALSE(cache.load_index(m_path, m_key));
+}
+
+TEST_F(wallet_cache_test, wallet_round_trip)
+{
+  const std::string path = (m_dir / "wallet").string();
+  tools::wallet2 wallet(true);
+  wallet.generate(path, "password");
+  wallet.set_attribute("test", "value");
+  wallet.store();
+
+  tools::wallet2 loaded(true);
+  loaded.load(path, "password");
+  ASSERT_EQ(wallet.get_account().get_public_address_str(true), loaded.get_account().get_public_address_str(true));
+  ASSERT_EQ("value", loaded.get_attribute("test"));
+}
+
+TEST_F(wallet_cache_test, wallet_transfers_round_trip)
+{
+  const std::string path = (m_dir / "wallet").string();
+  tools::wallet2 wallet(true);
+  wallet.generate(path, "password");
+
+  // more than one chunk of transfers, from transactions with several outputs each
+  std::vector<cryptonote::transaction_prefix> txes;
+  for (size_t i = 0; i < 3; ++i)
+    txes.push_back(make_tx_prefix(i + 2));
+  tools::wallet2::transfer_container &original = transfers(wallet);
+  for (size_t i = 0; i < 1500; ++i)
+  {
+    const cryptonote::transaction_prefix &tx = txes[i % txes.size()];
+    tools::wallet2::transfer_details td;
+    td.m_block_height = 1000 + i;
+    td.m_tx = tx;
+    td.m_txid = cryptonote::get_transaction_prefix_hash(tx);
+    td.m_internal_output_index = i % tx.vout.size();
+    td.m_global_output_index = 50000 + 7 * i;
+    td.m_spent = i % 3 == 0;
+    td.m_spent_height = td.m_spent ? 2000 + i : 0;
+    td.m_key_image = rct::rct2ki(rct::pkGen());
+    td.m_mask = rct::skGen();
+    td.m_amount = 1000000 * (i + 1);
+    td.m_rct = i % 2 == 0;
+    td.m_key_image_known = i % 5 != 0;
+    td.m_pk_index = i % 2;
+    td.m_subaddr_index = {(uint32_t)(i % 4), (uint32_t)(i % 7)};
+    td.m_key_image_partial = i % 11 == 0;
+    if (i % 100 == 0)
+    {
+      td.m_multisig_k = {rct::skGen(), rct::skGen()};
+      tools::wallet2::multisig_info mi;
+      mi.m_signer = rct::rct2pk(rct::pkGen());
+      mi.m_LR.push_back({rct::pkGen(), rct::pkGen()});
+      mi.m_partial_key_images.push_back(rct::rct2ki(rct::pkGen()));
+      td.m_multisig_info.push_back(mi);
+    }
+    original.push_back(td);
+  }
+  wallet.store();
+
+  tools::wallet2 loaded(true);
+  loaded.load(path, "password");
+  const tools::wallet2::transfer_container &reloaded = transfers(loaded);
+  ASSERT_EQ(original.size(), reloaded.size());
+  for (size_t i = 0; i < original.size(); ++i)
+  {
+    const tools::wallet2::transfer_details &a = original[i], &b = reloaded[i];
+    ASSERT_EQ(a.m_block_height, b.m_block_height);
+    ASSERT_EQ(to_blob(a.m_tx), to_blob(b.m_tx));
+    ASSERT_EQ(a.m_txid, b.m_txid);
+    ASSERT_EQ(a.m_internal_output_index, b.m_internal_output_index);
+    ASSERT_EQ(a.m_global_output_index, b.m_global_output_index);
+    ASSERT_EQ(a.m_spent, b.m_spent);
+    ASSERT_EQ(a.m_spent_height, b.m_spent_height);
+    ASSERT_EQ(a.m_key_image, b.m_key_image);
+    ASSERT_EQ(a.m_mask, b.m_mask);
+    ASSERT_EQ(a.m_amount, b.m_amount);
+    ASSERT_EQ(a.m_rct, b.m_rct);
+    ASSERT_EQ(a.m_key_image_known, b.m_key_image_known);
+    ASSERT_EQ(a.m_pk_index, b.m_pk_index);
+    ASSERT_EQ(a.m_subaddr_index, b.m_subaddr_index);
+    ASSERT_EQ(a.m_key_image_partial, b.m_key_image_partial);
+    ASSERT_EQ(to_blob(a.m_multisig_k), to_blob(b.m_multisig_k));
+    ASSERT_EQ(to_blob(a.m_multisig_info), to_blob(b.m_multisig_info));
+    ASSERT_EQ(a.get_public_key(), b.get_public_key());
+  }
+}
@@ -0,0 +1,167 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <map>
+#include <boost/filesystem.hpp>
+#include "gtest/gtest.h"
+
+#include "wallet/wallet2.h"
+#include "wallet/wallet_pool.h"
+
+namespace
+{
+  class wallet_pool_test: public ::testing::Test
+  {
+  protected:
+    wallet_pool_test():
+      m_dir(boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()),
+      m_loads(0),
+      m_pool(2, [this](const std::string &id, const epee::wipeable_string &password) {
+        ++m_loads;
+        std::unique_ptr<tools::wallet2> wallet(new tools::wallet2(true));
+        wallet->load((m_dir / id).string(), password);
+        return wallet;
+      })
+    {
+      boost::filesystem::create_directory(m_dir);
+    }
+
+    ~wallet_pool_test()
+    {
+      m_pool.stop();
+      boost::system::error_code ec;
+      boost::filesystem::remove_all(m_dir, ec);
+    }
+
+    bool add(const std::string &id)
+    {
+      std::unique_ptr<tools::wallet2> wallet(new tools::wallet2(true));
+      wallet->generate((m_dir / id).string(), "password");
+      m_addresses[id] = wallet->get_account().get_public_address_str(true);
+      return m_pool.add(id, "password", std::move(wallet), m_tokens[id]);
+    }
+
+    boost::filesystem::path m_dir;
+    unsigned m_loads;
+    tools::wallet_pool m_pool;
+    std::map<std::string, std::string> m_addresses;
+    std::map<std::string, std::string> m_tokens;
+  };
+}
+
+TEST_F(wallet_pool_test, evicts_least_recently_used)
+{
+  ASSERT_TRUE(add("a"));
+  ASSERT_TRUE(add("b"));
+  ASSERT_TRUE(add("c"));
+  ASSERT_EQ(3, m_pool.size());
+  ASSERT_EQ(2, m_pool.loaded());
+  ASSERT_EQ(0, m_loads);
+
+  // a was stored and unloaded to make room for c
+  {
+    tools::wallet_pool::handle h = m_pool.acquire("a");
+    ASSERT_TRUE(bool(h));
+    ASSERT_EQ(m_addresses["a"], h->get_account().get_public_address_str(true));
+  }
+  ASSERT_EQ(1, m_loads);
+  ASSERT_EQ(2, m_pool.loaded());
+
+  // loading a again pushed out b, the least recently used then
+  ASSERT_TRUE(bool(m_pool.acquire("c")));
+  ASSERT_EQ(1, m_loads);
+  ASSERT_TRUE(bool(m_pool.acquire("b")));
+  ASSERT_EQ(2, m_loads);
+
+  ASSERT_FALSE(bool(m_pool.acquire("d")));
+}
+
+TEST_F(wallet_pool_test, keeps_busy_wallets)
+{
+  ASSERT_TRUE(add("a"));
+  tools::wallet_pool::handle h = m_pool.acquire("a");
+  ASSERT_TRUE(bool(h));
+
+  // a is the least recently used, but in use, so b goes instead
+  ASSERT_TRUE(add("b"));
+  ASSERT_TRUE(add("c"));
+  ASSERT_EQ(2, m_pool.loaded());
+  ASSERT_TRUE(bool(h));
+  ASSERT_EQ(m_addresses["a"], h->get_account().get_public_address_str(true));
+}
+
+TEST_F(wallet_pool_test, close)
+{
+  ASSERT_TRUE(add("a"));
+  tools::wallet_pool::handle h = m_pool.acquire("a");
+  ASSERT_TRUE(m_pool.close(h));
+  ASSERT_FALSE(bool(h));
+  ASSERT_EQ(0, m_pool.size());
+  ASSERT_EQ(0, m_pool.loaded());
+  ASSERT_FALSE(bool(m_pool.acquire("a")));
+}
+
+TEST_F(wallet_pool_test, rejects_other_tokens)
+{
+  ASSERT_TRUE(add("a"));
+  ASSERT_TRUE(add("b"));
+  ASSERT_EQ(32, m_tokens["a"].size());
+  ASSERT_NE(m_tokens["a"], m_tokens["b"]);
+
+  // a second client knows the wallet's name, but not its token
+  {
+    tools::wallet_pool::handle h = m_pool.acquire("a");
+    ASSERT_TRUE(bool(h));
+    ASSERT_EQ(m_tokens["a"], h.token());
+    ASSERT_TRUE(h.authorized(m_tokens["a"]));
+    ASSERT_FALSE(h.authorized(""));
+    ASSERT_FALSE(h.authorized(m_tokens["b"]));
+    ASSERT_FALSE(h.authorized(m_tokens["a"].substr(1)));
+  }
+
+  // the token survives the wallet being unloaded and loaded again
+  ASSERT_TRUE(add("c"));
+  ASSERT_EQ(2, m_pool.loaded());
+  {
+    tools::wallet_pool::handle h = m_pool.acquire("b");
+    ASSERT_EQ(1, m_loads);
+    ASSERT_TRUE(h.authorized(m_tokens["b"]));
+  }
+
+  // opening the wallet again after closing it gives a new token
+  const std::string old_token = m_tokens["a"];
+  tools::wallet_pool::handle h = m_pool.acquire("a");
+  ASSERT_TRUE(m_pool.close(h));
+  ASSERT_FALSE(h.authorized(old_token));
+  std::unique_ptr<tools::wallet2> wallet(new tools::wallet2(true));
+  wallet->load((m_dir / "a").string(), "password");
+  ASSERT_TRUE(m_pool.add("a", "password", std::move(wallet), m_tokens["a"]));
+  ASSERT_NE(old_token, m_tokens["a"]);
+  ASSERT_FALSE(m_pool.acquire("a").authorized(old_token));
+  ASSERT_TRUE(m_pool.acquire("a").authorized(m_tokens["a"]));
+}
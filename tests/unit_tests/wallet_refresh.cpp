@@ -0,0 +1,296 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <list>
+#include "gtest/gtest.h"
+
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "wallet/wallet2.h"
+
+// runs blocks through the refresh pipeline (parse_blocks, then the batched
+// output scan of process_parsed_blocks), and through the serial path, which
+// scans each transaction as it is processed, and compares the results
+class wallet_refresh_test: public ::testing::Test
+{
+protected:
+  typedef tools::wallet2::parsed_block parsed_block;
+  typedef tools::wallet2::tx_cache_data tx_cache_data;
+
+  wallet_refresh_test(): m_next_global_index(0)
+  {
+    cryptonote::account_base seed;
+    seed.generate();
+    m_other.generate();
+    for (tools::wallet2 *w: {&m_pipelined, &m_serial})
+    {
+      // a small lookahead, so receiving makes the wallet look for new subaddresses
+      w->set_subaddress_lookahead(1, 3);
+      w->generate("", "", seed.get_keys().m_spend_secret_key, true, false);
+    }
+
+    cryptonote::block genesis;
+    m_pipelined.generate_genesis(genesis);
+    add_block(genesis, {});
+  }
+
+  const cryptonote::account_keys &keys() const { return m_pipelined.get_account().get_keys(); }
+
+  cryptonote::account_public_address subaddress(uint32_t minor) const { return m_pipelined.get_subaddress({0, minor}); }
+
+  void add_block(const cryptonote::block &b, const std::vector<cryptonote::transaction> &txs)
+  {
+    cryptonote::block_complete_entry bce;
+    bce.block = cryptonote::block_to_blob(b);
+    cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices indices;
+    indices.indices.resize(txs.size() + 1);
+    for (size_t n = 0; n < b.miner_tx.vout.size(); ++n)
+      indices.indices[0].indices.push_back(m_next_global_index++);
+    for (size_t i = 0; i < txs.size(); ++i)
+    {
+      bce.txs.push_back(cryptonote::tx_to_blob(txs[i]));
+      for (size_t n = 0; n < txs[i].vout.size(); ++n)
+        indices.indices[i + 1].indices.push_back(m_next_global_index++);
+    }
+    m_blocks.push_back(bce);
+    m_o_indices.push_back(indices);
+    m_chain.push_back(b);
+  }
+
+  // mines a block paying the given address, with the given transactions
+  void mine(const cryptonote::account_public_address &miner, const std::vector<cryptonote::transaction> &txs)
+  {
+    cryptonote::block b;
+    b.major_version = 1;
+    b.minor_version = 0;
+    b.timestamp = time(NULL);
+    b.nonce = 0;
+    b.prev_id = cryptonote::get_block_hash(m_chain.back());
+    ASSERT_TRUE(cryptonote::construct_miner_tx(m_chain.size(), 0, 0, 0, 0, miner, b.miner_tx));
+    for (const cryptonote::transaction &tx: txs)
+      b.tx_hashes.push_back(cryptonote::get_transaction_hash(tx));
+    add_block(b, txs);
+  }
+
+  // spends an output of a miner tx of ours
+  void spend(size_t height, size_t out, const std::vector<cryptonote::tx_destination_entry> &destinations, cryptonote::transaction &tx)
+  {
+    const cryptonote::transaction &miner_tx = m_chain[height].miner_tx;
+    cryptonote::tx_source_entry src;
+    src.amount = miner_tx.vout[out].amount;
+    src.push_output(m_o_indices[height].indices[0].indices[out], boost::get<cryptonote::txout_to_key>(miner_tx.vout[out].target).key, src.amount);
+    src.real_output = 0;
+    src.real_out_tx_key = cryptonote::get_tx_pub_key_from_extra(miner_tx);
+    src.real_output_in_tx_index = out;
+    src.rct = false;
+    src.mask = rct::identity();
+    std::vector<cryptonote::tx_source_entry> sources(1, src);
+
+    cryptonote::subaddress_map subaddresses;
+    subaddresses[keys().m_account_address.m_spend_public_key] = {0, 0};
+    crypto::secret_key tx_key;
+    std::vector<crypto::secret_key> additional_tx_keys;
+    ASSERT_TRUE(cryptonote::construct_tx_and_get_tx_key(keys(), subaddresses, sources, destinations, keys().m_account_address, {}, tx, 0, tx_key, additional_tx_keys, false));
+  }
+
+  void parse(const std::list<cryptonote::block_complete_entry> &blocks, std::vector<parsed_block> &parsed)
+  {
+    m_pipelined.parse_blocks(blocks, m_o_indices, parsed);
+  }
+
+  void cache_tx_data(const cryptonote::transaction &tx, bool miner_tx, tx_cache_data &tx_cache)
+  {
+    m_pipelined.cache_tx_data(tx, miner_tx, tx_cache);
+  }
+
+  void scan_tx_outputs(const cryptonote::transaction &tx, bool miner_tx, tx_cache_data &tx_cache)
+  {
+    m_pipelined.scan_tx_outputs(tx, miner_tx, tx_cache);
+  }
+
+  void refresh_pipelined(size_t batch_size)
+  {
+    // like the daemon does, each batch starts with the last block of the previous one
+    for (size_t start = 0, end = 0; end < m_blocks.size(); start = end - 1)
+    {
+      end = std::min(start + batch_size, m_blocks.size());
+      std::list<cryptonote::block_complete_entry> blocks;
+      std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> o_indices;
+      for (size_t n = start; n < end; ++n)
+      {
+        blocks.push_back(m_blocks[n]);
+        o_indices.push_back(m_o_indices[n]);
+      }
+      std::vector<parsed_block> parsed;
+      m_pipelined.parse_blocks(blocks, o_indices, parsed);
+      uint64_t blocks_added;
+      m_pipelined.process_parsed_blocks(start, parsed, blocks_added);
+    }
+  }
+
+  void refresh_serial()
+  {
+    std::list<cryptonote::block_complete_entry> blocks(m_blocks.begin(), m_blocks.end());
+    std::vector<parsed_block> parsed;
+    m_serial.parse_blocks(blocks, m_o_indices, parsed);
+    // without precomputed scan results, each transaction is scanned when processed
+    for (size_t height = 1; height < parsed.size(); ++height)
+      m_serial.process_new_blockchain_entry(parsed[height], height, {});
+  }
+
+  void check_same_transfers()
+  {
+    tools::wallet2::transfer_container pipelined, serial;
+    m_pipelined.get_transfers(pipelined);
+    m_serial.get_transfers(serial);
+    ASSERT_EQ(pipelined.size(), serial.size());
+    for (size_t n = 0; n < serial.size(); ++n)
+    {
+      ASSERT_EQ(pipelined[n].m_txid, serial[n].m_txid);
+      ASSERT_EQ(pipelined[n].m_internal_output_index, serial[n].m_internal_output_index);
+      ASSERT_EQ(pipelined[n].m_global_output_index, serial[n].m_global_output_index);
+      ASSERT_EQ(pipelined[n].m_block_height, serial[n].m_block_height);
+      ASSERT_EQ(pipelined[n].m_amount, serial[n].m_amount);
+      ASSERT_EQ(pipelined[n].m_spent, serial[n].m_spent);
+      ASSERT_EQ(pipelined[n].m_spent_height, serial[n].m_spent_height);
+      ASSERT_EQ(pipelined[n].m_key_image, serial[n].m_key_image);
+      ASSERT_EQ(pipelined[n].m_subaddr_index, serial[n].m_subaddr_index);
+    }
+    ASSERT_EQ(m_pipelined.balance(0), m_serial.balance(0));
+    ASSERT_EQ(m_pipelined.get_blockchain_current_height(), m_serial.get_blockchain_current_height());
+    ASSERT_EQ(m_pipelined.get_num_subaddresses(0), m_serial.get_num_subaddresses(0));
+  }
+
+  tools::wallet2 m_pipelined;
+  tools::wallet2 m_serial;
+  cryptonote::account_base m_other;
+  std::vector<cryptonote::block> m_chain;
+  std::vector<cryptonote::block_complete_entry> m_blocks;
+  std::vector<cryptonote::COMMAND_RPC_GET_BLOCKS_FAST::block_output_indices> m_o_indices;
+  uint64_t m_next_global_index;
+};
+
+TEST_F(wallet_refresh_test, parse_blocks)
+{
+  mine(keys().m_account_address, {});
+  mine(m_other.get_keys().m_account_address, {});
+  std::list<cryptonote::block_complete_entry> blocks(m_blocks.begin(), m_blocks.end());
+  std::vector<parsed_block> parsed;
+  parse(blocks, parsed);
+  ASSERT_EQ(parsed.size(), m_chain.size());
+  for (size_t n = 0; n < parsed.size(); ++n)
+  {
+    ASSERT_FALSE(parsed[n].error);
+    ASSERT_EQ(parsed[n].hash, cryptonote::get_block_hash(m_chain[n]));
+    ASSERT_EQ(parsed[n].o_indices.indices.size(), 1);
+  }
+
+  blocks.back().block = "not a block";
+  ASSERT_THROW(parse(blocks, parsed), tools::error::block_parse_error);
+}
+
+TEST_F(wallet_refresh_test, same_as_serial)
+{
+  mine(keys().m_account_address, {});
+  mine(keys().m_account_address, {});
+  mine(m_other.get_keys().m_account_address, {});
+
+  // to a subaddress and someone else, with change, so with additional tx keys
+  cryptonote::transaction tx1;
+  spend(1, 0, {
+    {m_chain[1].miner_tx.vout[0].amount / 4, subaddress(2), true},
+    {m_chain[1].miner_tx.vout[0].amount / 4, m_other.get_keys().m_account_address, false},
+    {m_chain[1].miner_tx.vout[0].amount / 4, keys().m_account_address, false}}, tx1);
+  mine(m_other.get_keys().m_account_address, {tx1});
+
+  // to a subaddress the wallet only looks for once tx1 is processed
+  cryptonote::transaction tx2;
+  spend(2, 0, {{m_chain[2].miner_tx.vout[0].amount / 2, subaddress(4), true}}, tx2);
+  mine(m_other.get_keys().m_account_address, {tx2});
+
+  refresh_serial();
+  refresh_pipelined(m_blocks.size());
+  check_same_transfers();
+
+  tools::wallet2::transfer_container transfers;
+  m_pipelined.get_transfers(transfers);
+  size_t spent = 0, to_subaddress = 0;
+  for (const tools::wallet2::transfer_details &td: transfers)
+  {
+    spent += td.m_spent;
+    if (td.m_subaddr_index.minor == 2)
+    {
+      ASSERT_EQ(td.m_amount, m_chain[1].miner_tx.vout[0].amount / 4);
+      ++to_subaddress;
+    }
+    else if (td.m_subaddr_index.minor == 4)
+    {
+      ASSERT_EQ(td.m_amount, m_chain[2].miner_tx.vout[0].amount / 2);
+      ++to_subaddress;
+    }
+  }
+  ASSERT_EQ(spent, 2);
+  ASSERT_EQ(to_subaddress, 2);
+}
+
+TEST_F(wallet_refresh_test, batch_boundaries)
+{
+  for (int n = 0; n < 4; ++n)
+    mine(keys().m_account_address, {});
+  cryptonote::transaction tx;
+  spend(3, 0, {{m_chain[3].miner_tx.vout[0].amount / 2, subaddress(1), true}}, tx);
+  mine(m_other.get_keys().m_account_address, {tx});
+  mine(keys().m_account_address, {});
+
+  refresh_serial();
+  refresh_pipelined(2);
+  check_same_transfers();
+}
+
+TEST_F(wallet_refresh_test, cache_tx_data)
+{
+  mine(keys().m_account_address, {});
+  mine(m_other.get_keys().m_account_address, {});
+
+  tx_cache_data ours, theirs;
+  cache_tx_data(m_chain[1].miner_tx, true, ours);
+  cache_tx_data(m_chain[2].miner_tx, true, theirs);
+  ASSERT_TRUE(ours.extra_parsed);
+  ASSERT_EQ(ours.primary.size(), 1);
+  ASSERT_EQ(ours.primary[0].scan_info.size(), m_chain[1].miner_tx.vout.size());
+  for (const auto &info: ours.primary[0].scan_info)
+    ASSERT_TRUE(info.received);
+  ASSERT_EQ(theirs.primary.size(), 1);
+  for (const auto &info: theirs.primary[0].scan_info)
+    ASSERT_FALSE(info.received);
+
+  // scanning again, as done when new subaddresses were found, gives the same results
+  scan_tx_outputs(m_chain[1].miner_tx, true, ours);
+  for (const auto &info: ours.primary[0].scan_info)
+    ASSERT_TRUE(info.received);
+}
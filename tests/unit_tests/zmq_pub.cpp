@@ -0,0 +1,272 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <boost/filesystem.hpp>
+#include <boost/thread/thread.hpp>
+#include "gtest/gtest.h"
+
+#include "blockchain_db/lmdb/db_lmdb.h"
+#include "cryptonote_basic/cryptonote_format_utils.h"
+#include "cryptonote_basic/hardfork.h"
+#include "cryptonote_core/cryptonote_tx_utils.h"
+#include "ringct/rctOps.h"
+#include "rpc/zmq_pub.h"
+#include "storages/portable_storage_template_helper.h"
+
+using cryptonote::rpc::ZmqPublisher;
+
+namespace
+{
+  crypto::hash make_hash(char c)
+  {
+    crypto::hash h;
+    memset(&h, c, sizeof(h));
+    return h;
+  }
+
+  template<typename T>
+  bool round_trip(const T& in, T& out)
+  {
+    std::string blob;
+    if (!epee::serialization::store_t_to_binary(in, blob))
+      return false;
+    return epee::serialization::load_t_from_binary(out, blob);
+  }
+}
+
+TEST(zmq_pub, block_notification)
+{
+  ZmqPublisher::block_notification n;
+  n.height = 1234567;
+  n.hash = make_hash(1);
+  n.block.block = "block blob";
+  n.block.txs.push_back("tx blob 1");
+  n.block.txs.push_back(std::string("tx\0blob 2", 9));
+  n.output_indices.indices.resize(3);
+  n.output_indices.indices[0].indices = {5};
+  n.output_indices.indices[1].indices = {};
+  n.output_indices.indices[2].indices = {7, 0, 0xffffffffffffffff};
+
+  ZmqPublisher::block_notification m;
+  ASSERT_TRUE(round_trip(n, m));
+  ASSERT_EQ(m.height, n.height);
+  ASSERT_EQ(m.hash, n.hash);
+  ASSERT_EQ(m.block.block, n.block.block);
+  ASSERT_EQ(m.block.txs, n.block.txs);
+  ASSERT_EQ(m.output_indices.indices.size(), 3);
+  for (size_t i = 0; i < 3; ++i)
+    ASSERT_EQ(m.output_indices.indices[i].indices, n.output_indices.indices[i].indices);
+}
+
+TEST(zmq_pub, tx_notification)
+{
+  ZmqPublisher::tx_notification n;
+  n.hash = make_hash(2);
+  n.tx = std::string("tx\0blob", 7);
+
+  ZmqPublisher::tx_notification m;
+  ASSERT_TRUE(round_trip(n, m));
+  ASSERT_EQ(m.hash, n.hash);
+  ASSERT_EQ(m.tx, n.tx);
+}
+
+TEST(zmq_pub, detach_notification)
+{
+  ZmqPublisher::detach_notification n;
+  n.height = 42;
+  n.hash = make_hash(3);
+
+  ZmqPublisher::detach_notification m;
+  ASSERT_TRUE(round_trip(n, m));
+  ASSERT_EQ(m.height, n.height);
+  ASSERT_EQ(m.hash, n.hash);
+}
+
+// publishes blocks added to a real database, as the blockchain's hook does
+class zmq_pub_test: public ::testing::Test
+{
+protected:
+  typedef ZmqPublisher::publisher publisher;
+  typedef ZmqPublisher::event event;
+
+  zmq_pub_test():
+    m_path((boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string()),
+    m_hardfork(m_db, 1, 0),
+    m_publisher(std::make_shared<publisher>(false))
+  {
+  }
+
+  virtual void SetUp()
+  {
+    m_db.open(m_path);
+    m_hardfork.init();
+    m_db.set_hard_fork(&m_hardfork);
+    m_db.set_batch_transactions(true);
+
+    cryptonote::block genesis = make_block(crypto::null_hash, {});
+    add_block(genesis, {});
+
+    m_publisher->pub_socket.reset(new zmq::socket_t(m_publisher->context, ZMQ_XPUB));
+    m_publisher->pub_socket->setsockopt(ZMQ_LINGER, 0);
+    m_publisher->pub_socket->bind("inproc://zmq-pub-test");
+    m_publisher->running = true;
+    m_publisher_thread = boost::thread(&publisher::run, m_publisher);
+
+    m_sub_socket.reset(new zmq::socket_t(m_publisher->context, ZMQ_SUB));
+    m_sub_socket->setsockopt(ZMQ_RCVTIMEO, 5000);
+    m_sub_socket->setsockopt(ZMQ_LINGER, 0);
+    m_sub_socket->connect("inproc://zmq-pub-test");
+    m_sub_socket->setsockopt(ZMQ_SUBSCRIBE, "block", 5);
+  }
+
+  virtual void TearDown()
+  {
+    m_sub_socket.reset();
+    {
+      boost::lock_guard<boost::mutex> guard(m_publisher->lock);
+      m_publisher->running = false;
+    }
+    m_publisher->queue_changed.notify_all();
+    m_publisher_thread.join();
+    m_publisher->pub_socket.reset();
+    m_db.close();
+    boost::filesystem::remove_all(m_path);
+  }
+
+  cryptonote::block make_block(const crypto::hash &prev_id, const std::vector<cryptonote::transaction> &txs)
+  {
+    cryptonote::account_base miner;
+    miner.generate();
+    cryptonote::block b;
+    b.major_version = 1;
+    b.minor_version = 0;
+    b.timestamp = 0;
+    b.nonce = 0;
+    b.prev_id = prev_id;
+    cryptonote::construct_miner_tx(m_db.height(), 0, 0, 0, 0, miner.get_keys().m_account_address, b.miner_tx);
+    for (const cryptonote::transaction &tx: txs)
+      b.tx_hashes.push_back(cryptonote::get_transaction_hash(tx));
+    return b;
+  }
+
+  void add_block(const cryptonote::block &b, const std::vector<cryptonote::transaction> &txs)
+  {
+    m_db.add_block(b, 0, cryptonote::difficulty_type(1), 0, txs);
+  }
+
+  // a transaction with one input and one output, which the database does not check
+  cryptonote::transaction make_tx()
+  {
+    cryptonote::transaction tx;
+    tx.version = 1;
+    tx.unlock_time = 0;
+    cryptonote::txin_to_key in;
+    in.amount = 1000;
+    in.key_offsets.push_back(0);
+    in.k_image = rct::rct2ki(rct::pkGen());
+    tx.vin.push_back(in);
+    cryptonote::tx_out out;
+    out.amount = 1000;
+    out.target = cryptonote::txout_to_key(rct::rct2pk(rct::pkGen()));
+    tx.vout.push_back(out);
+    cryptonote::add_tx_pub_key_to_extra(tx, rct::rct2pk(rct::pkGen()));
+    tx.signatures.resize(1);
+    tx.signatures[0].resize(1);
+    return tx;
+  }
+
+  bool wait_for_subscription()
+  {
+    for (int i = 0; i < 50; ++i)
+    {
+      if (m_publisher->wants("block"))
+        return true;
+      boost::this_thread::sleep_for(boost::chrono::milliseconds(100));
+    }
+    return false;
+  }
+
+  void block_added(uint64_t height, const crypto::hash &id, const cryptonote::block &b)
+  {
+    m_publisher->block_added(m_db, height, id, b);
+  }
+
+  bool receive(std::string &topic, std::string &payload)
+  {
+    zmq::message_t message;
+    if (!m_sub_socket->recv(&message))
+      return false;
+    topic.assign(static_cast<const char*>(message.data()), message.size());
+    if (!message.more() || !m_sub_socket->recv(&message))
+      return false;
+    payload.assign(static_cast<const char*>(message.data()), message.size());
+    return true;
+  }
+
+  std::string m_path;
+  cryptonote::BlockchainLMDB m_db;
+  cryptonote::HardFork m_hardfork;
+  std::shared_ptr<publisher> m_publisher;
+  boost::thread m_publisher_thread;
+  std::unique_ptr<zmq::socket_t> m_sub_socket;
+};
+
+TEST_F(zmq_pub_test, block_added_in_batch)
+{
+  ASSERT_TRUE(wait_for_subscription());
+
+  const cryptonote::transaction tx = make_tx();
+  const cryptonote::block b = make_block(m_db.top_block_hash(), {tx});
+  const crypto::hash id = cryptonote::get_block_hash(b);
+
+  ASSERT_TRUE(m_db.batch_start());
+  add_block(b, {tx});
+
+  // other threads, like the publisher's, do not see the block before the batch is committed
+  bool seen = true;
+  boost::thread([this, &id, &seen]() { seen = m_db.block_exists(id); }).join();
+  ASSERT_FALSE(seen);
+
+  block_added(1, id, b);
+
+  std::string topic, payload;
+  ASSERT_TRUE(receive(topic, payload));
+  m_db.batch_stop();
+
+  ASSERT_EQ(topic, "block");
+  ZmqPublisher::block_notification n;
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(n, payload));
+  ASSERT_EQ(n.height, 1);
+  ASSERT_EQ(n.hash, id);
+  ASSERT_EQ(n.block.block, cryptonote::block_to_blob(b));
+  ASSERT_EQ(n.block.txs.size(), 1);
+  ASSERT_EQ(n.block.txs.front(), cryptonote::tx_to_blob(tx));
+  ASSERT_EQ(n.output_indices.indices.size(), 2);
+  ASSERT_EQ(n.output_indices.indices[0].indices.size(), b.miner_tx.vout.size());
+  ASSERT_EQ(n.output_indices.indices[1].indices, std::vector<uint64_t>(1, 0));
+}
@@ -0,0 +1,146 @@
+// Copyright (c) 2018, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include "gtest/gtest.h"
+
+#include "rpc/zmq_server.h"
+
+namespace
+{
+  // echoes requests, holding "slow" ones until released
+  class test_handler: public cryptonote::rpc::RpcHandler
+  {
+  public:
+    test_handler(): slow_started(false), slow_released(false) {}
+
+    std::string handle(const std::string& request)
+    {
+      if (request == "slow")
+      {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        slow_started = true;
+        cond.notify_all();
+        while (!slow_released)
+          cond.wait(lock);
+      }
+      return request;
+    }
+
+    bool wait_slow_started()
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      const boost::posix_time::ptime deadline = boost::posix_time::microsec_clock::universal_time() + boost::posix_time::seconds(5);
+      while (!slow_started)
+        if (!cond.timed_wait(lock, deadline))
+          return slow_started;
+      return true;
+    }
+
+    void release_slow()
+    {
+      boost::unique_lock<boost::mutex> lock(mutex);
+      slow_released = true;
+      cond.notify_all();
+    }
+
+  private:
+    boost::mutex mutex;
+    boost::condition_variable cond;
+    bool slow_started;
+    bool slow_released;
+  };
+
+  std::string to_string(const zmq::message_t& message)
+  {
+    return std::string(static_cast<const char*>(message.data()), message.size());
+  }
+}
+
+class zmq_server_test: public ::testing::Test
+{
+protected:
+  zmq_server_test(): server(handler, 2), context(1) {}
+
+  ~zmq_server_test()
+  {
+    handler.release_slow();
+    server.stop();
+  }
+
+  //! the address the server's client socket ended up bound to
+  std::string endpoint()
+  {
+    char address[256];
+    size_t size = sizeof(address);
+    server.router_socket->getsockopt(ZMQ_LAST_ENDPOINT, address, &size);
+    return address;
+  }
+
+  std::unique_ptr<zmq::socket_t> connect()
+  {
+    std::unique_ptr<zmq::socket_t> socket(new zmq::socket_t(context, ZMQ_REQ));
+    socket->setsockopt(ZMQ_RCVTIMEO, 5000);
+    socket->setsockopt(ZMQ_LINGER, 0);
+    socket->connect(endpoint().c_str());
+    return socket;
+  }
+
+  test_handler handler;
+  cryptonote::rpc::ZmqServer server;
+  zmq::context_t context;
+};
+
+TEST_F(zmq_server_test, cheap_request_not_queued_behind_slow_one)
+{
+  ASSERT_TRUE(server.addTCPSocket("127.0.0.1", "*"));
+  server.run();
+
+  std::unique_ptr<zmq::socket_t> slow_client = connect();
+  std::unique_ptr<zmq::socket_t> fast_client = connect();
+
+  slow_client->send("slow", 4);
+  ASSERT_TRUE(handler.wait_slow_started());
+
+  // with two workers, handing requests out in turn would give every
+  // other one to the worker busy with the slow request
+  for (int n = 0; n < 4; ++n)
+  {
+    fast_client->send("fast", 4);
+    zmq::message_t reply;
+    ASSERT_TRUE(fast_client->recv(&reply));
+    ASSERT_EQ("fast", to_string(reply));
+  }
+
+  zmq::message_t reply;
+  ASSERT_FALSE(slow_client->recv(&reply, ZMQ_DONTWAIT));
+  handler.release_slow();
+  ASSERT_TRUE(slow_client->recv(&reply));
+  ASSERT_EQ("slow", to_string(reply));
+}